@@ -0,0 +1,290 @@
+// STD
+#include <chrono>
+#include <memory>
+#include <string>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+// posix
+#include <unistd.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// laar
+#include <src/ssd/macros.hpp>
+#include <src/ssd/core/server.hpp>
+#include <src/ssd/core/message.hpp>
+
+// protos
+#include <protos/holder.pb.h>
+
+// boost
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+
+// abseil
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/strings/str_format.h>
+
+// Round trip latency of client requests over tcp loopback and unix socket.
+// "raw" modes have reflector thread send every request batch back, so they are
+// kernel transport cost only. "server" modes are answered by in-process laar::Server,
+// so acceptors and session read/write path are included, sound handling is not.
+// usage: latency-bench [--runtime_dir=dir] [--port=port] [iterations] [payload bytes]
+
+ABSL_FLAG(std::optional<std::string>, runtime_dir, std::nullopt,
+    "directory for socket of in-process server, temporary one if not set");
+ABSL_FLAG(std::uint32_t, port, laar::Port + 1,
+    "tcp port of in-process server, default one is kept free for running daemon");
+
+namespace {
+
+    struct Endpoint {
+        sockaddr_storage addr;
+        socklen_t size;
+    };
+
+    [[noreturn]] void fail(const char* what) {
+        std::cerr << what << ": " << std::strerror(errno) << "\n";
+        std::exit(1);
+    }
+
+    bool readAll(int fd, std::uint8_t* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t got = read(fd, data, size);
+            if (got <= 0) {
+                return false;
+            }
+            data += got;
+            size -= got;
+        }
+        return true;
+    }
+
+    bool writeAll(int fd, const std::uint8_t* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t sent = write(fd, data, size);
+            if (sent <= 0) {
+                return false;
+            }
+            data += sent;
+            size -= sent;
+        }
+        return true;
+    }
+
+    void setNoDelay(int fd, const Endpoint& endpoint) {
+        if (endpoint.addr.ss_family == AF_INET) {
+            int enable = 1;
+            if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)) < 0) {
+                fail("setsockopt");
+            }
+        }
+    }
+
+    // listening socket, tcp one is bound to ephemeral port, so running server is not in the way
+    int listenOn(Endpoint& endpoint) {
+        int fd = socket(endpoint.addr.ss_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            fail("socket");
+        }
+        if (bind(fd, reinterpret_cast<sockaddr*>(&endpoint.addr), endpoint.size) < 0) {
+            fail("bind");
+        }
+        if (getsockname(fd, reinterpret_cast<sockaddr*>(&endpoint.addr), &endpoint.size) < 0) {
+            fail("getsockname");
+        }
+        if (listen(fd, 1) < 0) {
+            fail("listen");
+        }
+        return fd;
+    }
+
+    void reflect(int listener, Endpoint endpoint) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            fail("accept");
+        }
+        setNoDelay(fd, endpoint);
+
+        std::vector<std::uint8_t> buffer(laar::NetworkBufferSize);
+        while (true) {
+            ssize_t got = read(fd, buffer.data(), buffer.size());
+            if (got <= 0 || !writeAll(fd, buffer.data(), got)) {
+                break;
+            }
+        }
+        close(fd);
+    }
+
+    // request batch as client sends it: context connect followed by trail,
+    // client name carries payload so batch size is what was asked for
+    std::vector<std::uint8_t> makeBatch(std::size_t bytes) {
+        auto factory = laar::MessageFactory::configure();
+
+        NSound::THolder holder;
+        holder.mutable_client()->mutable_context_message()->mutable_connect()->set_name(std::string(bytes, 'x'));
+
+        laar::Message connect = factory->withType(laar::message::type::PROTOBUF).withPayload(std::move(holder)).construct().constructed();
+        laar::Message trail = factory->withType(laar::message::type::SIMPLE).withPayload(laar::TRAIL).construct().constructed();
+
+        std::size_t connectSize = laar::Message::Size::total(&connect);
+        std::size_t trailSize = laar::Message::Size::total(&trail);
+        std::vector<std::uint8_t> batch(connectSize + trailSize);
+        connect.writeToArray(batch.data(), connectSize);
+        trail.writeToArray(batch.data() + connectSize, trailSize);
+        return batch;
+    }
+
+    // server answers connect with ack, followed by its own trail
+    std::size_t answerSize() {
+        auto factory = laar::MessageFactory::configure();
+        laar::Message ack = factory->withType(laar::message::type::SIMPLE).withPayload(laar::ACK).construct().constructed();
+        laar::Message trail = factory->withType(laar::message::type::SIMPLE).withPayload(laar::TRAIL).construct().constructed();
+        return laar::Message::Size::total(&ack) + laar::Message::Size::total(&trail);
+    }
+
+    int connectTo(const Endpoint& endpoint) {
+        int fd = socket(endpoint.addr.ss_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            fail("socket");
+        }
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&endpoint.addr), endpoint.size) < 0) {
+            fail("connect");
+        }
+        setNoDelay(fd, endpoint);
+        return fd;
+    }
+
+    void measure(const char* name, int fd, std::size_t iterations, const std::vector<std::uint8_t>& batch, std::size_t answer) {
+        std::vector<std::uint8_t> response(answer);
+        std::vector<std::chrono::nanoseconds> samples;
+        samples.reserve(iterations);
+        // first round trips warm up caches and socket buffers
+        std::size_t warmup = std::min<std::size_t>(iterations / 10, 1000);
+        for (std::size_t i = 0; i < iterations + warmup; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            if (!writeAll(fd, batch.data(), batch.size()) || !readAll(fd, response.data(), response.size())) {
+                fail("round trip");
+            }
+            if (i >= warmup) {
+                samples.push_back(std::chrono::steady_clock::now() - start);
+            }
+        }
+
+        std::sort(samples.begin(), samples.end());
+        std::chrono::nanoseconds total{0};
+        for (auto sample : samples) {
+            total += sample;
+        }
+        auto percentile = [&samples](double p) {
+            return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))].count() / 1000.0;
+        };
+        std::cout << absl::StrFormat("%-12s mean %8.2f us, p50 %8.2f us, p99 %8.2f us, max %8.2f us\n", name,
+            total.count() / 1000.0 / samples.size(), percentile(0.5), percentile(0.99), samples.back().count() / 1000.0);
+    }
+
+    void runReflected(const char* name, Endpoint endpoint, std::size_t iterations, const std::vector<std::uint8_t>& batch) {
+        int listener = listenOn(endpoint);
+        std::thread reflector(reflect, listener, endpoint);
+
+        int fd = connectTo(endpoint);
+        measure(name, fd, iterations, batch, batch.size());
+
+        close(fd);
+        reflector.join();
+        close(listener);
+    }
+
+    void runServed(const char* name, const Endpoint& endpoint, std::size_t iterations, const std::vector<std::uint8_t>& batch) {
+        int fd = connectTo(endpoint);
+        measure(name, fd, iterations, batch, answerSize());
+        close(fd);
+    }
+
+    Endpoint loopback(std::uint16_t port) {
+        Endpoint tcp;
+        std::memset(&tcp.addr, 0, sizeof(tcp.addr));
+        auto inet = reinterpret_cast<sockaddr_in*>(&tcp.addr);
+        inet->sin_family = AF_INET;
+        inet->sin_port = htons(port);
+        inet->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        tcp.size = sizeof(sockaddr_in);
+        return tcp;
+    }
+
+    Endpoint socketAt(const std::filesystem::path& path) {
+        Endpoint local;
+        std::memset(&local.addr, 0, sizeof(local.addr));
+        auto address = reinterpret_cast<sockaddr_un*>(&local.addr);
+        address->sun_family = AF_UNIX;
+        std::strncpy(address->sun_path, path.c_str(), sizeof(address->sun_path) - 1);
+        local.size = sizeof(sockaddr_un);
+        return local;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<char*> args = absl::ParseCommandLine(argc, argv);
+    std::size_t iterations = (args.size() > 1) ? std::strtoul(args[1], nullptr, 10) : 10000;
+    std::size_t bytes = (args.size() > 2) ? std::strtoul(args[2], nullptr, 10) : 1024;
+    if (iterations == 0 || bytes + 64 > static_cast<std::size_t>(laar::MaxBytesOnMessage)) {
+        std::cerr << "usage: latency-bench [--runtime_dir=dir] [--port=port] [iterations] [payload bytes], "
+            << "payload has to fit " << laar::MaxBytesOnMessage << " bytes message\n";
+        return 1;
+    }
+
+    std::filesystem::path runtime;
+    bool isTemporary = false;
+    if (std::optional<std::string> flag = absl::GetFlag(FLAGS_runtime_dir); flag.has_value()) {
+        runtime = flag.value();
+    } else {
+        runtime = std::filesystem::temp_directory_path() / absl::StrFormat("laar-bench-%d", getpid());
+        std::filesystem::create_directories(runtime);
+        isTemporary = true;
+    }
+    std::uint32_t port = absl::GetFlag(FLAGS_port);
+
+    auto batch = makeBatch(bytes);
+    std::cout << absl::StrFormat("%d round trips of %d bytes batch\n", iterations, batch.size());
+
+    runReflected("raw tcp", loopback(0), iterations, batch);
+    runReflected("raw unix", socketAt(runtime / "reflector.sock"), iterations, batch);
+    std::filesystem::remove(runtime / "reflector.sock");
+
+    // sessions never open streams, so server runs without sound handler
+    auto context = std::make_shared<boost::asio::io_context>();
+    auto server = laar::Server::create(std::weak_ptr<laar::IStreamHandler>(), context, port, (runtime / laar::SocketName).string());
+    server->init();
+    auto guard = boost::asio::make_work_guard(*context);
+    std::thread io([context]() {
+        context->run();
+    });
+
+    runServed("server tcp", loopback(port), iterations, batch);
+    runServed("server unix", socketAt(runtime / laar::SocketName), iterations, batch);
+
+    guard.reset();
+    context->stop();
+    io.join();
+
+    std::filesystem::remove(runtime / laar::SocketName);
+    if (isTemporary) {
+        std::filesystem::remove_all(runtime);
+    }
+
+    return 0;
+}
@@ -4,6 +4,9 @@
 #include "pulse/stream.h"
 #include <cstdint>
 #include <memory>
+#include <deque>
+#include <string>
+#include <unordered_map>
 
 // pulse
 #include <pulse/def.h>
@@ -23,6 +26,7 @@
 // laar
 #include <src/ssd/macros.hpp>
 #include <src/ssd/core/message.hpp>
+#include <src/ssd/core/message-arena.hpp>
 #include <src/pcm/mapped-pulse/trace/trace.hpp>
 
 // protos
@@ -30,12 +34,8 @@
 
 namespace laar {
 
-    // robust - 2 secs of playback, so
-    // 44000 * 2 / 1000 = 88 calls
-    // 1 / 88 => every 10 ms 1000 samples
-    // in reality this should be managed by server 
-    // via two-sided protocol, but this one works fine for now
-    inline constexpr std::size_t SamplesPerTimeFrame = 1000;
+    // pace of capture pulls in first protocol version and of credit polls
+    // while server buffer is full
     inline constexpr std::chrono::milliseconds TimeFrame (10);
 
     template<typename T>
@@ -54,6 +54,9 @@ struct pa_operation {
     pa_operation_state_t state;
     pa_operation_notify_cb_t cbNotify;
     void* userdata;
+
+    // answered over and over until dropped, see pa_context::subscriptions
+    bool persistent = false;
 };
 
 struct pa_stream {
@@ -64,6 +67,7 @@ struct pa_stream {
         laar::CallbackWrapper<pa_stream_notify_cb_t> state;
         laar::CallbackWrapper<pa_stream_notify_cb_t> start;
         laar::CallbackWrapper<pa_stream_success_cb_t> drain;
+        laar::CallbackWrapper<pa_stream_success_cb_t> bufferAttr;
     } callbacks;
 
     struct PulseAttributes {
@@ -83,6 +87,25 @@ struct pa_stream {
         bool directWrite;
     } buffer;
 
+    // playback credit granted by server: bytes it accepts without overrun,
+    // minus bytes pushed since the grant and not confirmed yet
+    struct Flow {
+        std::size_t credit;
+        std::deque<std::size_t> pushed;
+        std::size_t inFlight;
+        bool polling;
+    } flow;
+
+    // captured data as it came from server, peek hands out
+    // front chunk in place and drop releases it
+    struct Capture {
+        std::deque<std::string> chunks;
+        std::size_t readable;
+        bool pulling;
+        // duplex sessions pull once, server answers with every captured period
+        pa_operation* subscription;
+    } capture;
+
     struct Network {
         NSound::NCommon::TStreamConfiguration config;
         std::uint32_t id;
@@ -108,6 +131,10 @@ struct pa_context {
     };
 
     std::list<QueuedMessage> out;
+    // duplex requests sent and not answered yet, by sequence number
+    std::unordered_map<std::uint32_t, pa_operation*> pending;
+    // duplex requests server keeps answering, by sequence number
+    std::unordered_map<std::uint32_t, pa_operation*> subscriptions;
 
     struct Callbacks {
         laar::CallbackWrapper<pa_context_notify_cb_t> notify;
@@ -117,6 +144,8 @@ struct pa_context {
     struct NetworkState {
         // message handling
         std::shared_ptr<laar::MessageFactory> factory;
+        // responses of current batch, reset on trail
+        laar::MessageArena arena;
         
         int mode;
         std::size_t total;
@@ -127,6 +156,15 @@ struct pa_context {
         int fd;
         std::unique_ptr<std::uint8_t[]> buffer;
         std::size_t size; 
+
+        // duplex protocol: server agreed to it, requests are written from
+        // separate buffer while responses are read
+        bool upgrade;
+        bool duplex;
+        std::uint32_t sequence;
+        std::unique_ptr<std::uint8_t[]> outBuffer;
+        std::size_t queued;
+        std::size_t written;
     } network;
 
     struct State {
@@ -19,17 +19,29 @@
 
 #ifdef __linux__
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #endif
 
 // STD
 #include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <string>
+#include <vector>
 
 // abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/numbers.h>
+#include <absl/strings/match.h>
+#include <absl/strings/strip.h>
 #include <absl/strings/str_format.h>
 
 #define HANDLE_SOCKET_ERROR(errnum, context)                                        \
@@ -49,9 +61,78 @@ namespace {
     enum Mode {
         READ = 0x1, 
         WRITE = 0x2,
-        DRAINING = 0x4
+        DRAINING = 0x4,
+        // reads and writes run independently, see protocol.md
+        DUPLEX = 0x8
     };
 
+    struct ServerAddress {
+        sockaddr_storage addr;
+        socklen_t size;
+    };
+
+    // "unix:/path", "/path", "tcp:host[:port]" or "host[:port]";
+    // host is ipv4 address or localhost, port defaults to laar::Port
+    absl::StatusOr<ServerAddress> parseServer(absl::string_view server) {
+        ServerAddress address;
+        std::memset(&address.addr, 0, sizeof(address.addr));
+
+        if (absl::ConsumePrefix(&server, "unix:") || absl::StartsWith(server, "/")) {
+            auto local = reinterpret_cast<sockaddr_un*>(&address.addr);
+            if (server.empty() || server.size() >= sizeof(local->sun_path)) {
+                return absl::InvalidArgumentError(absl::StrFormat("bad socket path: %s", server));
+            }
+            local->sun_family = AF_UNIX;
+            std::memcpy(local->sun_path, server.data(), server.size());
+            address.size = sizeof(sockaddr_un);
+            return address;
+        }
+
+        absl::ConsumePrefix(&server, "tcp:");
+        std::string host(server);
+        int port = laar::Port;
+        if (auto colon = server.rfind(':'); colon != absl::string_view::npos) {
+            host = std::string(server.substr(0, colon));
+            if (!absl::SimpleAtoi(server.substr(colon + 1), &port) || port <= 0 || port > 0xFFFF) {
+                return absl::InvalidArgumentError(absl::StrFormat("bad port in server address: %s", server));
+            }
+        }
+        if (host == "localhost") {
+            host = "127.0.0.1";
+        }
+
+        auto inet = reinterpret_cast<sockaddr_in*>(&address.addr);
+        inet->sin_family = AF_INET;
+        inet->sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &inet->sin_addr) != 1) {
+            return absl::InvalidArgumentError(absl::StrFormat("server host is not ipv4 address: %s", host));
+        }
+        address.size = sizeof(sockaddr_in);
+        return address;
+    }
+
+    // blocking socket connected to server, -1 with errno set on failure
+    int openConnection(const ServerAddress& address) {
+        int fd = socket(address.addr.ss_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+
+        if (address.addr.ss_family == AF_INET) {
+            // requests and responses are small, nagle would hold them back
+            int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address.addr), address.size) < 0) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+        return fd;
+    }
+
     void logContextNetworkState(pa_context* c, const char* message) {
         pcm_log::log(absl::StrFormat("[context] %s; context: t = %d, c = %d, e = %d", message, c->network.total, c->network.current, c->network.expected), pcm_log::ELogVerbosity::INFO);
     }
@@ -64,6 +145,96 @@ namespace {
         }
     }
 
+    void respond(pa_context* c, laar::Message message) {
+        auto sequence = message.sequence();
+        if (sequence.has_value()) {
+            if (auto subscription = c->subscriptions.find(sequence.value()); subscription != c->subscriptions.end()) {
+                // stays subscribed, operation is released by its owner
+                subscription->second->cbSuccess(std::move(message), subscription->second->owner);
+                return;
+            }
+        }
+
+        auto iter = (sequence.has_value()) ? c->pending.find(sequence.value()) : c->pending.end();
+        if (iter == c->pending.end()) {
+            pcm_log::log("[context] response to unknown request, dropping it", pcm_log::ELogVerbosity::WARNING);
+            return;
+        }
+
+        pa_operation* op = iter->second;
+        c->pending.erase(iter);
+        op->cbSuccess(std::move(message), op->owner);
+        laar::updateOp(op, PA_OPERATION_DONE);
+        pa_operation_unref(op);
+    }
+
+    void iterateDuplex(pa_context* c, int fd, pa_io_event_flags flags) {
+        if (flags & PA_IO_EVENT_OUTPUT) {
+            // next chunk is packed once previous one is gone; requests queued before
+            // drain are still sent, so their operations complete
+            if (c->network.written == c->network.queued) {
+                c->network.written = c->network.queued = 0;
+                while (!c->out.empty()) {
+                    auto& queued = c->out.front();
+                    queued.message.setSequence(c->network.sequence);
+                    if (c->network.queued + laar::Message::Size::total(&queued.message) > c->network.size) {
+                        break;
+                    }
+                    queued.message.writeToArray(c->network.outBuffer.get() + c->network.queued, c->network.size - c->network.queued);
+                    c->network.queued += laar::Message::Size::total(&queued.message);
+                    if (queued.op->persistent) {
+                        c->subscriptions.emplace(c->network.sequence++, queued.op);
+                    } else {
+                        c->pending.emplace(c->network.sequence++, queued.op);
+                    }
+                    laar::updateOp(queued.op, PA_OPERATION_RUNNING);
+                    c->out.pop_front();
+                }
+            }
+
+            while (c->network.written < c->network.queued) {
+                if (int written = write(fd, c->network.outBuffer.get() + c->network.written, c->network.queued - c->network.written); written >= 0) {
+                    c->network.written += written;
+                } else if (errno == EAGAIN) {
+                    break;
+                } else {
+                    pcm_log::log(strerror(errno), pcm_log::ELogVerbosity::ERROR);
+                    changeContextState(c, PA_CONTEXT_FAILED);
+                    return;
+                }
+            }
+        }
+
+        if (flags & PA_IO_EVENT_INPUT) {
+            // every part of message is read to buffer start, responses are handled
+            // right after they are parsed, so views into buffer do not outlive it
+            while (true) {
+                std::size_t wanted = c->network.factory->next();
+                int acquired = read(fd, c->network.buffer.get() + c->network.current, wanted - c->network.current);
+                if (acquired == 0) {
+                    pcm_log::log("[context] server closed connection", pcm_log::ELogVerbosity::ERROR);
+                    changeContextState(c, PA_CONTEXT_FAILED);
+                    return;
+                } else if (acquired < 0) {
+                    HANDLE_SOCKET_ERROR(errno, c);
+                }
+
+                c->network.current += acquired;
+                if (c->network.current < wanted) {
+                    continue;
+                }
+
+                c->network.current = 0;
+                std::size_t bytes = c->network.size;
+                c->network.factory->parse(c->network.buffer.get(), bytes);
+                if (c->network.factory->isParsedAvailable()) {
+                    respond(c, c->network.factory->parsed());
+                    c->network.arena.reset();
+                }
+            }
+        }
+    }
+
     void iterate(pa_mainloop_api* a, pa_io_event* e, int fd, pa_io_event_flags flags, void* userdata) {
         pa_context* c = reinterpret_cast<pa_context*>(userdata);
 
@@ -85,6 +256,16 @@ namespace {
             return;
         }
 
+        if (c->network.mode & DUPLEX) {
+            if (c->network.mode & DRAINING && c->out.empty() && c->pending.empty() && c->network.written == c->network.queued) {
+                // everything queued is sent and answered, drain completes on next iteration
+                c->network.mode = DRAINING;
+                return;
+            }
+            iterateDuplex(c, fd, flags);
+            return;
+        }
+
         if (flags & PA_IO_EVENT_OUTPUT && c->network.mode & WRITE) {
             if (!c->network.total) {
                 for (auto iter = c->out.begin(); iter != c->out.end(); ++iter, ++c->network.expected) {
@@ -158,9 +339,20 @@ namespace {
                             return;
                         }
                         c->network.current = c->network.total = 0;
+                        // responses were handled, buffer and arena are free for next batch
+                        c->network.arena.reset();
 
                         // draining should be the only state for check to unfold
                         c->network.mode = ((c->network.mode & DRAINING) ? DRAINING : WRITE);
+                        if (c->network.upgrade && !(c->network.mode & DRAINING)) {
+                            // server answered handshake with duplex version
+                            pcm_log::log("[context] switching to duplex protocol", pcm_log::ELogVerbosity::INFO);
+                            c->network.upgrade = false;
+                            c->network.duplex = true;
+                            c->network.mode = DUPLEX;
+                            c->network.outBuffer = std::make_unique<std::uint8_t[]>(c->network.size);
+                            c->network.factory->withSequencing(true);
+                        }
                         break;
                     }
 
@@ -190,12 +382,18 @@ namespace {
         });
     }
 
-    int failContextWithSyscall(pa_context* c) {
-        pcm_log::log(strerror(errno), pcm_log::ELogVerbosity::ERROR);
+    // context keeps positive code, caller gets negative one, as with pulse
+    int failContext(pa_context* c, int error) {
+        c->state.error = error;
         changeContextState(c, PA_CONTEXT_FAILED);
         pa_context_unref(c);
 
-        return PA_ERR_PROTOCOL;
+        return -error;
+    }
+
+    int failContextWithSyscall(pa_context* c) {
+        pcm_log::log(strerror(errno), pcm_log::ELogVerbosity::ERROR);
+        return failContext(c, PA_ERR_PROTOCOL);
     }
 
     void contextNameConfirmed(laar::Message message, void* owner) {
@@ -203,6 +401,8 @@ namespace {
         ENSURE_FAIL_UNLESS(message.type() == laar::message::type::SIMPLE);
         std::uint32_t simple = laar::messagePayload<laar::message::type::SIMPLE>(message);
         if (simple == laar::ACK) {
+            // servers that do not know duplex protocol answer with first version
+            context->network.upgrade = (message.version() == laar::message::version::DUPLEX);
             changeContextState(context, PA_CONTEXT_READY);
         } else {
             changeContextState(context, PA_CONTEXT_FAILED);
@@ -235,15 +435,18 @@ pa_context *pa_context_new(pa_mainloop_api* m, const char* name) {
     context->network.size = laar::NetworkBufferSize;
     context->network.current = context->network.total = context->network.expected = 0;
     context->network.mode = WRITE;
-    context->network.factory->withMessageVersion(laar::message::version::FIRST);
+    context->network.upgrade = false;
+    context->network.duplex = false;
+    context->network.sequence = 0;
+    context->network.queued = context->network.written = 0;
+    // handshake is sent in first version layout, header announces duplex support
+    context->network.factory->withMessageVersion(laar::message::version::DUPLEX);
+    // responses are handled before buffer is reused, which happens on trail only
+    context->network.factory->withViews(true);
 
     context->events.iter = nullptr;
-
-    // open & configure socket
-    if ((context->network.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0) {
-        failContextWithSyscall(context);
-        return nullptr;
-    }
+    // socket family is known once server is picked on connect
+    context->network.fd = -1;
 
     return context;
 }
@@ -258,26 +461,38 @@ pa_context *pa_context_new_with_proplist(pa_mainloop_api* mainloop, const char*
 
 int pa_context_connect(pa_context *c, const char *server, pa_context_flags_t flags, const pa_spawn_api *api) {
     PCM_STUB();
-    UNUSED(server);
     UNUSED(flags);
     UNUSED(api);
 
-    // set blocking mode for configuration
-    if (int err = fcntl(c->network.fd, F_SETFL, fcntl(c->network.fd, F_GETFL, 0) & ~O_NONBLOCK); err < 0) {
-        return failContextWithSyscall(c);
-    }
-
-    sockaddr_in addr;
-    addr.sin_port = htons(laar::Port);
-    addr.sin_family = AF_INET;
-    
-    if (inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr) < 0) {
-        return failContextWithSyscall(c);
+    // explicit server is used as is, otherwise unix socket of local server
+    // is preferred over tcp loopback
+    std::vector<ServerAddress> candidates;
+    if (server) {
+        auto address = parseServer(server);
+        if (!address.ok()) {
+            pcm_log::log(std::string(address.status().message()), pcm_log::ELogVerbosity::ERROR);
+            return failContext(c, PA_ERR_INVALIDSERVER);
+        }
+        candidates.push_back(address.value());
+    } else {
+        if (const char* runtime = std::getenv("LAAR_RUNTIME_DIR"); runtime) {
+            if (auto local = parseServer(absl::StrCat("unix:", runtime, "/", laar::SocketName)); local.ok()) {
+                candidates.push_back(local.value());
+            }
+        }
+        candidates.push_back(parseServer(absl::StrCat("127.0.0.1:", laar::Port)).value());
     }
 
     changeContextState(c, PA_CONTEXT_CONNECTING);
-    if (connect(c->network.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
-        return failContextWithSyscall(c);;
+    // socket stays blocking for configuration
+    for (std::size_t index = 0; index < candidates.size() && c->network.fd < 0; ++index) {
+        if (index > 0) {
+            pcm_log::log("[context] local server socket is unavailable, falling back to tcp", pcm_log::ELogVerbosity::WARNING);
+        }
+        c->network.fd = openConnection(candidates[index]);
+    }
+    if (c->network.fd < 0) {
+        return failContextWithSyscall(c);
     }
 
     changeContextState(c, PA_CONTEXT_AUTHORIZING);
@@ -314,8 +529,8 @@ void pa_context_unref(pa_context* c) {
     
     c->state.refs -= 1;
     if (c->state.refs <= 0) {
-        // don't forget to cleanup fd
-        if (close(c->network.fd) < 0) {
+        // don't forget to cleanup fd, if context got to connect
+        if (c->network.fd >= 0 && close(c->network.fd) < 0) {
             pcm_log::log(strerror(errno), pcm_log::ELogVerbosity::ERROR);
             changeContextState(c, PA_CONTEXT_FAILED);
         } else if (!(c->state.state & PA_CONTEXT_FAILED)) {
@@ -325,6 +540,10 @@ void pa_context_unref(pa_context* c) {
         if (c->events.iter) {
             c->state.api->io_free(c->events.iter);
         }
+
+        laar::MessageArena::Stats stats = c->network.arena.collectStats();
+        pcm_log::log(absl::StrFormat("[context] message arena: %d messages in %d batches, %d bytes used, peak %d bytes, %d batches spilled to heap",
+            stats.messages, stats.batches, stats.bytesUsed, stats.peakBytes, stats.spills), pcm_log::ELogVerbosity::INFO);
         std::destroy_at(c);
         pa_xfree(c);
     }
@@ -403,6 +622,9 @@ int pa_context_is_pending(const pa_context *c) {
 
     // TODO: this is very dependant on implementation,
     // should probably pick a more generic approach in the future
+    if (c->network.mode & DUPLEX) {
+        return !c->pending.empty() || !c->out.empty();
+    }
     return c->network.expected > 0;
 }
 
@@ -16,9 +16,14 @@
 #include <absl/strings/str_format.h>
 
 // STD
+#include <span>
+#include <chrono>
 #include <memory>
+#include <string>
 #include <cstddef>
+#include <optional>
 #include <cstdint>
+#include <algorithm>
 
 // laar
 #include <src/ssd/macros.hpp>
@@ -35,11 +40,66 @@
 
 namespace {
 
+    using TChannelMap = NSound::NCommon::TStreamConfiguration::TChannelMap;
+
+    void toMapValue(pa_channel_position_t position, std::size_t channel, TChannelMap::TMapValue* value) {
+        switch (position) {
+            case PA_CHANNEL_POSITION_MONO:
+                return value->set_position(TChannelMap::MONO);
+            case PA_CHANNEL_POSITION_FRONT_LEFT:
+                return value->set_position(TChannelMap::LEFT);
+            case PA_CHANNEL_POSITION_FRONT_RIGHT:
+                return value->set_position(TChannelMap::RIGHT);
+            case PA_CHANNEL_POSITION_FRONT_CENTER:
+                return value->set_position(TChannelMap::CENTER);
+            case PA_CHANNEL_POSITION_REAR_LEFT:
+                return value->set_position(TChannelMap::REAR_LEFT);
+            case PA_CHANNEL_POSITION_REAR_RIGHT:
+                return value->set_position(TChannelMap::REAR_RIGHT);
+            case PA_CHANNEL_POSITION_REAR_CENTER:
+                return value->set_position(TChannelMap::REAR_CENTER);
+            case PA_CHANNEL_POSITION_LFE:
+                return value->set_position(TChannelMap::LFE);
+            case PA_CHANNEL_POSITION_SIDE_LEFT:
+                return value->set_position(TChannelMap::SIDE_LEFT);
+            case PA_CHANNEL_POSITION_SIDE_RIGHT:
+                return value->set_position(TChannelMap::SIDE_RIGHT);
+            default:
+                break;
+        }
+
+        if (position >= PA_CHANNEL_POSITION_AUX0 && position <= PA_CHANNEL_POSITION_AUX31) {
+            return value->set_aux(position - PA_CHANNEL_POSITION_AUX0);
+        }
+
+        // server has no such speaker, channel goes to device output with the same index
+        pcm_log::log(absl::StrFormat("[stream] unsupported channel position: %d, sending as aux", position), pcm_log::ELogVerbosity::WARNING);
+        value->set_aux(channel);
+    }
+
+    // server stops answering subscription once stream is closed, client forgets it
+    void dropSubscription(pa_stream* s) {
+        pa_operation* o = s->capture.subscription;
+        if (!o) {
+            return;
+        }
+        s->capture.subscription = nullptr;
+
+        pa_context* c = s->state.context;
+        std::erase_if(c->subscriptions, [o](const auto& subscription) { return subscription.second == o; });
+        std::erase_if(c->out, [o](const pa_context::QueuedMessage& queued) { return queued.op == o; });
+        pa_operation_unref(o);
+    }
+
     void changeStreamState(pa_stream* s, pa_stream_state_t newState) {
         if (s->state.state == PA_STREAM_FAILED) {
             return;
         }
 
+        if (newState == PA_STREAM_FAILED || newState == PA_STREAM_TERMINATED) {
+            dropSubscription(s);
+        }
+
         s->state.state = newState;
         if (s->callbacks.state.cb) {
             s->callbacks.state.cb(s, s->callbacks.state.userdata);
@@ -71,57 +131,319 @@ namespace {
         pa_stream_unref(s);
     }
 
+    // credit carried by response, none if server refused request
+    std::optional<std::uint64_t> readCredit(pa_stream* s, laar::Message& message) {
+        if (message.type() != laar::message::type::PROTOBUF) {
+            return std::nullopt;
+        }
+
+        // answers every push and poll, so holder goes to batch arena
+        const NSound::THolder* holder = s->state.context->network.arena.parse(message);
+        if (!holder || !holder->has_server() || !holder->server().stream_message().has_state_poll()) {
+            return std::nullopt;
+        }
+        return holder->server().stream_message().state_poll().writable();
+    }
+
+    // time for one min_request_size chunk to play, server has room for it by then
+    pa_usec_t creditPollInterval(const pa_stream* s) {
+        const auto& spec = s->network.config.sample_spec();
+        std::uint64_t frames = s->network.config.buffer_config().min_request_size() / std::max<std::uint32_t>(spec.channels(), 1);
+        if (!frames || !spec.sample_rate()) {
+            return std::chrono::microseconds(laar::TimeFrame).count();
+        }
+        return std::max<pa_usec_t>(frames * 1000000 / spec.sample_rate(), 1000);
+    }
+
+    void pollStream(pa_stream* s);
+
+    void queryCredit(pa_mainloop_api* a, pa_time_event* e, const struct timeval* tv, void* userdata) {
+        // tv might be dead by the time callback is invoked
+        UNUSED(tv);
+        pa_stream* s = reinterpret_cast<pa_stream*>(userdata);
+        a->time_free(e);
+
+        if (s->state.cork || s->state.state != PA_STREAM_READY) {
+            return;
+        }
+
+        // pushes made meanwhile bring credit on their own
+        if (!s->flow.polling && s->flow.pushed.empty()) {
+            pollStream(s);
+        }
+    }
+
+    void grantCredit(pa_stream* s, std::uint64_t writable) {
+        std::size_t granted = writable * laar::getSampleSize(s->network.config.sample_spec().format());
+        s->flow.credit = (granted > s->flow.inFlight) ? granted - s->flow.inFlight : 0;
+        s->buffer.avail = s->buffer.wPos + std::min(s->flow.credit, s->buffer.size - s->buffer.wPos);
+
+        // responses to later pushes are more recent, client is woken up by the last one
+        if (!s->flow.pushed.empty() || s->state.cork) {
+            return;
+        }
+
+        if (s->buffer.avail > s->buffer.wPos) {
+            if (s->callbacks.write.cb) {
+                s->callbacks.write.cb(s, s->buffer.avail - s->buffer.wPos, s->callbacks.write.userdata);
+            }
+        } else if (!s->flow.polling) {
+            // server buffer is full, no timer runs otherwise
+            pa_context_rttime_new(s->state.context, creditPollInterval(s), queryCredit, s);
+        }
+    }
+
     void confirmWrite(laar::Message message, void* userdata) {
         pa_stream* s = reinterpret_cast<pa_stream*>(userdata);
 
-        if (message.type() != laar::message::type::SIMPLE) {
-            pcm_log::log("[stream] getting message of wrong type! expecting SIMPLE", pcm_log::ELogVerbosity::ERROR);
+        // pushes are answered in order they were sent
+        if (!s->flow.pushed.empty()) {
+            s->flow.inFlight -= s->flow.pushed.front();
+            s->flow.pushed.pop_front();
+        }
+
+        std::optional<std::uint64_t> writable = readCredit(s, message);
+        if (!writable.has_value()) {
+            pcm_log::log("[stream] write was refused by server, expecting stream state", pcm_log::ELogVerbosity::ERROR);
             changeStreamState(s, PA_STREAM_FAILED);
+            drained(s);
+            return;
         }
 
-        if (auto code = laar::messagePayload<laar::message::type::SIMPLE>(message); code != laar::ACK) {
-            pcm_log::log(absl::StrFormat("[stream] getting wrong code, got %d, expected %d", code, laar::ACK), pcm_log::ELogVerbosity::ERROR);
+        drained(s);
+        grantCredit(s, writable.value());
+    }
+
+    void confirmPoll(laar::Message message, void* userdata) {
+        pa_stream* s = reinterpret_cast<pa_stream*>(userdata);
+        s->flow.polling = false;
+
+        std::optional<std::uint64_t> writable = readCredit(s, message);
+        if (!writable.has_value()) {
+            pcm_log::log("[stream] poll was refused by server", pcm_log::ELogVerbosity::ERROR);
             changeStreamState(s, PA_STREAM_FAILED);
+            drained(s);
+            return;
         }
-        
+
         drained(s);
+        grantCredit(s, writable.value());
     }
 
-    void cleanup(pa_mainloop_api* a, pa_stream* s, pa_time_event* e) {
-        changeStreamState(s, PA_STREAM_FAILED);
-        a->time_free(e);
+    void pollStream(pa_stream* s) {
+        NSound::THolder holder;
+        holder.mutable_client()->mutable_stream_message()->set_stream_id(s->network.id);
+        holder.mutable_client()->mutable_stream_message()->mutable_poll();
+
+        pa_operation* o = new pa_operation;
+        o->cbNotify = nullptr;
+        o->cbSuccess = confirmPoll;
+        o->owner = s;
+        o->refs = 0;
+        o->state = PA_OPERATION_RUNNING;
+        o->userdata = nullptr;
+
+        ++s->state.ops;
+        pa_operation_ref(o);
+
+        auto message = s->state.context->network.factory->withType(laar::message::type::PROTOBUF)
+            .withPayload(std::move(holder))
+            .construct()
+            .constructed();
+
+        s->state.context->out.push_back(pa_context::QueuedMessage{
+            .message = std::move(message),
+            .op = o
+        });
+        s->flow.polling = true;
+    }
+
+    // false if server refused request
+    bool takeCapture(pa_stream* s, laar::Message& message) {
+        if (message.type() != laar::message::type::PROTOBUF) {
+            return false;
+        }
+
+        // payload is kept as is, peek hands it out without copying
+        NSound::THolder holder = laar::messagePayload<laar::message::type::PROTOBUF>(message);
+        std::string* data = holder.mutable_server()->mutable_stream_message()->mutable_pull()->mutable_data();
+        if (s->capture.readable + data->size() > s->buffer.size) {
+            // client does not drop what it peeked, data is lost as on server side overrun
+            pcm_log::log(absl::StrFormat("[stream] capture overrun, %d bytes dropped", data->size()), pcm_log::ELogVerbosity::WARNING);
+        } else if (!data->empty()) {
+            s->capture.readable += data->size();
+            s->capture.chunks.push_back(std::move(*data));
+        }
+        return true;
+    }
+
+    void notifyReadable(pa_stream* s) {
+        // application is woken up only when there is something to read
+        if (!s->capture.chunks.empty() && s->callbacks.read.cb) {
+            s->callbacks.read.cb(s, s->capture.readable, s->callbacks.read.userdata);
+        }
+    }
+
+    void confirmPull(laar::Message message, void* userdata) {
+        pa_stream* s = reinterpret_cast<pa_stream*>(userdata);
+        s->capture.pulling = false;
+
+        if (!takeCapture(s, message)) {
+            pcm_log::log("[stream] pull was refused by server", pcm_log::ELogVerbosity::ERROR);
+            changeStreamState(s, PA_STREAM_FAILED);
+            drained(s);
+            return;
+        }
+
+        drained(s);
+        notifyReadable(s);
+    }
+
+    // subscription is not counted in stream operations, it lasts as long as stream does
+    void confirmCapture(laar::Message message, void* userdata) {
+        pa_stream* s = reinterpret_cast<pa_stream*>(userdata);
+
+        if (!takeCapture(s, message)) {
+            pcm_log::log("[stream] capture subscription was refused by server", pcm_log::ELogVerbosity::ERROR);
+            changeStreamState(s, PA_STREAM_FAILED);
+            return;
+        }
+
+        notifyReadable(s);
+    }
+
+    void subscribeCapture(pa_stream* s) {
+        std::size_t sampleSize = laar::getSampleSize(s->network.config.sample_spec().format());
+
+        NSound::THolder holder;
+        holder.mutable_client()->mutable_stream_message()->set_stream_id(s->network.id);
+        holder.mutable_client()->mutable_stream_message()->mutable_pull()->set_size(s->buffer.size / sampleSize);
+
+        pa_operation* o = new pa_operation;
+        o->cbNotify = nullptr;
+        o->cbSuccess = confirmCapture;
+        o->owner = s;
+        o->refs = 0;
+        o->state = PA_OPERATION_RUNNING;
+        o->userdata = nullptr;
+        o->persistent = true;
+
+        pa_operation_ref(o);
+
+        auto message = s->state.context->network.factory->withType(laar::message::type::PROTOBUF)
+            .withPayload(std::move(holder))
+            .construct()
+            .constructed();
+
+        s->state.context->out.push_back(pa_context::QueuedMessage{
+            .message = std::move(message),
+            .op = o
+        });
+        s->capture.subscription = o;
     }
 
-    void queryStream(pa_mainloop_api* a, pa_time_event* e, const struct timeval* tv, void* userdata) {
+    void pullStream(pa_stream* s, std::size_t bytes) {
+        std::size_t sampleSize = laar::getSampleSize(s->network.config.sample_spec().format());
+
+        NSound::THolder holder;
+        holder.mutable_client()->mutable_stream_message()->set_stream_id(s->network.id);
+        holder.mutable_client()->mutable_stream_message()->mutable_pull()->set_size(bytes / sampleSize);
+
+        pa_operation* o = new pa_operation;
+        o->cbNotify = nullptr;
+        o->cbSuccess = confirmPull;
+        o->owner = s;
+        o->refs = 0;
+        o->state = PA_OPERATION_RUNNING;
+        o->userdata = nullptr;
+
+        ++s->state.ops;
+        pa_operation_ref(o);
+
+        auto message = s->state.context->network.factory->withType(laar::message::type::PROTOBUF)
+            .withPayload(std::move(holder))
+            .construct()
+            .constructed();
+
+        s->state.context->out.push_back(pa_context::QueuedMessage{
+            .message = std::move(message),
+            .op = o
+        });
+        s->capture.pulling = true;
+    }
+
+    void queryCapture(pa_mainloop_api* a, pa_time_event* e, const struct timeval* tv, void* userdata) {
         // tv might be dead by the time callback is invoked
         UNUSED(tv);
         pa_stream* s = reinterpret_cast<pa_stream*>(userdata);
 
-        // only playback is supported
-        if (s->pulseAttributes.dir != PA_STREAM_PLAYBACK) {
+        if (s->state.cork || s->state.state != PA_STREAM_READY) {
             a->time_free(e);
             return;
         }
 
-        // cork is serving its purpose
-        if (s->state.cork) {
-            pcm_log::log("[stream] stream corked, missing cycle", pcm_log::ELogVerbosity::INFO);
+        // session switched to duplex protocol, server sends captured data on its own
+        if (s->state.context->network.duplex) {
             a->time_free(e);
+            subscribeCapture(s);
             return;
         }
 
-        s->buffer.avail += laar::SamplesPerTimeFrame * laar::getSampleSize(s->network.config.sample_spec().format());;
-        if (s->buffer.avail > s->buffer.size) {
-            pcm_log::log("[stream] avail reached the size of buffer, aborting stream", pcm_log::ELogVerbosity::ERROR);
-            cleanup(a, s, e);
-            return;
+        // one pull in flight at most, server batches whatever was captured meanwhile;
+        // client that does not drop what it peeked stops pulling and server side overruns
+        if (!s->capture.pulling && s->capture.readable < s->buffer.size) {
+            pullStream(s, s->buffer.size - s->capture.readable);
         }
 
-        if (s->callbacks.write.cb) {
-            s->callbacks.write.cb(s, s->buffer.avail - s->buffer.wPos, s->callbacks.write.userdata);
+        pa_context_rttime_restart(s->state.context, e, std::chrono::microseconds(laar::TimeFrame).count());
+    }
+
+    // pulse attributes in bytes from sizes server negotiated in samples
+    void updateBufferAttr(pa_stream* s) {
+        const auto& config = s->network.config.buffer_config();
+        std::uint32_t sampleSize = laar::getSampleSize(s->network.config.sample_spec().format());
+
+        pa_buffer_attr& attr = s->pulseAttributes.buffer;
+        attr.maxlength = config.size() * sampleSize;
+        attr.tlength = config.size() * sampleSize;
+        attr.prebuf = config.prebuffing_size() * sampleSize;
+        attr.minreq = config.min_request_size() * sampleSize;
+        attr.fragsize = config.fragment_size() * sampleSize;
+    }
+
+    void toBufferConfig(const pa_buffer_attr* attr, pa_stream_direction dir, std::size_t sampleSize, NSound::NCommon::TStreamConfiguration::TBufferConfiguration* config) {
+        // pulse counts bytes and marks defaults with -1, server counts samples
+        auto toSamples = [sampleSize](std::uint32_t bytes) -> std::uint32_t {
+            return (bytes == static_cast<std::uint32_t>(-1)) ? 0 : bytes / sampleSize;
+        };
+        config->set_prebuffing_size(toSamples(attr->prebuf));
+        config->set_fragment_size(toSamples(attr->fragsize));
+        config->set_min_request_size(toSamples(attr->minreq));
+        // capture streams have no target length, server buffer is bounded by maxlength
+        config->set_size(toSamples((dir == PA_STREAM_RECORD) ? attr->maxlength : attr->tlength));
+    }
+
+    void confirmBufferAttr(laar::Message message, void* userdata) {
+        pa_stream* s = reinterpret_cast<pa_stream*>(userdata);
+
+        bool success = false;
+        if (message.type() == laar::message::type::PROTOBUF) {
+            NSound::THolder holder = laar::messagePayload<laar::message::type::PROTOBUF>(message);
+            if (holder.has_server() && holder.server().stream_message().has_connect_confirmal()) {
+                s->network.config = std::move(*holder.mutable_server()->mutable_stream_message()->mutable_connect_confirmal()->mutable_configuration());
+                updateBufferAttr(s);
+                success = true;
+            }
+        }
+
+        if (!success) {
+            pcm_log::log("[stream] server refused buffer attributes", pcm_log::ELogVerbosity::WARNING);
+        }
+        if (s->callbacks.bufferAttr.cb) {
+            s->callbacks.bufferAttr.cb(s, success, s->callbacks.bufferAttr.userdata);
         }
 
-        pa_context_rttime_restart(s->state.context, e, laar::TimeFrame.count());
+        drained(s);
     }
 
     void confirmStreamOpen(laar::Message message, void* userdata) {
@@ -131,6 +453,7 @@ namespace {
 
         s->network.id = holder.server().stream_message().stream_id();
         s->network.config = std::move(*holder.mutable_server()->mutable_stream_message()->mutable_connect_confirmal()->mutable_configuration());
+        updateBufferAttr(s);
 
         if (holder.server().stream_message().connect_confirmal().opened()) {
             changeStreamState(s, PA_STREAM_READY);
@@ -144,8 +467,21 @@ namespace {
             s->callbacks.start.cb(s, s->callbacks.start.userdata);
         }
 
-        // set up timer event for data writing
-        pa_context_rttime_new(s->state.context, laar::TimeFrame.count() * 1000, queryStream, s);
+        if (s->state.state != PA_STREAM_READY) {
+            return;
+        }
+
+        // duplex server sends capture as it comes, first protocol version has it pulled
+        // on timer; playback waits for credit server grants
+        if (s->pulseAttributes.dir == PA_STREAM_RECORD) {
+            if (s->state.context->network.duplex || s->state.context->network.upgrade) {
+                subscribeCapture(s);
+            } else {
+                pa_context_rttime_new(s->state.context, std::chrono::microseconds(laar::TimeFrame).count(), queryCapture, s);
+            }
+        } else {
+            pollStream(s);
+        }
     }
 
     void openStream(pa_stream *s, pa_stream_direction dir, const char* name, const pa_buffer_attr* attr) {
@@ -166,14 +502,19 @@ namespace {
 
         if (auto ss = &s->pulseAttributes.spec) {
 
-            if (ss->rate == laar::BaseSampleRate) {
-                config.mutable_sample_spec()->set_sample_rate(laar::BaseSampleRate);
+            // server resamples to device rate
+            if (ss->rate >= static_cast<std::uint32_t>(laar::MinSampleRate) && ss->rate <= static_cast<std::uint32_t>(laar::MaxSampleRate)) {
+                config.mutable_sample_spec()->set_sample_rate(ss->rate);
             } else {
                 pcm_log::log(absl::StrFormat("[stream] unsupported rate: %d", ss->rate), pcm_log::ELogVerbosity::ERROR);
             }
 
             if (ss->format == PA_SAMPLE_U8) {
                 config.mutable_sample_spec()->set_format(NSound::NCommon::TStreamConfiguration::TSampleSpecification::UNSIGNED_8);
+            } else if (ss->format == PA_SAMPLE_ALAW) {
+                config.mutable_sample_spec()->set_format(NSound::NCommon::TStreamConfiguration::TSampleSpecification::UNSIGNED_8_ALAW);
+            } else if (ss->format == PA_SAMPLE_ULAW) {
+                config.mutable_sample_spec()->set_format(NSound::NCommon::TStreamConfiguration::TSampleSpecification::UNSIGNED_8_ULAW);
             } else if (ss->format == PA_SAMPLE_S16LE) {
                 config.mutable_sample_spec()->set_format(NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_16_LITTLE_ENDIAN);
             } else if (ss->format == PA_SAMPLE_S16BE) {
@@ -182,6 +523,10 @@ namespace {
                 config.mutable_sample_spec()->set_format(NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_24_LITTLE_ENDIAN);
             } else if (ss->format == PA_SAMPLE_S24BE) {
                 config.mutable_sample_spec()->set_format(NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_24_BIG_ENDIAN);
+            } else if (ss->format == PA_SAMPLE_S24_32LE) {
+                config.mutable_sample_spec()->set_format(NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_24_LSB_LITTLE_ENDIAN);
+            } else if (ss->format == PA_SAMPLE_S24_32BE) {
+                config.mutable_sample_spec()->set_format(NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_24_LSB_BIG_ENDIAN);
             } else if (ss->format == PA_SAMPLE_S32LE) {
                 config.mutable_sample_spec()->set_format(NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_32_LITTLE_ENDIAN);
             } else if (ss->format == PA_SAMPLE_S32BE) {
@@ -194,19 +539,26 @@ namespace {
                 pcm_log::log(absl::StrFormat("[stream] unsupported format: %d", ss->format), pcm_log::ELogVerbosity::ERROR);
             }
 
-            if (ss->channels == 1) {
+            if (ss->channels > 0 && ss->channels <= PA_CHANNELS_MAX) {
                 config.mutable_sample_spec()->set_channels(ss->channels);
             } else {
                 pcm_log::log(absl::StrFormat("[stream] unsupported channel number: %d", ss->channels), pcm_log::ELogVerbosity::ERROR);
             }
+
+            // server remixes stream to device layout, so it needs to know speaker positions
+            const pa_channel_map* map = &s->pulseAttributes.map;
+            if (map->channels == ss->channels) {
+                for (std::size_t channel = 0; channel < map->channels; ++channel) {
+                    toMapValue(map->map[channel], channel, config.mutable_channel_map()->add_mapped_channel());
+                }
+            } else {
+                pcm_log::log("[stream] channel map does not match sample spec, server default is used", pcm_log::ELogVerbosity::WARNING);
+            }
         }
 
         if (attr) {
             s->pulseAttributes.buffer = *attr;
-            config.mutable_buffer_config()->set_prebuffing_size(attr->prebuf);
-            config.mutable_buffer_config()->set_fragment_size(attr->fragsize);
-            config.mutable_buffer_config()->set_min_request_size(attr->minreq);
-            config.mutable_buffer_config()->set_size(attr->tlength);
+            toBufferConfig(attr, dir, laar::getSampleSize(config.sample_spec().format()), config.mutable_buffer_config());
         }
 
         NSound::NClient::TStreamMessage streamMessage;
@@ -256,6 +608,14 @@ pa_stream* pa_stream_new(pa_context *c, const char* name, const pa_sample_spec*
     s->buffer.size = laar::NetworkBufferSize;
     s->buffer.avail = s->buffer.rPos = s->buffer.wPos = 0;
     s->buffer.directWrite = false;
+
+    s->flow.credit = 0;
+    s->flow.inFlight = 0;
+    s->flow.polling = false;
+
+    s->capture.readable = 0;
+    s->capture.pulling = false;
+    s->capture.subscription = nullptr;
     
     s->callbacks.write.cb = nullptr;
     s->callbacks.write.userdata = nullptr;
@@ -267,6 +627,8 @@ pa_stream* pa_stream_new(pa_context *c, const char* name, const pa_sample_spec*
     s->callbacks.start.userdata = nullptr;
     s->callbacks.state.cb = nullptr;
     s->callbacks.state.userdata = nullptr;
+    s->callbacks.bufferAttr.cb = nullptr;
+    s->callbacks.bufferAttr.userdata = nullptr;
 
     s->state.context = c;
     s->state.state = PA_STREAM_UNCONNECTED;
@@ -314,6 +676,8 @@ void pa_stream_unref(pa_stream* s) {
 
     --s->state.refs;
     if (s->state.refs <= 0) {
+        // server answers for stream that was never closed are dropped by context
+        dropSubscription(s);
         std::destroy_at(s);
         pa_xfree(s);
     }
@@ -497,23 +861,23 @@ int pa_stream_write_ext_free(pa_stream* p, const void* data, size_t nbytes, pa_f
     }
 
     // prepare for tiling data
+    // tiles must not split frames, 24-bit ones do not divide tile size evenly
+    std::size_t sampleSize = laar::getSampleSize(p->network.config.sample_spec().format());
+    std::size_t frameSize = sampleSize * std::max<std::size_t>(p->network.config.sample_spec().channels(), 1);
     std::size_t tileSize = pa_context_get_tile_size(p->state.context, &p->pulseAttributes.spec);
-    auto temp = std::make_unique<std::uint8_t[]>(tileSize);
+    tileSize -= tileSize % frameSize;
+    std::size_t written = currWPos + nbytes;
 
-    for (; p->buffer.rPos < p->buffer.avail; p->buffer.rPos += tileSize) {
+    for (; p->buffer.rPos < written; p->buffer.rPos += tileSize) {
         pcm_log::log(absl::StrFormat("[stream] assembling tile, rpos: %d, wpos: %d, avail: %d", p->buffer.rPos, p->buffer.wPos, p->buffer.avail), pcm_log::ELogVerbosity::INFO);
-        std::size_t end = std::min(p->buffer.rPos + tileSize, p->buffer.avail);
-        std::memcpy(temp.get(), p->buffer.buffer.get() + p->buffer.rPos, end - p->buffer.rPos);
-
-        NSound::THolder holder;
-        NSound::NClient::TStreamMessage streamMessage;
-        streamMessage.set_stream_id(p->network.id);
-        streamMessage.mutable_push()->set_data(std::string{reinterpret_cast<char*>(temp.get()), tileSize});
-        streamMessage.mutable_push()->set_size(tileSize / laar::getSampleSize(p->network.config.sample_spec().format()));
-
-        *holder.mutable_client()->mutable_stream_message() = std::move(streamMessage);
-        auto msg = p->state.context->network.factory->withType(laar::message::type::PROTOBUF)
-            .withPayload(std::move(holder))
+        std::size_t tile = std::min(tileSize, written - p->buffer.rPos);
+
+        // samples travel raw, server hands them to its handle without parsing
+        auto frames = laar::FramesPayload::copy(
+            p->network.id, tile / sampleSize, std::span<const char>(reinterpret_cast<const char*>(p->buffer.buffer.get() + p->buffer.rPos), tile)
+        );
+        auto msg = p->state.context->network.factory->withType(laar::message::type::FRAMES)
+            .withPayload(std::move(frames))
             .construct()
             .constructed();
 
@@ -532,19 +896,17 @@ int pa_stream_write_ext_free(pa_stream* p, const void* data, size_t nbytes, pa_f
             .message = std::move(msg),
             .op = o
         });
-    }
-
 
-    // if relative, update internal wPos
-    if (seek == PA_SEEK_RELATIVE && !offset) {
-        p->buffer.wPos += nbytes;
-
-        ENSURE_FAIL_UNLESS(p->buffer.rPos == p->buffer.wPos);
-        ENSURE_FAIL_UNLESS(p->buffer.wPos == p->buffer.avail);
-
-        p->buffer.rPos = p->buffer.wPos = p->buffer.avail = 0;
+        // spent until server confirms it and grants fresh credit
+        p->flow.pushed.push_back(tile);
+        p->flow.inFlight += tile;
+        p->flow.credit -= std::min(p->flow.credit, tile);
     }
 
+    // everything up to written is sent, what is left of credit stays writable
+    p->buffer.rPos = p->buffer.wPos = 0;
+    p->buffer.avail = std::min(p->flow.credit, p->buffer.size);
+
     if (free_cb) {
         free_cb(free_cb_data);
     }
@@ -555,19 +917,38 @@ int pa_stream_write_ext_free(pa_stream* p, const void* data, size_t nbytes, pa_f
 
 
 int pa_stream_peek(pa_stream* p, const void** data, size_t *nbytes) {
-    PCM_MISSED_STUB();
-    UNUSED(p);
-    UNUSED(data);
-    UNUSED(nbytes);
+    PCM_STUB();
+    PCM_MACRO_WRAPPER(ENSURE_NOT_NULL(p), PA_ERR_EXIST);
+    PCM_MACRO_WRAPPER(ENSURE_NOT_NULL(data), PA_ERR_INVALID);
+    PCM_MACRO_WRAPPER(ENSURE_NOT_NULL(nbytes), PA_ERR_INVALID);
 
-    return PA_ERR_NOTSUPPORTED;
+    if (p->pulseAttributes.dir != PA_STREAM_RECORD) {
+        return PA_ERR_BADSTATE;
+    }
+
+    // nothing captured yet, same as pulse does
+    if (p->capture.chunks.empty()) {
+        *data = nullptr;
+        *nbytes = 0;
+        return PA_OK;
+    }
+
+    *data = p->capture.chunks.front().data();
+    *nbytes = p->capture.chunks.front().size();
+    return PA_OK;
 }
 
 int pa_stream_drop(pa_stream* p) {
-    PCM_MISSED_STUB();
-    UNUSED(p);
+    PCM_STUB();
+    PCM_MACRO_WRAPPER(ENSURE_NOT_NULL(p), PA_ERR_EXIST);
 
-    return PA_ERR_NOTSUPPORTED;
+    if (p->pulseAttributes.dir != PA_STREAM_RECORD || p->capture.chunks.empty()) {
+        return PA_ERR_BADSTATE;
+    }
+
+    p->capture.readable -= p->capture.chunks.front().size();
+    p->capture.chunks.pop_front();
+    return PA_OK;
 }
 
 size_t pa_stream_writable_size(const pa_stream* p) {
@@ -577,10 +958,11 @@ size_t pa_stream_writable_size(const pa_stream* p) {
 }
 
 size_t pa_stream_readable_size(const pa_stream* p) {
-    PCM_MISSED_STUB();
-    UNUSED(p);
+    PCM_STUB();
+    // (size_t) -1 is what pulse returns on error
+    PCM_MACRO_WRAPPER(ENSURE_NOT_NULL(p), static_cast<size_t>(-1));
 
-    return 0;
+    return p->capture.readable;
 }
 
 pa_operation* pa_stream_drain(pa_stream* s, pa_stream_success_cb_t cb, void* userdata) {
@@ -794,13 +1176,50 @@ const pa_buffer_attr* pa_stream_get_buffer_attr(pa_stream* s) {
 }
 
 pa_operation* pa_stream_set_buffer_attr(pa_stream* s, const pa_buffer_attr* attr, pa_stream_success_cb_t cb, void* userdata) {
-    PCM_MISSED_STUB();
-    UNUSED(s);
-    UNUSED(cb);
-    UNUSED(attr);
-    UNUSED(userdata);
+    PCM_STUB();
+    PCM_MACRO_WRAPPER(ENSURE_NOT_NULL(s), nullptr);
+    PCM_MACRO_WRAPPER(ENSURE_NOT_NULL(attr), nullptr);
 
-    return nullptr;
+    if (s->state.state != PA_STREAM_READY) {
+        return nullptr;
+    }
+
+    // connected stream sends buffer config only, server resizes its buffer in place
+    NSound::NClient::TStreamMessage streamMessage;
+    streamMessage.set_stream_id(s->network.id);
+    toBufferConfig(
+        attr, s->pulseAttributes.dir, laar::getSampleSize(s->network.config.sample_spec().format()), 
+        streamMessage.mutable_connect()->mutable_configuration()->mutable_buffer_config()
+    );
+
+    NSound::THolder holder;
+    *holder.mutable_client()->mutable_stream_message() = std::move(streamMessage);
+
+    pa_operation* o = new pa_operation;
+    o->cbSuccess = confirmBufferAttr;
+    o->owner = s;
+    o->cbNotify = nullptr;
+    o->userdata = nullptr;
+    o->refs = 0;
+    o->state = PA_OPERATION_RUNNING;
+
+    ++s->state.ops;
+    pa_operation_ref(o);
+
+    s->callbacks.bufferAttr.cb = cb;
+    s->callbacks.bufferAttr.userdata = userdata;
+
+    auto message = s->state.context->network.factory->withType(laar::message::type::PROTOBUF)
+        .withPayload(std::move(holder))
+        .construct()
+        .constructed();
+
+    s->state.context->out.push_back(pa_context::QueuedMessage{
+        .message = std::move(message),
+        .op = o
+    });
+
+    return o;
 }
 
 pa_operation* pa_stream_update_sample_rate(pa_stream* s, uint32_t rate, pa_stream_success_cb_t cb, void* userdata) {
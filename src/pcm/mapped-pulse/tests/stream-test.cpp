@@ -34,13 +34,16 @@
 #include <gtest/gtest.h>
 
 // STD
+#include <string>
 #include <vector>
 #include <chrono>
 #include <cerrno>
 #include <memory>
+#include <atomic>
 #include <thread>
 #include <cstdint>
 #include <cstring>
+#include <optional>
 
 // abseil
 #include <absl/strings/str_format.h>
@@ -59,8 +62,41 @@ namespace {
     std::uint32_t id;
     NSound::NCommon::TStreamConfiguration commonConfig;
 
+    // samples fake server buffers for playback, every poll plays them out
+    constexpr std::uint64_t ServerCapacity = 1024;
+
+    // what fake server saw, read by tests after server thread is joined
+    struct ServerRecord {
+        std::string pushed;
+        std::uint64_t queued = 0;
+        int polls = 0;
+        int pulls = 0;
+    } record;
+
+    // fake server answers handshake with duplex version, set by test before context connects
+    std::atomic<bool> duplexServer = false;
+
+    // capture fake server sends, one chunk per pull (or right after the only one in duplex)
+    const std::vector<std::size_t> CapturedChunks = {400, 200};
+
+    std::string makeCaptured(std::size_t offset, std::size_t size) {
+        std::string data(size, '\0');
+        for (std::size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>((offset + i) % 251);
+        }
+        return data;
+    }
+
     enum EMessage {
-        ACK, TRAIL, STREAM_OPEN_CONFIRMAL
+        ACK, TRAIL, STREAM_OPEN_CONFIRMAL, STATE_POLL, CAPTURE
+    };
+
+    struct Reply {
+        EMessage type;
+        // credit carried by STATE_POLL
+        std::uint64_t writable = 0;
+        // samples carried by CAPTURE
+        std::string data;
     };
 
     struct Socket {
@@ -69,9 +105,9 @@ namespace {
         unsigned int addrlen;
     };
 
-    laar::Message getMessage(EMessage type, std::shared_ptr<laar::MessageFactory> factory) {
+    laar::Message getMessage(Reply reply, std::shared_ptr<laar::MessageFactory> factory) {
         NSound::THolder holder;
-        switch (type) {
+        switch (reply.type) {
             case ACK:
                 return factory->withType(laar::message::type::SIMPLE)
                     .withPayload(laar::ACK)
@@ -90,113 +126,220 @@ namespace {
                     .withPayload(std::move(holder))
                     .construct()
                     .constructed();
+            case STATE_POLL:
+                holder.mutable_server()->mutable_stream_message()->mutable_state_poll()->set_writable(reply.writable);
+                holder.mutable_server()->mutable_stream_message()->set_stream_id(id);
+                return factory->withType(laar::message::type::PROTOBUF)
+                    .withPayload(std::move(holder))
+                    .construct()
+                    .constructed();
+            case CAPTURE:
+                holder.mutable_server()->mutable_stream_message()->mutable_pull()->set_data(reply.data);
+                holder.mutable_server()->mutable_stream_message()->set_stream_id(id);
+                return factory->withType(laar::message::type::PROTOBUF)
+                    .withPayload(std::move(holder))
+                    .construct()
+                    .constructed();
         }
 
         ENSURE_FAIL();
     }
 
-    std::string formatPretty(EMessage type) {
-        switch (type) {
+    std::string formatPretty(Reply reply) {
+        switch (reply.type) {
             case ACK:
                 return absl::StrFormat("sending ACK");
             case TRAIL:
                 return absl::StrFormat("sending TRAIL");
             case STREAM_OPEN_CONFIRMAL:
                 return absl::StrFormat("sending STREAM_OPEN_CONFIRMAL");
+            case STATE_POLL:
+                return absl::StrFormat("sending STATE_POLL, writable: %d", reply.writable);
+            case CAPTURE:
+                return absl::StrFormat("sending CAPTURE, bytes: %d", reply.data.size());
         }
 
         ENSURE_FAIL();
     }
 
+    std::uint64_t writable() {
+        return (record.queued < ServerCapacity) ? ServerCapacity - record.queued : 0;
+    }
+
+    std::size_t capturedBefore(std::size_t chunk) {
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < chunk; ++i) {
+            offset += CapturedChunks[i];
+        }
+        return offset;
+    }
+
+    // sequence is set on duplex replies only
     void writeBack(
         Socket socket, 
-        int& received, 
         std::shared_ptr<laar::MessageFactory> factory, 
         std::unique_ptr<std::uint8_t[]>& buffer,
-        std::vector<EMessage> messages
+        const std::vector<Reply>& replies,
+        std::optional<laar::Message::SequenceType> sequence = std::nullopt
     ) {
-
-        auto cur = messages.begin();
         laar::Message message;
 
-        while(received--) {
-            pcm_log::log(absl::StrFormat("preparing to send message back, received: %d", received), pcm_log::ELogVerbosity::INFO);
-
-            message = getMessage(*cur, factory);
-            pcm_log::log(formatPretty(*cur), pcm_log::ELogVerbosity::INFO);
+        for (const auto& reply : replies) {
+            message = getMessage(reply, factory);
+            if (sequence.has_value()) {
+                message.setSequence(sequence.value());
+            }
+            pcm_log::log(formatPretty(reply), pcm_log::ELogVerbosity::INFO);
             message.writeToArray(buffer.get(), laar::NetworkBufferSize);
 
             if (int written = write(socket.cfd, buffer.get(), laar::Message::Size::total(&message)); written < 0) {
                 SYSCALL_FALLBACK();
             }
+        }
+    }
+
+    // false once client is gone
+    bool readExactly(Socket socket, std::uint8_t* data, std::size_t size) {
+        for (std::size_t acquired = 0; acquired < size;) {
+            int chunk = read(socket.cfd, data + acquired, size - acquired);
+            if (chunk < 0) {
+                SYSCALL_FALLBACK();
+            } else if (chunk == 0) {
+                return false;
+            }
+            acquired += chunk;
+        }
+        return true;
+    }
 
-            ++cur;
+    // answers message as server would; returns 0 once client closed stream
+    int handleMessage(laar::Message& msg, std::vector<Reply>& replies) {
+        if (msg.type() == laar::message::type::FRAMES) {
+            auto frames = laar::messagePayload<laar::message::type::FRAMES>(msg);
+            record.pushed.append(frames.data().data(), frames.data().size());
+            record.queued += frames.samples();
+            replies.push_back({STATE_POLL, writable()});
+            return 1;
         }
 
-        received = 0;
+        if (msg.type() == laar::message::type::PROTOBUF) {
+            auto clientMessage = std::move(*laar::messagePayload<laar::message::type::PROTOBUF>(msg).mutable_client());
+            if (clientMessage.has_stream_message()) {
+                auto& streamMessage = *clientMessage.mutable_stream_message();
+                if (streamMessage.has_close()) {
+                    replies.push_back({ACK});
+                    return 0;
+                } else if (streamMessage.has_poll()) {
+                    // device played out everything that was queued
+                    ++record.polls;
+                    record.queued = 0;
+                    replies.push_back({STATE_POLL, writable()});
+                    return 1;
+                } else if (streamMessage.has_pull()) {
+                    std::size_t chunk = record.pulls++;
+                    if (duplexServer) {
+                        // duplex pull is answered with everything captured from now on
+                        for (; chunk < CapturedChunks.size(); ++chunk) {
+                            replies.push_back({CAPTURE, 0, makeCaptured(capturedBefore(chunk), CapturedChunks[chunk])});
+                        }
+                    } else if (chunk < CapturedChunks.size()) {
+                        replies.push_back({CAPTURE, 0, makeCaptured(capturedBefore(chunk), CapturedChunks[chunk])});
+                    } else {
+                        // nothing captured since previous pull
+                        replies.push_back({CAPTURE});
+                    }
+                    return 1;
+                } else if (streamMessage.has_connect()) {
+                    commonConfig = std::move(*streamMessage.mutable_connect()->mutable_configuration());
+                    id = 1;
+                    replies.push_back({STREAM_OPEN_CONFIRMAL});
+                    return 1;
+                }
+            }
+        }
+
+        replies.push_back({ACK});
+        return 1;
     }
 
+    // reads one batch up to TRAIL and answers every message in it;
+    // returns 0 when client closed stream or connection
     int dispatchIncomingStream(
         Socket socket, 
-        int& received, 
         std::shared_ptr<laar::MessageFactory> factory, 
-        std::unique_ptr<std::uint8_t[]>& buffer
+        std::unique_ptr<std::uint8_t[]>& buffer,
+        std::vector<Reply>& replies
     ) {
         int retval = 1;
         // intermidiate data for parsing messages
         laar::Message msg;
         std::size_t size = laar::NetworkBufferSize;
         std::size_t offset = 0;
-       
 
         while (true) {
             pcm_log::log(absl::StrFormat("requesting for bytes: %d", factory->next()), pcm_log::ELogVerbosity::INFO);
-            if (int acquired = read(socket.cfd, buffer.get() + offset, factory->next()); acquired < static_cast<int>(factory->next())) {
-                if (acquired >= 0) {
-                    pcm_log::log(
-                        absl::StrFormat("requesting for bytes: %d; bytes received: %d", factory->next(), acquired), 
-                        pcm_log::ELogVerbosity::INFO
-                    );
-                } else {
-                    SYSCALL_FALLBACK();
-                }
-            } else {
-                factory->parse(buffer.get() + offset, size);
-                offset += acquired;
-                pcm_log::log(absl::StrFormat("part of message received, size is %d", size), pcm_log::ELogVerbosity::INFO);
+            std::size_t wanted = factory->next();
+            if (!readExactly(socket, buffer.get() + offset, wanted)) {
+                // nobody to answer to
+                pcm_log::log("client closed connection", pcm_log::ELogVerbosity::INFO);
+                replies.clear();
+                return 0;
             }
+            factory->parse(buffer.get() + offset, size);
+            offset += wanted;
 
-            if (factory->isParsedAvailable()) {
-                ++received;
-                msg = factory->parsed();
-                pcm_log::log("message received", pcm_log::ELogVerbosity::INFO);
-
-                if (msg.type() == laar::message::type::PROTOBUF) {
-                    auto clientMessage = std::move(*laar::messagePayload<laar::message::type::PROTOBUF>(msg).mutable_client());
-                    if (clientMessage.has_stream_message()) {
-                        if (clientMessage.stream_message().has_close()) {
-                            retval = 0;
-                        } else {
-                            commonConfig = std::move(*clientMessage.mutable_stream_message()->mutable_connect()->mutable_configuration());
-                            id = 1;
-                        }
-                    }
-                }
+            if (!factory->isParsedAvailable()) {
+                continue;
+            }
 
-                if (msg.type() == laar::message::type::SIMPLE && laar::messagePayload<laar::message::type::SIMPLE>(msg) == laar::TRAIL) {
-                    break;
-                }
+            // message is handled right away, next one may reuse buffer
+            offset = 0;
+            msg = factory->parsed();
+            pcm_log::log("message received", pcm_log::ELogVerbosity::INFO);
+
+            if (msg.type() == laar::message::type::SIMPLE && laar::messagePayload<laar::message::type::SIMPLE>(msg) == laar::TRAIL) {
+                replies.push_back({TRAIL});
+                break;
             }
+
+            retval &= handleMessage(msg, replies);
         }
 
         pcm_log::log("received TRAIL", pcm_log::ELogVerbosity::INFO);
         return retval;
     }
 
+    // duplex session: single request, answered with its sequence number
+    int dispatchIncomingMessage(
+        Socket socket, 
+        std::shared_ptr<laar::MessageFactory> factory, 
+        std::unique_ptr<std::uint8_t[]>& buffer
+    ) {
+        std::size_t size = laar::NetworkBufferSize;
+        std::size_t offset = 0;
+
+        while (!factory->isParsedAvailable()) {
+            std::size_t wanted = factory->next();
+            if (!readExactly(socket, buffer.get() + offset, wanted)) {
+                pcm_log::log("client closed connection", pcm_log::ELogVerbosity::INFO);
+                return 0;
+            }
+            factory->parse(buffer.get() + offset, size);
+            offset += wanted;
+        }
+
+        laar::Message msg = factory->parsed();
+        std::vector<Reply> replies;
+        int retval = handleMessage(msg, replies);
+        writeBack(socket, factory, buffer, replies, msg.sequence());
+        return retval;
+    }
+
     void dummyStreamConnector(int fd) {
 
         // prepare single socket data
         Socket socket;
+        socket.addrlen = sizeof(socket.addr);
 
         if (int err = socket.cfd = accept(fd, reinterpret_cast<sockaddr*>(&socket.addr), &socket.addrlen); err < 0) {
             SYSCALL_FALLBACK();
@@ -205,31 +348,171 @@ namespace {
         auto factory = laar::MessageFactory::configure();
         auto buffer = std::make_unique<std::uint8_t[]>(laar::NetworkBufferSize);
 
-        int received = 0;
-        // dispatch context connect first
+        // context connect, stream open and then data cycles until stream is closed
         pcm_log::log("connecting client, accepting context", pcm_log::ELogVerbosity::INFO);
-        dispatchIncomingStream(socket, received, factory, buffer);
-        writeBack(socket, received, factory, buffer, {ACK, STREAM_OPEN_CONFIRMAL, TRAIL});
-
-        // dispatch some data (one cycle)
-        pcm_log::log("dispatching data cycle 1", pcm_log::ELogVerbosity::INFO);
+        std::vector<Reply> replies;
+        if (duplexServer) {
+            // handshake is answered in first version layout with duplex version in header
+            factory->withMessageVersion(laar::message::version::DUPLEX);
+        }
+        int next = dispatchIncomingStream(socket, factory, buffer, replies);
+        writeBack(socket, factory, buffer, replies);
 
-        int next = 1;
-        while (next) {
-            next = dispatchIncomingStream(socket, received, factory, buffer);
-            std::vector<EMessage> messages;
-            for (int i = 0; i < received - 1; ++i) {
-                messages.push_back(ACK);
+        if (duplexServer) {
+            factory->withSequencing(true);
+            while (next) {
+                next = dispatchIncomingMessage(socket, factory, buffer);
             }
-            messages.push_back(TRAIL);
-            writeBack(socket, received, factory, buffer, messages);
         }
 
+        while (next) {
+            replies.clear();
+            next = dispatchIncomingStream(socket, factory, buffer, replies);
+            writeBack(socket, factory, buffer, replies);
+        }
 
         close(socket.cfd);
         close(fd);
     }
 
+    // playback client state shared with stream callbacks
+    struct Playback {
+        pa_mainloop_api* api;
+        // write callbacks served before stream is disconnected
+        int target;
+        int calls = 0;
+        std::string written;
+        std::vector<std::size_t> requested;
+        std::vector<std::size_t> leftAfterWrite;
+        pa_stream_state_t last = PA_STREAM_UNCONNECTED;
+    };
+
+    void watchPlayback(pa_stream* s, void* userdata) {
+        Playback* playback = reinterpret_cast<Playback*>(userdata);
+        playback->last = pa_stream_get_state(s);
+
+        switch (playback->last) {
+            case PA_STREAM_CREATING:
+                pcm_log::log("stream entered state: CREATING", pcm_log::ELogVerbosity::INFO);
+                return;
+            case PA_STREAM_UNCONNECTED:
+                pcm_log::log("stream entered state: UNCONNECTED", pcm_log::ELogVerbosity::INFO);
+                return;
+            case PA_STREAM_READY:
+                pcm_log::log("stream entered state: READY", pcm_log::ELogVerbosity::INFO);
+                return;
+            case PA_STREAM_FAILED:
+                pcm_log::log("stream entered state: FAILED", pcm_log::ELogVerbosity::INFO);
+                playback->api->quit(playback->api, 0);
+                return;
+            case PA_STREAM_TERMINATED:
+                // reference taken by pa_stream_new is dropped by stream on close
+                pcm_log::log("stream entered state: TERMINATED", pcm_log::ELogVerbosity::INFO);
+                playback->api->quit(playback->api, 0);
+                return;
+        }
+    }
+
+    void writePlayback(pa_stream* s, unsigned long size, void* userdata) {
+        Playback* playback = reinterpret_cast<Playback*>(userdata);
+        pcm_log::log(absl::StrFormat("receiving write request for %d bytes", size), pcm_log::ELogVerbosity::INFO);
+        ++playback->calls;
+        playback->requested.push_back(size);
+
+        std::size_t total = size;
+        void* data;
+        pa_stream_begin_write(s, &data, &total);
+
+        // pattern continues across writes, so server side can check order
+        auto* bytes = reinterpret_cast<char*>(data);
+        for (std::size_t i = 0; i < total; ++i) {
+            bytes[i] = static_cast<char>((playback->written.size() + i) % 251);
+        }
+        playback->written.append(bytes, total);
+
+        pa_stream_write(s, data, total, nullptr, 0, PA_SEEK_RELATIVE);
+        playback->leftAfterWrite.push_back(pa_stream_writable_size(s));
+
+        pcm_log::log(absl::StrFormat("written %d bytes", total), pcm_log::ELogVerbosity::INFO);
+        if (playback->calls == playback->target) {
+            pa_stream_disconnect(s);
+        }
+    }
+
+    // capture client state shared with stream callbacks
+    struct Capture {
+        pa_mainloop_api* api;
+        int reads = 0;
+        bool checkedEmpty = false;
+        bool checkedDrops = false;
+        pa_stream_state_t last = PA_STREAM_UNCONNECTED;
+    };
+
+    void expectEmptyCapture(pa_stream* s) {
+        const void* data = s;
+        std::size_t nbytes = 1;
+        EXPECT_EQ(pa_stream_peek(s, &data, &nbytes), PA_OK);
+        EXPECT_EQ(data, nullptr);
+        EXPECT_EQ(nbytes, 0u);
+        EXPECT_EQ(pa_stream_readable_size(s), 0u);
+        // nothing was peeked, nothing to drop
+        EXPECT_EQ(pa_stream_drop(s), PA_ERR_BADSTATE);
+    }
+
+    void expectPeek(pa_stream* s, std::size_t chunk) {
+        const void* data = nullptr;
+        std::size_t nbytes = 0;
+        ASSERT_EQ(pa_stream_peek(s, &data, &nbytes), PA_OK);
+        ASSERT_NE(data, nullptr);
+        ASSERT_EQ(nbytes, CapturedChunks[chunk]);
+        EXPECT_EQ(std::string(reinterpret_cast<const char*>(data), nbytes), makeCaptured(capturedBefore(chunk), nbytes));
+    }
+
+    void watchCapture(pa_stream* s, void* userdata) {
+        Capture* capture = reinterpret_cast<Capture*>(userdata);
+        capture->last = pa_stream_get_state(s);
+
+        switch (capture->last) {
+            case PA_STREAM_READY:
+                pcm_log::log("stream entered state: READY", pcm_log::ELogVerbosity::INFO);
+                // server did not send anything yet
+                expectEmptyCapture(s);
+                capture->checkedEmpty = true;
+                return;
+            case PA_STREAM_FAILED:
+            case PA_STREAM_TERMINATED:
+                pcm_log::log("stream is done", pcm_log::ELogVerbosity::INFO);
+                capture->api->quit(capture->api, 0);
+                return;
+            default:
+                return;
+        }
+    }
+
+    void readCapture(pa_stream* s, unsigned long size, void* userdata) {
+        Capture* capture = reinterpret_cast<Capture*>(userdata);
+        pcm_log::log(absl::StrFormat("receiving read request for %d bytes", size), pcm_log::ELogVerbosity::INFO);
+        ++capture->reads;
+        EXPECT_EQ(size, pa_stream_readable_size(s));
+
+        // wait for everything server captured
+        if (size < capturedBefore(CapturedChunks.size())) {
+            return;
+        }
+
+        // drop releases peeked chunk only, later one stays readable
+        expectPeek(s, 0);
+        EXPECT_EQ(pa_stream_drop(s), PA_OK);
+        EXPECT_EQ(pa_stream_readable_size(s), CapturedChunks[1]);
+
+        expectPeek(s, 1);
+        EXPECT_EQ(pa_stream_drop(s), PA_OK);
+        expectEmptyCapture(s);
+
+        capture->checkedDrops = true;
+        pa_stream_disconnect(s);
+    }
+
     class StreamTest : public ::testing::Test {
     public:
 
@@ -272,6 +555,9 @@ namespace {
                 SYSCALL_FALLBACK();
             }
 
+            record = ServerRecord{};
+            duplexServer = false;
+
             server = std::make_unique<std::thread>(dummyStreamConnector, fd);
         }
 
@@ -282,80 +568,132 @@ namespace {
             }
         }
 
-        // socket
-        int fd;
-        pa_mainloop* m;
-        pa_mainloop_api* a;
-        std::unique_ptr<std::thread> server;
+        void runPlayback(Playback& playback) {
+            pa_context* c = pa_context_new(a, "kek");
+            pa_context_connect(c, nullptr, PA_CONTEXT_NOFLAGS, nullptr);
 
-    };
+            pa_sample_spec spec;
+            spec.rate = 44100;
+            spec.channels = 1;
+            spec.format = PA_SAMPLE_S32LE;
+            pa_buffer_attr attr {};
+            attr.prebuf = spec.rate;
+            pa_channel_map map {};
 
-}
+            playback.api = a;
+            pa_stream* s = pa_stream_new(c, "lol", &spec, &map);
+            pa_stream_connect_playback(s, nullptr, &attr, PA_STREAM_NOFLAGS, nullptr, nullptr);
+            pa_stream_ref(s);
 
-TEST_F(StreamTest, StreamOpenAndSimpleWrite) {
-    pa_context* c = pa_context_new(a, "kek");
-    pa_context_connect(c, nullptr, PA_CONTEXT_NOFLAGS, nullptr);
+            pa_stream_set_state_callback(s, watchPlayback, &playback);
+            pa_stream_set_write_callback(s, writePlayback, &playback);
 
-    auto watcher = [](pa_stream* s, void* userdata) {
-        pa_mainloop_api* a = reinterpret_cast<pa_mainloop_api*>(userdata);
+            pa_mainloop_run(m, nullptr);
 
-        switch (pa_stream_get_state(s)) {
-            case PA_STREAM_CREATING:
-                pcm_log::log("stream entered state: CREATING", pcm_log::ELogVerbosity::INFO);
-                return;
-            case PA_STREAM_UNCONNECTED:
-                pcm_log::log("stream entered state: UNCONNECTED", pcm_log::ELogVerbosity::INFO);
-                return;
-            case PA_STREAM_READY:
-                pcm_log::log("stream entered state: READY", pcm_log::ELogVerbosity::INFO);
-                return;
-            case PA_STREAM_FAILED:
-                pcm_log::log("stream entered state: FAILED", pcm_log::ELogVerbosity::INFO);
-                pa_stream_unref(s);
-                a->quit(a, 0);
-                return;
-            case PA_STREAM_TERMINATED:
-                pcm_log::log("stream entered state: TERMINATED", pcm_log::ELogVerbosity::INFO);
+            if (playback.last != PA_STREAM_TERMINATED) {
+                // stream was not closed, so it still holds its own reference
                 pa_stream_unref(s);
-                a->quit(a, 0);
-                return;
+            }
+            pa_stream_unref(s);
+            pa_context_unref(c);
+
+            // server has seen everything client sent once it is done
+            server->join();
         }
-    };
 
-    auto writer = [](pa_stream* s, unsigned long size, void* userdata) {
-        UNUSED(userdata);
-        pcm_log::log(absl::StrFormat("receiving write request for %d bytes", size), pcm_log::ELogVerbosity::INFO);
+        void runCapture(Capture& capture) {
+            pa_context* c = pa_context_new(a, "kek");
+            pa_context_connect(c, nullptr, PA_CONTEXT_NOFLAGS, nullptr);
 
-        std::size_t total = size;
-        void* data;
-        pa_stream_begin_write(s, &data, &total);
-        
-        std::memset(data, 0, total);
+            pa_sample_spec spec;
+            spec.rate = 44100;
+            spec.channels = 1;
+            spec.format = PA_SAMPLE_S32LE;
+            pa_buffer_attr attr {};
+            attr.maxlength = static_cast<std::uint32_t>(-1);
+            attr.fragsize = static_cast<std::uint32_t>(-1);
+            pa_channel_map map {};
 
-        pa_stream_write(s, data, total, nullptr, 0, PA_SEEK_RELATIVE);
+            capture.api = a;
+            pa_stream* s = pa_stream_new(c, "lol", &spec, &map);
+            pa_stream_connect_record(s, nullptr, &attr, PA_STREAM_NOFLAGS);
+            pa_stream_ref(s);
+
+            pa_stream_set_state_callback(s, watchCapture, &capture);
+            pa_stream_set_read_callback(s, readCapture, &capture);
+
+            pa_mainloop_run(m, nullptr);
+
+            if (capture.last != PA_STREAM_TERMINATED) {
+                // stream was not closed, so it still holds its own reference
+                pa_stream_unref(s);
+            }
+            pa_stream_unref(s);
+            pa_context_unref(c);
+
+            server->join();
+        }
+
+        // socket
+        int fd;
+        pa_mainloop* m;
+        pa_mainloop_api* a;
+        std::unique_ptr<std::thread> server;
 
-        // request exit right after write
-        pcm_log::log(absl::StrFormat("written %d bytes", total), pcm_log::ELogVerbosity::INFO);
-        pa_stream_disconnect(s);
     };
 
-    auto spec = std::make_unique<pa_sample_spec>();
-    spec->rate = 44100;
-    spec->channels = 1;
-    spec->format = PA_SAMPLE_S32LE;
-    auto attr = std::make_unique<pa_buffer_attr>();
-    attr->prebuf = spec->rate;
-    auto map = std::make_unique<pa_channel_map>();
+}
 
-    pa_stream* s = pa_stream_new(c, "lol", spec.get(), map.get());
-    pa_stream_connect_playback(s, nullptr, attr.get(), PA_STREAM_NOFLAGS, nullptr, nullptr);
-    pa_stream_ref(s);
+TEST_F(StreamTest, StreamOpenAndSimpleWrite) {
+    Playback playback;
+    playback.target = 1;
+    runPlayback(playback);
+
+    EXPECT_EQ(playback.last, PA_STREAM_TERMINATED);
+    ASSERT_EQ(playback.calls, 1);
+    // client may write exactly what server granted
+    EXPECT_EQ(playback.requested.front(), ServerCapacity * sizeof(std::int32_t));
+    EXPECT_EQ(record.pushed, playback.written);
+}
 
-    pa_stream_set_state_callback(s, watcher, a);
-    pa_stream_set_write_callback(s, writer, nullptr);
+TEST_F(StreamTest, CreditExhaustionAndRefill) {
+    Playback playback;
+    playback.target = 2;
+    runPlayback(playback);
+
+    EXPECT_EQ(playback.last, PA_STREAM_TERMINATED);
+    ASSERT_EQ(playback.calls, 2);
+    for (int call = 0; call < playback.calls; ++call) {
+        EXPECT_EQ(playback.requested[call], ServerCapacity * sizeof(std::int32_t));
+        // whole credit is spent by write, next request waits for refill
+        EXPECT_EQ(playback.leftAfterWrite[call], 0u);
+    }
+    // buffer was full after first write, so credit came back on poll only
+    EXPECT_GE(record.polls, 2);
+    EXPECT_EQ(record.pushed, playback.written);
+}
 
-    pa_mainloop_run(m, nullptr);
+TEST_F(StreamTest, CapturePulledOnTimer) {
+    Capture capture;
+    runCapture(capture);
 
-    pa_stream_unref(s);
-    pa_context_unref(c);
-}
\ No newline at end of file
+    EXPECT_EQ(capture.last, PA_STREAM_TERMINATED);
+    EXPECT_TRUE(capture.checkedEmpty);
+    EXPECT_TRUE(capture.checkedDrops);
+    // first protocol version has client pull every chunk
+    EXPECT_GE(record.pulls, static_cast<int>(CapturedChunks.size()));
+}
+
+TEST_F(StreamTest, CaptureDeliveredByDuplexServer) {
+    duplexServer = true;
+
+    Capture capture;
+    runCapture(capture);
+
+    EXPECT_EQ(capture.last, PA_STREAM_TERMINATED);
+    EXPECT_TRUE(capture.checkedEmpty);
+    EXPECT_TRUE(capture.checkedDrops);
+    // one pull subscribes stream, chunks come without client asking
+    EXPECT_EQ(record.pulls, 1);
+    EXPECT_EQ(capture.reads, static_cast<int>(CapturedChunks.size()));
+}
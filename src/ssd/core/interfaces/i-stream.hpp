@@ -15,6 +15,7 @@
 #include <string>
 
 // laar
+#include <src/ssd/core/message.hpp>
 #include <src/ssd/core/interfaces/i-context.hpp>
 
 // proto
@@ -59,7 +60,10 @@ namespace laar {
         virtual void init() = 0;
         virtual operator bool() const = 0;
 
-        virtual IContext::APIResult onClientMessage(NSound::NClient::TStreamMessage message) = 0;
+        // message lives on context arena, parts stream keeps must be copied
+        virtual IContext::APIResult onClientMessage(NSound::NClient::TStreamMessage& message) = 0;
+        // samples are only valid for the duration of call
+        virtual IContext::APIResult onClientFrames(const MessageFramesPayloadType& frames) = 0;
 
         virtual ~IStream() = default;
 
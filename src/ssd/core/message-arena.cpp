@@ -0,0 +1,73 @@
+// laar
+#include <src/ssd/macros.hpp>
+#include <src/ssd/core/message.hpp>
+#include <src/ssd/core/message-arena.hpp>
+
+// protobuf
+#include <google/protobuf/arena.h>
+
+// protos
+#include <protos/holder.pb.h>
+
+// STD
+#include <memory>
+#include <variant>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+using namespace laar;
+
+namespace {
+
+    google::protobuf::ArenaOptions makeOptions(char* block, std::size_t size) {
+        google::protobuf::ArenaOptions options;
+        // first block is never freed by reset, so batch that fits it does not allocate
+        options.initial_block = block;
+        options.initial_block_size = size;
+        return options;
+    }
+
+}
+
+MessageArena::MessageArena(std::size_t blockSize)
+    : block_(std::make_unique<char[]>(blockSize))
+    , blockSize_(blockSize)
+    , arena_(makeOptions(block_.get(), blockSize))
+    , stats_{}
+{}
+
+NSound::THolder* MessageArena::parse(Message& message) {
+    if (auto* holder = std::get_if<MessageProtobufPayloadType>(&message.payload_)) {
+        return holder;
+    }
+
+    auto view = messageView(message);
+    if (!view.has_value()) {
+        return nullptr;
+    }
+
+    auto holder = google::protobuf::Arena::Create<NSound::THolder>(&arena_);
+    if (!holder->ParseFromArray(view->data(), view->size())) {
+        ENSURE_FAIL();
+    }
+    ++stats_.messages;
+    return holder;
+}
+
+void MessageArena::reset() {
+    std::uint64_t allocated = arena_.SpaceAllocated();
+    stats_.bytesUsed += arena_.SpaceUsed();
+    stats_.peakBytes = std::max(stats_.peakBytes, allocated);
+    if (allocated > blockSize_) {
+        ++stats_.spills;
+    }
+    ++stats_.batches;
+    arena_.Reset();
+}
+
+MessageArena::Stats MessageArena::collectStats() noexcept {
+    Stats stats = stats_;
+    stats_ = Stats{};
+    return stats;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// laar
+#include <src/ssd/core/message.hpp>
+
+// protobuf
+#include <google/protobuf/arena.h>
+
+// protos
+#include <protos/holder.pb.h>
+
+// STD
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace laar {
+
+    // Storage for protobuf messages of one request batch. Holders parsed here
+    // are bump allocated out of preallocated block and released all at once,
+    // when batch is answered. Batches that do not fit block spill to heap,
+    // which is what stats are for. Not thread safe.
+    class MessageArena {
+    public:
+
+        struct Stats {
+            std::uint64_t batches;
+            // holders parsed on arena
+            std::uint64_t messages;
+            // bytes holders took, summed over batches
+            std::uint64_t bytesUsed;
+            // largest arena footprint, preallocated block included
+            std::uint64_t peakBytes;
+            // batches that did not fit preallocated block
+            std::uint64_t spills;
+        };
+
+        static constexpr std::size_t DefaultBlockSize = 16 * 1024;
+
+        explicit MessageArena(std::size_t blockSize = DefaultBlockSize);
+
+        MessageArena(const MessageArena&) = delete;
+        MessageArena& operator=(const MessageArena&) = delete;
+
+        // holder of protobuf message, valid until reset and while message is alive;
+        // views are parsed onto arena, owned payloads are handed out in place
+        NSound::THolder* parse(Message& message);
+        // releases every holder parsed since previous reset
+        void reset();
+
+        // resets counters
+        Stats collectStats() noexcept;
+
+    private:
+        std::unique_ptr<char[]> block_;
+        const std::size_t blockSize_;
+        google::protobuf::Arena arena_;
+
+        Stats stats_;
+    };
+
+}
@@ -1,7 +1,10 @@
 // STD
+#include <span>
 #include <memory>
+#include <string>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <variant>
 
 // Plog
@@ -11,10 +14,19 @@
 // Abseil
 #include <absl/base/internal/endian.h>
 
+// protobuf
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
 // laar
 #include <src/ssd/macros.hpp>
 #include <src/ssd/core/message.hpp>
 
+// protos
+#include <protos/holder.pb.h>
+#include <protos/client-message.pb.h>
+#include <protos/client/stream.pb.h>
+
 using namespace laar;
 
 namespace {
@@ -54,7 +66,7 @@ namespace {
         std::memcpy(data, &integer, sizeof(integer));
     }
 
-    MessageProtobufPayloadType readProtobufMessage(void* data, std::size_t size) {
+    MessageProtobufPayloadType readProtobufMessage(const void* data, std::size_t size) {
         MessageProtobufPayloadType message;
         if (!message.ParseFromArray(data, size)) {
             ENSURE_FAIL();
@@ -70,6 +82,19 @@ namespace {
         return message;
     }
 
+    MessageFramesPayloadType readFramesMessage(void* data, std::size_t size) {
+        auto array = reinterpret_cast<const char*>(data);
+        std::uint32_t stream = 0;
+        std::uint32_t samples = 0;
+        readDataFromArray(stream, data);
+        readDataFromArray(samples, reinterpret_cast<std::uint8_t*>(data) + sizeof(stream));
+
+        // samples stay where they were received
+        return FramesPayload::view(stream, samples, std::span<const char>(
+            array + FramesPayload::HeaderSize, size - FramesPayload::HeaderSize
+        ));
+    }
+
     void writeProtobufMessage(void* data, std::size_t size, MessageProtobufPayloadType message) {
         if (!message.SerializeToArray(data, size)) {
             ENSURE_FAIL();
@@ -82,6 +107,58 @@ namespace {
         writeDataToArray(message, data);
     }
 
+    void writeFramesMessage(void* data, std::size_t size, const MessageFramesPayloadType& message) {
+        UNUSED(size);
+
+        auto array = reinterpret_cast<std::uint8_t*>(data);
+        writeDataToArray(message.stream(), array);
+        writeDataToArray(message.samples(), array + sizeof(std::uint32_t));
+        std::memcpy(array + FramesPayload::HeaderSize, message.data().data(), message.data().size());
+    }
+
+    using google::protobuf::io::CodedInputStream;
+    using google::protobuf::internal::WireFormatLite;
+
+    // fields of one serialized message level, length delimited ones as spans into it
+    struct WireFields {
+        std::optional<MessageViewPayloadType> nested;
+        std::optional<std::uint64_t> varint;
+    };
+
+    // looks up length delimited field and varint field of one message level;
+    // fails on malformed input or if any other length delimited field is present
+    std::optional<WireFields> walkFields(MessageViewPayloadType data, int nested, int varint) {
+        CodedInputStream input(data.data(), static_cast<int>(data.size()));
+        WireFields fields;
+
+        while (std::uint32_t tag = input.ReadTag()) {
+            int field = WireFormatLite::GetTagFieldNumber(tag);
+            auto type = WireFormatLite::GetTagWireType(tag);
+
+            if (type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+                std::uint32_t length = 0;
+                if (field != nested || !input.ReadVarint32(&length) || length > data.size() - static_cast<std::size_t>(input.CurrentPosition())) {
+                    return std::nullopt;
+                }
+                fields.nested = data.subspan(input.CurrentPosition(), length);
+                input.Skip(static_cast<int>(length));
+            } else if (type == WireFormatLite::WIRETYPE_VARINT && field == varint) {
+                std::uint64_t value = 0;
+                if (!input.ReadVarint64(&value)) {
+                    return std::nullopt;
+                }
+                fields.varint = value;
+            } else if (!WireFormatLite::SkipField(&input, tag)) {
+                return std::nullopt;
+            }
+        }
+
+        if (!input.ConsumedEntireMessage() || input.CurrentPosition() != static_cast<int>(data.size())) {
+            return std::nullopt;
+        }
+        return fields;
+    }
+
     Message popQueue(std::queue<Message>& source) {
         Message parsed = std::move(source.front());
         source.pop();
@@ -90,6 +167,74 @@ namespace {
 
 }
 
+// --- Frames Payload ---
+FramesPayload FramesPayload::view(std::uint32_t stream, std::uint32_t samples, std::span<const char> data) {
+    FramesPayload payload;
+    payload.stream_ = stream;
+    payload.samples_ = samples;
+    payload.view_ = data;
+    return payload;
+}
+
+FramesPayload FramesPayload::copy(std::uint32_t stream, std::uint32_t samples, std::span<const char> data) {
+    FramesPayload payload;
+    payload.stream_ = stream;
+    payload.samples_ = samples;
+    payload.owned_.assign(data.data(), data.size());
+    payload.isOwned_ = true;
+    return payload;
+}
+
+std::uint32_t FramesPayload::stream() const noexcept {
+    return stream_;
+}
+
+std::uint32_t FramesPayload::samples() const noexcept {
+    return samples_;
+}
+
+std::span<const char> FramesPayload::data() const noexcept {
+    return (isOwned_) ? std::span<const char>(owned_) : view_;
+}
+
+std::optional<PushView> laar::peekPush(MessageViewPayloadType holder) {
+    // holder.client.stream_message.push, each level holds only the next one
+    auto client = walkFields(holder, NSound::THolder::kClientFieldNumber, 0);
+    if (!client || !client->nested) {
+        return std::nullopt;
+    }
+    auto stream = walkFields(*client->nested, NSound::TClientMessage::kStreamMessageFieldNumber, 0);
+    if (!stream || !stream->nested) {
+        return std::nullopt;
+    }
+    auto request = walkFields(*stream->nested, NSound::NClient::TStreamMessage::kPushFieldNumber, NSound::NClient::TStreamMessage::kStreamIdFieldNumber);
+    if (!request || !request->nested) {
+        return std::nullopt;
+    }
+    auto push = walkFields(*request->nested, NSound::NClient::TStreamMessage::TPush::kDataFieldNumber, NSound::NClient::TStreamMessage::TPush::kSizeFieldNumber);
+    if (!push) {
+        return std::nullopt;
+    }
+
+    MessageViewPayloadType data = push->nested.value_or(MessageViewPayloadType());
+    return PushView{
+        .stream = static_cast<std::uint32_t>(request->varint.value_or(0)),
+        .samples = push->varint.value_or(0),
+        .data = std::string_view(reinterpret_cast<const char*>(data.data()), data.size())
+    };
+}
+
+MessageProtobufPayloadType laar::parseProtobufView(MessageViewPayloadType holder) {
+    return readProtobufMessage(holder.data(), holder.size());
+}
+
+std::optional<MessageViewPayloadType> laar::messageView(const Message& message) {
+    if (const auto* view = std::get_if<MessageViewPayloadType>(&message.payload_)) {
+        return *view;
+    }
+    return std::nullopt;
+}
+
 // --- Message ---
 void Message::readFromArray(void* data, std::size_t maxBytes) {
     std::size_t shift = 0;
@@ -116,6 +261,7 @@ void Message::readHeaderFromArray(void* data, std::size_t size) {
     // unimplemented fallback
     switch (version()) {
         case message::version::FIRST:
+        case message::version::DUPLEX:
             goto type;
         default:
             ENSURE_FAIL();
@@ -125,6 +271,8 @@ void Message::readHeaderFromArray(void* data, std::size_t size) {
     switch(type()) {
         case message::type::PROTOBUF:
             goto end;
+        case message::type::FRAMES:
+            goto end;
         case message::type::SIMPLE:
             goto end;
         default:
@@ -144,8 +292,14 @@ void Message::readVariableFromArray(void* data, std::size_t size) {
     UNUSED(size);
 #endif
 
+    if (sequence_.has_value()) {
+        readDataFromArray(sequence_.value(), data);
+        data = reinterpret_cast<std::uint8_t*>(data) + sizeof(SequenceType);
+    }
+
     switch (type()) {
         case message::type::PROTOBUF:
+        case message::type::FRAMES:
             readDataFromArray(size_, data);
             return;
         case message::type::SIMPLE:
@@ -171,6 +325,12 @@ void Message::readPayloadFromArray(void* data, std::size_t size) {
         case message::type::SIMPLE:
             payload_ = readSimpleMessage(data, size_);
             return;
+        case message::type::FRAMES:
+#ifdef SSD_RUNTIME_CHECKS
+            ENSURE_SIZE_IS_LESS_THAN_OR_EQUAL(FramesPayload::HeaderSize, size_);
+#endif
+            payload_ = readFramesMessage(data, size_);
+            return;
     }
 
     ENSURE_FAIL();
@@ -206,8 +366,14 @@ void Message::writeVariableToArray(void* data, std::size_t size) const {
     UNUSED(size);
 #endif
 
+    if (sequence_.has_value()) {
+        writeDataToArray(sequence_.value(), data);
+        data = reinterpret_cast<std::uint8_t*>(data) + sizeof(SequenceType);
+    }
+
     switch (type()) {
         case message::type::PROTOBUF:
+        case message::type::FRAMES:
             writeDataToArray(size_, data);
             return;
         case message::type::SIMPLE:
@@ -227,11 +393,18 @@ void Message::writePayloadToArray(void* data, std::size_t size) const {
 
     switch(type()) {
         case message::type::PROTOBUF:
+            if (const auto* view = std::get_if<MessageViewPayloadType>(&payload_)) {
+                std::memcpy(data, view->data(), view->size());
+                return;
+            }
             writeProtobufMessage(data, size, std::get<MessageProtobufPayloadType>(payload_));
             return;
         case message::type::SIMPLE:
             writeSimpleMessage(data, size, std::get<MessageSimplePayloadType>(payload_));
             return;
+        case message::type::FRAMES:
+            writeFramesMessage(data, size, std::get<MessageFramesPayloadType>(payload_));
+            return;
     }
 
     ENSURE_FAIL();
@@ -249,6 +422,14 @@ Message::SizeType Message::size() const {
     return size_;
 }
 
+std::optional<Message::SequenceType> Message::sequence() const {
+    return sequence_;
+}
+
+void Message::setSequence(SequenceType sequence) {
+    sequence_ = sequence;
+}
+
 void Message::setVersion(std::uint8_t version) {
     header_ &= ~VERSION_MASK;
     header_ |= version << VERSION_SHIFT;
@@ -265,12 +446,12 @@ void Message::setSize(SizeType size) {
 
 bool Message::validVersion() const {
     std::uint8_t v = version();
-    return v == message::version::FIRST;
+    return v == message::version::FIRST || v == message::version::DUPLEX;
 }
 
 bool Message::validType() const {
     std::uint8_t t = type();
-    return t == message::type::PROTOBUF || t == message::type::SIMPLE;
+    return t == message::type::PROTOBUF || t == message::type::SIMPLE || t == message::type::FRAMES;
 }
 
 bool Message::validSize() const {
@@ -301,10 +482,14 @@ std::size_t MessageFactory::parse(void* data, std::size_t& available) {
         case State::EStage::HEADER:
             // all messages are at least header + simple payload size (= size in structured), so request that
 #ifdef SSD_RUNTIME_CHECKS
-            ENSURE_SIZE_IS_LESS_THAN_OR_EQUAL(Message::Size::header() + sizeof(MessageAddedSize), available);
+            ENSURE_SIZE_IS_LESS_THAN_OR_EQUAL(next(), available);
 #endif
             state_.parsing.readHeaderFromArray(array + shift, available - shift);
             shift += Message::Size::header();
+            if (sequencing_) {
+                // actual number is read along with size
+                state_.parsing.setSequence(0);
+            }
             state_.parsing.readVariableFromArray(array + shift, available - shift);
             shift += Message::Size::variable(&state_.parsing);
             if (state_.parsing.type() == message::type::SIMPLE) {
@@ -312,7 +497,7 @@ std::size_t MessageFactory::parse(void* data, std::size_t& available) {
                 shift += Message::Size::payload(&state_.parsing);
                 // expect next message
                 finishOnState(available, shift, State::EStage::HEADER, true);
-                return Message::Size::header() + sizeof(MessageAddedSize);
+                return next();
             }
             finishOnState(available, shift, State::EStage::PAYLOAD);
             return Message::Size::payload(&state_.parsing);
@@ -321,9 +506,14 @@ std::size_t MessageFactory::parse(void* data, std::size_t& available) {
 #ifdef SSD_RUNTIME_CHECKS
             ENSURE_SIZE_IS_LESS_THAN_OR_EQUAL(Message::Size::payload(&state_.parsing), available);
 #endif
-            state_.parsing.readPayloadFromArray(array, available);
+            if (views_ && state_.parsing.type() == message::type::PROTOBUF) {
+                // parsed later, if at all
+                state_.parsing.payload_ = MessageViewPayloadType(array, Message::Size::payload(&state_.parsing));
+            } else {
+                state_.parsing.readPayloadFromArray(array, available);
+            }
             finishOnState(available, Message::Size::payload(&state_.parsing), State::EStage::HEADER, true);
-            return Message::Size::header() + sizeof(MessageAddedSize);
+            return next();
     }
 
     ENSURE_FAIL();
@@ -372,6 +562,16 @@ MessageFactory& MessageFactory::withType(std::uint8_t type, bool persistent) {
     return *this;
 }
 
+MessageFactory& MessageFactory::withViews(bool enabled) {
+    views_ = enabled;
+    return *this;
+}
+
+MessageFactory& MessageFactory::withSequencing(bool enabled) {
+    sequencing_ = enabled;
+    return *this;
+}
+
 MessageFactory& MessageFactory::withPayload(MessageProtobufPayloadType payload) {
     state_.constructing.setSize(payload.ByteSizeLong());
     state_.constructing.payload_ = std::move(payload);
@@ -384,6 +584,12 @@ MessageFactory& MessageFactory::withPayload(MessageSimplePayloadType payload) {
     return *this;
 }
 
+MessageFactory& MessageFactory::withPayload(MessageFramesPayloadType payload) {
+    state_.constructing.setSize(FramesPayload::HeaderSize + payload.data().size());
+    state_.constructing.payload_ = std::move(payload);
+    return *this;
+}
+
 MessageFactory& MessageFactory::construct() {
     if (!state_.constructing.validVersion()) {
         state_.constructing.setVersion(version_);
@@ -405,6 +611,9 @@ MessageFactory& MessageFactory::construct() {
         case message::type::PROTOBUF:
             ENSURE_FAIL_UNLESS(std::holds_alternative<MessageProtobufPayloadType>(state_.constructing.payload_));
             break;
+        case message::type::FRAMES:
+            ENSURE_FAIL_UNLESS(std::holds_alternative<MessageFramesPayloadType>(state_.constructing.payload_));
+            break;
     }
 
     constructed_.emplace(std::move(state_.constructing));
@@ -415,7 +624,7 @@ MessageFactory& MessageFactory::construct() {
 std::size_t MessageFactory::next() const {
     switch(state_.stage) {
         case State::EStage::HEADER:
-            return Message::Size::header() + sizeof(MessageAddedSize);
+            return Message::Size::header() + ((sequencing_) ? sizeof(Message::SequenceType) : 0) + sizeof(MessageAddedSize);
         case State::EStage::PAYLOAD:
             return Message::Size::payload(&state_.parsing);
     }
@@ -1,10 +1,15 @@
 #pragma once
 
 // STD
+#include <span>
 #include <queue>
 #include <memory>
+#include <string>
 #include <cstdint>
+#include <variant>
 #include <concepts>
+#include <optional>
+#include <string_view>
 
 // protos
 #include <protos/holder.pb.h>
@@ -16,17 +21,60 @@ namespace laar {
 
         namespace version {
             inline constexpr std::uint8_t FIRST = 0x01;
+            // full duplex, messages carry sequence numbers; see protocol.md
+            inline constexpr std::uint8_t DUPLEX = 0x02;
         }
 
         namespace type {
             inline constexpr std::uint8_t SIMPLE = 0x01;
             inline constexpr std::uint8_t PROTOBUF = 0x02;
+            // raw samples of one stream, no protobuf involved
+            inline constexpr std::uint8_t FRAMES = 0x03;
         }
 
     }
 
+    // Samples pushed to stream. Parsed payload does not own samples, it points into
+    // buffer message was parsed from and is only valid until that buffer is reused;
+    // constructed payload owns a copy, as it is sent later.
+    class FramesPayload {
+    public:
+
+        // stream id and sample count precede samples on wire
+        static constexpr std::size_t HeaderSize = 2 * sizeof(std::uint32_t);
+
+        FramesPayload() = default;
+        static FramesPayload view(std::uint32_t stream, std::uint32_t samples, std::span<const char> data);
+        static FramesPayload copy(std::uint32_t stream, std::uint32_t samples, std::span<const char> data);
+
+        std::uint32_t stream() const noexcept;
+        std::uint32_t samples() const noexcept;
+        std::span<const char> data() const noexcept;
+
+    private:
+        std::uint32_t stream_ = 0;
+        std::uint32_t samples_ = 0;
+        std::span<const char> view_;
+        std::string owned_;
+        bool isOwned_ = false;
+    };
+
     using MessageSimplePayloadType = std::uint32_t;
     using MessageProtobufPayloadType = NSound::THolder;
+    using MessageFramesPayloadType = FramesPayload;
+    // serialized protobuf left in buffer it was received to, see MessageFactory::withViews
+    using MessageViewPayloadType = std::span<const std::uint8_t>;
+
+    // client push found in serialized holder, data points into it
+    struct PushView {
+        std::uint32_t stream;
+        std::uint64_t samples;
+        std::string_view data;
+    };
+
+    // walks wire format of holder without parsing it, nullopt unless it is a client stream push
+    std::optional<PushView> peekPush(MessageViewPayloadType holder);
+    MessageProtobufPayloadType parseProtobufView(MessageViewPayloadType holder);
 
     template<std::uint8_t PayloadType>
     using MessagePayloadTypeMatch = 
@@ -34,7 +82,10 @@ namespace laar {
             MessageSimplePayloadType, 
             typename std::conditional<PayloadType == message::type::PROTOBUF, 
                 MessageProtobufPayloadType, 
-                void>::type
+                typename std::conditional<PayloadType == message::type::FRAMES, 
+                    MessageFramesPayloadType, 
+                    void>::type
+                >::type
         >::type;
 
     // Protocol message provides API for message parsing and writing
@@ -43,6 +94,7 @@ namespace laar {
     public:
 
         using SizeType = std::uint32_t;
+        using SequenceType = std::uint32_t;
 
         // Input
         void readFromArray(void* data, std::size_t maxBytes);
@@ -63,13 +115,15 @@ namespace laar {
             }
 
             inline static std::size_t variable(const Message* message) {
+                std::size_t sequence = (message->sequence_.has_value()) ? sizeof(SequenceType) : 0;
                 switch (message->type()) {
                     case message::type::SIMPLE:
-                        return 0;
+                        return sequence;
                     case message::type::PROTOBUF:
-                        return sizeof(SizeType);
+                    case message::type::FRAMES:
+                        return sequence + sizeof(SizeType);
                 }
-                return 0;
+                return sequence;
             }
 
             inline static std::size_t payload(const Message* message) {
@@ -88,11 +142,17 @@ namespace laar {
         std::uint8_t version() const;
         std::uint8_t type() const;
         SizeType size() const;
+        // sequence number, present on messages of duplex sessions only
+        std::optional<SequenceType> sequence() const;
+        // sequence is assigned by session when message is sent, not when it is constructed
+        void setSequence(SequenceType sequence);
 
         template<std::uint8_t PayloadType>
         friend auto messagePayload(Message* message) -> MessagePayloadTypeMatch<PayloadType>;
+        friend std::optional<MessageViewPayloadType> messageView(const Message& message);
 
         friend class MessageFactory;
+        friend class MessageArena;
 
     private:
         // setters are for factory only
@@ -108,8 +168,9 @@ namespace laar {
     private:
         std::uint8_t header_ = 0;
         SizeType size_ = 0;
+        std::optional<SequenceType> sequence_;
         // payload type depends on certain message
-        std::variant<MessageProtobufPayloadType, MessageSimplePayloadType> payload_;
+        std::variant<MessageProtobufPayloadType, MessageSimplePayloadType, MessageFramesPayloadType, MessageViewPayloadType> payload_;
 
     };
 
@@ -118,7 +179,13 @@ namespace laar {
         if constexpr (PayloadType == message::type::SIMPLE) {
             return std::get<MessageSimplePayloadType>(message->payload_);
         } else if constexpr (PayloadType == message::type::PROTOBUF) {
+            // views are parsed on first access
+            if (const auto* view = std::get_if<MessageViewPayloadType>(&message->payload_)) {
+                return parseProtobufView(*view);
+            }
             return std::get<MessageProtobufPayloadType>(std::move(message->payload_));
+        } else if constexpr (PayloadType == message::type::FRAMES) {
+            return std::get<MessageFramesPayloadType>(std::move(message->payload_));
         }
     }
 
@@ -127,6 +194,9 @@ namespace laar {
         return messagePayload<PayloadType>(&message);
     }
 
+    // serialized payload of protobuf message parsed in view mode
+    std::optional<MessageViewPayloadType> messageView(const Message& message);
+
     class MessageFactory 
         : std::enable_shared_from_this<MessageFactory> {
     public:
@@ -152,9 +222,15 @@ namespace laar {
         // Message construction.
         MessageFactory& withMessageVersion(std::uint8_t version, bool persistent = true);
         MessageFactory& withType(std::uint8_t type, bool persistent = true);
+        // parsed protobuf messages reference buffer given to parse() instead of
+        // being parsed right away, they are valid until that buffer is reused
+        MessageFactory& withViews(bool enabled);
+        // parsed messages are expected to carry sequence numbers, switch only between messages
+        MessageFactory& withSequencing(bool enabled);
         // method overrides to handle different payload types
         MessageFactory& withPayload(MessageProtobufPayloadType payload);
         MessageFactory& withPayload(MessageSimplePayloadType payload);
+        MessageFactory& withPayload(MessageFramesPayloadType payload);
         // dump all available settings into message and move it to queue
         MessageFactory& construct();
 
@@ -187,6 +263,8 @@ namespace laar {
         // flags.
         std::uint8_t type_ = message::type::SIMPLE;
         std::uint8_t version_ = message::version::FIRST;
+        bool views_ = false;
+        bool sequencing_ = false;
 
         // state for parsing & constructing.
         State state_;
@@ -1,17 +1,25 @@
 // STD
 #include <mutex>
 #include <memory>
+#include <string>
+#include <optional>
+#include <filesystem>
+
+// posix
+#include <sys/un.h>
 
 // Boost
 #include <boost/asio.hpp>
 #include <boost/bind/bind.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/executor.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 #include <boost/asio/execution_context.hpp>
 
 // Abseil (google common libs)
 #include <absl/status/status.h>
 #include <absl/status/statusor.h>
+#include <absl/strings/str_format.h>
 
 // plog
 #include <plog/Log.h>
@@ -26,15 +34,61 @@
 
 using namespace laar;
 
-std::shared_ptr<Server> Server::create(std::weak_ptr<IStreamHandler> handler, std::shared_ptr<boost::asio::io_context> context, std::uint32_t port) {
-    return std::shared_ptr<Server>(new Server(std::move(handler), std::move(context), port));
+std::shared_ptr<Server> Server::create(
+    std::weak_ptr<IStreamHandler> handler, 
+    std::shared_ptr<boost::asio::io_context> context, 
+    std::uint32_t port, 
+    std::optional<std::string> socketPath
+) {
+    return std::shared_ptr<Server>(new Server(std::move(handler), std::move(context), port, std::move(socketPath)));
 }
 
-Server::Server(std::weak_ptr<IStreamHandler> handler, std::shared_ptr<boost::asio::io_context> context, std::uint32_t port)
+Server::Server(
+    std::weak_ptr<IStreamHandler> handler, 
+    std::shared_ptr<boost::asio::io_context> context, 
+    std::uint32_t port, 
+    std::optional<std::string> socketPath
+)
     : acceptor_(*context, tcp::endpoint(tcp::v4(), port))
     , context_(std::move(context))
     , handler_(std::move(handler))
-{}
+{
+    if (socketPath.has_value()) {
+        if (absl::Status status = openLocal(socketPath.value()); !status.ok()) {
+            PLOG(plog::warning) << "[server] serving tcp only: " << status.message();
+        } else {
+            PLOG(plog::info) << "[server] listening on " << socketPath.value();
+        }
+    }
+}
+
+absl::Status Server::openLocal(const std::string& path) {
+    if (path.size() >= sizeof(sockaddr_un::sun_path)) {
+        return absl::InvalidArgumentError(absl::StrFormat("socket path is too long: %s", path));
+    }
+
+    // socket left by previous run fails bind, anything else is not touched
+    std::error_code ignored;
+    if (std::filesystem::is_socket(path, ignored)) {
+        std::filesystem::remove(path, ignored);
+    }
+
+    auto acceptor = std::make_unique<local::acceptor>(*context_);
+    boost::system::error_code error;
+    acceptor->open(local(), error);
+    if (!error) {
+        acceptor->bind(local::endpoint(path), error);
+    }
+    if (!error) {
+        acceptor->listen(boost::asio::socket_base::max_listen_connections, error);
+    }
+    if (error) {
+        return absl::InternalError(absl::StrFormat("failed to listen on %s: %s", path, error.message()));
+    }
+
+    localAcceptor_ = std::move(acceptor);
+    return absl::OkStatus();
+}
 
 void Server::init() {
     std::call_once(init_, [this]() {
@@ -45,15 +99,28 @@ void Server::init() {
             .withHandler(handler_)
             .withMaster(weak_from_this());
 
-        auto pair = factory_.AssembleAndReturn();
-        acceptor_.async_accept(
-            *pair.first,
-            boost::bind(&Server::accept, this, pair.second, boost::asio::placeholders::error)
-        );
+        listen(ETransport::TCP);
+        if (localAcceptor_) {
+            listen(ETransport::LOCAL);
+        }
     });
 }
 
+void Server::listen(ETransport transport) {
+    auto pair = factory_.AssembleAndReturn();
+    auto handler = boost::bind(&Server::accept, this, pair.first, pair.second, transport, boost::asio::placeholders::error);
+    switch (transport) {
+        case ETransport::TCP:
+            acceptor_.async_accept(*pair.first, std::move(handler));
+            return;
+        case ETransport::LOCAL:
+            localAcceptor_->async_accept(*pair.first, std::move(handler));
+            return;
+    }
+}
+
 void Server::notification(std::weak_ptr<IContext> context, EReason reason) {
+    std::unique_lock<std::mutex> locked(lock_);
     switch (reason) {
         case EReason::ABORTING:
             PLOG(plog::warning) << "[server] context requested abortion";
@@ -77,20 +144,23 @@ void Server::notification(std::weak_ptr<IContext> context, EReason reason) {
     }
 }
 
-void Server::accept(std::shared_ptr<Context> context, const boost::system::error_code& error) {
+void Server::accept(std::shared_ptr<Context::socket_type> socket, std::shared_ptr<Context> context, ETransport transport, const boost::system::error_code& error) {
     if (error) {
         onNetworkError(error, true);
     }
 
+    if (transport == ETransport::TCP) {
+        // requests and responses are small, nagle would hold them back
+        boost::system::error_code ignored;
+        socket->set_option(tcp::no_delay(true), ignored);
+    }
+
+    std::unique_lock<std::mutex> locked(lock_);
     context->init();
     contexts_.emplace_back(std::move(context));
-    PLOG(plog::info) << "[server] connecting new client";
+    PLOG(plog::info) << "[server] connecting new client over " << ((transport == ETransport::TCP) ? "tcp" : "unix socket");
 
-    auto pair = factory_.AssembleAndReturn();
-    acceptor_.async_accept(
-        *pair.first, 
-        boost::bind(&Server::accept, this, pair.second, boost::asio::placeholders::error)
-    );
+    listen(transport);
 }
 
 void Server::onNetworkError(const boost::system::error_code& error, bool isCritical) {
@@ -121,9 +191,10 @@ ContextFactory& ContextFactory::withContext(std::shared_ptr<boost::asio::io_cont
     return *this;
 }
 
-std::pair<std::shared_ptr<boost::asio::ip::tcp::socket>, std::shared_ptr<Context>> ContextFactory::AssembleAndReturn() {
+std::pair<std::shared_ptr<Context::socket_type>, std::shared_ptr<Context>> ContextFactory::AssembleAndReturn() {
     if (state_.context) {
-        auto socket = std::make_shared<boost::asio::ip::tcp::socket>(*state_.context);
+        // protocol is set by acceptor socket is passed to
+        auto socket = std::make_shared<Context::socket_type>(*state_.context);
         return std::make_pair(socket, Context::configure(state_.master, state_.context, socket, state_.handler, state_.size));
     }
     std::abort();
@@ -3,9 +3,12 @@
 // STD
 #include <mutex>
 #include <memory>
+#include <string>
+#include <optional>
 
 // Boost
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 #include <boost/asio/executor.hpp>
 #include <boost/asio/execution_context.hpp>
 
@@ -34,7 +37,7 @@ namespace laar {
         ContextFactory& withHandler(std::weak_ptr<IStreamHandler> handler);
         ContextFactory& withContext(std::shared_ptr<boost::asio::io_context> context);
 
-        std::pair<std::shared_ptr<boost::asio::ip::tcp::socket>, std::shared_ptr<Context>> AssembleAndReturn();
+        std::pair<std::shared_ptr<Context::socket_type>, std::shared_ptr<Context>> AssembleAndReturn();
 
     private:
 
@@ -53,8 +56,19 @@ namespace laar {
     public:
 
         using tcp = boost::asio::ip::tcp;
-
-        static std::shared_ptr<Server> create(std::weak_ptr<IStreamHandler> handler, std::shared_ptr<boost::asio::io_context> context, std::uint32_t port);
+        using local = boost::asio::local::stream_protocol;
+
+        enum class ETransport : std::uint8_t {
+            TCP, LOCAL
+        };
+
+        // clients on same host are served over unix socket at socketPath as well, if it is given
+        static std::shared_ptr<Server> create(
+            std::weak_ptr<IStreamHandler> handler, 
+            std::shared_ptr<boost::asio::io_context> context, 
+            std::uint32_t port, 
+            std::optional<std::string> socketPath = std::nullopt
+        );
         void init();
         
         // laar::IContext::IContextMaster implementation
@@ -68,19 +82,30 @@ namespace laar {
         Server& operator=(const Server&) = delete;
         Server& operator=(Server&&) = delete;
 
-        Server(std::weak_ptr<IStreamHandler> handler, std::shared_ptr<boost::asio::io_context> context, std::uint32_t port);
+        Server(
+            std::weak_ptr<IStreamHandler> handler, 
+            std::shared_ptr<boost::asio::io_context> context, 
+            std::uint32_t port, 
+            std::optional<std::string> socketPath
+        );
 
-        void accept(std::shared_ptr<Context> context, const boost::system::error_code& error);
+        absl::Status openLocal(const std::string& path);
+        void listen(ETransport transport);
+        void accept(std::shared_ptr<Context::socket_type> socket, std::shared_ptr<Context> context, ETransport transport, const boost::system::error_code& error);
         void onNetworkError(const boost::system::error_code& error, bool isCritical);
 
     private:
 
         std::once_flag init_;
+        // both acceptors may complete at once on different io threads
+        std::mutex lock_;
 
         ContextFactory factory_;
         std::vector<std::shared_ptr<Context>> contexts_;
 
         tcp::acceptor acceptor_;
+        // null if unix socket was not requested or could not be opened
+        std::unique_ptr<local::acceptor> localAcceptor_;
         std::shared_ptr<boost::asio::io_context> context_;
         std::weak_ptr<IStreamHandler> handler_;
 
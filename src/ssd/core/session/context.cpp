@@ -9,9 +9,12 @@
 
 // boost
 #include <boost/asio/post.hpp>
+#include <boost/asio/read.hpp>
 #include <boost/bind/bind.hpp>
+#include <boost/asio/write.hpp>
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <boost/asio/steady_timer.hpp>
 
 // protos
 #include <protos/holder.pb.h>
@@ -28,9 +31,12 @@
 #include <plog/Severity.h>
 
 // STD
+#include <span>
 #include <mutex>
 #include <memory>
+#include <optional>
 #include <utility>
+#include <algorithm>
 #include <cstdint>
 #include <variant>
 
@@ -55,7 +61,7 @@ namespace {
 std::shared_ptr<Context> Context::configure(
     std::weak_ptr<IContext::IContextMaster> master,
     std::shared_ptr<boost::asio::io_context> context, 
-    std::shared_ptr<tcp::socket> socket,
+    std::shared_ptr<socket_type> socket,
     std::weak_ptr<IStreamHandler> handler,
     std::size_t bufferSize
 ) {
@@ -65,7 +71,7 @@ std::shared_ptr<Context> Context::configure(
 Context::Context(
     std::weak_ptr<IContext::IContextMaster> master,
     std::shared_ptr<boost::asio::io_context> context, 
-    std::shared_ptr<tcp::socket> socket,
+    std::shared_ptr<socket_type> socket,
     std::weak_ptr<IStreamHandler> handler,
     std::size_t bufferSize
 )
@@ -75,19 +81,38 @@ Context::Context(
     , context_(std::move(context))
     , master_(std::move(master))
     , handler_(std::move(handler))
-{}
+{
+    // messages are routed before next read reuses buffer
+    factory_->withViews(true);
+}
 
 void Context::init() {
     std::call_once(init_, [this]() mutable {
-        socket_->async_read_some(
+        receive();
+    });
+}
+
+void Context::receive() {
+    if (networkState_->duplex) {
+        // duplex reads do not wait for whole batch, so every part is read in full
+        boost::asio::async_read(
+            *socket_,
+            boost::asio::mutable_buffer(networkState_->buffer.get(), factory_->next()),
+            bindCall(&Context::sRead, networkState_, weak_from_this())
+        );
+        return;
+    }
+
+    socket_->async_read_some(
         boost::asio::mutable_buffer(networkState_->buffer.get(), factory_->next()),
         bindCall(&Context::sRead, networkState_, weak_from_this())
-        );
-    });
+    );
 }
 
 void Context::read(const boost::system::error_code& error, std::size_t bytes) {
     PLOG(plog::debug) << "[context] received " << bytes;
+    // duplex write handler may run on another thread meanwhile
+    std::unique_lock<std::mutex> locked(lock_);
 
     if (error) {
         onCriticalSessionError(absl::InternalError(error.what()));
@@ -100,30 +125,55 @@ void Context::read(const boost::system::error_code& error, std::size_t bytes) {
     if (factory_->isParsedAvailable()) {
         auto message = factory_->parsed();
         // check on message here
+        if (auto sequence = message.sequence(); sequence.has_value()) {
+            networkState_->sequence = sequence.value();
+        }
 
         PLOG(plog::debug) << "[context] message ready, routing it";
-        if (message.type() == laar::message::type::PROTOBUF) {
+        // pushed samples go to handle right from network buffer, holder is never parsed
+        std::optional<PushView> push = std::nullopt;
+        if (auto view = messageView(message); view) {
+            push = peekPush(view.value());
+        }
+
+        if (push) {
+            PLOG(plog::debug) << "[context] received push of " << push->samples << " samples for stream: " << push->stream;
+            if (push->stream >= streams_.size() || !streams_[push->stream]) {
+                onCriticalSessionError(absl::InternalError(absl::StrFormat("received push for stream out of bounds: %d, count: %d", push->stream, streams_.size())));
+                return;
+            }
+            auto frames = FramesPayload::view(push->stream, static_cast<std::uint32_t>(push->samples), std::span<const char>(push->data.data(), push->data.size()));
+            patch(streams_[push->stream]->onClientFrames(frames), push->stream);
+        } else if (message.type() == laar::message::type::PROTOBUF) {
             PLOG(plog::debug) << "[context] received proto message";
-            // parse and handle protos accordingly
-            NSound::THolder holder = laar::messagePayload<laar::message::type::PROTOBUF>(message);
-            if (!holder.has_client()) {
+            // parse and handle protos accordingly, holder lives on arena until trail
+            NSound::THolder* holder = networkState_->arena.parse(message);
+            if (!holder || !holder->has_client()) {
                 onCriticalSessionError(absl::InternalError("[context] got holder with no client message"));
+                return;
             }
 
-            if (holder.client().has_context_message()) {
+            if (holder->client().has_context_message()) {
                 PLOG(plog::debug) << "[context] message belongs to context, running matching";
-                NSound::NClient::TContextMessage message = std::move(*holder.mutable_client()->mutable_context_message());
+                // client announces protocol version it speaks with header of connect request
+                bool duplex = !networkState_->duplex && message.version() == laar::message::version::DUPLEX;
+                const NSound::NClient::TContextMessage& message = holder->client().context_message();
                 if (message.has_connect()) {
                     PLOG(plog::info) << "[context] connecting new context with name: " << message.connect().name();
+                    if (duplex) {
+                        // answer tells client that server speaks it too
+                        networkState_->upgrade = true;
+                        factory_->withMessageVersion(laar::message::version::DUPLEX);
+                    }
                     acknowledge();
                 }
             } 
 
-            if (holder.client().has_stream_message()) {
+            if (holder->client().has_stream_message()) {
                 // only new stream connections are partially handled in context
                 PLOG(plog::debug) << "[context] message belongs to stream, checking on it";
                 // check on stream id. UINT32 is invalid and is signal for new stream
-                NSound::NClient::TStreamMessage message = std::move(*holder.mutable_client()->mutable_stream_message());
+                NSound::NClient::TStreamMessage& message = *holder->mutable_client()->mutable_stream_message();
                 std::shared_ptr<Stream> selected = nullptr;
                 std::uint32_t id = 0;
                 if (message.stream_id() == UINT32_MAX) {
@@ -131,24 +181,51 @@ void Context::read(const boost::system::error_code& error, std::size_t bytes) {
                     streams_.push_back(laar::Stream::configure(context_, weak_from_this(), handler_));
                     selected = streams_.back();
                     id = streams_.size() - 1;
-                } else if (message.stream_id() > streams_.size()) {
+                } else if (message.stream_id() >= streams_.size() || !streams_[message.stream_id()]) {
                     onCriticalSessionError(absl::InternalError(absl::StrFormat("received stream index out of bounds: %d, count: %d", message.stream_id(), streams_.size())));
+                    return;
                 } else {
                     PLOG(plog::debug) << "[context] selected index: " << message.stream_id();
                     selected = streams_[message.stream_id()];
-                    id = streams_.size() - message.stream_id();
+                    // responses carry index client addresses stream with
+                    id = message.stream_id();
                 }
 
                 PLOG(plog::debug) << "[context] sending message down to stream";
-                patch(selected->onClientMessage(std::move(message)), id);
+                bool pulling = message.has_pull();
+                bool closing = message.has_close();
+                IContext::APIResult result = selected->onClientMessage(message);
+                // duplex pulls are answered now and then with every captured period
+                bool subscribing = networkState_->duplex && pulling && result.status.ok();
+                patch(std::move(result), id);
+
+                if (subscribing) {
+                    subscribe(id);
+                } else if (closing) {
+                    subscriptions_.erase(id);
+                }
+            }
+        }
+
+        if (message.type() == laar::message::type::FRAMES) {
+            // samples point into network buffer, which is not reused until next read
+            MessageFramesPayloadType frames = laar::messagePayload<laar::message::type::FRAMES>(message);
+            PLOG(plog::debug) << "[context] received " << frames.samples() << " samples for stream: " << frames.stream();
+            if (frames.stream() >= streams_.size() || !streams_[frames.stream()]) {
+                onCriticalSessionError(absl::InternalError(absl::StrFormat("received frames for stream out of bounds: %d, count: %d", frames.stream(), streams_.size())));
+                return;
             }
+            patch(streams_[frames.stream()]->onClientFrames(frames), frames.stream());
         }
 
         if (message.type() == laar::message::type::SIMPLE) {
             PLOG(plog::debug) << "[context] received simple message";
             MessageSimplePayloadType code = laar::messagePayload<laar::message::type::SIMPLE>(message);
-            if (code == laar::TRAIL) {
+            // duplex requests are answered one by one, there are no batches to trail
+            if (code == laar::TRAIL && !networkState_->duplex) {
                 PLOG(plog::debug) << "[context] received trail";
+                // every request of batch is answered, holders are not needed anymore
+                networkState_->arena.reset();
                 // end of stream, switch to write and begin writing responses
                 if (networkState_->responses.size()) {
                     laar::Message message = std::move(networkState_->responses.front());
@@ -165,23 +242,32 @@ void Context::read(const boost::system::error_code& error, std::size_t bytes) {
             } 
         }
 
+        if (networkState_->duplex) {
+            // request is answered, holders are not needed anymore
+            networkState_->arena.reset();
+            flush();
+        }
     }
 
-    socket_->async_read_some(
-        boost::asio::mutable_buffer(networkState_->buffer.get(), factory_->next()),
-        bindCall(&Context::sRead, networkState_, weak_from_this())
-    );
+    receive();
 }
 
 void Context::write(const boost::system::error_code& error, std::size_t bytes) {
     UNUSED(bytes);
     PLOG(plog::debug) << "[context] writing message";
+    std::unique_lock<std::mutex> locked(lock_);
 
     if (error) {
         onCriticalSessionError(absl::InternalError(error.what()));
         return;
     }
 
+    if (networkState_->duplex) {
+        networkState_->writing = false;
+        flush();
+        return;
+    }
+
     std::size_t offset = 0;
     if (networkState_->responses.size()) {
         while (networkState_->responses.size()) {
@@ -198,13 +284,114 @@ void Context::write(const boost::system::error_code& error, std::size_t bytes) {
         return;
     }
 
+    if (networkState_->upgrade) {
+        upgrade();
+    }
+
     PLOG(plog::debug) << "[context] switching to read";
-    socket_->async_read_some(
-        boost::asio::mutable_buffer(networkState_->buffer.get(), factory_->next()),
-        bindCall(&Context::sRead, networkState_, weak_from_this())
+    receive();
+}
+
+void Context::upgrade() {
+    PLOG(plog::info) << "[context] switching to duplex protocol";
+    networkState_->upgrade = false;
+    networkState_->duplex = true;
+    networkState_->outBuffer = std::make_unique<std::uint8_t[]>(networkState_->bufferSize);
+    factory_->withSequencing(true);
+}
+
+void Context::flush() {
+    if (networkState_->writing || networkState_->responses.empty()) {
+        return;
+    }
+
+    std::size_t offset = 0;
+    while (networkState_->responses.size()) {
+        laar::Message& message = networkState_->responses.front();
+        if (offset && offset + laar::Message::Size::total(&message) > networkState_->bufferSize) {
+            break;
+        }
+        message.writeToArray(networkState_->outBuffer.get() + offset, networkState_->bufferSize - offset);
+        offset += laar::Message::Size::total(&message);
+        networkState_->responses.pop();
+    }
+
+    networkState_->writing = true;
+    boost::asio::async_write(
+        *socket_,
+        boost::asio::buffer(networkState_->outBuffer.get(), offset),
+        bindCall(&Context::sWrite, networkState_, weak_from_this())
     );
 }
 
+void Context::subscribe(std::uint32_t id) {
+    Subscription& subscription = subscriptions_[id];
+    // repeated pull moves subscription to its number
+    subscription.sequence = networkState_->sequence;
+    if (!subscription.timer) {
+        PLOG(plog::debug) << "[context] stream " << id << " subscribed to capture";
+        subscription.timer = std::make_unique<boost::asio::steady_timer>(*context_);
+        scheduleCapture(id);
+    }
+}
+
+void Context::scheduleCapture(std::uint32_t id) {
+    Subscription& subscription = subscriptions_.at(id);
+    subscription.timer->expires_after(streams_[id]->capturePeriod());
+    subscription.timer->async_wait(boost::bind(&Context::sCapture, weak_from_this(), id, boost::asio::placeholders::error));
+}
+
+void Context::capture(const boost::system::error_code& error, std::uint32_t id) {
+    std::unique_lock<std::mutex> locked(lock_);
+
+    // timer is cancelled when subscription is dropped
+    auto subscription = subscriptions_.find(id);
+    if (error || subscription == subscriptions_.end()) {
+        return;
+    }
+    if (id >= streams_.size() || !streams_[id]) {
+        subscriptions_.erase(subscription);
+        return;
+    }
+
+    // same as pull client would send, stream bounds it to one network message
+    NSound::NClient::TStreamMessage pull;
+    pull.set_stream_id(id);
+    pull.mutable_pull()->set_size(UINT32_MAX);
+
+    IContext::APIResult result = streams_[id]->onClientMessage(pull);
+    if (!result.status.ok() || !result.response.has_value() || !std::holds_alternative<MessageProtobufPayloadType>(result.response.value())) {
+        PLOG(plog::error) << "[context] capture of stream " << id << " failed, dropping subscription: " << result.status.ToString();
+        subscriptions_.erase(subscription);
+        return;
+    }
+
+    // nothing captured since last period, nothing to send
+    auto holder = std::get<MessageProtobufPayloadType>(std::move(result.response.value()));
+    if (!holder.server().stream_message().pull().data().empty()) {
+        holder.mutable_server()->mutable_stream_message()->set_stream_id(id);
+        laar::Message message = factory_->withType(message::type::PROTOBUF)
+            .withPayload(std::move(holder))
+            .construct()
+            .constructed();
+        message.setSequence(subscription->second.sequence);
+        networkState_->responses.push(std::move(message));
+        flush();
+    }
+
+    scheduleCapture(id);
+}
+
+MessageArena::Stats Context::collectStats() noexcept {
+    return networkState_->arena.collectStats();
+}
+
+Context::~Context() {
+    MessageArena::Stats stats = collectStats();
+    PLOG(plog::info) << "[context] message arena: " << stats.messages << " messages in " << stats.batches << " batches, "
+        << stats.bytesUsed << " bytes used, peak " << stats.peakBytes << " bytes, " << stats.spills << " batches spilled to heap";
+}
+
 void Context::sRead(std::shared_ptr<NetworkState> state, std::weak_ptr<Context> context, const boost::system::error_code& error, std::size_t bytes) {
     UNUSED(state);
     if (auto that = context.lock()) {
@@ -219,6 +406,12 @@ void Context::sWrite(std::shared_ptr<NetworkState> state, std::weak_ptr<Context>
     }
 }
 
+void Context::sCapture(std::weak_ptr<Context> context, std::uint32_t id, const boost::system::error_code& error) {
+    if (auto that = context.lock()) {
+        that->capture(error, id);
+    }
+}
+
 void Context::onCriticalSessionError(absl::Status status) {
     PLOG(plog::error) << "[context] error: " << status.ToString();
     if (auto master = master_.lock()) {
@@ -263,7 +456,7 @@ void Context::acknowledgeWithCode(laar::MessageSimplePayloadType simple) {
         .withPayload(simple)
         .construct()
         .constructed();
-    networkState_->responses.push(std::move(message));
+    respond(std::move(message));
 }
 
 void Context::acknowledgeWithProtobuf(laar::MessageProtobufPayloadType protobuf) {
@@ -271,10 +464,18 @@ void Context::acknowledgeWithProtobuf(laar::MessageProtobufPayloadType protobuf)
         .withPayload(std::move(protobuf))
         .construct()
         .constructed();
+    respond(std::move(message));
+}
+
+void Context::respond(laar::Message message) {
+    if (networkState_->duplex) {
+        message.setSequence(networkState_->sequence);
+    }
     networkState_->responses.push(std::move(message));
 }
 
 void Context::abort(std::weak_ptr<IStream> slave, std::optional<std::string> reason) {
+    std::unique_lock<std::mutex> locked(lock_);
     if (reason.has_value()) {
         PLOG(plog::error) << "[context] stream aborting: " << reason.value();
     } else {
@@ -283,6 +484,7 @@ void Context::abort(std::weak_ptr<IStream> slave, std::optional<std::string> rea
 
     if (auto stream = slave.lock()) {
         if (auto iter = std::find(streams_.begin(), streams_.end(), stream); iter != streams_.end()) {
+            subscriptions_.erase(static_cast<std::uint32_t>(iter - streams_.begin()));
             iter->reset();
             PLOG(plog::info) << "[context] slave stream " << stream.get() << " exited";
         } else {
@@ -295,8 +497,10 @@ void Context::abort(std::weak_ptr<IStream> slave, std::optional<std::string> rea
 }
 
 void Context::close(std::weak_ptr<IStream> slave) {
+    std::unique_lock<std::mutex> locked(lock_);
     if (auto stream = slave.lock()) {
         if (auto iter = std::find(streams_.begin(), streams_.end(), stream); iter != streams_.end()) {
+            subscriptions_.erase(static_cast<std::uint32_t>(iter - streams_.begin()));
             iter->reset();
             PLOG(plog::info) << "[context] slave stream " << stream.get() << " exited";
         } else {
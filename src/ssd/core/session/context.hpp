@@ -3,12 +3,14 @@
 // laar
 #include <src/ssd/core/session/stream.hpp>
 #include <src/ssd/core/message.hpp>
+#include <src/ssd/core/message-arena.hpp>
 #include <src/ssd/core/interfaces/i-stream.hpp>
 #include <src/ssd/core/interfaces/i-context.hpp>
 #include <src/ssd/sound/interfaces/i-audio-handler.hpp>
 
 // boost
-#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
 #include <boost/system/system_error.hpp>
 #include <boost/system/detail/error_code.hpp>
 
@@ -22,6 +24,7 @@
 // STD
 #include <memory>
 #include <cstdint>
+#include <unordered_map>
 
 
 namespace laar {
@@ -32,12 +35,13 @@ namespace laar {
         , public std::enable_shared_from_this<laar::Context> {
     public:
     
-        using tcp = boost::asio::ip::tcp;
+        // tcp and unix sockets alike
+        using socket_type = boost::asio::generic::stream_protocol::socket;
 
         static std::shared_ptr<Context> configure(
             std::weak_ptr<IContext::IContextMaster> master,
             std::shared_ptr<boost::asio::io_context> context, 
-            std::shared_ptr<tcp::socket> socket,
+            std::shared_ptr<socket_type> socket,
             std::weak_ptr<IStreamHandler> handler,
             std::size_t bufferSize
         );
@@ -54,6 +58,23 @@ namespace laar {
             std::unique_ptr<std::uint8_t[]> buffer;
 
             std::queue<laar::Message> responses;
+            // requests of current batch, reset on trail
+            MessageArena arena;
+
+            // client asked for duplex protocol, session switches once handshake batch is answered
+            bool upgrade = false;
+            bool duplex = false;
+            // duplex sessions write from separate buffer while next requests are read
+            std::unique_ptr<std::uint8_t[]> outBuffer;
+            bool writing = false;
+            // request being answered, responses carry its number
+            Message::SequenceType sequence = 0;
+        };
+
+        // duplex pull server keeps answering with captured samples until stream is closed
+        struct Subscription {
+            Message::SequenceType sequence;
+            std::unique_ptr<boost::asio::steady_timer> timer;
         };
         
         // IContext implementation
@@ -63,7 +84,10 @@ namespace laar {
         virtual void abort(std::weak_ptr<IStream> slave, std::optional<std::string> reason) override;
         virtual void close(std::weak_ptr<IStream> slave) override;
 
-        virtual ~Context() override = default;
+        // resets counters
+        MessageArena::Stats collectStats() noexcept;
+
+        virtual ~Context() override;
 
     private:
 
@@ -79,7 +103,7 @@ namespace laar {
         Context(
             std::weak_ptr<IContext::IContextMaster> master,
             std::shared_ptr<boost::asio::io_context> context, 
-            std::shared_ptr<tcp::socket> socket,
+            std::shared_ptr<socket_type> socket,
             std::weak_ptr<IStreamHandler> handler,
             std::size_t bufferSize
         );
@@ -91,9 +115,20 @@ namespace laar {
         void acknowledge();
         void acknowledgeWithCode(laar::MessageSimplePayloadType simple);
         void acknowledgeWithProtobuf(laar::MessageProtobufPayloadType protobuf);
+        void respond(laar::Message message);
+
+        // --- DUPLEX PROTOCOL ---
+        void upgrade();
+        // writes queued responses unless write is in progress
+        void flush();
+        // captured samples of stream are sent as they come, so client does not poll
+        void subscribe(std::uint32_t id);
+        void scheduleCapture(std::uint32_t id);
+        void capture(const boost::system::error_code& error, std::uint32_t id);
 
         // --- NETWORK LOW LEVEL I/O ---
         // normal I/O handlers
+        void receive();
         void read(const boost::system::error_code& error, std::size_t bytes);
         void write(const boost::system::error_code& error, std::size_t bytes);
         // static wrappers to preserve tokens' lifetime reqs
@@ -109,6 +144,11 @@ namespace laar {
             const boost::system::error_code& error, 
             std::size_t bytes
         );
+        static void sCapture(
+            std::weak_ptr<Context> session, 
+            std::uint32_t id,
+            const boost::system::error_code& error
+        );
 
     private:
 
@@ -119,7 +159,7 @@ namespace laar {
         std::once_flag init_;
 
         // Client & server owning data
-        std::shared_ptr<tcp::socket> socket_;
+        std::shared_ptr<socket_type> socket_;
         std::shared_ptr<MessageFactory> factory_;
         std::shared_ptr<boost::asio::io_context> context_;
 
@@ -128,6 +168,8 @@ namespace laar {
         std::weak_ptr<IStreamHandler> handler_;
 
         std::vector<std::shared_ptr<Stream>> streams_;
+        // by stream id
+        std::unordered_map<std::uint32_t, Subscription> subscriptions_;
 
     };
 
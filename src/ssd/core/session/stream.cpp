@@ -5,6 +5,9 @@
 #include <src/ssd/core/session/stream.hpp>
 #include <src/ssd/core/interfaces/i-stream.hpp>
 #include <src/ssd/core/interfaces/i-context.hpp>
+#include <src/ssd/sound/converter.hpp>
+#include <src/ssd/sound/resampler.hpp>
+#include <src/ssd/sound/channel-matrix.hpp>
 #include <src/ssd/sound/interfaces/i-audio-handler.hpp>
 
 // plog
@@ -24,14 +27,24 @@
 
 // Abseil
 #include <absl/status/status.h>
+#include <absl/strings/str_format.h>
 
 // STD
+#include <chrono>
 #include <memory>
+#include <string>
+#include <cstdint>
+#include <algorithm>
 
 using namespace laar;
 
 namespace {
 
+    // capture delivery follows fragment size client asked for, but is never
+    // slower than polling of first protocol version it replaces
+    constexpr auto minCapturePeriod = std::chrono::milliseconds(1);
+    constexpr auto maxCapturePeriod = std::chrono::milliseconds(10);
+
     std::string makeUnimplementedMessage(std::source_location location = std::source_location::current()) {
         return absl::StrFormat(
             "Unimplemented API; File: \"%s\"; Function: \"%s\"; Line: %d", location.file_name(), location.function_name(), location.line()
@@ -109,6 +122,13 @@ Stream::Stream(
     , master_(std::move(master))
 {}
 
+Stream::~Stream() {
+    // audio thread keeps handle alive until it is unregistered
+    if (handle_) {
+        handle_->abort();
+    }
+}
+
 void Stream::init() {
     // do nothing
 }
@@ -117,7 +137,7 @@ Stream::operator bool() const {
     return true;
 }
 
-IContext::APIResult Stream::onClientMessage(NSound::NClient::TStreamMessage message) {
+IContext::APIResult Stream::onClientMessage(NSound::NClient::TStreamMessage& message) {
     PLOG(plog::debug) << "[stream] Handling API on stream";
 
     if (message.has_close()) {
@@ -126,24 +146,75 @@ IContext::APIResult Stream::onClientMessage(NSound::NClient::TStreamMessage mess
         return onStreamConfiguration(std::move(*message.mutable_connect()->mutable_configuration()));
     } else if (message.has_push()) {
         return onIOOperation(std::move(*message.mutable_push()));
+    } else if (message.has_pull()) {
+        return onIOOperation(std::move(*message.mutable_pull()));
+    } else if (message.has_poll()) {
+        return onPoll(std::move(*message.mutable_poll()));
     }
 
     return IContext::APIResult::unimplemented();
 }
 
 IContext::APIResult Stream::onIOOperation(NSound::NClient::TStreamMessage::TPull message) {
-    UNUSED(message);
+    PLOG(plog::debug) << "[stream] sending captured data";
 
-    return IContext::APIResult::unimplemented();
+    if (!streamConfig_.has_value() || !handle_) {
+        return IContext::APIResult::misconfiguration("pull on stream that is not connected");
+    }
+    if (streamConfig_->direction() != NSound::NCommon::TStreamConfiguration::RECORD) {
+        return IContext::APIResult::misconfiguration("received wrong IO operation: read");
+    }
+
+    // everything captured since previous pull goes in one response,
+    // bounded so that it fits network buffer along with other responses
+    std::size_t sampleSize = getSampleSize(handle_->getFormat());
+    std::size_t samples = std::min<std::size_t>(message.size(), MaxPulledBytes / sampleSize);
+
+    NSound::THolder holder;
+    std::string* data = holder.mutable_server()->mutable_stream_message()->mutable_pull()->mutable_data();
+    data->resize(samples * sampleSize);
+
+    absl::StatusOr<int> taken = handle_->read(data->data(), samples);
+    if (!taken.ok()) {
+        return IContext::APIResult{taken.status()};
+    }
+    data->resize(static_cast<std::size_t>(taken.value()) * sampleSize);
+
+    return IContext::APIResult{absl::OkStatus(), std::move(holder)};
 }
 
 IContext::APIResult Stream::onIOOperation(NSound::NClient::TStreamMessage::TPush message) {
     PLOG(plog::debug) << "[stream] receiving data";
 
+    return write(message.data().c_str(), message.size());
+}
+
+IContext::APIResult Stream::onClientFrames(const MessageFramesPayloadType& frames) {
+    PLOG(plog::debug) << "[stream] receiving frames";
+
+    if (!streamConfig_.has_value() || !handle_) {
+        return IContext::APIResult::misconfiguration("push on stream that is not connected");
+    }
+    // samples go straight from network buffer to handle, so their count is checked first
+    if (frames.data().size() != frames.samples() * getSampleSize(handle_->getFormat())) {
+        return IContext::APIResult::misconfiguration(absl::StrFormat(
+            "frames hold %d bytes, which does not match %d samples", frames.data().size(), frames.samples()
+        ));
+    }
+
+    return write(frames.data().data(), frames.samples());
+}
+
+IContext::APIResult Stream::write(const char* data, std::size_t samples) {
+    if (!streamConfig_.has_value() || !handle_) {
+        return IContext::APIResult::misconfiguration("push on stream that is not connected");
+    }
+
     if (streamConfig_->direction() == NSound::NCommon::TStreamConfiguration::PLAYBACK) {
-        auto status = handle_->write(message.data().c_str(), message.size());
+        auto status = handle_->write(data, samples);
         PLOG(plog::debug) << "write status: " << status.status().ToString();
-        return IContext::APIResult{absl::OkStatus()};
+        // every push is answered with credit left after it
+        return IContext::APIResult{absl::OkStatus(), makeStatePoll()};
     } else if (streamConfig_->direction() == NSound::NCommon::TStreamConfiguration::RECORD) {
         return IContext::APIResult::misconfiguration("received wrong IO operation: write");
     }
@@ -151,12 +222,57 @@ IContext::APIResult Stream::onIOOperation(NSound::NClient::TStreamMessage::TPush
     return IContext::APIResult::unimplemented(makeUnimplementedMessage());
 }
 
+IContext::APIResult Stream::onPoll(NSound::NClient::TStreamMessage::TPoll message) {
+    UNUSED(message);
+
+    if (!streamConfig_.has_value() || !handle_) {
+        return IContext::APIResult::misconfiguration("poll on stream that is not connected");
+    }
+    if (streamConfig_->direction() != NSound::NCommon::TStreamConfiguration::PLAYBACK) {
+        return IContext::APIResult::misconfiguration("poll is supported on playback streams only");
+    }
+
+    return IContext::APIResult{absl::OkStatus(), makeStatePoll()};
+}
+
+NSound::THolder Stream::makeStatePoll() {
+    // credit never splits frames, client writes whole ones only
+    std::size_t channels = std::max<std::size_t>(streamConfig_->sample_spec().channels(), 1);
+    std::size_t granularity = std::max<std::size_t>(streamConfig_->buffer_config().min_request_size(), channels);
+    granularity -= granularity % channels;
+
+    std::size_t writable = handle_->writableSize();
+    writable -= writable % granularity;
+
+    NSound::THolder holder;
+    holder.mutable_server()->mutable_stream_message()->mutable_state_poll()->set_writable(writable);
+    return holder;
+}
+
 IContext::APIResult Stream::onStreamConfiguration(NSound::NCommon::TStreamConfiguration message) {
     PLOG(plog::debug) << "[stream] connecting client stream";
     if (streamConfig_.has_value()) {
+        // connected stream may only change its buffer sizes
+        if (message.has_buffer_config() && handle_) {
+            return onBufferResize(std::move(*message.mutable_buffer_config()));
+        }
         return IContext::APIResult{absl::InternalError("double config on stream")};
     }
 
+    absl::StatusOr<ChannelLayout> layout = ChannelLayout::fromConfig(message);
+    if (!layout.ok()) {
+        return IContext::APIResult::misconfiguration(std::string(layout.status().message()));
+    }
+    if (message.direction() == NSound::NCommon::TStreamConfiguration::RECORD && layout->size() != 1) {
+        return IContext::APIResult::misconfiguration("capture streams support mono only");
+    }
+    // any rate in range is converted to device one by handle
+    if (absl::Status status = Resampler::checkRate(message.sample_spec().sample_rate()); !status.ok()) {
+        return IContext::APIResult::misconfiguration(std::string(status.message()));
+    }
+    // client learns layout server actually remixes with
+    layout->toConfig(message.mutable_channel_map());
+
     if (auto handler = handler_.lock(); handler) {
         switch (message.direction()) {
             case NSound::NCommon::TStreamConfiguration::PLAYBACK:
@@ -169,6 +285,10 @@ IContext::APIResult Stream::onStreamConfiguration(NSound::NCommon::TStreamConfig
                 return IContext::APIResult::unimplemented(makeUnimplementedMessage());
         }
     }
+    // client learns sizes server picked within its limits
+    if (handle_) {
+        *message.mutable_buffer_config() = handle_->getBufferConfig();
+    }
 
     PLOG(plog::debug) << dumpStreamConfig(message);
 
@@ -179,6 +299,21 @@ IContext::APIResult Stream::onStreamConfiguration(NSound::NCommon::TStreamConfig
     return IContext::APIResult{absl::OkStatus(), std::move(holder)};
 }
 
+IContext::APIResult Stream::onBufferResize(NSound::NCommon::TStreamConfiguration::TBufferConfiguration message) {
+    PLOG(plog::debug) << "[stream] resizing stream buffer";
+
+    absl::StatusOr<NSound::NCommon::TStreamConfiguration::TBufferConfiguration> resized = handle_->resize(std::move(message));
+    if (!resized.ok()) {
+        return IContext::APIResult{resized.status()};
+    }
+
+    *streamConfig_->mutable_buffer_config() = std::move(resized.value());
+    NSound::THolder holder;
+    holder.mutable_server()->mutable_stream_message()->mutable_connect_confirmal()->mutable_configuration()->CopyFrom(streamConfig_.value());
+    holder.mutable_server()->mutable_stream_message()->mutable_connect_confirmal()->set_opened(true);
+    return IContext::APIResult{absl::OkStatus(), std::move(holder)};
+}
+
 IContext::APIResult Stream::onDrain(NSound::NCommon::TStreamDirective message) {
     UNUSED(message);
 
@@ -195,12 +330,25 @@ IContext::APIResult Stream::onClose(NSound::NClient::TStreamMessage::TClose mess
     UNUSED(message);
 
     PLOG(plog::debug) << "[stream] closing stream";
+    if (handle_) {
+        handle_->abort();
+    }
     if (auto master = master_.lock()) {
         master->wrapClose(context_, weak_from_this());
     }
     return IContext::APIResult{absl::OkStatus()};
 }
 
+std::chrono::microseconds Stream::capturePeriod() const {
+    if (!streamConfig_.has_value() || !streamConfig_->sample_spec().sample_rate()) {
+        return maxCapturePeriod;
+    }
+
+    std::uint64_t frames = streamConfig_->buffer_config().fragment_size() / std::max<std::uint32_t>(streamConfig_->sample_spec().channels(), 1);
+    std::chrono::microseconds period(frames * 1000000 / streamConfig_->sample_spec().sample_rate());
+    return std::clamp<std::chrono::microseconds>(period, minCapturePeriod, maxCapturePeriod);
+}
+
 void Stream::onBufferDrained(int status) {
     UNUSED(status);
 }
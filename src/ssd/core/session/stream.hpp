@@ -13,6 +13,7 @@
 #include <boost/system/detail/error_code.hpp>
 
 // protos
+#include <protos/holder.pb.h>
 #include <protos/client/stream.pb.h>
 #include <protos/common/directives.pb.h>
 #include <protos/common/stream-configuration.pb.h>
@@ -21,6 +22,7 @@
 #include <absl/status/status.h>
 
 // STD
+#include <chrono>
 #include <memory>
 
 
@@ -38,15 +40,21 @@ namespace laar {
             std::weak_ptr<IStreamHandler> handler
         );
 
+        ~Stream();
+
         // IStream implementation
         virtual void init() override;
         virtual operator bool() const override;
-        virtual IContext::APIResult onClientMessage(NSound::NClient::TStreamMessage message) override;
+        virtual IContext::APIResult onClientMessage(NSound::NClient::TStreamMessage& message) override;
+        virtual IContext::APIResult onClientFrames(const MessageFramesPayloadType& frames) override;
 
         // IStreamHandler::IHandle::IListener implementation
         virtual void onBufferDrained(int status) override;
         virtual void onBufferFlushed(int status) override;
 
+        // how often captured samples are sent to client that subscribed to them
+        std::chrono::microseconds capturePeriod() const;
+
     private:
 
         Stream() = delete;
@@ -66,11 +74,18 @@ namespace laar {
         IContext::APIResult onIOOperation(NSound::NClient::TStreamMessage::TPull message);
         IContext::APIResult onIOOperation(NSound::NClient::TStreamMessage::TPush message);
         IContext::APIResult onClose(NSound::NClient::TStreamMessage::TClose message);
+        IContext::APIResult onPoll(NSound::NClient::TStreamMessage::TPoll message);
         IContext::APIResult onStreamConfiguration(NSound::NCommon::TStreamConfiguration message);
+        IContext::APIResult onBufferResize(NSound::NCommon::TStreamConfiguration::TBufferConfiguration message);
 
         IContext::APIResult onDrain(NSound::NCommon::TStreamDirective message);
         IContext::APIResult onFlush(NSound::NCommon::TStreamDirective message);
 
+        // playback credit: free space of handle in whole min_request_size chunks
+        NSound::THolder makeStatePoll();
+        // pushed samples of either message type go here
+        IContext::APIResult write(const char* data, std::size_t samples);
+
     private:
         std::shared_ptr<boost::asio::io_context> context_;
 
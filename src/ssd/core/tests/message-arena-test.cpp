@@ -0,0 +1,114 @@
+// GTest
+#include <gtest/gtest.h>
+
+// standard
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// laar
+#include <src/ssd/macros.hpp>
+#include <src/ssd/core/message.hpp>
+#include <src/ssd/core/message-arena.hpp>
+
+// protobuf
+#include <google/protobuf/arena.h>
+#include <google/protobuf/util/message_differencer.h>
+
+// protos
+#include <protos/holder.pb.h>
+
+namespace {
+
+    NSound::THolder makePull(std::uint32_t stream, std::size_t bytes) {
+        NSound::THolder holder;
+        holder.mutable_server()->mutable_stream_message()->set_stream_id(stream);
+        holder.mutable_server()->mutable_stream_message()->mutable_pull()->set_data(std::string(bytes, 'x'));
+        return holder;
+    }
+
+    // writes holders back to back and parses them in view mode
+    std::vector<laar::Message> parseViews(const std::vector<NSound::THolder>& holders, std::unique_ptr<std::uint8_t[]>& buffer) {
+        const std::size_t bufferSize = laar::MaxBytesOnMessage;
+        buffer = std::make_unique<std::uint8_t[]>(bufferSize);
+        auto factory = laar::MessageFactory::configure();
+
+        std::size_t shift = 0;
+        for (const auto& holder : holders) {
+            laar::Message message = factory->withType(laar::message::type::PROTOBUF).withPayload(holder).construct().constructed();
+            message.writeToArray(buffer.get() + shift, bufferSize - shift);
+            shift += laar::Message::Size::total(&message);
+        }
+
+        factory->withViews(true);
+        std::size_t remains = bufferSize;
+        std::vector<laar::Message> parsed;
+        while (parsed.size() < holders.size()) {
+            factory->parse(buffer.get() + (bufferSize - remains), remains);
+            if (factory->isParsedAvailable()) {
+                parsed.push_back(factory->parsed());
+            }
+        }
+        return parsed;
+    }
+
+}
+
+TEST(MessageArenaTest, ParsesViewsOntoArena) {
+    std::unique_ptr<std::uint8_t[]> buffer;
+    std::vector<NSound::THolder> holders = {makePull(0, 16), makePull(1, 32)};
+    auto parsed = parseViews(holders, buffer);
+
+    laar::MessageArena arena;
+    for (std::size_t index = 0; index < parsed.size(); ++index) {
+        NSound::THolder* holder = arena.parse(parsed[index]);
+        ASSERT_NE(holder, nullptr);
+        EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(*holder, holders[index]));
+    }
+    arena.reset();
+
+    auto stats = arena.collectStats();
+    EXPECT_EQ(stats.batches, 1u);
+    EXPECT_EQ(stats.messages, 2u);
+    EXPECT_GT(stats.bytesUsed, 0u);
+    EXPECT_EQ(stats.spills, 0u);
+
+    // counters start over
+    EXPECT_EQ(arena.collectStats().messages, 0u);
+}
+
+TEST(MessageArenaTest, OwnedPayloadStaysInMessage) {
+    auto factory = laar::MessageFactory::configure();
+    laar::Message message = factory->withType(laar::message::type::PROTOBUF).withPayload(makePull(3, 8)).construct().constructed();
+
+    laar::MessageArena arena;
+    NSound::THolder* holder = arena.parse(message);
+    ASSERT_NE(holder, nullptr);
+    EXPECT_EQ(holder->server().stream_message().stream_id(), 3u);
+    EXPECT_EQ(arena.collectStats().messages, 0u);
+
+    laar::Message simple = factory->withType(laar::message::type::SIMPLE).withPayload(laar::ACK).construct().constructed();
+    EXPECT_EQ(arena.parse(simple), nullptr);
+}
+
+TEST(MessageArenaTest, CountsSpilledBatches) {
+    std::unique_ptr<std::uint8_t[]> buffer;
+    auto parsed = parseViews(std::vector<NSound::THolder>(32, makePull(0, 8)), buffer);
+
+    laar::MessageArena arena(1024);
+    for (auto& message : parsed) {
+        ASSERT_NE(arena.parse(message), nullptr);
+    }
+    arena.reset();
+
+    // batch that fits block again does not spill
+    ASSERT_NE(arena.parse(parsed[0]), nullptr);
+    arena.reset();
+
+    auto stats = arena.collectStats();
+    EXPECT_EQ(stats.batches, 2u);
+    EXPECT_EQ(stats.messages, 33u);
+    EXPECT_EQ(stats.spills, 1u);
+    EXPECT_GT(stats.peakBytes, 1024u);
+}
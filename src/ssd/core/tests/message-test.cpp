@@ -2,10 +2,14 @@
 #include <gtest/gtest.h>
 
 // standard
+#include <span>
 #include <cmath>
 #include <memory>
+#include <vector>
 #include <cstdint>
+#include <numeric>
 #include <iostream>
+#include <algorithm>
 
 // laar
 #include <src/ssd/macros.hpp>
@@ -188,4 +192,132 @@ TEST_F(MessageTest, TestParsingMultiple) {
         ASSERT_EQ(google::protobuf::util::MessageDifferencer::Equals(laar::messagePayload<laar::message::type::PROTOBUF>(parsed), message), true);
     }
 
-}
\ No newline at end of file
+}
+TEST_F(MessageTest, TestFramesParsing) {
+    std::vector<char> samples(96);
+    std::iota(samples.begin(), samples.end(), 0);
+
+    // constructed payload owns samples, source may be reused right away
+    factory
+        ->withMessageVersion(laar::message::version::FIRST, true)
+        .withType(laar::message::type::FRAMES, true)
+        .withPayload(laar::FramesPayload::copy(3, 48, std::span<const char>(samples)))
+        .construct();
+    std::vector<char> expected = samples;
+    std::fill(samples.begin(), samples.end(), 0);
+
+    const std::size_t bufferSize = laar::MaxBytesOnMessage;
+    auto buffer = std::make_unique<std::uint8_t[]>(bufferSize);
+
+    laar::Message message = factory->constructed();
+    ASSERT_EQ(laar::Message::Size::payload(&message), laar::FramesPayload::HeaderSize + expected.size());
+    message.writeToArray(buffer.get(), bufferSize);
+
+    std::size_t remains = bufferSize;
+    while (!factory->isParsedAvailable()) {
+        factory->parse(buffer.get() + (bufferSize - remains), remains);
+    }
+
+    laar::Message parsed = factory->parsed();
+    ASSERT_EQ(message.compareMetadata(parsed), true);
+    laar::MessageFramesPayloadType frames = laar::messagePayload<laar::message::type::FRAMES>(parsed);
+    ASSERT_EQ(frames.stream(), 3);
+    ASSERT_EQ(frames.samples(), 48);
+    ASSERT_EQ(std::vector<char>(frames.data().begin(), frames.data().end()), expected);
+    // parsed samples are not copied out of receive buffer
+    ASSERT_EQ(reinterpret_cast<const std::uint8_t*>(frames.data().data()), 
+        buffer.get() + laar::Message::Size::header() + laar::Message::Size::variable(&parsed) + laar::FramesPayload::HeaderSize);
+}
+
+TEST_F(MessageTest, TestViewParsing) {
+    NSound::THolder push;
+    push.mutable_client()->mutable_stream_message()->set_stream_id(2);
+    push.mutable_client()->mutable_stream_message()->mutable_push()->set_data(std::string(400, 'x'));
+    push.mutable_client()->mutable_stream_message()->mutable_push()->set_size(200);
+
+    NSound::THolder connect;
+    connect.mutable_client()->mutable_stream_message()->set_stream_id(UINT32_MAX);
+    connect.mutable_client()->mutable_stream_message()->mutable_connect()->mutable_configuration()->set_stream_name("view");
+
+    const std::size_t bufferSize = laar::MaxBytesOnMessage;
+    auto buffer = std::make_unique<std::uint8_t[]>(bufferSize);
+
+    std::size_t shift = 0;
+    for (const auto& holder : {push, connect}) {
+        laar::Message message = factory->withType(laar::message::type::PROTOBUF).withPayload(holder).construct().constructed();
+        message.writeToArray(buffer.get() + shift, bufferSize - shift);
+        shift += laar::Message::Size::total(&message);
+    }
+
+    factory->withViews(true);
+    std::size_t remains = bufferSize;
+    std::vector<laar::Message> parsed;
+    while (parsed.size() < 2) {
+        factory->parse(buffer.get() + (bufferSize - remains), remains);
+        if (factory->isParsedAvailable()) {
+            parsed.push_back(factory->parsed());
+        }
+    }
+
+    // push data is sliced out of buffer as is
+    auto view = laar::messageView(parsed[0]);
+    ASSERT_TRUE(view.has_value());
+    auto peeked = laar::peekPush(view.value());
+    ASSERT_TRUE(peeked.has_value());
+    ASSERT_EQ(peeked->stream, 2);
+    ASSERT_EQ(peeked->samples, 200);
+    ASSERT_EQ(peeked->data, std::string(400, 'x'));
+    ASSERT_GE(reinterpret_cast<const std::uint8_t*>(peeked->data.data()), buffer.get());
+    ASSERT_LT(reinterpret_cast<const std::uint8_t*>(peeked->data.data()), buffer.get() + shift);
+
+    // anything else is not a push and is parsed on access
+    auto other = laar::messageView(parsed[1]);
+    ASSERT_TRUE(other.has_value());
+    ASSERT_FALSE(laar::peekPush(other.value()).has_value());
+    ASSERT_TRUE(google::protobuf::util::MessageDifferencer::Equals(laar::messagePayload<laar::message::type::PROTOBUF>(parsed[1]), connect));
+    ASSERT_TRUE(google::protobuf::util::MessageDifferencer::Equals(laar::messagePayload<laar::message::type::PROTOBUF>(parsed[0]), push));
+
+    // malformed input is rejected rather than read past its end
+    std::vector<std::uint8_t> truncated(view->begin(), view->end() - 10);
+    ASSERT_FALSE(laar::peekPush(laar::MessageViewPayloadType(truncated)).has_value());
+}
+
+TEST_F(MessageTest, TestSequencedParsing) {
+    NSound::THolder holder;
+    initMessage(holder);
+
+    std::vector<laar::Message> messages;
+    messages.push_back(factory->withMessageVersion(laar::message::version::DUPLEX).withType(laar::message::type::SIMPLE).withPayload(laar::ACK).construct().constructed());
+    messages.push_back(factory->withType(laar::message::type::PROTOBUF).withPayload(holder).construct().constructed());
+    // unsequenced messages keep first version layout
+    ASSERT_FALSE(messages.back().sequence().has_value());
+    ASSERT_EQ(laar::Message::Size::variable(&messages.back()), sizeof(laar::Message::SizeType));
+
+    const std::size_t bufferSize = laar::MaxBytesOnMessage;
+    auto buffer = std::make_unique<std::uint8_t[]>(bufferSize);
+    std::size_t shift = 0;
+    for (std::size_t index = 0; index < messages.size(); ++index) {
+        messages[index].setSequence(7 - index);
+        messages[index].writeToArray(buffer.get() + shift, bufferSize - shift);
+        shift += laar::Message::Size::total(&messages[index]);
+    }
+
+    factory->withSequencing(true);
+    ASSERT_EQ(factory->next(), laar::Message::Size::header() + sizeof(laar::Message::SequenceType) + sizeof(laar::Message::SizeType));
+
+    std::size_t remains = bufferSize;
+    std::vector<laar::Message> parsed;
+    while (parsed.size() < messages.size()) {
+        factory->parse(buffer.get() + (bufferSize - remains), remains);
+        if (factory->isParsedAvailable()) {
+            parsed.push_back(factory->parsed());
+        }
+    }
+    ASSERT_EQ(bufferSize - remains, shift);
+
+    ASSERT_EQ(parsed[0].version(), laar::message::version::DUPLEX);
+    ASSERT_EQ(parsed[0].sequence(), 7u);
+    ASSERT_EQ(laar::messagePayload<laar::message::type::SIMPLE>(parsed[0]), laar::ACK);
+    ASSERT_EQ(parsed[1].sequence(), 6u);
+    ASSERT_TRUE(google::protobuf::util::MessageDifferencer::Equals(laar::messagePayload<laar::message::type::PROTOBUF>(parsed[1]), holder));
+}
@@ -81,9 +81,16 @@ namespace laar {
     inline constexpr int MaxBytesOnMessage = 4096;
     inline constexpr int StreamTrailSize = 100;
     inline constexpr int NetworkBufferSize = 8192;
+    // captured data sent back on one pull, leaves room for other responses of the cycle
+    inline constexpr int MaxPulledBytes = MaxBytesOnMessage - StreamTrailSize;
     inline constexpr int Port = 7777;
+    // unix socket of server, created in its runtime directory
+    inline constexpr const char* SocketName = "server.sock";
     inline constexpr int BaseSampleRate = 44100;
-    inline constexpr std::int32_t Silence = INT32_MIN;
+    // streams outside of it are refused, device rate too
+    inline constexpr int MinSampleRate = 8000;
+    inline constexpr int MaxSampleRate = 192000;
+    inline constexpr std::int32_t Silence = 0;
     inline constexpr std::int32_t BaseSampleSize = sizeof Silence;
 
     // Simple protocol directives
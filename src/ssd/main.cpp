@@ -22,6 +22,7 @@
 // laar
 #include <src/ssd/core/server.hpp>
 #include <src/ssd/util/config-loader.hpp>
+#include <src/ssd/util/thread-tuning.hpp>
 #include <src/ssd/sound/audio-handler.hpp>
 
 ABSL_FLAG(std::optional<std::string>, runtime_dir, std::nullopt, 
@@ -54,22 +55,42 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    // io threads serve network and sessions, kept off audio cpus if configured
+    auto networkThreads = std::make_shared<laar::ThreadSettings>();
+    configHandler->subscribeOnDefaultConfig("network", [networkThreads](const nlohmann::json& config) {
+        if (auto settings = laar::ThreadSettings::parse(config); settings.ok()) {
+            *networkThreads = std::move(settings.value());
+        } else {
+            PLOG(plog::warning) << "network thread settings ignored: " << settings.status().message();
+        }
+    }, networkThreads);
+    laar::ThreadSettings networkSettings = *networkThreads;
+    PLOG(plog::info) << "network threads: " << laar::toString(networkSettings);
+
     auto soundHandler = laar::SoundHandler::configure(configHandler, context);
     soundHandler->init();
     PLOG(plog::debug) << "module created: " << "SoundHandler; instance: " << soundHandler.get();
 
-    auto server = laar::Server::create(soundHandler, context, laar::Port);
+    auto server = laar::Server::create(soundHandler, context, laar::Port, absl::StrCat(runtimeDirectory, "/", laar::SocketName));
     server->init();
     PLOG(plog::debug) << "module created: " << "Server; instance: " << soundHandler.get();
 
     auto guard = boost::asio::make_work_guard(*context);
 
+    auto tune = [](const laar::ThreadSettings& settings) {
+        if (absl::Status status = laar::tuneCurrentThread(settings); !status.ok()) {
+            PLOG(plog::warning) << "network thread runs with default scheduling: " << status.message();
+        }
+    };
+
     for (std::size_t tNum = 0; tNum < threads; ++tNum) {
-        boost::asio::post(*tPool, [context]() {
+        boost::asio::post(*tPool, [context, tune, networkSettings]() {
+            tune(networkSettings);
             context->run();
         });
     }
 
+    tune(networkSettings);
     context->run();
 
     return 0;
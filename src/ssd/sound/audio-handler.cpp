@@ -3,9 +3,12 @@
 #include <boost/asio/dispatch.hpp>
 
 // laar
+#include <src/ssd/sound/mixer.hpp>
+#include <src/ssd/sound/resampler.hpp>
 #include <src/ssd/sound/read-handle.hpp>
 #include <src/ssd/sound/write-handle.hpp>
 #include <src/ssd/util/config-loader.hpp>
+#include <src/ssd/util/thread-tuning.hpp>
 #include <src/ssd/sound/audio-handler.hpp>
 #include <src/ssd/sound/interfaces/i-audio-handler.hpp>
 #include <src/ssd/sound/dispatchers/tube-dispatcher.hpp>
@@ -28,11 +31,12 @@
 #include <mutex>
 #include <queue>
 #include <cctype>
+#include <chrono>
 #include <memory>
-#include <future>
 #include <utility>
 #include <vector>
 #include <cstdint>
+#include <cstring>
 #include <stdexcept>
 #include <exception>
 #include <algorithm>
@@ -56,8 +60,12 @@ namespace {
     constexpr int inChannelShift = 0;
     constexpr int outChannelShift = 0;
     constexpr int inChannelsCount = 1;
-    constexpr int outChannelsCount = 2;
-    constexpr int bufferFrames = 1000;
+    constexpr int defaultOutChannelsCount = 2;
+    constexpr unsigned int defaultPeriodFrames = 1000;
+    constexpr unsigned int minPeriodFrames = 16;
+    constexpr unsigned int maxPeriodFrames = 8192;
+    constexpr unsigned int maxPeriods = 32;
+    constexpr auto sweepInterval = std::chrono::milliseconds(100);
 
 }
 
@@ -73,23 +81,43 @@ SoundHandler::SoundHandler(
     std::shared_ptr<boost::asio::io_context> context,
     Private /* access */
 )
-    : clean_(true)
-    , context_(std::move(context))
+    : context_(std::move(context))
+    , poolStats_{}
     , configHandler_(std::move(configHandler))
-    , bassDispatcher_(laar::BassRouterDispatcher::create(
-        ESamplesOrder::NONINTERLEAVED, 
-        ESamples::SIGNED_32_LITTLE_ENDIAN,
-        BaseSampleRate,
-        BassRouterDispatcher::BassRange(20, 250),
-        BassRouterDispatcher::ChannelInfo(0, 1))
-    )
+    , outLayout_(ChannelLayout::byCount(defaultOutChannelsCount).value())
+    , deviceRate_(BaseSampleRate)
+    , isInterleaved_(false)
+    , delayFrames_(0)
+    , delayPosition_(0)
+    , frontLeft_(0)
+    , frontRight_(0)
+    , lfe_(0)
     , local_(nullptr)
     , audio_(RtAudio::Api::LINUX_ALSA)
-{}
+{
+    settings_.outputChannels = defaultOutChannelsCount;
+    settings_.sampleRate = BaseSampleRate;
+    settings_.periodFrames = defaultPeriodFrames;
+    settings_.periods = 0;
+    settings_.isInterleaved = false;
+    settings_.minimizeLatency = true;
+    settings_.lockMemory = false;
+}
+
+SoundHandler::~SoundHandler() {
+    // callbacks hold plain pointer to handler, so stream stops before any member is torn down
+    if (audio_.isStreamOpen()) {
+        if (audio_.isStreamRunning()) {
+            audio_.stopStream();
+        }
+        audio_.closeStream();
+    }
+}
 
 void SoundHandler::init() {
     std::call_once(init_, [this](){
             local_ = makeLocalData();
+            scheduleSweep();
 
             configHandler_->subscribeOnDefaultConfig(
                 SOUND_SECTION, 
@@ -99,6 +127,44 @@ void SoundHandler::init() {
                 weak_from_this()
             );
 
+            if (auto layout = ChannelLayout::byCount(settings_.outputChannels); layout.ok()) {
+                outLayout_ = std::move(layout.value());
+            } else {
+                PLOG(plog::warning) << "output layout ignored: " << layout.status().message();
+            }
+            PLOG(plog::info) << "output layout: " << outLayout_.toString();
+
+            if (absl::Status status = Resampler::checkRate(settings_.sampleRate); status.ok()) {
+                deviceRate_ = settings_.sampleRate;
+            } else {
+                PLOG(plog::warning) << "device sample rate ignored: " << status.message();
+            }
+            PLOG(plog::info) << "device sample rate: " << deviceRate_;
+
+            // crossover depends on device rate, so dispatcher is built once it is known
+            bassDispatcher_ = laar::BassRouterDispatcher::create(
+                ESamplesOrder::NONINTERLEAVED, 
+                ESamples::SIGNED_32_LITTLE_ENDIAN,
+                deviceRate_,
+                BassRouterDispatcher::BassRange(20, 250),
+                BassRouterDispatcher::ChannelInfo(0, 1)
+            );
+
+            local_->audioThread = settings_.audioThread;
+
+            // stream buffers are taken from pool, so it is mapped before memory gets locked
+            if (settings_.streamPool.blocks) {
+                if (auto pool = BufferPool::create(settings_.streamPool); pool.ok()) {
+                    pool_ = std::move(pool.value());
+                    poolStats_ = pool_->collectStats();
+                    PLOG(plog::info) 
+                        << "stream pool: " << poolStats_.blocks << " blocks in " << poolStats_.reservedBytes 
+                        << " bytes, huge pages: " << poolStats_.isHuge;
+                } else {
+                    PLOG(plog::warning) << "stream buffers are allocated on heap: " << pool.status().message();
+                }
+            }
+
             auto inputDevice = probeDevices(true);
             auto outputDevice = probeDevices(false);
 
@@ -124,6 +190,15 @@ void SoundHandler::init() {
             } else {
                 onError(std::runtime_error("at least one option for stream type must be enabled"));
             }
+
+            // stream buffers, mix bus and dsp stage are allocated by now
+            if (settings_.lockMemory) {
+                if (absl::Status status = lockMemory(); status.ok()) {
+                    PLOG(plog::info) << "memory locked";
+                } else {
+                    PLOG(plog::warning) << "working set may be paged out: " << status.message();
+                }
+            }
         }
     );
 }
@@ -133,19 +208,18 @@ absl::Status SoundHandler::openDuplexStream(unsigned int devInput, unsigned int
         .deviceId = devInput, .nChannels = inChannelsCount, .firstChannel = inChannelShift
     };
     RtAudio::StreamParameters outParams {
-        .deviceId = devOutput, .nChannels = outChannelsCount, .firstChannel = outChannelShift
+        .deviceId = devOutput, .nChannels = static_cast<unsigned int>(outLayout_.size()), .firstChannel = outChannelShift
     };
 
-    unsigned int bufferFrames = ::bufferFrames;
-    RtAudio::StreamOptions options;
-    options.flags = RTAUDIO_MINIMIZE_LATENCY & RTAUDIO_NONINTERLEAVED;
+    unsigned int bufferFrames = settings_.periodFrames;
+    RtAudio::StreamOptions options = makeStreamOptions();
 
     if (RtAudioErrorType error = 
         audio_.openStream(
             &outParams, 
             &inParams, 
             RTAUDIO_SINT32, 
-            BaseSampleRate, 
+            static_cast<unsigned int>(deviceRate_), 
             &bufferFrames, 
             &laar::duplexCallback,
             (void*)local_.get(),
@@ -155,29 +229,29 @@ absl::Status SoundHandler::openDuplexStream(unsigned int devInput, unsigned int
         return absl::InternalError(audio_.getErrorText());
     }
 
+    isInterleaved_ = !(options.flags & RTAUDIO_NONINTERLEAVED);
+    preparePlayback(bufferFrames);
     audio_.startStream();
-    PLOG(plog::info) 
-        << "duplex stream opened with nframes buffer: " << bufferFrames 
-        << " with device ids: out: " << devOutput << " and in: " << devInput;
+    PLOG(plog::info) << "duplex stream opened with device ids: out: " << devOutput << " and in: " << devInput;
+    reportStream(bufferFrames, options);
 
     return absl::OkStatus(); 
 }
 
 absl::Status SoundHandler::openPlayback(unsigned int dev) {
     RtAudio::StreamParameters outParams {
-        .deviceId = dev, .nChannels = outChannelsCount, .firstChannel = outChannelShift
+        .deviceId = dev, .nChannels = static_cast<unsigned int>(outLayout_.size()), .firstChannel = outChannelShift
     };
 
-    unsigned int bufferFrames = ::bufferFrames;
-    RtAudio::StreamOptions options;
-    options.flags = RTAUDIO_MINIMIZE_LATENCY & RTAUDIO_NONINTERLEAVED;
+    unsigned int bufferFrames = settings_.periodFrames;
+    RtAudio::StreamOptions options = makeStreamOptions();
 
     if (RtAudioErrorType error = 
         audio_.openStream(
             &outParams, 
             nullptr, 
             RTAUDIO_SINT32, 
-            BaseSampleRate, 
+            static_cast<unsigned int>(deviceRate_), 
             &bufferFrames, 
             &laar::writeCallback,
             (void*)local_.get(),
@@ -187,10 +261,11 @@ absl::Status SoundHandler::openPlayback(unsigned int dev) {
         return absl::InternalError(audio_.getErrorText());
     }
 
+    isInterleaved_ = !(options.flags & RTAUDIO_NONINTERLEAVED);
+    preparePlayback(bufferFrames);
     audio_.startStream();
-    PLOG(plog::info) 
-        << "output stream opened with nframes buffer: " << bufferFrames 
-        << " with device id: " << dev;
+    PLOG(plog::info) << "output stream opened with device id: " << dev;
+    reportStream(bufferFrames, options);
 
     return absl::OkStatus(); 
 }
@@ -200,16 +275,15 @@ absl::Status SoundHandler::openCapture(unsigned int dev) {
         .deviceId = dev, .nChannels = inChannelsCount, .firstChannel = inChannelShift
     };
 
-    unsigned int bufferFrames = ::bufferFrames;
-    RtAudio::StreamOptions options;
-    options.flags = RTAUDIO_MINIMIZE_LATENCY & RTAUDIO_NONINTERLEAVED;
+    unsigned int bufferFrames = settings_.periodFrames;
+    RtAudio::StreamOptions options = makeStreamOptions();
 
     if (RtAudioErrorType error = 
         audio_.openStream(
             nullptr, 
             &inParams, 
             RTAUDIO_SINT32, 
-            BaseSampleRate, 
+            static_cast<unsigned int>(deviceRate_), 
             &bufferFrames, 
             &laar::readCallback,
             (void*)local_.get(),
@@ -220,13 +294,45 @@ absl::Status SoundHandler::openCapture(unsigned int dev) {
     }
 
     audio_.startStream();
-    PLOG(plog::info) 
-        << "input stream opened with nframes buffer: " << bufferFrames 
-        << " with device id: " << dev;
+    PLOG(plog::info) << "input stream opened with device id: " << dev;
+    reportStream(bufferFrames, options);
 
     return absl::OkStatus();
 }
 
+RtAudio::StreamOptions SoundHandler::makeStreamOptions() const {
+    RtAudio::StreamOptions options;
+    options.flags = 0;
+    if (!settings_.isInterleaved) {
+        // mix graph produces one plane per channel, so planar devices need no reordering
+        options.flags |= RTAUDIO_NONINTERLEAVED;
+    }
+    if (settings_.minimizeLatency) {
+        options.flags |= RTAUDIO_MINIMIZE_LATENCY;
+    }
+    if (settings_.audioThread.policy != ESchedulingPolicy::OTHER) {
+        // backend creates thread with SCHED_RR and quietly falls back when it is not permitted,
+        // exact policy and pinning are applied from the thread itself
+        options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+        options.priority = settings_.audioThread.priority;
+    }
+    // zero lets backend pick
+    options.numberOfBuffers = settings_.periods;
+    return options;
+}
+
+void SoundHandler::reportStream(unsigned int periodFrames, const RtAudio::StreamOptions& options) {
+    // backend writes back what it actually configured into frames and options
+    PLOG(plog::info) 
+        << "negotiated period: " << periodFrames << " frames (requested " << settings_.periodFrames << ")"
+        << "; periods: " << options.numberOfBuffers << " (requested " << settings_.periods << ")"
+        << "; sample rate: " << audio_.getStreamSampleRate()
+        << "; latency: " << audio_.getStreamLatency() << " frames"
+        << "; interleaved: " << std::boolalpha << !(options.flags & RTAUDIO_NONINTERLEAVED)
+        << "; minimize latency: " << static_cast<bool>(options.flags & RTAUDIO_MINIMIZE_LATENCY)
+        << "; audio thread: " << toString(settings_.audioThread);
+}
+
 unsigned int SoundHandler::probeDevices(bool isInput) noexcept {
 
     constexpr unsigned int highPriority = 2;
@@ -248,6 +354,7 @@ unsigned int SoundHandler::probeDevices(bool isInput) noexcept {
         // required to pass
         status &= checkSampleRate(info, verdict);
         status &= checkSampleFormat(info, verdict);
+        status &= checkChannels(info, isInput, verdict);
         
         std::int64_t priority = 0;
         if (status) {
@@ -285,7 +392,7 @@ unsigned int SoundHandler::probeDevices(bool isInput) noexcept {
 
 bool SoundHandler::checkSampleRate(const RtAudio::DeviceInfo& info, std::string& verdict) noexcept {
     if (
-        auto iter = std::find(info.sampleRates.begin(), info.sampleRates.end(), laar::BaseSampleRate); 
+        auto iter = std::find(info.sampleRates.begin(), info.sampleRates.end(), deviceRate_); 
         iter == info.sampleRates.end()
     ) {
         std::string available;
@@ -301,7 +408,7 @@ bool SoundHandler::checkSampleRate(const RtAudio::DeviceInfo& info, std::string&
             &verdict, 
             absl::StrFormat(
                 "device does not have %d sample rate available, only the following are supported: %s",
-                laar::BaseSampleRate,
+                deviceRate_,
                 available
             )
         );
@@ -309,7 +416,7 @@ bool SoundHandler::checkSampleRate(const RtAudio::DeviceInfo& info, std::string&
         return false;
     }
 
-    absl::StrAppend(&verdict, absl::StrFormat("device supports requested sample rate: %d; ", laar::BaseSampleRate));
+    absl::StrAppend(&verdict, absl::StrFormat("device supports requested sample rate: %d; ", deviceRate_));
     return true;
 }
 
@@ -338,6 +445,19 @@ bool SoundHandler::checkSampleFormat(const RtAudio::DeviceInfo& info, std::strin
     return true;
 }
 
+bool SoundHandler::checkChannels(const RtAudio::DeviceInfo& info, bool isInput, std::string& verdict) noexcept {
+    unsigned int available = (isInput) ? info.inputChannels : info.outputChannels;
+    unsigned int required = (isInput) ? inChannelsCount : outLayout_.size();
+
+    if (available < required) {
+        absl::StrAppend(&verdict, absl::StrFormat("device has %d channels, %d are required; ", available, required));
+        return false;
+    }
+
+    absl::StrAppend(&verdict, absl::StrFormat("device has %d channels; ", available));
+    return true;
+}
+
 bool SoundHandler::checkName(const RtAudio::DeviceInfo& info, std::string& /* verdict */) noexcept {
     std::string name = info.name;
     std::for_each(name.begin(), name.end(), [](char& ch) {
@@ -350,8 +470,13 @@ bool SoundHandler::checkName(const RtAudio::DeviceInfo& info, std::string& /* ve
 
 std::unique_ptr<SoundHandler::LocalData> SoundHandler::makeLocalData() {
     auto data = std::make_unique<LocalData>();
-    data->object = shared_from_this();
+    data->object = this;
     data->abort = false;
+    data->failedReads = 0;
+    data->failedWrites = 0;
+    data->isThreadTuned = false;
+    data->isTuningDone = false;
+    data->isTuningReported = false;
 
     return data;
 }
@@ -385,59 +510,43 @@ int laar::writeCallback(
     void* local) 
 {
     auto data = (SoundHandler::LocalData*) local;
-    auto handler = data->object.lock();
-
-    if (!handler) {
-        // abort stream
-        PLOG(plog::warning) << "handler is nullptr, exiting on playback stream";
-        return rtcontrol::ABORT;
-    }
+    // stream is closed before handler goes away, so pointer is valid here
+    SoundHandler* handler = data->object;
 
     if (data->abort) {
-        PLOG(plog::warning) << "draining and aborting playback stream";
         // drain stream and close it
         return rtcontrol::DRAIN;
     }
 
+    handler->tuneAudioThread();
+
+    // mix graph renders planes, interleaved devices get them woven afterwards
     auto result = (std::int32_t*) out;
-    if (handler->clean_) {
-        // fill with silence until we acquire valid source
-        std::memset(result, laar::Silence, frames);
-        return rtcontrol::SUCCESS;
+    std::int32_t* planes = result;
+    if (handler->isInterleaved_) {
+        if (frames * handler->outLayout_.size() > handler->planes_.size()) {
+            std::fill_n(result, frames * handler->outLayout_.size(), Silence);
+            return rtcontrol::SUCCESS;
+        }
+        planes = handler->planes_.data();
     }
 
-    std::unique_ptr<int32_t[]> buffer;
+    // device mix goes out full range, bass routing only adds low end to lfe
+    handler->squash(planes, frames);
+    if (handler->dsp_ && frames <= handler->dry_.size()) {
+        handler->routeBass(planes, frames);
+    }
 
-    buffer = handler->squash(frames);
-    for (std::size_t channel = 0; channel < 2; ++channel) {
-        for (std::size_t sample = 0; sample < frames; ++sample) {
-            result[channel * frames + sample] = buffer[sample];
+    if (handler->isInterleaved_) {
+        const std::size_t channels = handler->outLayout_.size();
+        for (std::size_t channel = 0; channel < channels; ++channel) {
+            const std::int32_t* plane = planes + channel * frames;
+            for (std::size_t frame = 0; frame < frames; ++frame) {
+                result[frame * channels + channel] = plane[frame];
+            }
         }
     }
 
-    // if (!handler->future_.valid()) {
-    //     // future is empty, task was not run yet
-    //     
-    // } else {
-    //     buffer = handler->future_.get();
-    // }
-
-    // for (std::size_t channel = 0; channel < 2; ++channel) {
-    //     for (std::size_t sample = 0; sample < frames; ++sample) {
-    //         result[channel * frames + sample] = buffer[sample];
-    //     }
-    // }
-
-    // handler->future_ = boost::asio::post(*handler->context_, 
-    //     std::packaged_task<std::unique_ptr<std::int32_t[]>()>(
-    //         [frames, handler]() {
-    //             // request more data to dispatch it in async manner
-    //             auto buffer = handler->squash(frames);
-    //             return handler->dispatchAsync(std::move(buffer), frames);
-    //         }
-    //     )
-    // );
-
     return rtcontrol::SUCCESS;
 }
 
@@ -450,41 +559,121 @@ int laar::readCallback(
     void* local) 
 {
     auto data = (SoundHandler::LocalData*) local;
-    auto handler = data->object.lock();
-
-    if (!handler) {
-        // abort stream
-        return rtcontrol::ABORT;
-    }
+    // stream is closed before handler goes away, so pointer is valid here
+    SoundHandler* handler = data->object;
 
     if (data->abort) {
         // drain stream and close it
         return rtcontrol::DRAIN;
     }
 
-    auto result = (std::int32_t*) in;
-    
-    if (absl::Status status = handler->unfetter(result, frames); !status.ok()) {
-        PLOG(plog::error) << "Read Callback: failed to unfetter data, aborting";
-        std::abort();
+    handler->tuneAudioThread();
+    handler->unfetter((const std::int32_t*) in, frames);
+    return rtcontrol::SUCCESS;
+}
+
+SoundHandler::Settings SoundHandler::parseSettings(const nlohmann::json& config, Settings settings) {
+    settings.isCaptureEnabled = config.value<bool>("isCaptureEnabled", true);
+    settings.isPlaybackEnabled = config.value<bool>("isPlaybackEnabled", true);
+    // opt-in, needs lfe output: low end of front pair is added to it
+    settings.isBassRoutingEnabled = config.value<bool>("isBassRoutingEnabled", false);
+    // applied when device opens, layout is fixed for the lifetime of playback
+    settings.outputChannels = config.value<std::size_t>("outputChannels", defaultOutChannelsCount);
+    settings.sampleRate = config.value<std::size_t>("sampleRate", BaseSampleRate);
+
+    // device stream, negotiated when it opens
+    settings.periodFrames = config.value<unsigned int>("periodFrames", defaultPeriodFrames);
+    if (settings.periodFrames < minPeriodFrames || settings.periodFrames > maxPeriodFrames) {
+        PLOG(plog::warning) 
+            << "period of " << settings.periodFrames << " frames ignored, it must be within [" 
+            << minPeriodFrames << ", " << maxPeriodFrames << "]";
+        settings.periodFrames = defaultPeriodFrames;
+    }
+    settings.periods = config.value<unsigned int>("periods", 0);
+    if (settings.periods > maxPeriods) {
+        PLOG(plog::warning) << "period count " << settings.periods << " ignored, at most " << maxPeriods << " are supported";
+        settings.periods = 0;
+    }
+    settings.isInterleaved = config.value<bool>("interleaved", false);
+    settings.minimizeLatency = config.value<bool>("minimizeLatency", true);
+    // plain priority is what older configs have, it means default backend policy
+    ThreadSettings audioDefaults;
+    if (int priority = config.value<int>("priority", 0); priority > 0) {
+        audioDefaults.policy = ESchedulingPolicy::RR;
+        audioDefaults.priority = priority;
+    }
+    settings.audioThread = audioDefaults;
+    if (auto audioThread = ThreadSettings::parse(config.value("audioThread", nlohmann::json::object()), audioDefaults); audioThread.ok()) {
+        settings.audioThread = std::move(audioThread.value());
+    } else {
+        PLOG(plog::warning) << "audio thread settings ignored: " << audioThread.status().message();
     }
 
-    return rtcontrol::SUCCESS;
+    settings.dspThread = ThreadSettings();
+    if (auto dspThread = ThreadSettings::parse(config.value("dspThread", nlohmann::json::object())); dspThread.ok()) {
+        settings.dspThread = std::move(dspThread.value());
+    } else {
+        PLOG(plog::warning) << "dsp thread settings ignored: " << dspThread.status().message();
+    }
+    settings.lockMemory = config.value<bool>("lockMemory", false);
+    settings.wisdomPath = config.value<std::string>("fftwWisdomPath", "");
+
+    // applied when playback opens, dispatcher state is owned by dsp stage afterwards
+    if (auto bassRouting = BassRouterDispatcher::parseSettings(config); bassRouting.ok()) {
+        settings.bassRouting = bassRouting.value();
+    } else {
+        PLOG(plog::warning) << "bass routing settings ignored: " << bassRouting.status().message();
+    }
+
+    if (auto resampler = Resampler::parseSettings(config); resampler.ok()) {
+        settings.resampler = resampler.value();
+    } else {
+        PLOG(plog::warning) << "resampler settings ignored: " << resampler.status().message();
+    }
+
+    if (auto streamBuffer = BufferLimits::parse(config); streamBuffer.ok()) {
+        settings.streamBuffer = streamBuffer.value();
+    } else {
+        PLOG(plog::warning) << "stream buffer limits ignored: " << streamBuffer.status().message();
+    }
+
+    if (auto streamPool = BufferPool::parseSettings(config); streamPool.ok()) {
+        settings.streamPool = streamPool.value();
+    } else {
+        PLOG(plog::warning) << "stream pool settings ignored: " << streamPool.status().message();
+    }
+
+    return settings;
 }
 
 void SoundHandler::parseDefaultConfig(const nlohmann::json& config) {
-    settings_.isCaptureEnabled = config.value<bool>("isCaptureEnabled", true);
-    settings_.isPlaybackEnabled = config.value<bool>("isPlaybackEnabled", true);
+    settings_ = parseSettings(config, std::move(settings_));
+
+    absl::StatusOr<Mixer::Settings> mixerSettings = Mixer::parseSettings(config);
+    if (!mixerSettings.ok()) {
+        PLOG(plog::warning) << "mixer settings ignored: " << mixerSettings.status().message();
+        return;
+    }
+
+    if (absl::Status status = mixer_.configure(mixerSettings.value()); !status.ok()) {
+        PLOG(plog::warning) << "mixer settings ignored: " << status.message();
+        return;
+    }
+
+    PLOG(plog::info) 
+        << "mixer configured with headroom: " << mixer_.settings().headroom 
+        << " dB and limiter knee: " << mixer_.settings().knee << " dB";
 }
 
 std::shared_ptr<SoundHandler::IReadHandle> SoundHandler::acquireReadHandle(
     NSound::NCommon::TStreamConfiguration config,
     std::weak_ptr<IStreamHandler::IHandle::IListener> owner) 
 {
-    std::unique_lock<std::mutex> locked(local_->handlerLock);
-    clean_ = false;
-    auto handle = std::make_shared<laar::ReadHandle>(std::move(config), std::move(owner));
-    inHandles_.push_back(handle);
+    auto resampler = makeResampler(deviceRate_, config.sample_spec().sample_rate(), inChannelsCount);
+    auto handle = std::allocate_shared<laar::ReadHandle>(
+        PoolAllocator<laar::ReadHandle>(pool_), std::move(config), std::move(resampler), settings_.streamBuffer, pool_, std::move(owner)
+    );
+    inHandles_.add(handle);
     return handle;
 }
 
@@ -492,101 +681,246 @@ std::shared_ptr<SoundHandler::IWriteHandle> SoundHandler::acquireWriteHandle(
     NSound::NCommon::TStreamConfiguration config,
     std::weak_ptr<IStreamHandler::IHandle::IListener> owner) 
 {
-    std::unique_lock<std::mutex> locked(local_->handlerLock);
-    clean_ = false;
-    auto handle = std::make_shared<laar::WriteHandle>(std::move(config), std::move(owner));
-    outHandles_.push_back(handle);
+    absl::StatusOr<ChannelLayout> layout = ChannelLayout::fromConfig(config);
+    if (!layout.ok()) {
+        // streams validate layout before acquiring handles, this is a last resort
+        PLOG(plog::error) << "stream layout is invalid, treating it as mono: " << layout.status().message();
+        layout = ChannelLayout::byCount(1);
+    }
+
+    auto remix = ChannelMatrix::create(layout.value(), outLayout_);
+    auto resampler = makeResampler(config.sample_spec().sample_rate(), deviceRate_, layout->size());
+    auto handle = std::allocate_shared<laar::WriteHandle>(
+        PoolAllocator<laar::WriteHandle>(pool_), std::move(config), std::move(remix), std::move(resampler), settings_.streamBuffer, pool_, std::move(owner)
+    );
+    outHandles_.add(handle);
     return handle;
 }
 
-std::unique_ptr<std::int32_t[]> SoundHandler::dispatchAsync(std::unique_ptr<std::int32_t[]> in, std::size_t samples) {
-    auto out = std::make_unique<std::int32_t[]>(samples * 2);
-    if (absl::Status status = bassDispatcher_->dispatch(in.get(), out.get(), samples); !status.ok()) {
-        return nullptr;
+Resampler SoundHandler::makeResampler(std::size_t inRate, std::size_t outRate, std::size_t channels) {
+    absl::StatusOr<Resampler> resampler = Resampler::create(inRate, outRate, channels, settings_.resampler.quality);
+    if (!resampler.ok()) {
+        // streams validate rate before acquiring handles, this is a last resort
+        PLOG(plog::error) << "stream is not resampled: " << resampler.status().message();
+        return Resampler::create(deviceRate_, deviceRate_, channels, settings_.resampler.quality).value();
     }
-    return out;
+
+    if (!resampler->isPassthrough()) {
+        PLOG(plog::info) 
+            << "stream is resampled from " << inRate << " to " << outRate << " Hz with " 
+            << resampler->taps() << " taps, adding " << resampler->latency() << " frames of latency";
+    }
+    return std::move(resampler.value());
 }
 
-std::unique_ptr<std::int32_t[]> SoundHandler::squash(std::size_t frames) {
-    std::vector<std::unique_ptr<std::int32_t[]>> buffers;
-    {
-        std::unique_lock<std::mutex> locked(local_->handlerLock);
+void SoundHandler::preparePlayback(std::size_t frames) {
+    // periods longer than negotiated one are still mixed, in chunks
+    mixer_.reserve(frames, outLayout_.size());
+    // stream chunk is read interleaved before it is remixed onto bus
+    mixScratch_.resize(mixer_.capacity() * ChannelLayout::MaxChannels);
+    if (isInterleaved_) {
+        planes_.resize(frames * outLayout_.size());
+    }
 
-        for (std::size_t i = 0; i < outHandles_.size(); ++i) {
-            if (auto handle = outHandles_[i].lock()) {
-                if (!handle->isAlive()) {
-                    std::swap(outHandles_[i], outHandles_.back());
-                    outHandles_.pop_back();
-                    continue;
-                }
+    if (!settings_.isBassRoutingEnabled) {
+        return;
+    }
 
-                buffers.emplace_back(std::make_unique<std::int32_t[]>(frames));
-                if (absl::StatusOr<int> bytes = handle->read(buffers.back().get(), frames); !bytes.ok()) {
-                    PLOG(plog::warning) 
-                        << "Write Callback: failed to get " << frames 
-                        << " bytes from handle: " << handle.get() 
-                        << "; error: " << bytes.status().message();
-                }
-            }
+    auto lfe = outLayout_.find(ChannelLayout::Position::labeled(ChannelLayout::TChannelMap::LFE));
+    auto left = outLayout_.find(ChannelLayout::Position::labeled(ChannelLayout::TChannelMap::LEFT));
+    auto right = outLayout_.find(ChannelLayout::Position::labeled(ChannelLayout::TChannelMap::RIGHT));
+    if (!lfe || !left || !right) {
+        PLOG(plog::info) << "bass routing needs front pair and lfe output, it is disabled for " << outLayout_.toString();
+        return;
+    }
+
+    if (!settings_.wisdomPath.empty()) {
+        if (absl::Status status = BassRouterDispatcher::importWisdom(settings_.wisdomPath); !status.ok()) {
+            PLOG(plog::info) << "planning from scratch: " << status.message();
         }
     }
 
-    auto squashed = std::make_unique<std::int32_t[]>(frames);
+    if (absl::Status status = bassDispatcher_->configure(settings_.bassRouting); !status.ok()) {
+        PLOG(plog::warning) << "bass routing settings ignored: " << status.message();
+    }
 
-    for (std::size_t frame = 0; frame < frames; ++frame) {
-        bool isFirst = true;
-        for (auto& buffer : buffers) {
-            if (isFirst) {
-                isFirst = false;
-                squashed[frame] = buffer[frame];
-            } else {
-                // mixing two channels (only for unsigned integers/floats):
-                // Z = 2 * (A + B) - 2 * A * B / bit_width - bit_width
-                std::uint64_t first = static_cast<std::int64_t>(squashed[frame]) - INT32_MIN;
-                std::uint64_t second = static_cast<std::int64_t>(buffer[frame]) - INT32_MIN;
-                squashed[frame] = std::clamp<std::uint64_t>(2 * (first + second) 
-                    - std::max(first, second) / (UINT64_MAX / 2) * std::min(first, second)
-                    - UINT64_MAX + INT32_MIN,
-                INT32_MIN, INT32_MAX);
+    // measuring plans takes a while, it must not happen on dsp stage
+    if (absl::Status status = bassDispatcher_->prepare(frames); !status.ok()) {
+        PLOG(plog::warning) << "bass routing disabled: " << status.message();
+        return;
+    }
+
+    if (!settings_.wisdomPath.empty()) {
+        if (absl::Status status = BassRouterDispatcher::exportWisdom(settings_.wisdomPath); !status.ok()) {
+            PLOG(plog::warning) << status.message();
+        }
+    }
+
+    frontLeft_ = *left;
+    frontRight_ = *right;
+    lfe_ = *lfe;
+    dry_.resize(frames);
+    // dispatcher splits dry mix into highs and bass planes
+    split_.resize(frames * 2);
+    dsp_ = DspStage::create(bassDispatcher_, frames, 2);
+    if (absl::Status status = dsp_->tune(settings_.dspThread); status.ok()) {
+        PLOG(plog::info) << "dsp thread tuned, " << toString(settings_.dspThread);
+    } else {
+        PLOG(plog::warning) << "dsp thread runs with default scheduling: " << status.message();
+    }
+    std::size_t latency = dsp_->latency() + bassDispatcher_->latency();
+    delayFrames_ = latency;
+    delayPosition_ = 0;
+    mainsDelay_.assign(latency * outLayout_.size(), Silence);
+    PLOG(plog::info) 
+        << "bass routing onto " << outLayout_.toString() << " enabled, it adds " << latency << " frames ("
+        << latency * 1000.0 / deviceRate_ << " ms) of latency";
+}
+
+void SoundHandler::routeBass(std::int32_t* planes, std::size_t frames) noexcept {
+    const std::int32_t* left = planes + frontLeft_ * frames;
+    const std::int32_t* right = planes + frontRight_ * frames;
+    for (std::size_t i = 0; i < frames; ++i) {
+        dry_[i] = static_cast<std::int32_t>((static_cast<std::int64_t>(left[i]) + right[i]) / 2);
+    }
+    // split lags dsp latency behind the mix
+    dsp_->process(dry_.data(), split_.data(), frames);
+
+    // so mix is held back by as much, sample by sample through per-channel delay line
+    if (delayFrames_) {
+        for (std::size_t channel = 0; channel < outLayout_.size(); ++channel) {
+            std::int32_t* plane = planes + channel * frames;
+            std::int32_t* line = mainsDelay_.data() + channel * delayFrames_;
+            std::size_t position = delayPosition_;
+            for (std::size_t i = 0; i < frames; ++i) {
+                std::swap(plane[i], line[position]);
+                position = (position + 1 == delayFrames_) ? 0 : position + 1;
             }
         }
+        delayPosition_ = (delayPosition_ + frames) % delayFrames_;
+    }
+
+    std::int32_t* lfe = planes + lfe_ * frames;
+    const std::int32_t* bass = split_.data() + frames;
+    for (std::size_t i = 0; i < frames; ++i) {
+        std::int64_t sum = static_cast<std::int64_t>(lfe[i]) + bass[i];
+        lfe[i] = static_cast<std::int32_t>(std::clamp<std::int64_t>(sum, INT32_MIN, INT32_MAX));
+    }
+}
+
+void SoundHandler::tuneAudioThread() noexcept {
+    // first period pays for a couple of syscalls, the rest only for this check
+    if (local_->isThreadTuned) {
+        return;
+    }
+
+    local_->isThreadTuned = true;
+    local_->tuning = tuneCurrentThreadRaw(local_->audioThread);
+    local_->isTuningDone.store(true, std::memory_order_release);
+}
+
+void SoundHandler::scheduleSweep() {
+    sweepTimer_ = std::make_unique<boost::asio::steady_timer>(*context_, sweepInterval);
+    sweepTimer_->async_wait([weak = weak_from_this()](const boost::system::error_code& error) {
+        if (error) {
+            return;
+        }
+
+        if (auto handler = weak.lock()) {
+            handler->sweep();
+            handler->scheduleSweep();
+        }
+    });
+}
+
+void SoundHandler::sweep() {
+    std::size_t playback = outHandles_.sweep();
+    std::size_t capture = inHandles_.sweep();
+    if (playback || capture) {
+        PLOG(plog::debug) << "released " << playback << " playback and " << capture << " capture handles";
+    }
+
+    if (auto failed = local_->failedReads.exchange(0, std::memory_order_relaxed)) {
+        PLOG(plog::warning) << "playback: " << failed << " reads from handles failed since last sweep";
+    }
+
+    if (auto failed = local_->failedWrites.exchange(0, std::memory_order_relaxed)) {
+        PLOG(plog::warning) << "capture: " << failed << " writes to handles overran since last sweep";
+    }
+
+    if (!local_->isTuningReported && local_->isTuningDone.load(std::memory_order_acquire)) {
+        local_->isTuningReported = true;
+        // audio thread only left error codes, message is built here
+        if (absl::Status status = toStatus(local_->audioThread, local_->tuning); status.ok()) {
+            PLOG(plog::info) << "audio thread tuned, " << toString(local_->audioThread);
+        } else {
+            PLOG(plog::warning) << "audio thread runs with default scheduling: " << status.message();
+        }
+    }
 
-        if (buffers.empty()) {
-            // put silence
-            squashed[frame] = Silence;
+    if (dsp_) {
+        if (DspStage::Stats stats = dsp_->collectStats(); stats.missed || stats.failed) {
+            PLOG(plog::warning) 
+                << "dsp stage: " << stats.missed << " periods missed deadline and " 
+                << stats.failed << " failed, " << stats.processed << " processed since last sweep";
         }
     }
 
-    return squashed;
+    if (pool_) {
+        BufferPool::Stats stats = pool_->collectStats();
+        if (stats.misses) {
+            PLOG(plog::warning) 
+                << "stream pool: " << stats.misses << " allocations went to heap since last sweep, peak occupancy: " 
+                << stats.peak << "/" << stats.blocks;
+        } else if (stats.used != poolStats_.used) {
+            PLOG(plog::debug) << "stream pool occupancy: " << stats.used << "/" << stats.blocks;
+        }
+        poolStats_ = stats;
+    }
 }
 
-absl::Status SoundHandler::unfetter(std::int32_t* source, std::size_t frames) {
-    std::unique_lock<std::mutex> locked(local_->handlerLock);
+void SoundHandler::squash(std::int32_t* dest, std::size_t frames) noexcept {
+    auto handles = outHandles_.acquire();
+    std::size_t chunk = mixer_.capacity();
+
+    if (!chunk) {
+        std::fill_n(dest, frames * outLayout_.size(), Silence);
+        return;
+    }
+
+    for (std::size_t offset = 0; offset < frames; offset += chunk) {
+        std::size_t size = std::min(chunk, frames - offset);
 
-    for (std::size_t i = 0; i < inHandles_.size(); ++i) {
-        if (auto handle = inHandles_[i].lock()) {
+        mixer_.reset(size);
+        for (const auto& handle : handles) {
             if (!handle->isAlive()) {
-                std::swap(inHandles_[i], inHandles_.back());
-                inHandles_.pop_back();
                 continue;
             }
 
-            if (absl::StatusOr<int> bytes = handle->write(source, frames); !bytes.ok() || static_cast<unsigned int>(bytes.value()) < frames) {
-                if (!bytes.ok()) {
-                    PLOG(plog::warning) 
-                        << "unfetter: encountered error while writing bytes to handle: "
-                        << handle.get() << ", message: " << bytes.status().message();
-                } else {
-                    PLOG(plog::warning)
-                        << "unfetter: only " << bytes.value() << " bytes were written to handle; expected " << frames;
-                }
-                if (absl::Status status = handle->flush(); !status.ok()) {
-                    PLOG(plog::error) << "unfetter: failed to recover handle, aborting";
-                    return absl::InternalError("failed to recover handle, unfetter failed");
-                }
+            // handle pads missing samples with silence, so whole chunk is mixed anyway
+            const ChannelMatrix& remix = handle->getChannelMatrix();
+            if (absl::StatusOr<int> samples = handle->read(mixScratch_.data(), size * remix.inputs()); !samples.ok()) {
+                local_->failedReads.fetch_add(1, std::memory_order_relaxed);
+                continue;
             }
+
+            mixer_.add(mixScratch_.data(), size, remix);
         }
+
+        mixer_.mixdown(dest + offset, size, frames);
     }
+}
 
-    return absl::OkStatus();
-}
\ No newline at end of file
+void SoundHandler::unfetter(const std::int32_t* source, std::size_t frames) noexcept {
+    for (const auto& handle : inHandles_.acquire()) {
+        if (!handle->isAlive()) {
+            continue;
+        }
+
+        if (absl::StatusOr<int> samples = handle->write(source, frames); !samples.ok() || static_cast<std::size_t>(samples.value()) < frames) {
+            // reader is too slow, drop what it has not taken yet
+            local_->failedWrites.fetch_add(1, std::memory_order_relaxed);
+            handle->flush().IgnoreError();
+        }
+    }
+}
@@ -4,12 +4,21 @@
 #include <boost/asio.hpp>
 #include <boost/asio/executor.hpp>
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
 
 // Abseil
 #include <absl/status/status.h>
 
 // laar
+#include <src/ssd/sound/mixer.hpp>
+#include <src/ssd/sound/dsp-stage.hpp>
+#include <src/ssd/sound/buffer-pool.hpp>
+#include <src/ssd/sound/resampler.hpp>
+#include <src/ssd/sound/buffer-limits.hpp>
+#include <src/ssd/sound/channel-matrix.hpp>
+#include <src/ssd/sound/handle-registry.hpp>
 #include <src/ssd/util/config-loader.hpp>
+#include <src/ssd/util/thread-tuning.hpp>
 #include <src/ssd/sound/interfaces/i-audio-handler.hpp>
 #include <src/ssd/sound/dispatchers/tube-dispatcher.hpp>
 #include <src/ssd/sound/dispatchers/bass-router-dispatcher.hpp>
@@ -22,7 +31,10 @@
 
 // std
 #include <mutex>
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
 #include <cstdint>
 #include <exception>
 
@@ -69,6 +81,36 @@ namespace laar {
     private: struct Private {};
     public:
 
+        struct Settings {
+            bool isPlaybackEnabled;
+            bool isCaptureEnabled;
+            bool isBassRoutingEnabled;
+            std::size_t outputChannels;
+            std::size_t sampleRate;
+            // device period in frames and number of periods, zero lets backend pick
+            unsigned int periodFrames;
+            unsigned int periods;
+            bool isInterleaved;
+            bool minimizeLatency;
+            // realtime policy of audio thread is requested from backend as well
+            ThreadSettings audioThread;
+            ThreadSettings dspThread;
+            // pin working set once playback is prepared
+            bool lockMemory;
+            // quality of handles opened from now on
+            Resampler::Settings resampler;
+            // bounds of buffers clients negotiate
+            BufferLimits streamBuffer;
+            // preallocated once, on init
+            BufferPool::Settings streamPool;
+            // fftw planner wisdom, reused between runs if set
+            std::string wisdomPath;
+            BassRouterDispatcher::Settings bassRouting;
+        };
+
+        // keys with invalid values are logged and keep what settings had before
+        static Settings parseSettings(const nlohmann::json& config, Settings settings);
+
         static std::shared_ptr<SoundHandler> configure(
             std::shared_ptr<laar::ConfigHandler> configHandler,
             std::shared_ptr<boost::asio::io_context> context
@@ -80,6 +122,8 @@ namespace laar {
             Private access
         );
 
+        ~SoundHandler();
+
         void init() override;
         virtual std::shared_ptr<IReadHandle> acquireReadHandle(
             NSound::NCommon::TStreamConfiguration config,
@@ -129,6 +173,10 @@ namespace laar {
         bool checkSampleRate(const RtAudio::DeviceInfo& info, std::string& verdict) noexcept;
         bool checkName(const RtAudio::DeviceInfo& info, std::string& verdict) noexcept;
         bool checkSampleFormat(const RtAudio::DeviceInfo& info, std::string& verdict) noexcept;
+        bool checkChannels(const RtAudio::DeviceInfo& info, bool isInput, std::string& verdict) noexcept;
+
+        RtAudio::StreamOptions makeStreamOptions() const;
+        void reportStream(unsigned int periodFrames, const RtAudio::StreamOptions& options);
 
         absl::Status openDuplexStream(unsigned int devInput, unsigned int devOutput);
         absl::Status openPlayback(unsigned int dev);
@@ -136,35 +184,77 @@ namespace laar {
 
         void parseDefaultConfig(const nlohmann::json& config);
 
-        std::unique_ptr<std::int32_t[]> dispatchAsync(std::unique_ptr<std::int32_t[]> in, std::size_t samples);
-        std::unique_ptr<std::int32_t[]> squash(std::size_t frames);
-        absl::Status unfetter(std::int32_t* source, std::size_t frames);
+        void preparePlayback(std::size_t frames);
+        // stream rate converter, falls back to passthrough on invalid rates
+        Resampler makeResampler(std::size_t inRate, std::size_t outRate, std::size_t channels);
+        // periodically releases dead handles off real-time path
+        void scheduleSweep();
+        void sweep();
 
-    private:
+        // audio thread applies its own settings on first callback, backend gives no handle to it
+        void tuneAudioThread() noexcept;
 
-        bool clean_;
+        // real-time safe: no allocations, locks or logging
+        // dest receives one plane of frames per output channel
+        void squash(std::int32_t* dest, std::size_t frames) noexcept;
+        void unfetter(const std::int32_t* source, std::size_t frames) noexcept;
+        // adds low end of front pair to lfe, planes hold device mix of frames
+        void routeBass(std::int32_t* planes, std::size_t frames) noexcept;
 
-        std::future<std::unique_ptr<std::int32_t[]>> future_;
+    private:
 
         std::once_flag init_;
         std::shared_ptr<boost::asio::io_context> context_;
 
-        std::vector<std::weak_ptr<IWriteHandle>> outHandles_;
-        std::vector<std::weak_ptr<IReadHandle>> inHandles_;
+        HandleRegistry<IWriteHandle> outHandles_;
+        HandleRegistry<IReadHandle> inHandles_;
+        // handles and their buffers, handles released by sweep return to it
+        std::shared_ptr<BufferPool> pool_;
+        BufferPool::Stats poolStats_;
+        std::unique_ptr<boost::asio::steady_timer> sweepTimer_;
 
         std::shared_ptr<laar::ConfigHandler> configHandler_;
         std::shared_ptr<BassRouterDispatcher> bassDispatcher_;
 
+        // fixed once playback opens, every write handle is remixed onto it
+        ChannelLayout outLayout_;
+        // fixed once device opens, every handle is resampled to it
+        std::size_t deviceRate_;
+        // device takes frames interleaved, mix is rendered into planes first
+        bool isInterleaved_;
+        std::vector<std::int32_t> planes_;
+
+        Mixer mixer_;
+        std::vector<std::int32_t> mixScratch_;
+        // mono downmix of front pair and its highs and bass planes from dsp stage
+        std::vector<std::int32_t> dry_;
+        std::vector<std::int32_t> split_;
+        std::unique_ptr<DspStage> dsp_;
+        // device mix is held back by dsp latency, so bass reaches lfe in step with it
+        std::vector<std::int32_t> mainsDelay_;
+        std::size_t delayFrames_;
+        std::size_t delayPosition_;
+        std::size_t frontLeft_;
+        std::size_t frontRight_;
+        std::size_t lfe_;
+
         struct LocalData {
-            std::weak_ptr<SoundHandler> object;
+            // plain pointer keeps refcount off audio thread, destructor closes stream first
+            SoundHandler* object;
             std::atomic<bool> abort;
-            std::mutex handlerLock;
+            // reported off real-time path
+            std::atomic<std::uint64_t> failedReads;
+            std::atomic<std::uint64_t> failedWrites;
+            // set before stream starts, applied by audio thread itself;
+            // outcome is published once and logged by sweep
+            ThreadSettings audioThread;
+            bool isThreadTuned;
+            TuningResult tuning;
+            std::atomic<bool> isTuningDone;
+            bool isTuningReported;
         };
 
-        struct Settings {
-            bool isPlaybackEnabled;
-            bool isCaptureEnabled;
-        } settings_;
+        Settings settings_;
 
         std::unique_ptr<LocalData> local_;
         
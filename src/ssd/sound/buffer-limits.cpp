@@ -0,0 +1,80 @@
+// laar
+#include <src/ssd/sound/buffer-limits.hpp>
+
+// abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <absl/strings/str_format.h>
+
+// json
+#include <nlohmann/json.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+using namespace laar;
+
+namespace {
+
+    constexpr auto BUFFER_SECTION = "streamBuffer";
+
+}
+
+absl::StatusOr<BufferLimits> BufferLimits::parse(const nlohmann::json& config) {
+    BufferLimits limits;
+    if (!config.contains(BUFFER_SECTION)) {
+        return limits;
+    }
+
+    const auto& section = config[BUFFER_SECTION];
+    if (!section.is_object()) {
+        return absl::InvalidArgumentError("stream buffer section must be an object");
+    }
+
+    try {
+        limits.minMs = section.value<std::size_t>("min", limits.minMs);
+        limits.defaultMs = section.value<std::size_t>("default", limits.defaultMs);
+        limits.maxMs = section.value<std::size_t>("max", limits.maxMs);
+    } catch (const nlohmann::json::exception& error) {
+        return absl::InvalidArgumentError(absl::StrFormat("malformed stream buffer settings: %s", error.what()));
+    }
+
+    if (!limits.minMs || limits.minMs > limits.defaultMs || limits.defaultMs > limits.maxMs) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "stream buffer limits must satisfy 0 < min <= default <= max, got: %d, %d, %d", limits.minMs, limits.defaultMs, limits.maxMs
+        ));
+    }
+
+    return limits;
+}
+
+BufferLimits::TBufferConfiguration BufferLimits::negotiate(const TStreamConfiguration& config) const {
+    const std::size_t channels = std::max<std::size_t>(config.sample_spec().channels(), 1);
+    const std::size_t rate = config.sample_spec().sample_rate();
+    const TBufferConfiguration& requested = config.buffer_config();
+
+    auto toFrames = [rate](std::size_t ms) -> std::size_t {
+        return std::max<std::size_t>(ms * rate / 1000, 1);
+    };
+
+    // pulse defaults: requests are a quarter of target length
+    std::size_t size = (requested.size()) ? requested.size() / channels : toFrames(defaultMs);
+    size = std::clamp(size, toFrames(minMs), toFrames(maxMs));
+
+    std::size_t prebuffering = std::min<std::size_t>(requested.prebuffing_size() / channels, size);
+    std::size_t minRequest = (requested.min_request_size())
+        ? std::clamp<std::size_t>(requested.min_request_size() / channels, 1, std::max<std::size_t>(size / 2, 1))
+        : std::max<std::size_t>(size / 4, 1);
+    std::size_t fragment = (requested.fragment_size())
+        ? std::clamp<std::size_t>(requested.fragment_size() / channels, 1, size)
+        : std::max<std::size_t>(size / 4, 1);
+
+    TBufferConfiguration negotiated;
+    negotiated.set_size(static_cast<std::uint32_t>(size * channels));
+    negotiated.set_prebuffing_size(static_cast<std::uint32_t>(prebuffering * channels));
+    negotiated.set_min_request_size(static_cast<std::uint32_t>(minRequest * channels));
+    negotiated.set_fragment_size(static_cast<std::uint32_t>(fragment * channels));
+    return negotiated;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// abseil
+#include <absl/status/statusor.h>
+
+// json
+#include <nlohmann/json_fwd.hpp>
+
+// std
+#include <cstddef>
+
+// proto
+#include <protos/common/stream-configuration.pb.h>
+
+
+namespace laar {
+
+    // Server side bounds of per-stream buffers, in milliseconds of stream audio.
+    // Clients ask for sizes in TBufferConfiguration, server answers with what it picked.
+    struct BufferLimits {
+
+        using TStreamConfiguration = NSound::NCommon::TStreamConfiguration;
+        using TBufferConfiguration = TStreamConfiguration::TBufferConfiguration;
+
+        std::size_t minMs = 20;
+        std::size_t defaultMs = 250;
+        std::size_t maxMs = 2000;
+
+        // "streamBuffer": {"min": 20, "default": 250, "max": 2000}, missing keys keep defaults
+        static absl::StatusOr<BufferLimits> parse(const nlohmann::json& config);
+
+        // sizes are in stream samples and hold whole frames,
+        // zero fields are requests for server defaults
+        TBufferConfiguration negotiate(const TStreamConfiguration& config) const;
+    };
+
+}
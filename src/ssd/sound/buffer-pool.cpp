@@ -0,0 +1,210 @@
+// laar
+#include <src/ssd/sound/buffer-pool.hpp>
+
+// abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+
+// json
+#include <nlohmann/json.hpp>
+
+// std
+#include <bit>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <memory_resource>
+
+// posix
+#include <sys/mman.h>
+
+using namespace laar;
+
+namespace {
+
+    constexpr auto POOL_SECTION = "streamPool";
+    // blocks of larger classes are only page aligned
+    constexpr std::size_t PageSize = 4096;
+    constexpr std::size_t HugePageSize = 2 * 1024 * 1024;
+    constexpr std::size_t MaxBlocks = 1024;
+    constexpr std::size_t MaxBlockSize = 64 * 1024 * 1024;
+
+}
+
+absl::StatusOr<BufferPool::Settings> BufferPool::parseSettings(const nlohmann::json& config) {
+    Settings settings;
+    if (!config.contains(POOL_SECTION)) {
+        return settings;
+    }
+
+    const auto& section = config[POOL_SECTION];
+    if (!section.is_object()) {
+        return absl::InvalidArgumentError("stream pool section must be an object");
+    }
+
+    try {
+        settings.blocks = section.value<std::size_t>("blocks", settings.blocks);
+        settings.minBlock = section.value<std::size_t>("minBlock", settings.minBlock);
+        settings.maxBlock = section.value<std::size_t>("maxBlock", settings.maxBlock);
+        settings.hugePages = section.value<bool>("hugePages", settings.hugePages);
+    } catch (const nlohmann::json::exception& error) {
+        return absl::InvalidArgumentError(absl::StrFormat("malformed stream pool settings: %s", error.what()));
+    }
+
+    if (settings.blocks > MaxBlocks) {
+        return absl::InvalidArgumentError(absl::StrFormat("at most %d blocks per size class are supported, got: %d", MaxBlocks, settings.blocks));
+    }
+    if (!std::has_single_bit(settings.minBlock) || !std::has_single_bit(settings.maxBlock)) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "block sizes must be powers of two, got: %d, %d", settings.minBlock, settings.maxBlock
+        ));
+    }
+    if (settings.minBlock < alignof(std::max_align_t) || settings.minBlock > settings.maxBlock || settings.maxBlock > MaxBlockSize) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "block sizes must satisfy %d <= min <= max <= %d, got: %d, %d",
+            alignof(std::max_align_t), MaxBlockSize, settings.minBlock, settings.maxBlock
+        ));
+    }
+
+    return settings;
+}
+
+absl::StatusOr<std::shared_ptr<BufferPool>> BufferPool::create(Settings settings) {
+    auto pool = std::make_shared<BufferPool>(std::move(settings), Private());
+    if (absl::Status status = pool->map(); !status.ok()) {
+        return status;
+    }
+    return pool;
+}
+
+BufferPool::BufferPool(Settings settings, Private /* access */)
+    : settings_(std::move(settings))
+    , arena_(nullptr)
+    , arenaSize_(0)
+    , isHuge_(false)
+    , used_(0)
+    , peak_(0)
+    , misses_(0)
+{}
+
+BufferPool::~BufferPool() {
+    if (arena_) {
+        munmap(arena_, arenaSize_);
+    }
+}
+
+absl::Status BufferPool::map() {
+    std::size_t classes = std::countr_zero(settings_.maxBlock) - std::countr_zero(settings_.minBlock) + 1;
+    for (std::size_t index = 0; index < classes; ++index) {
+        arenaSize_ += (settings_.maxBlock >> index) * settings_.blocks;
+    }
+    classes_.resize(classes);
+    if (!arenaSize_) {
+        return absl::OkStatus();
+    }
+
+    if (settings_.hugePages) {
+        std::size_t size = (arenaSize_ + HugePageSize - 1) / HugePageSize * HugePageSize;
+        void* arena = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (arena != MAP_FAILED) {
+            arena_ = static_cast<char*>(arena);
+            arenaSize_ = size;
+            isHuge_ = true;
+        }
+    }
+
+    if (!arena_) {
+        void* arena = mmap(nullptr, arenaSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED) {
+            return absl::ResourceExhaustedError(absl::StrCat("mapping stream pool failed: ", std::strerror(errno)));
+        }
+        arena_ = static_cast<char*>(arena);
+        // no reserved huge pages, transparent ones are the next best thing;
+        // pages are touched right away, so stream open never faults them in
+        if (settings_.hugePages) {
+            madvise(arena_, arenaSize_, MADV_HUGEPAGE);
+        }
+        std::memset(arena_, 0, arenaSize_);
+    }
+
+    // largest class goes first, so every block is aligned to its size (up to a page)
+    char* position = arena_;
+    for (std::size_t index = 0; index < classes; ++index) {
+        std::size_t size = settings_.maxBlock >> index;
+        classes_[index].reserve(settings_.blocks);
+        for (std::size_t block = 0; block < settings_.blocks; ++block) {
+            classes_[index].push_back(position + (settings_.blocks - block - 1) * size);
+        }
+        position += size * settings_.blocks;
+    }
+
+    return absl::OkStatus();
+}
+
+BufferPool::Stats BufferPool::collectStats() noexcept {
+    std::unique_lock<std::mutex> locked(lock_);
+
+    Stats stats {
+        .blocks = classes_.size() * settings_.blocks,
+        .used = used_,
+        .peak = peak_,
+        .misses = misses_,
+        .reservedBytes = (arena_) ? arenaSize_ : 0,
+        .isHuge = isHuge_
+    };
+    peak_ = used_;
+    misses_ = 0;
+    return stats;
+}
+
+std::size_t BufferPool::classOf(std::size_t size, std::size_t alignment) const noexcept {
+    if (alignment > PageSize) {
+        return classes_.size();
+    }
+
+    std::size_t block = std::bit_ceil(std::max({size, alignment, settings_.minBlock}));
+    if (block > settings_.maxBlock) {
+        return classes_.size();
+    }
+    return std::countr_zero(settings_.maxBlock) - std::countr_zero(block);
+}
+
+void* BufferPool::do_allocate(std::size_t bytes, std::size_t alignment) {
+    if (std::size_t index = classOf(bytes, alignment); arena_ && index < classes_.size()) {
+        std::unique_lock<std::mutex> locked(lock_);
+        if (auto& free = classes_[index]; !free.empty()) {
+            char* block = free.back();
+            free.pop_back();
+            peak_ = std::max(peak_, ++used_);
+            return block;
+        }
+        ++misses_;
+    } else {
+        std::unique_lock<std::mutex> locked(lock_);
+        ++misses_;
+    }
+
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void BufferPool::do_deallocate(void* block, std::size_t bytes, std::size_t alignment) {
+    char* pointer = static_cast<char*>(block);
+    if (!arena_ || pointer < arena_ || pointer >= arena_ + arenaSize_) {
+        return std::pmr::new_delete_resource()->deallocate(block, bytes, alignment);
+    }
+
+    // class list has room for every block, so push never allocates
+    std::unique_lock<std::mutex> locked(lock_);
+    classes_[classOf(bytes, alignment)].push_back(pointer);
+    --used_;
+}
+
+bool BufferPool::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+// abseil
+#include <absl/status/statusor.h>
+
+// json
+#include <nlohmann/json_fwd.hpp>
+
+// std
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+
+namespace laar {
+
+    // Preallocated storage for stream buffers and handles, so that opening
+    // and closing streams does not go to general allocator. Blocks come in
+    // power of two size classes carved out of one mapping, which is populated
+    // up front and backed by huge pages when system has them. Requests that
+    // do not fit any class, or find their class exhausted, go to heap.
+    // Thread safe, but must not be used on audio thread.
+    class BufferPool : public std::pmr::memory_resource {
+    private: struct Private {};
+    public:
+
+        struct Settings {
+            // blocks preallocated in every size class, zero disables pool
+            std::size_t blocks = 8;
+            // smallest and largest size class, in bytes
+            std::size_t minBlock = 256;
+            std::size_t maxBlock = 256 * 1024;
+            bool hugePages = true;
+        };
+
+        struct Stats {
+            std::size_t blocks;
+            std::size_t used;
+            // most blocks used at once since previous collection
+            std::size_t peak;
+            // requests served by heap since previous collection
+            std::uint64_t misses;
+            std::size_t reservedBytes;
+            bool isHuge;
+        };
+
+        // "streamPool": {"blocks": 8, "minBlock": 256, "maxBlock": 262144, "hugePages": true},
+        // missing keys keep defaults
+        static absl::StatusOr<Settings> parseSettings(const nlohmann::json& config);
+        static absl::StatusOr<std::shared_ptr<BufferPool>> create(Settings settings);
+
+        BufferPool(Settings settings, Private access);
+        ~BufferPool() override;
+
+        BufferPool(const BufferPool&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        // resets peak and misses
+        Stats collectStats() noexcept;
+
+    private:
+        absl::Status map();
+        // class serving size bytes aligned to alignment, classes_.size() if none does
+        std::size_t classOf(std::size_t size, std::size_t alignment) const noexcept;
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* block, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    private:
+        const Settings settings_;
+
+        char* arena_;
+        std::size_t arenaSize_;
+        bool isHuge_;
+
+        std::mutex lock_;
+        // free blocks of every class, largest class first
+        std::vector<std::vector<char*>> classes_;
+        std::size_t used_;
+        std::size_t peak_;
+        std::uint64_t misses_;
+    };
+
+    // std allocator over shared memory resource, allocations keep resource alive;
+    // null resource stands for heap
+    template<typename T>
+    class PoolAllocator {
+    public:
+        using value_type = T;
+
+        explicit PoolAllocator(std::shared_ptr<std::pmr::memory_resource> resource) noexcept
+            : resource_(std::move(resource))
+        {}
+
+        template<typename U>
+        PoolAllocator(const PoolAllocator<U>& other) noexcept
+            : resource_(other.resource())
+        {}
+
+        T* allocate(std::size_t n) {
+            return static_cast<T*>(get()->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T* pointer, std::size_t n) noexcept {
+            get()->deallocate(pointer, n * sizeof(T), alignof(T));
+        }
+
+        const std::shared_ptr<std::pmr::memory_resource>& resource() const noexcept {
+            return resource_;
+        }
+
+        template<typename U>
+        bool operator==(const PoolAllocator<U>& other) const noexcept {
+            return get() == other.get();
+        }
+
+        std::pmr::memory_resource* get() const noexcept {
+            return (resource_) ? resource_.get() : std::pmr::new_delete_resource();
+        }
+
+    private:
+        std::shared_ptr<std::pmr::memory_resource> resource_;
+    };
+
+}
@@ -0,0 +1,354 @@
+// laar
+#include <src/ssd/sound/channel-matrix.hpp>
+
+// abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+
+// std
+#include <cmath>
+#include <span>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <iterator>
+#include <algorithm>
+
+// proto
+#include <protos/common/stream-configuration.pb.h>
+
+using namespace laar;
+
+namespace {
+
+    using Position = ChannelLayout::Position;
+    using EPosition = ChannelLayout::EPosition;
+
+    constexpr float halfPower = static_cast<float>(M_SQRT1_2);
+
+    Position labeled(EPosition position) {
+        return Position::labeled(position);
+    }
+
+    // speaker a channel falls back to when device lacks its own
+    struct Fold {
+        EPosition from;
+        EPosition to;
+    };
+
+    constexpr Fold surroundFolds[] = {
+        { NSound::NCommon::TStreamConfiguration::TChannelMap::SIDE_LEFT, NSound::NCommon::TStreamConfiguration::TChannelMap::REAR_LEFT },
+        { NSound::NCommon::TStreamConfiguration::TChannelMap::SIDE_RIGHT, NSound::NCommon::TStreamConfiguration::TChannelMap::REAR_RIGHT },
+        { NSound::NCommon::TStreamConfiguration::TChannelMap::REAR_LEFT, NSound::NCommon::TStreamConfiguration::TChannelMap::SIDE_LEFT },
+        { NSound::NCommon::TStreamConfiguration::TChannelMap::REAR_RIGHT, NSound::NCommon::TStreamConfiguration::TChannelMap::SIDE_RIGHT },
+    };
+
+}
+
+Position ChannelLayout::Position::labeled(EPosition position) noexcept {
+    return Position{ .isAux = false, .value = static_cast<std::int32_t>(position) };
+}
+
+Position ChannelLayout::Position::aux(std::int32_t index) noexcept {
+    return Position{ .isAux = true, .value = index };
+}
+
+ChannelLayout::ChannelLayout(std::vector<Position> positions)
+    : positions_(std::move(positions))
+{}
+
+absl::StatusOr<ChannelLayout> ChannelLayout::fromConfig(const NSound::NCommon::TStreamConfiguration& config) {
+    std::size_t channels = config.sample_spec().channels();
+    if (!config.has_channel_map() || config.channel_map().mapped_channel_size() == 0) {
+        return byCount(channels);
+    }
+
+    const auto& map = config.channel_map();
+    if (static_cast<std::size_t>(map.mapped_channel_size()) != channels) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "channel map has %d positions for %d channels", map.mapped_channel_size(), channels
+        ));
+    }
+
+    if (channels > MaxChannels) {
+        return absl::InvalidArgumentError(absl::StrFormat("at most %d channels are supported, got: %d", MaxChannels, channels));
+    }
+
+    std::vector<Position> positions;
+    positions.reserve(channels);
+    for (const auto& channel : map.mapped_channel()) {
+        Position position = (channel.has_aux())
+            ? Position::aux(channel.aux())
+            : Position::labeled(channel.position());
+
+        if (position.isAux && (position.value < 0 || position.value >= static_cast<std::int32_t>(MaxChannels))) {
+            return absl::InvalidArgumentError(absl::StrFormat("aux channel out of range: %d", position.value));
+        }
+        if (std::find(positions.begin(), positions.end(), position) != positions.end()) {
+            return absl::InvalidArgumentError("channel map has duplicate positions");
+        }
+
+        positions.push_back(position);
+    }
+
+    return ChannelLayout(std::move(positions));
+}
+
+absl::StatusOr<ChannelLayout> ChannelLayout::byCount(std::size_t channels) {
+    if (!channels || channels > MaxChannels) {
+        return absl::InvalidArgumentError(absl::StrFormat("channel count must be within [1, %d], got: %d", MaxChannels, channels));
+    }
+
+    std::vector<Position> positions;
+    switch (channels) {
+        case 1:
+            positions = { labeled(TChannelMap::MONO) };
+            break;
+        case 2:
+            positions = { labeled(TChannelMap::LEFT), labeled(TChannelMap::RIGHT) };
+            break;
+        case 4:
+            positions = {
+                labeled(TChannelMap::LEFT), labeled(TChannelMap::RIGHT),
+                labeled(TChannelMap::REAR_LEFT), labeled(TChannelMap::REAR_RIGHT)
+            };
+            break;
+        case 5:
+            positions = {
+                labeled(TChannelMap::LEFT), labeled(TChannelMap::RIGHT),
+                labeled(TChannelMap::REAR_LEFT), labeled(TChannelMap::REAR_RIGHT),
+                labeled(TChannelMap::CENTER)
+            };
+            break;
+        case 6:
+            positions = {
+                labeled(TChannelMap::LEFT), labeled(TChannelMap::RIGHT),
+                labeled(TChannelMap::REAR_LEFT), labeled(TChannelMap::REAR_RIGHT),
+                labeled(TChannelMap::CENTER), labeled(TChannelMap::LFE)
+            };
+            break;
+        case 8:
+            positions = {
+                labeled(TChannelMap::LEFT), labeled(TChannelMap::RIGHT),
+                labeled(TChannelMap::REAR_LEFT), labeled(TChannelMap::REAR_RIGHT),
+                labeled(TChannelMap::CENTER), labeled(TChannelMap::LFE),
+                labeled(TChannelMap::SIDE_LEFT), labeled(TChannelMap::SIDE_RIGHT)
+            };
+            break;
+        default:
+            // no common meaning, channels go to matching device outputs as is
+            for (std::size_t channel = 0; channel < channels; ++channel) {
+                positions.push_back(Position::aux(channel));
+            }
+            break;
+    }
+
+    return ChannelLayout(std::move(positions));
+}
+
+void ChannelLayout::toConfig(TChannelMap* map) const {
+    map->clear_mapped_channel();
+    for (const Position& position : positions_) {
+        auto* channel = map->add_mapped_channel();
+        if (position.isAux) {
+            channel->set_aux(position.value);
+        } else {
+            channel->set_position(static_cast<EPosition>(position.value));
+        }
+    }
+}
+
+std::string ChannelLayout::toString() const {
+    std::string result;
+    for (const Position& position : positions_) {
+        if (!result.empty()) {
+            absl::StrAppend(&result, " ");
+        }
+
+        if (position.isAux) {
+            absl::StrAppend(&result, "AUX", position.value);
+        } else {
+            absl::StrAppend(&result, TChannelMap::TLabeledPosition_Name(static_cast<EPosition>(position.value)));
+        }
+    }
+    return result;
+}
+
+std::size_t ChannelLayout::size() const noexcept {
+    return positions_.size();
+}
+
+std::optional<std::size_t> ChannelLayout::find(Position position) const noexcept {
+    if (auto iter = std::find(positions_.begin(), positions_.end(), position); iter != positions_.end()) {
+        return std::distance(positions_.begin(), iter);
+    }
+    return std::nullopt;
+}
+
+const Position& ChannelLayout::operator[](std::size_t channel) const noexcept {
+    return positions_[channel];
+}
+
+ChannelMatrix::ChannelMatrix(std::size_t inputs, std::size_t outputs, std::vector<Entry> entries)
+    : inputs_(inputs)
+    , outputs_(outputs)
+    , entries_(std::move(entries))
+{}
+
+ChannelMatrix ChannelMatrix::create(const ChannelLayout& from, const ChannelLayout& to) {
+    using TChannelMap = ChannelLayout::TChannelMap;
+
+    std::vector<Entry> entries;
+    auto route = [&](std::size_t input, std::optional<std::size_t> output, float gain) {
+        if (output) {
+            entries.push_back(Entry{
+                .input = static_cast<std::uint32_t>(input),
+                .output = static_cast<std::uint32_t>(*output),
+                .gain = gain
+            });
+        }
+    };
+
+    auto left = to.find(labeled(TChannelMap::LEFT));
+    auto right = to.find(labeled(TChannelMap::RIGHT));
+    auto center = to.find(labeled(TChannelMap::CENTER));
+    auto mono = to.find(labeled(TChannelMap::MONO));
+    auto lfe = labeled(TChannelMap::LFE);
+
+    // devices of uncommon channel counts have aux outputs only,
+    // first two of them stand in for front speakers
+    bool isAuxOnly = !left && !right && !center && !mono && to.size() > 1 && to[0].isAux && to[1].isAux;
+    if (isAuxOnly) {
+        left = 0;
+        right = 1;
+    }
+
+    // mono device averages everything except lfe
+    std::size_t audible = 0;
+    for (std::size_t input = 0; input < from.size(); ++input) {
+        audible += !(from[input] == lfe);
+    }
+
+    for (std::size_t input = 0; input < from.size(); ++input) {
+        const Position position = from[input];
+
+        if (auto output = to.find(position)) {
+            route(input, output, 1.f);
+            continue;
+        }
+
+        if (mono) {
+            if (!(position == lfe)) {
+                route(input, mono, 1.f / audible);
+            }
+            continue;
+        }
+
+        if (position.isAux) {
+            // device has no such output: channel goes to output of same index,
+            // so streams of uncommon channel counts still play as they did before remixing
+            if (static_cast<std::size_t>(position.value) < to.size()) {
+                route(input, static_cast<std::size_t>(position.value), 1.f);
+            } else {
+                route(input, left, halfPower);
+                route(input, right, halfPower);
+            }
+            continue;
+        }
+
+        switch (static_cast<ChannelLayout::EPosition>(position.value)) {
+            case TChannelMap::MONO:
+                if (center) {
+                    route(input, center, 1.f);
+                } else if ((left || right) && !isAuxOnly) {
+                    // keeps level of mono clients as they were before remixing
+                    route(input, left, 1.f);
+                    route(input, right, 1.f);
+                } else {
+                    for (std::size_t output = 0; output < to.size(); ++output) {
+                        if (!(to[output] == lfe)) {
+                            route(input, output, 1.f);
+                        }
+                    }
+                }
+                break;
+            case TChannelMap::CENTER:
+                route(input, left, halfPower);
+                route(input, right, halfPower);
+                break;
+            case TChannelMap::REAR_CENTER:
+                if (auto rearLeft = to.find(labeled(TChannelMap::REAR_LEFT)), rearRight = to.find(labeled(TChannelMap::REAR_RIGHT)); rearLeft && rearRight) {
+                    route(input, rearLeft, halfPower);
+                    route(input, rearRight, halfPower);
+                } else if (auto sideLeft = to.find(labeled(TChannelMap::SIDE_LEFT)), sideRight = to.find(labeled(TChannelMap::SIDE_RIGHT)); sideLeft && sideRight) {
+                    route(input, sideLeft, halfPower);
+                    route(input, sideRight, halfPower);
+                } else {
+                    route(input, left, 0.5f);
+                    route(input, right, 0.5f);
+                }
+                break;
+            case TChannelMap::REAR_LEFT:
+            case TChannelMap::REAR_RIGHT:
+            case TChannelMap::SIDE_LEFT:
+            case TChannelMap::SIDE_RIGHT: {
+                const auto* fold = std::find_if(std::begin(surroundFolds), std::end(surroundFolds), [&](const Fold& fold) {
+                    return labeled(fold.from) == position;
+                });
+                if (auto output = to.find(labeled(fold->to))) {
+                    route(input, output, 1.f);
+                    break;
+                }
+
+                bool isLeft = position == labeled(TChannelMap::REAR_LEFT) || position == labeled(TChannelMap::SIDE_LEFT);
+                route(input, (isLeft) ? left : right, halfPower);
+                break;
+            }
+            case TChannelMap::LEFT:
+                route(input, left, 1.f);
+                break;
+            case TChannelMap::RIGHT:
+                route(input, right, 1.f);
+                break;
+            case TChannelMap::LFE:
+            default:
+                // aux output of same index is as good as any, labeled ones are left alone
+                if (input < to.size() && to[input].isAux) {
+                    route(input, input, 1.f);
+                }
+                break;
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return std::tie(lhs.output, lhs.input) < std::tie(rhs.output, rhs.input);
+    });
+
+    return ChannelMatrix(from.size(), to.size(), std::move(entries));
+}
+
+std::size_t ChannelMatrix::inputs() const noexcept {
+    return inputs_;
+}
+
+std::size_t ChannelMatrix::outputs() const noexcept {
+    return outputs_;
+}
+
+std::span<const ChannelMatrix::Entry> ChannelMatrix::entries() const noexcept {
+    return entries_;
+}
+
+float ChannelMatrix::gain(std::size_t input, std::size_t output) const noexcept {
+    for (const Entry& entry : entries_) {
+        if (entry.input == input && entry.output == output) {
+            return entry.gain;
+        }
+    }
+    return 0.f;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+
+// std
+#include <span>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+// proto
+#include <protos/common/stream-configuration.pb.h>
+
+
+namespace laar {
+
+    // Ordered speaker positions of a stream or a device.
+    class ChannelLayout {
+    public:
+
+        using TChannelMap = NSound::NCommon::TStreamConfiguration::TChannelMap;
+        using EPosition = TChannelMap::TLabeledPosition;
+
+        // matches PA_CHANNELS_MAX, so any pulse stream fits
+        static constexpr std::size_t MaxChannels = 32;
+
+        struct Position {
+            static Position labeled(EPosition position) noexcept;
+            static Position aux(std::int32_t index) noexcept;
+
+            bool operator==(const Position& other) const noexcept = default;
+
+            bool isAux;
+            std::int32_t value;
+        };
+
+        // map from config if present, default layout for channel count otherwise
+        static absl::StatusOr<ChannelLayout> fromConfig(const NSound::NCommon::TStreamConfiguration& config);
+        // ALSA order, which is what RtAudio devices use: FL FR RL RR FC LFE SL SR
+        static absl::StatusOr<ChannelLayout> byCount(std::size_t channels);
+
+        void toConfig(TChannelMap* map) const;
+        std::string toString() const;
+
+        std::size_t size() const noexcept;
+        std::optional<std::size_t> find(Position position) const noexcept;
+        const Position& operator[](std::size_t channel) const noexcept;
+
+    private:
+        explicit ChannelLayout(std::vector<Position> positions);
+
+    private:
+        std::vector<Position> positions_;
+    };
+
+    // Gains mapping every channel of one layout onto another. Kept sparse,
+    // since almost every output gets one or two inputs at most.
+    class ChannelMatrix {
+    public:
+
+        struct Entry {
+            std::uint32_t input;
+            std::uint32_t output;
+            float gain;
+        };
+
+        // computed once per stream, off real-time path
+        static ChannelMatrix create(const ChannelLayout& from, const ChannelLayout& to);
+
+        std::size_t inputs() const noexcept;
+        std::size_t outputs() const noexcept;
+        std::span<const Entry> entries() const noexcept;
+
+        float gain(std::size_t input, std::size_t output) const noexcept;
+
+    private:
+        ChannelMatrix(std::size_t inputs, std::size_t outputs, std::vector<Entry> entries);
+
+    private:
+        std::size_t inputs_;
+        std::size_t outputs_;
+        std::vector<Entry> entries_;
+    };
+
+}
@@ -1,18 +1,33 @@
 // std
+#include <array>
 #include <cstdint>
+#include <cstring>
+#include <cstddef>
 
 // laar
 #include <src/ssd/sound/converter.hpp>
+#include <src/ssd/sound/sample-traits.hpp>
 
 // abseil
+#include <absl/status/status.h>
 #include <absl/base/internal/endian.h>
 
 // proto
 #include <protos/client/stream.pb.h>
 
+using namespace laar;
+
 using ESamples = 
     NSound::NCommon::TStreamConfiguration::TSampleSpecification;
 
+// Batch converters are cloned for several instruction sets and
+// picked by loader at runtime, default clone is plain scalar code.
+#if defined(__x86_64__) && defined(__ELF__) && defined(__GNUC__)
+    #define SSD_CONVERTER_CLONES __attribute__((target_clones("avx2", "sse4.2", "default")))
+#else
+    #define SSD_CONVERTER_CLONES
+#endif
+
 
 std::uint16_t laar::convertToLE(std::uint16_t data) {
     #if __BYTE_ORDER == __LITTLE_ENDIAN
@@ -94,47 +109,225 @@ std::uint32_t laar::convertFromBE(std::uint32_t data) {
     #endif
 }
 
+namespace {
+
+    // Reference G.711 companding (as in ITU-T G.191 / Sun g711.c),
+    // evaluated only at compile time to fill lookup tables.
+
+    constexpr int segmentOf(int value, const std::array<int, 8>& ends) {
+        for (int segment = 0; segment < 8; ++segment) {
+            if (value <= ends[segment]) {
+                return segment;
+            }
+        }
+        return 8;
+    }
+
+    constexpr std::uint8_t linearToALaw(int sample) {
+        constexpr std::array<int, 8> ends = {0x1F, 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF};
+
+        int mask = 0xD5;
+        sample >>= 3;
+        if (sample < 0) {
+            mask = 0x55;
+            sample = -sample - 1;
+        }
+
+        int segment = segmentOf(sample, ends);
+        if (segment >= 8) {
+            return 0x7F ^ mask;
+        }
+
+        int value = (segment << 4) | ((segment < 2) ? ((sample >> 1) & 0x0F) : ((sample >> segment) & 0x0F));
+        return value ^ mask;
+    }
+
+    constexpr std::int16_t aLawToLinear(std::uint8_t value) {
+        value ^= 0x55;
+
+        int sample = (value & 0x0F) << 4;
+        int segment = (value & 0x70) >> 4;
+        if (segment == 0) {
+            sample += 8;
+        } else {
+            sample = (sample + 0x108) << (segment - 1);
+        }
+
+        return (value & 0x80) ? sample : -sample;
+    }
+
+    constexpr std::uint8_t linearToULaw(int sample) {
+        constexpr std::array<int, 8> ends = {0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF, 0x1FFF};
+        constexpr int bias = 0x84;
+        constexpr int clip = 8159;
+
+        int mask = 0xFF;
+        sample >>= 2;
+        if (sample < 0) {
+            mask = 0x7F;
+            sample = -sample;
+        }
+        sample = (sample > clip) ? clip : sample;
+        sample += bias >> 2;
+
+        int segment = segmentOf(sample, ends);
+        if (segment >= 8) {
+            return 0x7F ^ mask;
+        }
+
+        int value = (segment << 4) | ((sample >> (segment + 1)) & 0x0F);
+        return value ^ mask;
+    }
+
+    constexpr std::int16_t uLawToLinear(std::uint8_t value) {
+        constexpr int bias = 0x84;
+
+        value = ~value;
+        int sample = (((value & 0x0F) << 3) + bias) << ((value & 0x70) >> 4);
+        return (value & 0x80) ? (bias - sample) : (sample - bias);
+    }
+
+    template<std::size_t Size, typename FunctorType>
+    constexpr auto makeTable(FunctorType generate) {
+        std::array<decltype(generate(0)), Size> table {};
+        for (std::size_t i = 0; i < Size; ++i) {
+            table[i] = generate(i);
+        }
+        return table;
+    }
+
+    // encode tables are indexed by top bits of s16 sample, so index is
+    // sign-extended back into s16 before companding
+    constexpr auto alawEncodeTable = makeTable<1 << 13>([](std::size_t index) {
+        return linearToALaw(static_cast<std::int16_t>(index << 3));
+    });
+
+    constexpr auto ulawEncodeTable = makeTable<1 << 14>([](std::size_t index) {
+        return linearToULaw(static_cast<std::int16_t>(index << 2));
+    });
+
+    constexpr auto alawDecodeTable = makeTable<256>([](std::size_t index) {
+        return aLawToLinear(index);
+    });
+
+    constexpr auto ulawDecodeTable = makeTable<256>([](std::size_t index) {
+        return uLawToLinear(index);
+    });
+
+    static_assert(alawDecodeTable[0xD5] == 8 && alawDecodeTable[0x2A] == -32256, "A-law table is broken");
+    static_assert(ulawDecodeTable[0xFF] == 0 && ulawDecodeTable[0x00] == -32124, "mu-law table is broken");
+    static_assert(alawEncodeTable[0] == 0xD5 && ulawEncodeTable[0] == 0xFF, "G.711 encode tables are broken");
+
+}
+
+const std::array<std::int16_t, 256> laar::ALawDecodeTable = alawDecodeTable;
+const std::array<std::int16_t, 256> laar::ULawDecodeTable = ulawDecodeTable;
+const std::array<std::uint8_t, 1 << 13> laar::ALawEncodeTable = alawEncodeTable;
+const std::array<std::uint8_t, 1 << 14> laar::ULawEncodeTable = ulawEncodeTable;
+
+namespace {
+
+    // Batch kernels, one instantiation per format. Codec is inlined,
+    // so loops are branch-free and get vectorized for every clone.
+    // Encoded side may sit at any offset inside a network message,
+    // so samples are moved with memcpy, which compiles to unaligned
+    // loads and stores.
+
+    template<ESampleType Format>
+    SSD_CONVERTER_CLONES
+    void encodeSamples(const std::int32_t* src, void* dest, std::size_t count) {
+        using Codec = laar::SampleCodec<Format>;
+        using StorageType = typename Codec::StorageType;
+        auto* encoded = static_cast<std::byte*>(dest);
+        for (std::size_t i = 0; i < count; ++i) {
+            const StorageType sample = Codec::encode(src[i]);
+            std::memcpy(encoded + i * sizeof(StorageType), &sample, sizeof(StorageType));
+        }
+    }
+
+    template<ESampleType Format>
+    SSD_CONVERTER_CLONES
+    void decodeSamples(const void* src, std::int32_t* dest, std::size_t count) {
+        using Codec = laar::SampleCodec<Format>;
+        using StorageType = typename Codec::StorageType;
+        const auto* encoded = static_cast<const std::byte*>(src);
+        for (std::size_t i = 0; i < count; ++i) {
+            StorageType sample;
+            std::memcpy(&sample, encoded + i * sizeof(StorageType), sizeof(StorageType));
+            dest[i] = Codec::decode(sample);
+        }
+    }
+
+}
+
 std::uint8_t laar::convertToUnsigned8(std::int32_t sample) {
-   return ((std::int64_t) sample - INT32_MIN) / (((std::int64_t) INT32_MAX - INT32_MIN) / UINT8_MAX);
+    return SampleCodec<ESamples::UNSIGNED_8>::encode(sample);
 }
 
 std::uint32_t laar::convertToFloat32BE(std::int32_t sample) {
-    float floating = (sample > 0) ? ((float) sample / INT32_MAX) : ((float) sample / INT32_MIN * -1);
-    return convertToBE(reinterpret_cast<uint32_t&>(floating));
+    return SampleCodec<ESamples::FLOAT_32_BIG_ENDIAN>::encode(sample);
 }
 
 std::uint32_t laar::convertToFloat32LE(std::int32_t sample) {
-    return convertToLE(convertToFloat32BE(sample));
+    return SampleCodec<ESamples::FLOAT_32_LITTLE_ENDIAN>::encode(sample);
 }
 
 std::uint32_t laar::convertToSigned32LE(std::int32_t sample) {
-    return convertToLE(reinterpret_cast<std::uint32_t&>(sample));
+    return SampleCodec<ESamples::SIGNED_32_LITTLE_ENDIAN>::encode(sample);
 }
 
 std::uint32_t laar::convertToSigned32BE(std::int32_t sample) {
-    return convertToBE(reinterpret_cast<std::uint32_t&>(sample));
+    return SampleCodec<ESamples::SIGNED_32_BIG_ENDIAN>::encode(sample);
 }
 
 std::uint16_t laar::convertToSigned16BE(std::int32_t sample) {
-    constexpr auto positiveScale = (((std::int64_t) INT32_MAX - INT32_MIN) / INT16_MAX);
-    constexpr auto negativeScale = (((std::int64_t) INT32_MAX - INT32_MIN) / -INT16_MIN);
-    auto result = (sample > 0) ? (sample / positiveScale) : (sample / negativeScale);
-    return convertToBE(reinterpret_cast<std::uint16_t&>(result));
+    return SampleCodec<ESamples::SIGNED_16_BIG_ENDIAN>::encode(sample);
 }
 
 std::uint16_t laar::convertToSigned16LE(std::int32_t sample) {
-    return convertToLE(convertToSigned16BE(sample));
+    return SampleCodec<ESamples::SIGNED_16_LITTLE_ENDIAN>::encode(sample);
+}
+
+PackedSample24 laar::convertToSigned24LE(std::int32_t sample) {
+    return SampleCodec<ESamples::SIGNED_24_LITTLE_ENDIAN>::encode(sample);
+}
+
+PackedSample24 laar::convertToSigned24BE(std::int32_t sample) {
+    return SampleCodec<ESamples::SIGNED_24_BIG_ENDIAN>::encode(sample);
+}
+
+std::uint32_t laar::convertToSigned24LsbLE(std::int32_t sample) {
+    return SampleCodec<ESamples::SIGNED_24_LSB_LITTLE_ENDIAN>::encode(sample);
+}
+
+std::uint32_t laar::convertToSigned24LsbBE(std::int32_t sample) {
+    return SampleCodec<ESamples::SIGNED_24_LSB_BIG_ENDIAN>::encode(sample);
+}
+
+std::uint8_t laar::convertToALaw(std::int32_t sample) {
+    return SampleCodec<ESamples::UNSIGNED_8_ALAW>::encode(sample);
+}
+
+std::uint8_t laar::convertToULaw(std::int32_t sample) {
+    return SampleCodec<ESamples::UNSIGNED_8_ULAW>::encode(sample);
 }
 
 std::size_t laar::getSampleSize(ESampleType format) {
     switch(format) {
         case ESamples::UNSIGNED_8:
+        case ESamples::UNSIGNED_8_ALAW:
+        case ESamples::UNSIGNED_8_ULAW:
             return sizeof(std::uint8_t);
         case ESamples::SIGNED_16_BIG_ENDIAN:
         case ESamples::SIGNED_16_LITTLE_ENDIAN:
             return sizeof(std::uint16_t);
+        case ESamples::SIGNED_24_BIG_ENDIAN:
+        case ESamples::SIGNED_24_LITTLE_ENDIAN:
+            return sizeof(PackedSample24);
         case ESamples::SIGNED_32_LITTLE_ENDIAN:
         case ESamples::SIGNED_32_BIG_ENDIAN:
+        case ESamples::SIGNED_24_LSB_LITTLE_ENDIAN:
+        case ESamples::SIGNED_24_LSB_BIG_ENDIAN:
         case ESamples::FLOAT_32_BIG_ENDIAN:
         case ESamples::FLOAT_32_LITTLE_ENDIAN:
             return sizeof(std::uint32_t);
@@ -144,43 +337,225 @@ std::size_t laar::getSampleSize(ESampleType format) {
 }
 
 std::int32_t laar::convertFromUnsigned8(std::uint8_t sample) {
-    return (std::int64_t) sample * (((std::int64_t) INT32_MAX - INT32_MIN) / UINT8_MAX) + INT32_MIN;
+    return SampleCodec<ESamples::UNSIGNED_8>::decode(sample);
 }
 
 std::int32_t laar::convertFromFloat32BE(std::uint32_t sample) {
-    auto converted = convertFromBE(sample);
-    long double floating = reinterpret_cast<float&>(converted);
-    return (floating > 0) ? (floating * INT32_MAX) : -(floating * INT32_MIN);
+    return SampleCodec<ESamples::FLOAT_32_BIG_ENDIAN>::decode(sample);
 }
 
 std::int32_t laar::convertFromFloat32LE(std::uint32_t sample) {
-    auto converted = convertFromLE(sample);
-    long double floating = reinterpret_cast<float&>(converted);
-    return (floating > 0) ? (floating * INT32_MAX) : -(floating * INT32_MIN);
+    return SampleCodec<ESamples::FLOAT_32_LITTLE_ENDIAN>::decode(sample);
 }
 
 std::int32_t laar::convertFromSigned32LE(std::uint32_t sample) {
-    auto converted = convertFromLE(sample);
-    return reinterpret_cast<std::int32_t&>(converted);
+    return SampleCodec<ESamples::SIGNED_32_LITTLE_ENDIAN>::decode(sample);
 }
 
 std::int32_t laar::convertFromSigned32BE(std::uint32_t sample) {
-    auto converted = convertFromBE(sample);
-    return reinterpret_cast<std::int32_t&>(converted);
+    return SampleCodec<ESamples::SIGNED_32_BIG_ENDIAN>::decode(sample);
 }
 
 std::int32_t laar::convertFromSigned16BE(std::uint16_t sample) {
-    constexpr auto positiveScale =  INT32_MAX / INT16_MAX;
-    constexpr auto negativeScale =  INT32_MIN / INT16_MIN;
-    auto converted = convertFromBE(sample);
-    std::int32_t casted = reinterpret_cast<int16_t&>(converted);
-    return (casted > 0) ? (casted * positiveScale) : (casted * negativeScale);
+    return SampleCodec<ESamples::SIGNED_16_BIG_ENDIAN>::decode(sample);
 }
 
 std::int32_t laar::convertFromSigned16LE(std::uint16_t sample) {
-    constexpr auto positiveScale =  INT32_MAX / INT16_MAX;
-    constexpr auto negativeScale =  INT32_MIN / INT16_MIN;
-    auto converted = convertFromLE(sample);
-    std::int32_t casted = reinterpret_cast<int16_t&>(converted);
-    return (casted > 0) ? (casted * positiveScale) : (casted * negativeScale);
-}
\ No newline at end of file
+    return SampleCodec<ESamples::SIGNED_16_LITTLE_ENDIAN>::decode(sample);
+}
+
+std::int32_t laar::convertFromSigned24LE(PackedSample24 sample) {
+    return SampleCodec<ESamples::SIGNED_24_LITTLE_ENDIAN>::decode(sample);
+}
+
+std::int32_t laar::convertFromSigned24BE(PackedSample24 sample) {
+    return SampleCodec<ESamples::SIGNED_24_BIG_ENDIAN>::decode(sample);
+}
+
+std::int32_t laar::convertFromSigned24LsbLE(std::uint32_t sample) {
+    return SampleCodec<ESamples::SIGNED_24_LSB_LITTLE_ENDIAN>::decode(sample);
+}
+
+std::int32_t laar::convertFromSigned24LsbBE(std::uint32_t sample) {
+    return SampleCodec<ESamples::SIGNED_24_LSB_BIG_ENDIAN>::decode(sample);
+}
+
+std::int32_t laar::convertFromALaw(std::uint8_t sample) {
+    return SampleCodec<ESamples::UNSIGNED_8_ALAW>::decode(sample);
+}
+
+std::int32_t laar::convertFromULaw(std::uint8_t sample) {
+    return SampleCodec<ESamples::UNSIGNED_8_ULAW>::decode(sample);
+}
+
+void laar::convertToUnsigned8(const std::int32_t* src, std::uint8_t* dest, std::size_t count) {
+    encodeSamples<ESamples::UNSIGNED_8>(src, dest, count);
+}
+
+void laar::convertToFloat32BE(const std::int32_t* src, std::uint32_t* dest, std::size_t count) {
+    encodeSamples<ESamples::FLOAT_32_BIG_ENDIAN>(src, dest, count);
+}
+
+void laar::convertToFloat32LE(const std::int32_t* src, std::uint32_t* dest, std::size_t count) {
+    encodeSamples<ESamples::FLOAT_32_LITTLE_ENDIAN>(src, dest, count);
+}
+
+void laar::convertToSigned32LE(const std::int32_t* src, std::uint32_t* dest, std::size_t count) {
+    encodeSamples<ESamples::SIGNED_32_LITTLE_ENDIAN>(src, dest, count);
+}
+
+void laar::convertToSigned32BE(const std::int32_t* src, std::uint32_t* dest, std::size_t count) {
+    encodeSamples<ESamples::SIGNED_32_BIG_ENDIAN>(src, dest, count);
+}
+
+void laar::convertToSigned16BE(const std::int32_t* src, std::uint16_t* dest, std::size_t count) {
+    encodeSamples<ESamples::SIGNED_16_BIG_ENDIAN>(src, dest, count);
+}
+
+void laar::convertToSigned16LE(const std::int32_t* src, std::uint16_t* dest, std::size_t count) {
+    encodeSamples<ESamples::SIGNED_16_LITTLE_ENDIAN>(src, dest, count);
+}
+
+void laar::convertToSigned24LE(const std::int32_t* src, PackedSample24* dest, std::size_t count) {
+    encodeSamples<ESamples::SIGNED_24_LITTLE_ENDIAN>(src, dest, count);
+}
+
+void laar::convertToSigned24BE(const std::int32_t* src, PackedSample24* dest, std::size_t count) {
+    encodeSamples<ESamples::SIGNED_24_BIG_ENDIAN>(src, dest, count);
+}
+
+void laar::convertToSigned24LsbLE(const std::int32_t* src, std::uint32_t* dest, std::size_t count) {
+    encodeSamples<ESamples::SIGNED_24_LSB_LITTLE_ENDIAN>(src, dest, count);
+}
+
+void laar::convertToSigned24LsbBE(const std::int32_t* src, std::uint32_t* dest, std::size_t count) {
+    encodeSamples<ESamples::SIGNED_24_LSB_BIG_ENDIAN>(src, dest, count);
+}
+
+void laar::convertToALaw(const std::int32_t* src, std::uint8_t* dest, std::size_t count) {
+    encodeSamples<ESamples::UNSIGNED_8_ALAW>(src, dest, count);
+}
+
+void laar::convertToULaw(const std::int32_t* src, std::uint8_t* dest, std::size_t count) {
+    encodeSamples<ESamples::UNSIGNED_8_ULAW>(src, dest, count);
+}
+
+void laar::convertFromUnsigned8(const std::uint8_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::UNSIGNED_8>(src, dest, count);
+}
+
+void laar::convertFromFloat32BE(const std::uint32_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::FLOAT_32_BIG_ENDIAN>(src, dest, count);
+}
+
+void laar::convertFromFloat32LE(const std::uint32_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::FLOAT_32_LITTLE_ENDIAN>(src, dest, count);
+}
+
+void laar::convertFromSigned32LE(const std::uint32_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::SIGNED_32_LITTLE_ENDIAN>(src, dest, count);
+}
+
+void laar::convertFromSigned32BE(const std::uint32_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::SIGNED_32_BIG_ENDIAN>(src, dest, count);
+}
+
+void laar::convertFromSigned16BE(const std::uint16_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::SIGNED_16_BIG_ENDIAN>(src, dest, count);
+}
+
+void laar::convertFromSigned16LE(const std::uint16_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::SIGNED_16_LITTLE_ENDIAN>(src, dest, count);
+}
+
+void laar::convertFromSigned24LE(const PackedSample24* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::SIGNED_24_LITTLE_ENDIAN>(src, dest, count);
+}
+
+void laar::convertFromSigned24BE(const PackedSample24* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::SIGNED_24_BIG_ENDIAN>(src, dest, count);
+}
+
+void laar::convertFromSigned24LsbLE(const std::uint32_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::SIGNED_24_LSB_LITTLE_ENDIAN>(src, dest, count);
+}
+
+void laar::convertFromSigned24LsbBE(const std::uint32_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::SIGNED_24_LSB_BIG_ENDIAN>(src, dest, count);
+}
+
+void laar::convertFromALaw(const std::uint8_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::UNSIGNED_8_ALAW>(src, dest, count);
+}
+
+void laar::convertFromULaw(const std::uint8_t* src, std::int32_t* dest, std::size_t count) {
+    decodeSamples<ESamples::UNSIGNED_8_ULAW>(src, dest, count);
+}
+
+template<ESampleType Format>
+SampleConverter SampleConverter::make() noexcept {
+    return SampleConverter(
+        Format, SampleTraits<Format>::width, &encodeSamples<Format>, &decodeSamples<Format>, Private());
+}
+
+absl::StatusOr<SampleConverter> SampleConverter::create(ESampleType format) {
+    switch (format) {
+        case ESamples::UNSIGNED_8:
+            return make<ESamples::UNSIGNED_8>();
+        case ESamples::FLOAT_32_BIG_ENDIAN:
+            return make<ESamples::FLOAT_32_BIG_ENDIAN>();
+        case ESamples::FLOAT_32_LITTLE_ENDIAN:
+            return make<ESamples::FLOAT_32_LITTLE_ENDIAN>();
+        case ESamples::SIGNED_32_LITTLE_ENDIAN:
+            return make<ESamples::SIGNED_32_LITTLE_ENDIAN>();
+        case ESamples::SIGNED_32_BIG_ENDIAN:
+            return make<ESamples::SIGNED_32_BIG_ENDIAN>();
+        case ESamples::SIGNED_16_BIG_ENDIAN:
+            return make<ESamples::SIGNED_16_BIG_ENDIAN>();
+        case ESamples::SIGNED_16_LITTLE_ENDIAN:
+            return make<ESamples::SIGNED_16_LITTLE_ENDIAN>();
+        case ESamples::SIGNED_24_LITTLE_ENDIAN:
+            return make<ESamples::SIGNED_24_LITTLE_ENDIAN>();
+        case ESamples::SIGNED_24_BIG_ENDIAN:
+            return make<ESamples::SIGNED_24_BIG_ENDIAN>();
+        case ESamples::SIGNED_24_LSB_LITTLE_ENDIAN:
+            return make<ESamples::SIGNED_24_LSB_LITTLE_ENDIAN>();
+        case ESamples::SIGNED_24_LSB_BIG_ENDIAN:
+            return make<ESamples::SIGNED_24_LSB_BIG_ENDIAN>();
+        case ESamples::UNSIGNED_8_ALAW:
+            return make<ESamples::UNSIGNED_8_ALAW>();
+        case ESamples::UNSIGNED_8_ULAW:
+            return make<ESamples::UNSIGNED_8_ULAW>();
+        default:
+            return absl::InvalidArgumentError("format is not supported");
+    }
+}
+
+SampleConverter::SampleConverter(
+    ESampleType format, 
+    std::size_t sampleSize, 
+    EncodeFunction encode, 
+    DecodeFunction decode, 
+    Private /* access */
+)
+    : format_(format)
+    , sampleSize_(sampleSize)
+    , encode_(encode)
+    , decode_(decode)
+{}
+
+void SampleConverter::toFormat(const std::int32_t* src, void* dest, std::size_t count) const noexcept {
+    encode_(src, dest, count);
+}
+
+void SampleConverter::fromFormat(const void* src, std::int32_t* dest, std::size_t count) const noexcept {
+    decode_(src, dest, count);
+}
+
+ESampleType SampleConverter::format() const noexcept {
+    return format_;
+}
+
+std::size_t SampleConverter::sampleSize() const noexcept {
+    return sampleSize_;
+}
@@ -3,12 +3,20 @@
 // RtAudio
 #include <RtAudio.h>
 
+// abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+
 // std
+#include <cstddef>
 #include <cstdint>
 
 // proto
 #include <protos/client/stream.pb.h>
 
+// laar
+#include <src/ssd/sound/sample-traits.hpp>
+
 namespace laar {
 
     using ESampleType =
@@ -32,6 +40,12 @@ namespace laar {
     std::uint32_t convertToSigned32BE(std::int32_t sample);
     std::uint16_t convertToSigned16BE(std::int32_t sample);
     std::uint16_t convertToSigned16LE(std::int32_t sample);
+    PackedSample24 convertToSigned24LE(std::int32_t sample);
+    PackedSample24 convertToSigned24BE(std::int32_t sample);
+    std::uint32_t convertToSigned24LsbLE(std::int32_t sample);
+    std::uint32_t convertToSigned24LsbBE(std::int32_t sample);
+    std::uint8_t convertToALaw(std::int32_t sample);
+    std::uint8_t convertToULaw(std::int32_t sample);
 
     // for pushing
     std::int32_t convertFromUnsigned8(std::uint8_t sample);
@@ -41,8 +55,83 @@ namespace laar {
     std::int32_t convertFromSigned32BE(std::uint32_t sample);
     std::int32_t convertFromSigned16BE(std::uint16_t sample);
     std::int32_t convertFromSigned16LE(std::uint16_t sample);
+    std::int32_t convertFromSigned24LE(PackedSample24 sample);
+    std::int32_t convertFromSigned24BE(PackedSample24 sample);
+    std::int32_t convertFromSigned24LsbLE(std::uint32_t sample);
+    std::int32_t convertFromSigned24LsbBE(std::uint32_t sample);
+    std::int32_t convertFromALaw(std::uint8_t sample);
+    std::int32_t convertFromULaw(std::uint8_t sample);
+
+    // batch versions of the above, convert count samples at once;
+    // implementation for current CPU is picked at runtime
+    void convertToUnsigned8(const std::int32_t* src, std::uint8_t* dest, std::size_t count);
+    void convertToFloat32BE(const std::int32_t* src, std::uint32_t* dest, std::size_t count);
+    void convertToFloat32LE(const std::int32_t* src, std::uint32_t* dest, std::size_t count);
+    void convertToSigned32LE(const std::int32_t* src, std::uint32_t* dest, std::size_t count);
+    void convertToSigned32BE(const std::int32_t* src, std::uint32_t* dest, std::size_t count);
+    void convertToSigned16BE(const std::int32_t* src, std::uint16_t* dest, std::size_t count);
+    void convertToSigned16LE(const std::int32_t* src, std::uint16_t* dest, std::size_t count);
+    void convertToSigned24LE(const std::int32_t* src, PackedSample24* dest, std::size_t count);
+    void convertToSigned24BE(const std::int32_t* src, PackedSample24* dest, std::size_t count);
+    void convertToSigned24LsbLE(const std::int32_t* src, std::uint32_t* dest, std::size_t count);
+    void convertToSigned24LsbBE(const std::int32_t* src, std::uint32_t* dest, std::size_t count);
+    void convertToALaw(const std::int32_t* src, std::uint8_t* dest, std::size_t count);
+    void convertToULaw(const std::int32_t* src, std::uint8_t* dest, std::size_t count);
+
+    void convertFromUnsigned8(const std::uint8_t* src, std::int32_t* dest, std::size_t count);
+    void convertFromFloat32BE(const std::uint32_t* src, std::int32_t* dest, std::size_t count);
+    void convertFromFloat32LE(const std::uint32_t* src, std::int32_t* dest, std::size_t count);
+    void convertFromSigned32LE(const std::uint32_t* src, std::int32_t* dest, std::size_t count);
+    void convertFromSigned32BE(const std::uint32_t* src, std::int32_t* dest, std::size_t count);
+    void convertFromSigned16BE(const std::uint16_t* src, std::int32_t* dest, std::size_t count);
+    void convertFromSigned16LE(const std::uint16_t* src, std::int32_t* dest, std::size_t count);
+    void convertFromSigned24LE(const PackedSample24* src, std::int32_t* dest, std::size_t count);
+    void convertFromSigned24BE(const PackedSample24* src, std::int32_t* dest, std::size_t count);
+    void convertFromSigned24LsbLE(const std::uint32_t* src, std::int32_t* dest, std::size_t count);
+    void convertFromSigned24LsbBE(const std::uint32_t* src, std::int32_t* dest, std::size_t count);
+    void convertFromALaw(const std::uint8_t* src, std::int32_t* dest, std::size_t count);
+    void convertFromULaw(const std::uint8_t* src, std::int32_t* dest, std::size_t count);
 
     // get sample size on bytes
     std::size_t getSampleSize(ESampleType format);
 
+    // Batch conversion between stream format and base samples. Format
+    // is resolved once on creation, so every call goes straight to
+    // kernel specialized for it.
+    class SampleConverter {
+    private: struct Private { };
+    public:
+
+        using EncodeFunction = void (*)(const std::int32_t* src, void* dest, std::size_t count);
+        using DecodeFunction = void (*)(const void* src, std::int32_t* dest, std::size_t count);
+
+        static absl::StatusOr<SampleConverter> create(ESampleType format);
+
+        SampleConverter(
+            ESampleType format, 
+            std::size_t sampleSize, 
+            EncodeFunction encode, 
+            DecodeFunction decode, 
+            Private access
+        );
+
+        // dest/src hold count samples of stream format
+        void toFormat(const std::int32_t* src, void* dest, std::size_t count) const noexcept;
+        void fromFormat(const void* src, std::int32_t* dest, std::size_t count) const noexcept;
+
+        ESampleType format() const noexcept;
+        std::size_t sampleSize() const noexcept;
+
+    private:
+        template<ESampleType Format>
+        static SampleConverter make() noexcept;
+
+    private:
+        ESampleType format_;
+        std::size_t sampleSize_;
+        EncodeFunction encode_;
+        DecodeFunction decode_;
+
+    };
+
 };
\ No newline at end of file
@@ -1,13 +1,24 @@
 // abseil
 #include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <absl/strings/str_format.h>
 
 // fftw3
 #include <fftw3.h>
 
+// json
+#include <nlohmann/json.hpp>
+
 // STD
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <vector>
 #include <memory>
 #include <cstddef>
 #include <cstdint>
+#include <climits>
+#include <algorithm>
 
 // laar
 #include <src/ssd/sound/converter.hpp>
@@ -34,30 +45,54 @@ namespace {
     };
 
     struct TubeState {
-        TubeState(const ESamplesOrder& order)
+        TubeState(
+            const ESamplesOrder& order, 
+            const SampleConverter& converter,
+            std::vector<std::uint32_t>& formatScratch, 
+            std::vector<std::int32_t>& baseScratch
+        )
             : order_(order)
+            , converter_(converter)
+            , formatScratch_(formatScratch)
+            , baseScratch_(baseScratch)
         {}
 
         const ESamplesOrder order_;
+        const SampleConverter& converter_;
+
+        // storage wide enough for any supported sample type
+        std::vector<std::uint32_t>& formatScratch_;
+        std::vector<std::int32_t>& baseScratch_;
     };
 
-    template<typename ResultingSampleType, typename FunctorType>
-    absl::Status typedRoute(void* in, void* out, std::size_t samples, TubeState state, RoutingChannelInfo routingInfo, FunctorType process) {
-        fftw_complex* original = static_cast<fftw_complex*>(in);
+    constexpr auto BASS_ROUTING_SECTION = "bassRouting";
 
-        ResultingSampleType* resulting = static_cast<ResultingSampleType*>(out);
-        StreamWrapper<ResultingSampleType> outWrappedStream(
-            samples, routingInfo.channelNum, state.order_, resulting 
-        );
+    // fftw planner is not thread-safe, execution of ready plans is
+    std::mutex plannerLock;
 
-        auto outCurrent = outWrappedStream.begin(routingInfo.routeTo);
+    std::int32_t clampToBase(double sample) {
+        // bands may overshoot original signal slightly
+        return static_cast<std::int32_t>(std::lround(std::clamp<double>(sample, INT32_MIN, INT32_MAX)));
+    }
+
+    template<typename ResultingSampleType>
+    absl::Status typedRoute(const double* in, void* out, std::size_t samples, TubeState state, RoutingChannelInfo routingInfo) {
+        state.baseScratch_.resize(samples);
         for (std::size_t sample = 0; sample < samples; ++sample) {
-            if (outCurrent == outWrappedStream.end(routingInfo.routeTo)) {
-                return absl::OutOfRangeError("reached end of out stream unexpectedly");
-            }
-            *outCurrent = process(static_cast<std::int32_t>(original[sample][0] / samples));
-            ++outCurrent;
+            state.baseScratch_[sample] = clampToBase(in[sample]);
         }
+
+        state.formatScratch_.resize(samples);
+        ResultingSampleType* converted = reinterpret_cast<ResultingSampleType*>(state.formatScratch_.data());
+        state.converter_.toFormat(state.baseScratch_.data(), converted, samples);
+
+        ResultingSampleType* resulting = static_cast<ResultingSampleType*>(out);
+        visitSamplesOrder(state.order_, [&](auto order) {
+            StreamWrapper<ResultingSampleType, decltype(order)::value> outWrappedStream(
+                samples, routingInfo.channelNum, resulting 
+            );
+            std::copy_n(converted, samples, outWrappedStream.begin(routingInfo.routeTo));
+        });
         
         return absl::OkStatus();
     }
@@ -88,131 +123,422 @@ BassRouterDispatcher::BassRouterDispatcher(
     , sampleRate_(sampleRate)
     , range_(range)
     , info_(info)
-{}
+    , converter_(SampleConverter::create(format))
+    , pending_(0)
+    , ready_(0)
+{
+    // defaults are always valid
+    configure(Settings()).IgnoreError();
+}
 
-BassRouterDispatcher::Frequencies BassRouterDispatcher::splitWindow(std::int32_t* in, std::size_t sampleRate, std::size_t samples) {
-    fftw_complex *complexIn = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * samples);
-    fftw_complex *complexOut = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * samples);
+absl::StatusOr<BassRouterDispatcher::Settings> BassRouterDispatcher::parseSettings(const nlohmann::json& config) {
+    Settings settings;
+    if (!config.contains(BASS_ROUTING_SECTION)) {
+        return settings;
+    }
 
-    for (std::size_t i = 0; i < samples; ++i) {
-        complexIn[i][0] = in[i];
-        complexIn[i][1] = 0.0;
+    const auto& routing = config[BASS_ROUTING_SECTION];
+    if (!routing.is_object()) {
+        return absl::InvalidArgumentError("bass routing section must be an object");
+    }
+
+    try {
+        std::string crossover = routing.value<std::string>("crossover", "overlap-add");
+        if (crossover == "block") {
+            settings.crossover = ECrossover::BLOCK;
+        } else if (crossover == "overlap-add") {
+            settings.crossover = ECrossover::OVERLAP_ADD;
+        } else if (crossover == "linkwitz-riley") {
+            settings.crossover = ECrossover::LINKWITZ_RILEY;
+        } else {
+            return absl::InvalidArgumentError(absl::StrFormat("unknown crossover: %s", crossover));
+        }
+        settings.fftSize = routing.value<std::size_t>("fftSize", settings.fftSize);
+    } catch (const nlohmann::json::exception& error) {
+        return absl::InvalidArgumentError(absl::StrFormat("malformed bass routing settings: %s", error.what()));
+    }
+
+    return settings;
+}
+
+absl::Status BassRouterDispatcher::configure(Settings settings) {
+    if (settings.crossover == ECrossover::OVERLAP_ADD) {
+        if (settings.fftSize < 16 || (settings.fftSize & (settings.fftSize - 1))) {
+            return absl::InvalidArgumentError(absl::StrFormat("fft size must be a power of two not less than 16, got: %d", settings.fftSize));
+        }
+    }
+
+    if (settings.crossover == ECrossover::LINKWITZ_RILEY) {
+        if (!(range_.higher > 0 && range_.higher < sampleRate_ / 2.0)) {
+            return absl::InvalidArgumentError(absl::StrFormat("crossover must be below nyquist, got: %f", range_.higher));
+        }
+    }
+
+    settings_ = settings;
+
+    if (settings_.crossover == ECrossover::OVERLAP_ADD) {
+        // periodic sqrt-hann: squared windows at half overlap sum to one, so
+        // analysis and synthesis both use it
+        window_.resize(settings_.fftSize);
+        for (std::size_t i = 0; i < settings_.fftSize; ++i) {
+            window_[i] = std::sin(M_PI * i / settings_.fftSize);
+        }
+    }
+
+    if (settings_.crossover == ECrossover::LINKWITZ_RILEY) {
+        // LR4 is a squared butterworth, i.e. two equal sections with Q = 1/sqrt(2)
+        const double omega = 2 * M_PI * range_.higher / sampleRate_;
+        const double alpha = std::sin(omega) / M_SQRT2;
+        const double cosine = std::cos(omega);
+        const double a0 = 1 + alpha;
+
+        Biquad lowpass;
+        lowpass.b0 = (1 - cosine) / 2 / a0;
+        lowpass.b1 = (1 - cosine) / a0;
+        lowpass.b2 = lowpass.b0;
+        lowpass.a1 = -2 * cosine / a0;
+        lowpass.a2 = (1 - alpha) / a0;
+
+        Biquad highpass;
+        highpass.b0 = (1 + cosine) / 2 / a0;
+        highpass.b1 = -(1 + cosine) / a0;
+        highpass.b2 = highpass.b0;
+        highpass.a1 = lowpass.a1;
+        highpass.a2 = lowpass.a2;
+
+        lowpass_.fill(lowpass);
+        highpass_.fill(highpass);
     }
 
-    fftw_plan p = fftw_plan_dft_1d(samples, complexIn, complexOut, FFTW_FORWARD, FFTW_ESTIMATE);
-    fftw_execute(p);
+    resetStream();
+    return absl::OkStatus();
+}
+
+std::size_t BassRouterDispatcher::latency() const noexcept {
+    return (settings_.crossover == ECrossover::OVERLAP_ADD) ? settings_.fftSize : 0;
+}
+
+const BassRouterDispatcher::Settings& BassRouterDispatcher::settings() const noexcept {
+    return settings_;
+}
 
-    double resolution = static_cast<double>(sampleRate) / samples;
-    Frequencies frequencies;
-    frequencies.bass = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * samples);
-    frequencies.normal = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * samples);
+BassRouterDispatcher::BlockPlan::BlockPlan(std::size_t samples)
+    : samples(samples)
+    , signal(fftw_alloc_real(samples))
+    , spectrum(fftw_alloc_complex(samples / 2 + 1))
+    , bassSpectrum(fftw_alloc_complex(samples / 2 + 1))
+    , normal(fftw_alloc_real(samples))
+    , bass(fftw_alloc_real(samples))
+{
+    std::lock_guard<std::mutex> lock (plannerLock);
+    // measuring overwrites buffers, nothing is stored in them yet
+    forward = fftw_plan_dft_r2c_1d(samples, signal, spectrum, FFTW_MEASURE);
+    // same plan runs for both bands, via new-array execute
+    backward = fftw_plan_dft_c2r_1d(samples, spectrum, normal, FFTW_MEASURE);
+}
 
+BassRouterDispatcher::BlockPlan::~BlockPlan() {
+    {
+        std::lock_guard<std::mutex> lock (plannerLock);
+        if (forward) {
+            fftw_destroy_plan(forward);
+        }
+        if (backward) {
+            fftw_destroy_plan(backward);
+        }
+    }
+
+    fftw_free(signal);
+    fftw_free(spectrum);
+    fftw_free(bassSpectrum);
+    fftw_free(normal);
+    fftw_free(bass);
+}
+
+absl::Status BassRouterDispatcher::prepare(std::size_t samples) {
+    reserveStream(samples);
+
+    switch (settings_.crossover) {
+        case ECrossover::BLOCK:
+            return acquirePlan(samples).status();
+        case ECrossover::OVERLAP_ADD:
+            return acquirePlan(settings_.fftSize).status();
+        case ECrossover::LINKWITZ_RILEY:
+            return absl::OkStatus();
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status BassRouterDispatcher::importWisdom(const std::string& path) {
+    std::lock_guard<std::mutex> lock (plannerLock);
+    if (!fftw_import_wisdom_from_filename(path.c_str())) {
+        return absl::NotFoundError(absl::StrFormat("failed to import fftw wisdom from %s", path));
+    }
+    return absl::OkStatus();
+}
+
+absl::Status BassRouterDispatcher::exportWisdom(const std::string& path) {
+    std::lock_guard<std::mutex> lock (plannerLock);
+    if (!fftw_export_wisdom_to_filename(path.c_str())) {
+        return absl::InternalError(absl::StrFormat("failed to export fftw wisdom to %s", path));
+    }
+    return absl::OkStatus();
+}
+
+absl::StatusOr<BassRouterDispatcher::BlockPlan*> BassRouterDispatcher::acquirePlan(std::size_t samples) {
+    if (!samples) {
+        return absl::InvalidArgumentError("block of zero samples can not be transformed");
+    }
+
+    if (auto iter = plans_.find(samples); iter != plans_.end()) {
+        return iter->second.get();
+    }
+
+    // slow path: measuring takes a while, prepare() is expected to run beforehand
+    auto plan = std::make_unique<BlockPlan>(samples);
+    if (!plan->signal || !plan->spectrum || !plan->bassSpectrum || !plan->normal || !plan->bass) {
+        return absl::ResourceExhaustedError("failed to allocate fftw buffers");
+    }
+    if (!plan->forward || !plan->backward) {
+        return absl::InternalError(absl::StrFormat("failed to plan transforms of %d samples", samples));
+    }
+
+    return plans_.emplace(samples, std::move(plan)).first->second.get();
+}
+
+void BassRouterDispatcher::splitSpectrum(BlockPlan& plan) {
+    const std::size_t samples = plan.samples;
+    const std::size_t bins = samples / 2 + 1;
+    // backward transform is not normalized, scale is folded into split
+    const double scale = 1.0 / samples;
+
+    fftw_execute(plan.forward);
+
+    // real input has hermitian spectrum, only non-negative frequencies are stored
+    double resolution = static_cast<double>(sampleRate_) / samples;
     bool bassEmpty = true;
     bool normalEmpty = true;
-    for (std::size_t i = 0; i < samples / 2; ++i) {
+    for (std::size_t i = 0; i < bins; ++i) {
         double freq = i * resolution;
 
         if (freq >= range_.lower && freq <= range_.higher) {
-            frequencies.bass[i][0] = complexOut[i][0];
-            frequencies.bass[i][1] = complexOut[i][1];
-            frequencies.normal[i][0] = 0;
-            frequencies.normal[i][1] = 0;
+            plan.bassSpectrum[i][0] = plan.spectrum[i][0] * scale;
+            plan.bassSpectrum[i][1] = plan.spectrum[i][1] * scale;
+            plan.spectrum[i][0] = 0;
+            plan.spectrum[i][1] = 0;
             bassEmpty = false; 
         } else {
-            frequencies.bass[i][0] = 0;
-            frequencies.bass[i][1] = 0;
-            frequencies.normal[i][0] = complexOut[i][0];
-            frequencies.normal[i][1] = complexOut[i][1];
+            plan.bassSpectrum[i][0] = 0;
+            plan.bassSpectrum[i][1] = 0;
+            plan.spectrum[i][0] *= scale;
+            plan.spectrum[i][1] *= scale;
             normalEmpty = false;
         }
     }
+
+    // c2r destroys its input, spectra are not needed afterwards anyway
     if (!normalEmpty) {
-        fftw_plan normalBackwardPlan = fftw_plan_dft_1d(samples, frequencies.normal, complexIn, FFTW_BACKWARD, FFTW_ESTIMATE);
-        fftw_execute(normalBackwardPlan);
-        fftw_destroy_plan(normalBackwardPlan);
+        fftw_execute_dft_c2r(plan.backward, plan.spectrum, plan.normal);
     } else {
-        for (std::size_t i = 0; i < samples; ++i) {
-            complexIn[i][0] = laar::Silence * samples;
-            complexIn[i][1] = 0;
-        }
+        std::fill_n(plan.normal, samples, laar::Silence);
     }
 
     if (!bassEmpty) {
-        fftw_plan bassBackwardPlan = fftw_plan_dft_1d(samples, frequencies.bass, complexOut, FFTW_BACKWARD, FFTW_ESTIMATE);
-        fftw_execute(bassBackwardPlan);
-        fftw_destroy_plan(bassBackwardPlan);
+        fftw_execute_dft_c2r(plan.backward, plan.bassSpectrum, plan.bass);
     } else {
-        for (std::size_t i = 0; i < samples; ++i) {
-            complexOut[i][0] = laar::Silence * samples;
-            complexOut[i][1] = 0;
+        std::fill_n(plan.bass, samples, laar::Silence);
+    }
+}
+
+absl::Status BassRouterDispatcher::splitBlock(const std::int32_t* in, std::size_t samples) {
+    absl::StatusOr<BlockPlan*> plan = acquirePlan(samples);
+    if (!plan.ok()) {
+        return plan.status();
+    }
+
+    std::copy_n(in, samples, (*plan)->signal);
+    splitSpectrum(**plan);
+
+    std::copy_n((*plan)->bass, samples, bass_.data());
+    std::copy_n((*plan)->normal, samples, normal_.data());
+    return absl::OkStatus();
+}
+
+absl::Status BassRouterDispatcher::splitOverlapAdd(const std::int32_t* in, std::size_t samples) {
+    const std::size_t size = settings_.fftSize;
+    const std::size_t hop = size / 2;
+
+    absl::StatusOr<BlockPlan*> acquired = acquirePlan(size);
+    if (!acquired.ok()) {
+        return acquired.status();
+    }
+    BlockPlan& plan = **acquired;
+
+    // history holds previous hop in front and new samples gathered behind it
+    std::size_t consumed = 0;
+    while (consumed < samples) {
+        std::size_t taken = std::min(hop - pending_, samples - consumed);
+        std::copy_n(in + consumed, taken, history_.data() + hop + pending_);
+        pending_ += taken;
+        consumed += taken;
+
+        if (pending_ < hop) {
+            break;
+        }
+
+        for (std::size_t i = 0; i < size; ++i) {
+            plan.signal[i] = history_[i] * window_[i];
         }
+        splitSpectrum(plan);
+
+        for (std::size_t i = 0; i < size; ++i) {
+            overlapBass_[i] += plan.bass[i] * window_[i];
+            overlapNormal_[i] += plan.normal[i] * window_[i];
+        }
+
+        // first hop has got both of its frames now
+        std::copy_n(overlapBass_.data(), hop, bass_.data() + ready_);
+        std::copy_n(overlapNormal_.data(), hop, normal_.data() + ready_);
+        ready_ += hop;
+
+        std::copy_n(overlapBass_.data() + hop, hop, overlapBass_.data());
+        std::copy_n(overlapNormal_.data() + hop, hop, overlapNormal_.data());
+        std::fill_n(overlapBass_.data() + hop, hop, 0.0);
+        std::fill_n(overlapNormal_.data() + hop, hop, 0.0);
+
+        std::copy_n(history_.data() + hop, hop, history_.data());
+        pending_ = 0;
+    }
+
+    // stream was primed with hop of silence, so there is always enough output
+    return (ready_ >= samples) 
+        ? absl::OkStatus() 
+        : absl::InternalError("overlap-add stream ran dry");
+}
+
+void BassRouterDispatcher::splitLinkwitzRiley(const std::int32_t* in, std::size_t samples) noexcept {
+    for (std::size_t i = 0; i < samples; ++i) {
+        double sample = in[i];
+        bass_[i] = lowpass_[1].process(lowpass_[0].process(sample));
+        normal_[i] = highpass_[1].process(highpass_[0].process(sample));
+    }
+}
+
+double BassRouterDispatcher::Biquad::process(double sample) noexcept {
+    double result = b0 * sample + z1;
+    z1 = b1 * sample - a1 * result + z2;
+    z2 = b2 * sample - a2 * result;
+    return result;
+}
+
+void BassRouterDispatcher::reserveStream(std::size_t samples) {
+    // overlap-add keeps up to a hop of output over requested samples
+    std::size_t capacity = samples + settings_.fftSize;
+    if (bass_.size() < capacity) {
+        bass_.resize(capacity);
+        normal_.resize(capacity);
     }
+}
 
-    fftw_free(frequencies.normal);
-    fftw_free(frequencies.bass);
+void BassRouterDispatcher::resetStream() {
+    const std::size_t size = settings_.fftSize;
 
-    fftw_destroy_plan(p);
+    history_.assign(size, 0.0);
+    overlapBass_.assign(size, 0.0);
+    overlapNormal_.assign(size, 0.0);
+    pending_ = 0;
 
-    frequencies.normal = complexIn;
-    frequencies.bass = complexOut;
+    reserveStream(0);
+    // prime output with a hop of silence: together with the half-empty first
+    // frame this makes latency exactly fftSize
+    ready_ = size / 2;
+    std::fill_n(bass_.begin(), ready_, 0.0);
+    std::fill_n(normal_.begin(), ready_, 0.0);
 
-    return frequencies;
+    for (auto& section : lowpass_) {
+        section.z1 = section.z2 = 0;
+    }
+    for (auto& section : highpass_) {
+        section.z1 = section.z2 = 0;
+    }
 }
 
 absl::Status BassRouterDispatcher::dispatch(void* in, void* out, std::size_t samples) {
-    auto data = splitWindow(reinterpret_cast<std::int32_t*>(in), sampleRate_, samples);
+    const std::int32_t* source = reinterpret_cast<const std::int32_t*>(in);
+    // no-op once prepare() has seen this period size
+    reserveStream(samples);
+
+    absl::Status status = absl::OkStatus();
+    switch (settings_.crossover) {
+        case ECrossover::BLOCK:
+            status = splitBlock(source, samples);
+            break;
+        case ECrossover::OVERLAP_ADD:
+            status = splitOverlapAdd(source, samples);
+            break;
+        case ECrossover::LINKWITZ_RILEY:
+            splitLinkwitzRiley(source, samples);
+            break;
+    }
+
+    if (!status.ok()) {
+        return status;
+    }
 
     absl::Status result = absl::OkStatus();
-    result.Update(routeBass(data.bass, out, samples));
-    result.Update(routeNormal(data.normal, out, samples));
-    fftw_free(data.normal);
-    fftw_free(data.bass);
+    result.Update(routeBass(bass_.data(), out, samples));
+    result.Update(routeNormal(normal_.data(), out, samples));
+
+    if (settings_.crossover == ECrossover::OVERLAP_ADD) {
+        std::copy(bass_.begin() + samples, bass_.begin() + ready_, bass_.begin());
+        std::copy(normal_.begin() + samples, normal_.begin() + ready_, normal_.begin());
+        ready_ -= samples;
+    }
+
     return result;
 }
 
-absl::Status BassRouterDispatcher::routeBass(void* in, void* out, std::size_t samples){
-    TubeState state (order_);
+absl::Status BassRouterDispatcher::routeBass(const double* in, void* out, std::size_t samples){
+    if (!converter_.ok()) {
+        return converter_.status();
+    }
+
+    TubeState state (order_, *converter_, formatScratch_, baseScratch_);
     RoutingChannelInfo routingInfo (info_.bass, info_.normal, info_);
 
-    switch (format_) {
-        case ESamples::FLOAT_32_BIG_ENDIAN:
-            return typedRoute<std::uint32_t>(in, out, samples, state, routingInfo, &convertToFloat32BE);
-        case ESamples::FLOAT_32_LITTLE_ENDIAN:
-            return typedRoute<std::uint32_t>(in, out, samples, state, routingInfo, &convertToFloat32LE);
-        case ESamples::UNSIGNED_8:
-            return typedRoute<std::uint8_t>(in, out, samples, state, routingInfo, &convertToUnsigned8);
-        case ESamples::SIGNED_32_BIG_ENDIAN:
-            return typedRoute<std::uint32_t>(in, out, samples, state, routingInfo, &convertToSigned32BE);
-        case ESamples::SIGNED_32_LITTLE_ENDIAN:
-            return typedRoute<std::uint32_t>(in, out, samples, state, routingInfo, &convertToSigned32LE);
-        case ESamples::SIGNED_16_BIG_ENDIAN:
-            return typedRoute<std::uint16_t>(in, out, samples, state, routingInfo, &convertToSigned16BE);
-        case ESamples::SIGNED_16_LITTLE_ENDIAN:
-            return typedRoute<std::uint16_t>(in, out, samples, state, routingInfo, &convertToSigned16LE);
+    // conversion is done by converter, only storage width matters here
+    switch (converter_->sampleSize()) {
+        case sizeof(std::uint8_t):
+            return typedRoute<std::uint8_t>(in, out, samples, state, routingInfo);
+        case sizeof(std::uint16_t):
+            return typedRoute<std::uint16_t>(in, out, samples, state, routingInfo);
+        case sizeof(PackedSample24):
+            return typedRoute<PackedSample24>(in, out, samples, state, routingInfo);
+        case sizeof(std::uint32_t):
+            return typedRoute<std::uint32_t>(in, out, samples, state, routingInfo);
         default:
             return absl::InvalidArgumentError("format is not supported");
     }
 }
 
-absl::Status BassRouterDispatcher::routeNormal(void* in, void* out, std::size_t samples){
-    TubeState state (order_);
+absl::Status BassRouterDispatcher::routeNormal(const double* in, void* out, std::size_t samples){
+    if (!converter_.ok()) {
+        return converter_.status();
+    }
+
+    TubeState state (order_, *converter_, formatScratch_, baseScratch_);
     RoutingChannelInfo routingInfo (info_.normal, info_.bass, info_);
 
-    switch (format_) {
-        case ESamples::FLOAT_32_BIG_ENDIAN:
-            return typedRoute<std::uint32_t>(in, out, samples, state, routingInfo, &convertToFloat32BE);
-        case ESamples::FLOAT_32_LITTLE_ENDIAN:
-            return typedRoute<std::uint32_t>(in, out, samples, state, routingInfo, &convertToFloat32LE);
-        case ESamples::UNSIGNED_8:
-            return typedRoute<std::uint8_t>(in, out, samples, state, routingInfo, &convertToUnsigned8);
-        case ESamples::SIGNED_32_BIG_ENDIAN:
-            return typedRoute<std::uint32_t>(in, out, samples, state, routingInfo, &convertToSigned32BE);
-        case ESamples::SIGNED_32_LITTLE_ENDIAN:
-            return typedRoute<std::uint32_t>(in, out, samples, state, routingInfo, &convertToSigned32LE);
-        case ESamples::SIGNED_16_BIG_ENDIAN:
-            return typedRoute<std::uint16_t>(in, out, samples, state, routingInfo, &convertToSigned16BE);
-        case ESamples::SIGNED_16_LITTLE_ENDIAN:
-            return typedRoute<std::uint16_t>(in, out, samples, state, routingInfo, &convertToSigned16LE);
+    switch (converter_->sampleSize()) {
+        case sizeof(std::uint8_t):
+            return typedRoute<std::uint8_t>(in, out, samples, state, routingInfo);
+        case sizeof(std::uint16_t):
+            return typedRoute<std::uint16_t>(in, out, samples, state, routingInfo);
+        case sizeof(PackedSample24):
+            return typedRoute<PackedSample24>(in, out, samples, state, routingInfo);
+        case sizeof(std::uint32_t):
+            return typedRoute<std::uint32_t>(in, out, samples, state, routingInfo);
         default:
             return absl::InvalidArgumentError("format is not supported");
     }
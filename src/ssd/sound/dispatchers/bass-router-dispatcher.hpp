@@ -2,14 +2,22 @@
 
 // abseil
 #include <absl/status/status.h>
+#include <absl/status/statusor.h>
 
 // fftw3
 #include <fftw3.h>
 
+// json
+#include <nlohmann/json_fwd.hpp>
+
 // STD
+#include <array>
+#include <string>
+#include <vector>
 #include <memory>
 #include <cstddef>
 #include <cstdint>
+#include <unordered_map>
 
 // laar
 #include <src/ssd/sound/converter.hpp>
@@ -20,7 +28,7 @@
 namespace laar {
 
     class BassRouterDispatcher
-        : IDispatcher
+        : public IDispatcher
         , std::enable_shared_from_this<TubeDispatcher> {
     private: struct Private { };
     public:
@@ -40,6 +48,23 @@ namespace laar {
             const std::size_t bass; 
         };
 
+        enum class ECrossover {
+            // transform of every period on its own, discontinuous on period boundaries
+            BLOCK,
+            // windowed overlap-add of fixed size, adds fftSize samples of latency
+            OVERLAP_ADD,
+            // 4th order IIR split at higher bound of bass range, no latency
+            LINKWITZ_RILEY
+        };
+
+        struct Settings {
+            ECrossover crossover = ECrossover::OVERLAP_ADD;
+            // overlap-add frame, power of two, hop is half of it
+            std::size_t fftSize = 1024;
+        };
+
+        static absl::StatusOr<Settings> parseSettings(const nlohmann::json& config);
+
         static std::shared_ptr<BassRouterDispatcher> create(
             const ESamplesOrder& order, 
             const ESampleType& format,
@@ -60,17 +85,62 @@ namespace laar {
         // IDispatcher implementation
         absl::Status dispatch(void* in, void* out, std::size_t samples) override;
 
+        // drops stream state, must not run concurrently with dispatch
+        absl::Status configure(Settings settings);
+        // plans transforms for block size ahead of time, so dispatch does not stall on it
+        absl::Status prepare(std::size_t samples);
+
+        // added latency in samples, depends on crossover
+        std::size_t latency() const noexcept;
+        const Settings& settings() const noexcept;
+
+        // planner wisdom, shared by all dispatchers in process
+        static absl::Status importWisdom(const std::string& path);
+        static absl::Status exportWisdom(const std::string& path);
+
     private:
 
-        struct Frequencies {
-            fftw_complex* bass;
-            fftw_complex* normal;
+        // persistent real transforms and aligned work buffers for one block size
+        struct BlockPlan {
+            explicit BlockPlan(std::size_t samples);
+            ~BlockPlan();
+
+            BlockPlan(const BlockPlan&) = delete;
+            BlockPlan& operator=(const BlockPlan&) = delete;
+
+            const std::size_t samples;
+            double* signal;
+            fftw_complex* spectrum;
+            fftw_complex* bassSpectrum;
+            double* normal;
+            double* bass;
+
+            fftw_plan forward;
+            fftw_plan backward;
+        };
+
+        // direct form II transposed section
+        struct Biquad {
+            double process(double sample) noexcept;
+
+            double b0 = 1, b1 = 0, b2 = 0;
+            double a1 = 0, a2 = 0;
+            double z1 = 0, z2 = 0;
         };
 
-        Frequencies splitWindow(std::int32_t* in, std::size_t sampleRate, std::size_t samples);
+        absl::StatusOr<BlockPlan*> acquirePlan(std::size_t samples);
+        // splits spectrum of plan.signal into normalized plan.bass and plan.normal
+        void splitSpectrum(BlockPlan& plan);
+
+        absl::Status splitBlock(const std::int32_t* in, std::size_t samples);
+        absl::Status splitOverlapAdd(const std::int32_t* in, std::size_t samples);
+        void splitLinkwitzRiley(const std::int32_t* in, std::size_t samples) noexcept;
+
+        void reserveStream(std::size_t samples);
+        void resetStream();
 
-        absl::Status routeBass(void* in, void* out, std::size_t samples);
-        absl::Status routeNormal(void* in, void* out, std::size_t samples);
+        absl::Status routeBass(const double* in, void* out, std::size_t samples);
+        absl::Status routeNormal(const double* in, void* out, std::size_t samples);
 
     private:
         const ESamplesOrder order_; 
@@ -78,6 +148,30 @@ namespace laar {
         const std::size_t sampleRate_;
         const BassRange range_;
         const ChannelInfo info_;
+        const absl::StatusOr<SampleConverter> converter_;
+
+        // conversion buffers, reused between calls
+        std::vector<std::uint32_t> formatScratch_;
+        std::vector<std::int32_t> baseScratch_;
+
+        std::unordered_map<std::size_t, std::unique_ptr<BlockPlan>> plans_;
+        Settings settings_;
+
+        // split bands of current call, in base samples
+        std::vector<double> bass_;
+        std::vector<double> normal_;
+
+        // overlap-add state: analysis history, partial sums and finished output
+        std::vector<double> window_;
+        std::vector<double> history_;
+        std::vector<double> overlapBass_;
+        std::vector<double> overlapNormal_;
+        std::size_t pending_;
+        std::size_t ready_;
+
+        // linkwitz-riley state: two butterworth sections per band
+        std::array<Biquad, 2> lowpass_;
+        std::array<Biquad, 2> highpass_;
 
     };
 
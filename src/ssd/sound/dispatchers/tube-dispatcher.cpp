@@ -5,7 +5,9 @@
 #include <protos/client/stream.pb.h>
 
 // STD
+#include <vector>
 #include <cstdint>
+#include <algorithm>
 
 // Local
 #include <src/ssd/sound/converter.hpp>
@@ -19,71 +21,81 @@ using ESamples = NSound::NCommon::TStreamConfiguration::TSampleSpecification;
 namespace {
 
     struct TubeState {
-        TubeState(const ESamplesOrder& order, const std::size_t& channels)
+        TubeState(
+            const ESamplesOrder& order, 
+            const std::size_t& channels, 
+            const SampleConverter& converter,
+            std::vector<std::uint32_t>& formatScratch, 
+            std::vector<std::int32_t>& baseScratch
+        )
             : order_(order)
             , channels_(channels)
+            , converter_(converter)
+            , formatScratch_(formatScratch)
+            , baseScratch_(baseScratch)
         {}
 
         const ESamplesOrder order_;
         const std::size_t channels_;
+        const SampleConverter& converter_;
+
+        // storage wide enough for any supported sample type
+        std::vector<std::uint32_t>& formatScratch_;
+        std::vector<std::int32_t>& baseScratch_;
     };
 
-    template<typename ResultingSampleType, typename FunctorType>
-    absl::Status typedDispatchOneToMany(void* in, void* out, std::size_t samples, TubeState state, FunctorType process) {
-        std::int32_t* original = static_cast<std::int32_t*>(in);
-        StreamWrapper<std::int32_t> inWrappedStream(
-            samples, 1, state.order_, original 
-        );
+    template<typename ResultingSampleType>
+    absl::Status typedDispatchOneToMany(void* in, void* out, std::size_t samples, TubeState state) {
+        // convert whole stream once, then copy it to every channel
+        state.formatScratch_.resize(samples);
+        ResultingSampleType* converted = reinterpret_cast<ResultingSampleType*>(state.formatScratch_.data());
+        state.converter_.toFormat(static_cast<const std::int32_t*>(in), converted, samples);
 
         ResultingSampleType* resulting = static_cast<ResultingSampleType*>(out);
-        StreamWrapper<ResultingSampleType> outWrappedStream(
-            samples, state.channels_, state.order_, resulting 
-        );
+        visitSamplesOrder(state.order_, [&](auto order) {
+            StreamWrapper<ResultingSampleType, decltype(order)::value> outWrappedStream(
+                samples, state.channels_, resulting 
+            );
 
-        std::vector<ChannelIterator<ResultingSampleType>> channelIters;
-        for (std::size_t channel = 0; channel < state.channels_; ++channel) {
-            channelIters.push_back(outWrappedStream.begin(channel));
-        }
-
-        for (auto inCurrent = inWrappedStream.begin(); inCurrent != inWrappedStream.end(); ++inCurrent) {
-            for (auto& outCurrent : channelIters) {
-                *outCurrent = process(*inCurrent);
-                ++outCurrent;
+            for (std::size_t channel = 0; channel < state.channels_; ++channel) {
+                std::copy_n(converted, samples, outWrappedStream.begin(channel));
             }
-        }
+        });
 
         return absl::OkStatus();
     }
 
-    template<typename IncomingSampleType, typename FunctorType>
-    absl::Status typedDispatchManyToOne(void* in, void* out, std::size_t samples, TubeState state, FunctorType process) {
+    template<typename IncomingSampleType>
+    absl::Status typedDispatchManyToOne(void* in, void* out, std::size_t samples, TubeState state) {
         std::int32_t* resulting = static_cast<std::int32_t*>(out);
-        StreamWrapper<std::int32_t> outWrappedStream(
-            samples, 1, state.order_, resulting 
-        );
 
         IncomingSampleType* incoming = static_cast<IncomingSampleType*>(in);
-        StreamWrapper<IncomingSampleType> inWrappedStream(
-            samples, state.channels_, state.order_, incoming 
+        StreamWrapper<IncomingSampleType, ESamplesOrder::INTERLEAVED> inWrappedStream(
+            samples, state.channels_, incoming 
         );
 
-        std::vector<ChannelIterator<IncomingSampleType>> channelIters;
+        state.formatScratch_.resize(samples);
+        state.baseScratch_.resize(samples);
+        IncomingSampleType* gathered = reinterpret_cast<IncomingSampleType*>(state.formatScratch_.data());
+
         for (std::size_t channel = 0; channel < state.channels_; ++channel) {
-            channelIters.push_back(inWrappedStream.begin(channel));
-        }
+            // channel is contiguous already unless samples are interleaved
+            const IncomingSampleType* channelSamples = incoming + channel * samples;
+            if (state.order_ == ESamplesOrder::INTERLEAVED && state.channels_ > 1) {
+                std::copy_n(inWrappedStream.begin(channel), samples, gathered);
+                channelSamples = gathered;
+            }
+
+            if (channel == 0) {
+                state.converter_.fromFormat(channelSamples, resulting, samples);
+                continue;
+            }
 
-        for (auto outCurrent = outWrappedStream.begin(); outCurrent != outWrappedStream.end(); ++outCurrent) {
-            bool isFirst = true;
-            for (auto& inCurrent : channelIters) {
-                if (isFirst) {
-                    *outCurrent = process(*inCurrent);
-                    isFirst = false;
-                } else {
-                    std::int32_t processed = process(*inCurrent);
-                    *outCurrent = 2 * ((std::int64_t) *outCurrent + processed) 
-                        - (long double) *outCurrent / (INT32_MAX / 2) * processed - INT32_MAX;
-                }
-                ++inCurrent;
+            state.converter_.fromFormat(channelSamples, state.baseScratch_.data(), samples);
+            for (std::size_t sample = 0; sample < samples; ++sample) {
+                std::int32_t processed = state.baseScratch_[sample];
+                resulting[sample] = 2 * ((std::int64_t) resulting[sample] + processed) 
+                    - (long double) resulting[sample] / (INT32_MAX / 2) * processed - INT32_MAX;
             }
         }
 
@@ -105,46 +117,43 @@ absl::Status TubeDispatcher::dispatch(void* in, void* out, std::size_t samples)
 }
 
 absl::Status TubeDispatcher::dispatchOneToMany(void* in, void* out, std::size_t samples) noexcept {
-    TubeState state (order_, channels_);
-
-    switch (format_) {
-        case ESamples::FLOAT_32_BIG_ENDIAN:
-            return typedDispatchOneToMany<std::uint32_t>(in, out, samples, state, &convertToFloat32BE);
-        case ESamples::FLOAT_32_LITTLE_ENDIAN:
-            return typedDispatchOneToMany<std::uint32_t>(in, out, samples, state, &convertToFloat32LE);
-        case ESamples::UNSIGNED_8:
-            return typedDispatchOneToMany<std::uint8_t>(in, out, samples, state, &convertToUnsigned8);
-        case ESamples::SIGNED_32_BIG_ENDIAN:
-            return typedDispatchOneToMany<std::uint32_t>(in, out, samples, state, &convertToSigned32BE);
-        case ESamples::SIGNED_32_LITTLE_ENDIAN:
-            return typedDispatchOneToMany<std::uint32_t>(in, out, samples, state, &convertToSigned32LE);
-        case ESamples::SIGNED_16_BIG_ENDIAN:
-            return typedDispatchOneToMany<std::uint16_t>(in, out, samples, state, &convertToSigned16BE);
-        case ESamples::SIGNED_16_LITTLE_ENDIAN:
-            return typedDispatchOneToMany<std::uint16_t>(in, out, samples, state, &convertToSigned16LE);
+    if (!converter_.ok()) {
+        return converter_.status();
+    }
+
+    TubeState state (order_, channels_, *converter_, formatScratch_, baseScratch_);
+
+    // conversion is done by converter, only storage width matters here
+    switch (converter_->sampleSize()) {
+        case sizeof(std::uint8_t):
+            return typedDispatchOneToMany<std::uint8_t>(in, out, samples, state);
+        case sizeof(std::uint16_t):
+            return typedDispatchOneToMany<std::uint16_t>(in, out, samples, state);
+        case sizeof(PackedSample24):
+            return typedDispatchOneToMany<PackedSample24>(in, out, samples, state);
+        case sizeof(std::uint32_t):
+            return typedDispatchOneToMany<std::uint32_t>(in, out, samples, state);
         default:
             return absl::InvalidArgumentError("format is not supported");
     }
 }
 
 absl::Status TubeDispatcher::dispatchManyToOne(void* in, void* out, std::size_t samples) noexcept {
-    TubeState state (order_, channels_);
-
-    switch (format_) {
-        case ESamples::FLOAT_32_BIG_ENDIAN:
-            return typedDispatchManyToOne<std::uint32_t>(in, out, samples, state, &convertFromFloat32BE);
-        case ESamples::FLOAT_32_LITTLE_ENDIAN:
-            return typedDispatchManyToOne<std::uint32_t>(in, out, samples, state, &convertFromFloat32LE);
-        case ESamples::UNSIGNED_8:
-            return typedDispatchManyToOne<std::uint8_t>(in, out, samples, state, &convertFromUnsigned8);
-        case ESamples::SIGNED_32_BIG_ENDIAN:
-            return typedDispatchManyToOne<std::uint32_t>(in, out, samples, state, &convertFromSigned32BE);
-        case ESamples::SIGNED_32_LITTLE_ENDIAN:
-            return typedDispatchManyToOne<std::uint32_t>(in, out, samples, state, &convertFromSigned32LE);
-        case ESamples::SIGNED_16_BIG_ENDIAN:
-            return typedDispatchManyToOne<std::uint16_t>(in, out, samples, state, &convertFromSigned16BE);
-        case ESamples::SIGNED_16_LITTLE_ENDIAN:
-            return typedDispatchManyToOne<std::uint16_t>(in, out, samples, state, &convertFromSigned16LE);
+    if (!converter_.ok()) {
+        return converter_.status();
+    }
+
+    TubeState state (order_, channels_, *converter_, formatScratch_, baseScratch_);
+
+    switch (converter_->sampleSize()) {
+        case sizeof(std::uint8_t):
+            return typedDispatchManyToOne<std::uint8_t>(in, out, samples, state);
+        case sizeof(std::uint16_t):
+            return typedDispatchManyToOne<std::uint16_t>(in, out, samples, state);
+        case sizeof(PackedSample24):
+            return typedDispatchManyToOne<PackedSample24>(in, out, samples, state);
+        case sizeof(std::uint32_t):
+            return typedDispatchManyToOne<std::uint32_t>(in, out, samples, state);
         default:
             return absl::InvalidArgumentError("format is not supported");
     }
@@ -161,6 +170,7 @@ TubeDispatcher::TubeDispatcher(
     , order_(order)
     , format_(format)
     , channels_(channels)
+    , converter_(SampleConverter::create(format))
 {}
 
 std::shared_ptr<TubeDispatcher> TubeDispatcher::create(
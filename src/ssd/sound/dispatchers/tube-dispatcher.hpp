@@ -2,12 +2,17 @@
 
 // abseil
 #include <absl/status/status.h>
+#include <absl/status/statusor.h>
 
 // STD
+#include <compare>
+#include <cassert>
+#include <vector>
 #include <memory>
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <type_traits>
 
 // Local
 #include <src/ssd/sound/converter.hpp>
@@ -20,78 +25,106 @@ namespace laar {
         INTERLEAVED, NONINTERLEAVED
     };
 
-    template<typename SampleType>
+    // Walks samples of one channel with constant stride. Layout is fixed at
+    // compile time, so loops over it reduce to plain (strided) pointer arithmetic.
+    // Bounds are only checked in debug builds.
+    template<typename SampleType, ESamplesOrder Order>
     class ChannelIterator {
     public:
 
         using difference_type = std::ptrdiff_t;
-        using value_type = SampleType;
+        using value_type = std::remove_cv_t<SampleType>;
         using pointer = SampleType*;
         using reference = SampleType&;
-        using iterator_category = std::bidirectional_iterator_tag;
+        using iterator_category = std::random_access_iterator_tag;
+        using iterator_concept = std::random_access_iterator_tag;
 
+        ChannelIterator() noexcept = default;
         ChannelIterator(
             std::uint32_t samples,
             std::uint32_t channels,
             std::uint32_t channel,
-            ESamplesOrder order,
             pointer buffer,
             std::uint32_t position
-        );
+        ) noexcept;
 
-        ChannelIterator& operator++();
-        ChannelIterator& operator--();
+        ChannelIterator& operator++() noexcept;
+        ChannelIterator& operator--() noexcept;
 
-        ChannelIterator& operator++(int);
-        ChannelIterator& operator--(int);
+        ChannelIterator operator++(int) noexcept;
+        ChannelIterator operator--(int) noexcept;
 
-        bool operator==(const ChannelIterator& other) noexcept;
-        bool operator!=(const ChannelIterator& other) noexcept;
+        ChannelIterator& operator+=(difference_type distance) noexcept;
+        ChannelIterator& operator-=(difference_type distance) noexcept;
 
-        reference operator*();
+        ChannelIterator operator+(difference_type distance) const noexcept;
+        ChannelIterator operator-(difference_type distance) const noexcept;
+        difference_type operator-(const ChannelIterator& other) const noexcept;
 
-    private:
-        pointer advance(std::int32_t distance);
-        difference_type shift();
+        friend ChannelIterator operator+(difference_type distance, const ChannelIterator& iter) noexcept {
+            return iter + distance;
+        }
+
+        bool operator==(const ChannelIterator& other) const noexcept;
+        std::strong_ordering operator<=>(const ChannelIterator& other) const noexcept;
+
+        reference operator*() const noexcept;
+        reference operator[](difference_type distance) const noexcept;
 
     private:
-        const std::uint32_t samples_;
-        const std::uint32_t channels_;
-        const std::uint32_t channel_;
-        const ESamplesOrder order_;
+        difference_type stride() const noexcept;
 
-        pointer buffer_;
-        pointer position_;
+    private:
+        pointer position_ = nullptr;
+        // samples are adjacent when noninterleaved, stride is used otherwise
+        difference_type stride_ = 1;
+
+    #ifndef NDEBUG
+        pointer first_ = nullptr;
+        pointer last_ = nullptr;
+    #endif
     
     };
 
-    template<typename SampleType>
+    template<typename SampleType, ESamplesOrder Order>
     class StreamWrapper {
     public:
 
+        using iterator = ChannelIterator<SampleType, Order>;
+
         StreamWrapper(
             std::uint32_t samples,
             std::uint32_t channels,
-            ESamplesOrder order,
             SampleType* buffer
-        );
+        ) noexcept;
 
-        ChannelIterator<SampleType> begin(std::uint32_t channel = 0) noexcept;
-        ChannelIterator<SampleType> end(std::uint32_t channel = 0) noexcept;
+        iterator begin(std::uint32_t channel = 0) const noexcept;
+        iterator end(std::uint32_t channel = 0) const noexcept;
 
-        ChannelIterator<SampleType> at(std::uint32_t sample, std::uint32_t channel = 0) noexcept;
+        iterator at(std::uint32_t sample, std::uint32_t channel = 0) const noexcept;
 
     private:
         const std::uint32_t samples_;
         const std::uint32_t channels_;
-        const ESamplesOrder order_;
         SampleType* buffer_;
 
     };
 
     // const iterator variation
-    template<typename SampleType>
-    using ConstChannelIterator = ChannelIterator<const SampleType>;
+    template<typename SampleType, ESamplesOrder Order>
+    using ConstChannelIterator = ChannelIterator<const SampleType, Order>;
+
+    // resolves runtime order once, visitor gets it as std::integral_constant
+    template<typename Visitor>
+    decltype(auto) visitSamplesOrder(ESamplesOrder order, Visitor&& visitor) {
+        switch (order) {
+            case ESamplesOrder::INTERLEAVED:
+                return visitor(std::integral_constant<ESamplesOrder, ESamplesOrder::INTERLEAVED>());
+            case ESamplesOrder::NONINTERLEAVED:
+            default:
+                return visitor(std::integral_constant<ESamplesOrder, ESamplesOrder::NONINTERLEAVED>());
+        }
+    }
 
     // Dispatches incoming channels into one, or one-to-many
     class TubeDispatcher 
@@ -131,150 +164,152 @@ namespace laar {
         const ESamplesOrder order_;
         const ESampleType format_;
         const std::size_t channels_;
+        const absl::StatusOr<SampleConverter> converter_;
+
+        // conversion buffers, reused between calls
+        std::vector<std::uint32_t> formatScratch_;
+        std::vector<std::int32_t> baseScratch_;
 
     };
 
 }
 
 
-template<typename SampleType>
-laar::ChannelIterator<SampleType>::ChannelIterator(
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order>::ChannelIterator(
     std::uint32_t samples,
     std::uint32_t channels,
     std::uint32_t channel,
-    ESamplesOrder order,
     pointer buffer,
     std::uint32_t position
-)
-    : samples_(samples)
-    , channels_(channels)
-    , channel_(channel)
-    , order_(order)
-    , buffer_(buffer)
-    , position_(buffer)
+) noexcept
+    : stride_((Order == ESamplesOrder::INTERLEAVED) ? channels : 1)
 {
-    advance(position);
+    pointer first = (Order == ESamplesOrder::INTERLEAVED) 
+        ? buffer + channel
+        : buffer + static_cast<std::size_t>(samples) * channel;
+    position_ = first + static_cast<difference_type>(position) * stride();
+
+#ifndef NDEBUG
+    first_ = first;
+    last_ = first + static_cast<difference_type>(samples) * stride();
+#endif
 }
 
-template<typename SampleType>
-laar::ChannelIterator<SampleType>& laar::ChannelIterator<SampleType>::operator++() {
-    position_ = advance(1);
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order>& laar::ChannelIterator<SampleType, Order>::operator++() noexcept {
+    position_ += stride();
     return *this;
 }
 
-template<typename SampleType>
-laar::ChannelIterator<SampleType>& laar::ChannelIterator<SampleType>::operator++(int) {
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order> laar::ChannelIterator<SampleType, Order>::operator++(int) noexcept {
     auto frozen = *this;
-    position_ = advance(1);
+    position_ += stride();
     return frozen;
 }
 
-template<typename SampleType>
-laar::ChannelIterator<SampleType>& laar::ChannelIterator<SampleType>::operator--() {
-    position_ = advance(-1);
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order>& laar::ChannelIterator<SampleType, Order>::operator--() noexcept {
+    position_ -= stride();
     return *this;
 }
 
-template<typename SampleType>
-laar::ChannelIterator<SampleType>& laar::ChannelIterator<SampleType>::operator--(int) {
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order> laar::ChannelIterator<SampleType, Order>::operator--(int) noexcept {
     auto frozen = *this;
-    position_ = advance(-1);
+    position_ -= stride();
     return frozen;
 }
 
-template<typename SampleType>
-bool laar::ChannelIterator<SampleType>::operator==(const ChannelIterator& other) noexcept {
-    return (
-        samples_ == other.samples_ &&
-        channels_ == other.channels_ &&
-        channel_ == other.channel_ &&
-        order_ == other.order_
-    ) && (
-        buffer_ == other.buffer_ &&
-        position_ == other.position_
-    );
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order>& laar::ChannelIterator<SampleType, Order>::operator+=(difference_type distance) noexcept {
+    position_ += distance * stride();
+    return *this;
 }
 
-template<typename SampleType>
-bool laar::ChannelIterator<SampleType>::operator!=(const ChannelIterator& other) noexcept {
-    return !operator==(other);
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order>& laar::ChannelIterator<SampleType, Order>::operator-=(difference_type distance) noexcept {
+    position_ -= distance * stride();
+    return *this;
 }
 
-template<typename SampleType>
-laar::ChannelIterator<SampleType>::reference laar::ChannelIterator<SampleType>::operator*() {
-    return *position_;
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order> laar::ChannelIterator<SampleType, Order>::operator+(difference_type distance) const noexcept {
+    auto moved = *this;
+    return moved += distance;
 }
 
-template<typename SampleType>
-SampleType* laar::ChannelIterator<SampleType>::advance(std::int32_t distance) {
-    if ((distance + shift() > samples_ && distance > 0) || (shift() + distance < 0 && distance < 0)) {
-        throw std::runtime_error("channel read out of bounds");
-    }
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order> laar::ChannelIterator<SampleType, Order>::operator-(difference_type distance) const noexcept {
+    auto moved = *this;
+    return moved -= distance;
+}
 
-    switch (order_) {
-        case laar::ESamplesOrder::INTERLEAVED:
-            if (buffer_ == position_) {
-                position_ += channel_;
-            } 
-            position_ += channels_ * distance;
-            break;
-        case laar::ESamplesOrder::NONINTERLEAVED:
-            if (buffer_ == position_) {
-                position_ += samples_ * channel_;
-            }
-            position_ += distance;
-            break;
-    }
+template<typename SampleType, laar::ESamplesOrder Order>
+std::ptrdiff_t laar::ChannelIterator<SampleType, Order>::operator-(const ChannelIterator& other) const noexcept {
+    return (position_ - other.position_) / stride();
+}
+
+template<typename SampleType, laar::ESamplesOrder Order>
+bool laar::ChannelIterator<SampleType, Order>::operator==(const ChannelIterator& other) const noexcept {
+    return position_ == other.position_;
+}
+
+template<typename SampleType, laar::ESamplesOrder Order>
+std::strong_ordering laar::ChannelIterator<SampleType, Order>::operator<=>(const ChannelIterator& other) const noexcept {
+    return position_ <=> other.position_;
+}
+
+template<typename SampleType, laar::ESamplesOrder Order>
+SampleType& laar::ChannelIterator<SampleType, Order>::operator*() const noexcept {
+    assert(position_ >= first_ && position_ < last_ && "channel access out of bounds");
+    return *position_;
+}
 
-    return &operator*();
+template<typename SampleType, laar::ESamplesOrder Order>
+SampleType& laar::ChannelIterator<SampleType, Order>::operator[](difference_type distance) const noexcept {
+    return *(*this + distance);
 }
 
-template<typename SampleType>
-ptrdiff_t laar::ChannelIterator<SampleType>::shift() {
-    switch (order_) {
-        case laar::ESamplesOrder::INTERLEAVED:
-            return static_cast<ptrdiff_t>(position_ - channel_ - buffer_) / channels_;
-        case laar::ESamplesOrder::NONINTERLEAVED:
-            return static_cast<ptrdiff_t>(position_ - buffer_ - channel_ * samples_);
-        default:
-            return 0;
+template<typename SampleType, laar::ESamplesOrder Order>
+std::ptrdiff_t laar::ChannelIterator<SampleType, Order>::stride() const noexcept {
+    if constexpr (Order == ESamplesOrder::NONINTERLEAVED) {
+        return 1;
+    } else {
+        return stride_;
     }
 }
 
 
-template<typename SampleType>
-laar::StreamWrapper<SampleType>::StreamWrapper(
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::StreamWrapper<SampleType, Order>::StreamWrapper(
     std::uint32_t samples,
     std::uint32_t channels,
-    ESamplesOrder order,
     SampleType* buffer
-)
+) noexcept
     : samples_(samples)
     , channels_(channels)
-    , order_(order)
     , buffer_(buffer)
 {}
 
 
-template<typename SampleType>
-laar::ChannelIterator<SampleType> laar::StreamWrapper<SampleType>::begin(std::uint32_t channel) noexcept {
-    return ChannelIterator<SampleType>(
-        samples_, channels_, channel, order_, buffer_, 0
-    );
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order> laar::StreamWrapper<SampleType, Order>::begin(std::uint32_t channel) const noexcept {
+    return iterator(samples_, channels_, channel, buffer_, 0);
 }
 
 
-template<typename SampleType>
-laar::ChannelIterator<SampleType> laar::StreamWrapper<SampleType>::end(std::uint32_t channel) noexcept {
-    return ChannelIterator<SampleType>(
-        samples_, channels_, channel, order_, buffer_, samples_
-    );
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order> laar::StreamWrapper<SampleType, Order>::end(std::uint32_t channel) const noexcept {
+    return iterator(samples_, channels_, channel, buffer_, samples_);
 }
 
 
-template<typename SampleType>
-laar::ChannelIterator<SampleType> laar::StreamWrapper<SampleType>::at(std::uint32_t sample, std::uint32_t channel) noexcept {
-    return ChannelIterator<SampleType>(
-        samples_, channels_, channel, order_, buffer_, sample
-    );
-}
\ No newline at end of file
+template<typename SampleType, laar::ESamplesOrder Order>
+laar::ChannelIterator<SampleType, Order> laar::StreamWrapper<SampleType, Order>::at(std::uint32_t sample, std::uint32_t channel) const noexcept {
+    return iterator(samples_, channels_, channel, buffer_, sample);
+}
+
+static_assert(std::random_access_iterator<laar::ChannelIterator<std::int32_t, laar::ESamplesOrder::INTERLEAVED>>);
+static_assert(std::random_access_iterator<laar::ChannelIterator<const std::int32_t, laar::ESamplesOrder::NONINTERLEAVED>>);
\ No newline at end of file
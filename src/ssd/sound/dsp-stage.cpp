@@ -0,0 +1,155 @@
+// laar
+#include <src/ssd/macros.hpp>
+#include <src/ssd/sound/dsp-stage.hpp>
+#include <src/ssd/util/thread-tuning.hpp>
+#include <src/ssd/sound/interfaces/i-dispatcher.hpp>
+
+// abseil
+#include <absl/status/status.h>
+
+// std
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using namespace laar;
+
+std::unique_ptr<DspStage> DspStage::create(
+    std::shared_ptr<IDispatcher> dispatcher,
+    std::size_t frames,
+    std::size_t channels
+) {
+    return std::make_unique<DspStage>(std::move(dispatcher), frames, channels, Private());
+}
+
+DspStage::DspStage(
+    std::shared_ptr<IDispatcher> dispatcher,
+    std::size_t frames,
+    std::size_t channels,
+    Private /* access */
+)
+    : dispatcher_(std::move(dispatcher))
+    , frames_(frames)
+    , channels_(channels)
+    , previousDry_(frames, Silence)
+    , next_(0)
+    , hasPrevious_(false)
+    , stop_(false)
+    , requests_(0)
+    , processed_(0)
+    , missed_(0)
+    , failed_(0)
+{
+    for (auto& slot : slots_) {
+        slot.state.store(ESlotState::FREE, std::memory_order_relaxed);
+        slot.dry.resize(frames_);
+        slot.wet.resize(frames_ * channels_);
+    }
+
+    worker_ = std::thread(&DspStage::run, this);
+}
+
+DspStage::~DspStage() {
+    stop_.store(true, std::memory_order_release);
+    requests_.fetch_add(1, std::memory_order_release);
+    requests_.notify_one();
+    worker_.join();
+}
+
+void DspStage::process(const std::int32_t* dry, std::int32_t* out, std::size_t frames) noexcept {
+    if (frames != frames_) {
+        // period does not fit slots, pipeline restarts on the next call
+        missed_.fetch_add(1, std::memory_order_relaxed);
+        hasPrevious_ = false;
+        playDry(dry, out, frames);
+        return;
+    }
+
+    // play period handed over on previous call
+    bool played = false;
+    if (hasPrevious_) {
+        Slot& slot = slots_[next_ ^ 1];
+        ESlotState state = slot.state.load(std::memory_order_acquire);
+        if (state == ESlotState::DONE) {
+            std::memcpy(out, slot.wet.data(), slot.wet.size() * sizeof(std::int32_t));
+            slot.state.store(ESlotState::FREE, std::memory_order_relaxed);
+            processed_.fetch_add(1, std::memory_order_relaxed);
+            played = true;
+        } else if (state == ESlotState::READY) {
+            // worker has not even started, no need to process it anymore
+            slot.state.compare_exchange_strong(state, ESlotState::FREE, std::memory_order_relaxed);
+        }
+    }
+
+    if (!played) {
+        if (hasPrevious_) {
+            missed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        playDry(previousDry_.data(), out, frames);
+    }
+
+    // hand current period over, unless worker is still busy with this slot
+    Slot& slot = slots_[next_];
+    ESlotState state = slot.state.load(std::memory_order_acquire);
+    hasPrevious_ = state != ESlotState::READY && state != ESlotState::PROCESSING;
+    if (hasPrevious_) {
+        std::memcpy(slot.dry.data(), dry, frames * sizeof(std::int32_t));
+        slot.state.store(ESlotState::READY, std::memory_order_release);
+        requests_.fetch_add(1, std::memory_order_release);
+        requests_.notify_one();
+        next_ ^= 1;
+    }
+
+    std::memcpy(previousDry_.data(), dry, frames * sizeof(std::int32_t));
+}
+
+absl::Status DspStage::tune(const ThreadSettings& settings) {
+    return tuneThread(worker_.native_handle(), settings);
+}
+
+std::size_t DspStage::latency() const noexcept {
+    return frames_;
+}
+
+DspStage::Stats DspStage::collectStats() noexcept {
+    return Stats {
+        .processed = processed_.exchange(0, std::memory_order_relaxed),
+        .missed = missed_.exchange(0, std::memory_order_relaxed),
+        .failed = failed_.exchange(0, std::memory_order_relaxed)
+    };
+}
+
+void DspStage::run() {
+    std::uint32_t seen = 0;
+    while (true) {
+        requests_.wait(seen, std::memory_order_acquire);
+        seen = requests_.load(std::memory_order_acquire);
+
+        if (stop_.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        for (auto& slot : slots_) {
+            ESlotState expected = ESlotState::READY;
+            if (!slot.state.compare_exchange_strong(expected, ESlotState::PROCESSING, std::memory_order_acq_rel)) {
+                continue;
+            }
+
+            absl::Status status = dispatcher_->dispatch(slot.dry.data(), slot.wet.data(), frames_);
+            if (!status.ok()) {
+                failed_.fetch_add(1, std::memory_order_relaxed);
+            }
+            slot.state.store(status.ok() ? ESlotState::DONE : ESlotState::FAILED, std::memory_order_release);
+        }
+    }
+}
+
+void DspStage::playDry(const std::int32_t* dry, std::int32_t* out, std::size_t frames) noexcept {
+    for (std::size_t channel = 0; channel < channels_; ++channel) {
+        std::memcpy(out + channel * frames, dry, frames * sizeof(std::int32_t));
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+// abseil
+#include <absl/status/status.h>
+
+// laar
+#include <src/ssd/util/thread-tuning.hpp>
+#include <src/ssd/sound/ring-buffer.hpp>
+#include <src/ssd/sound/interfaces/i-dispatcher.hpp>
+
+// std
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace laar {
+
+    // Runs dispatcher on its own thread, one period behind the audio thread.
+    // Each period the audio thread hands dry mono mix over and gets back the
+    // period handed over one call earlier, so latency is exactly one period.
+    // If worker has not finished in time, that period is played dry instead.
+    class DspStage {
+    private: struct Private { };
+    public:
+
+        struct Stats {
+            std::uint64_t processed;
+            std::uint64_t missed;
+            std::uint64_t failed;
+        };
+
+        // dispatcher maps mono period of frames to channels noninterleaved ones
+        static std::unique_ptr<DspStage> create(
+            std::shared_ptr<IDispatcher> dispatcher,
+            std::size_t frames,
+            std::size_t channels
+        );
+
+        DspStage(
+            std::shared_ptr<IDispatcher> dispatcher,
+            std::size_t frames,
+            std::size_t channels,
+            Private access
+        );
+
+        ~DspStage();
+
+        // audio thread: dry holds frames mono samples, out receives frames * channels
+        void process(const std::int32_t* dry, std::int32_t* out, std::size_t frames) noexcept;
+
+        // scheduling and placement of worker thread
+        absl::Status tune(const ThreadSettings& settings);
+
+        // added latency in frames
+        std::size_t latency() const noexcept;
+        // counters since previous call
+        Stats collectStats() noexcept;
+
+    private:
+        enum class ESlotState : std::uint8_t {
+            FREE, READY, PROCESSING, DONE, FAILED
+        };
+
+        struct Slot {
+            alignas(CacheLineSize) std::atomic<ESlotState> state;
+            std::vector<std::int32_t> dry;
+            std::vector<std::int32_t> wet;
+        };
+
+        void run();
+        void playDry(const std::int32_t* dry, std::int32_t* out, std::size_t frames) noexcept;
+
+    private:
+        const std::shared_ptr<IDispatcher> dispatcher_;
+        const std::size_t frames_;
+        const std::size_t channels_;
+
+        std::array<Slot, 2> slots_;
+        // owned by audio thread
+        std::vector<std::int32_t> previousDry_;
+        std::size_t next_;
+        bool hasPrevious_;
+
+        std::atomic<bool> stop_;
+        std::atomic<std::uint32_t> requests_;
+
+        std::atomic<std::uint64_t> processed_;
+        std::atomic<std::uint64_t> missed_;
+        std::atomic<std::uint64_t> failed_;
+
+        std::thread worker_;
+    };
+
+}
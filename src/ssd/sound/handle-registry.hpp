@@ -0,0 +1,76 @@
+#pragma once
+
+// laar
+#include <src/ssd/sound/rcu-snapshot.hpp>
+
+// std
+#include <span>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+
+namespace laar {
+
+    // Handles shared between session threads and the audio thread.
+    // Every change publishes a fresh copy of the list, the audio thread
+    // only reads the latest copy and never waits for writers. Handles and
+    // stale copies are released by sweep(), which must run off the audio thread.
+    template<typename HandleType>
+    class HandleRegistry {
+    public:
+
+        using HandlePtr = std::shared_ptr<HandleType>;
+
+        void add(HandlePtr handle) {
+            std::unique_lock<std::mutex> locked(lock_);
+            handles_.push_back(std::move(handle));
+            publish();
+        }
+
+        // drops handles that are not alive anymore, returns how many were dropped
+        std::size_t sweep() {
+            std::unique_lock<std::mutex> locked(lock_);
+            auto dead = std::remove_if(handles_.begin(), handles_.end(), [](const HandlePtr& handle) {
+                return !handle->isAlive();
+            });
+
+            std::size_t dropped = std::distance(dead, handles_.end());
+            if (dropped) {
+                handles_.erase(dead, handles_.end());
+                publish();
+            } else {
+                snapshot_.reclaim();
+            }
+
+            return dropped;
+        }
+
+        std::size_t size() const {
+            std::unique_lock<std::mutex> locked(lock_);
+            return handles_.size();
+        }
+
+        // audio thread side: list stays valid until the next call, may hold dead handles
+        std::span<const HandlePtr> acquire() noexcept {
+            if (const auto* snapshot = snapshot_.acquire()) {
+                return *snapshot;
+            }
+            return {};
+        }
+
+    private:
+        void publish() {
+            snapshot_.publish(std::make_unique<const std::vector<HandlePtr>>(handles_));
+        }
+
+    private:
+        // serializes writers only, audio thread never takes it
+        mutable std::mutex lock_;
+        std::vector<HandlePtr> handles_;
+        RcuSnapshot<std::vector<HandlePtr>> snapshot_;
+    };
+
+}
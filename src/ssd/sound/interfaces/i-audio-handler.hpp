@@ -7,6 +7,7 @@
 // laar
 #include <src/ssd/macros.hpp>
 #include <src/ssd/sound/converter.hpp>
+#include <src/ssd/sound/channel-matrix.hpp>
 
 // std
 #include <memory>
@@ -50,6 +51,15 @@ namespace laar {
 
             // // getters
             virtual ESampleType getFormat() const = 0;
+            // stream samples that can be written right now without overrun
+            virtual std::size_t writableSize() = 0;
+            // buffer sizes server picked for stream, in stream samples
+            virtual NSound::NCommon::TStreamConfiguration::TBufferConfiguration getBufferConfig() const = 0;
+
+            // renegotiates buffer sizes, queued samples are kept
+            virtual absl::StatusOr<NSound::NCommon::TStreamConfiguration::TBufferConfiguration> resize(
+                NSound::NCommon::TStreamConfiguration::TBufferConfiguration config
+            ) = 0;
 
             // // setters
 
@@ -72,6 +82,9 @@ namespace laar {
             virtual absl::StatusOr<int> read(std::int32_t* /* dest */, std::size_t /* size */) override { 
                 return absl::InternalError("not implemented");
             }
+            virtual std::size_t writableSize() override {
+                return 0;
+            }
         };
 
         class IWriteHandle : public IHandle {
@@ -79,6 +92,10 @@ namespace laar {
             virtual ~IWriteHandle() = default;
             virtual absl::StatusOr<int> write(const char* src, std::size_t size) override = 0;
             virtual absl::StatusOr<int> read(std::int32_t* dest, std::size_t size) override = 0;
+            virtual std::size_t writableSize() override = 0;
+
+            // maps interleaved stream channels onto device ones
+            virtual const ChannelMatrix& getChannelMatrix() const noexcept = 0;
 
         private:
             virtual absl::StatusOr<int> read(char* /* src */, std::size_t /* size */) override { 
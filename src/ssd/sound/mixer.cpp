@@ -0,0 +1,154 @@
+// laar
+#include <src/ssd/sound/mixer.hpp>
+
+// abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <absl/strings/str_format.h>
+
+// json
+#include <nlohmann/json.hpp>
+
+// std
+#include <cmath>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+using namespace laar;
+
+namespace {
+
+    constexpr auto MIXER_SECTION = "mixer";
+    constexpr float fullScale = 2147483648.f;
+    // largest float below 2^31, so limited bus always fits int32
+    constexpr float outputScale = 2147483520.f;
+
+    float fromDecibels(float value) {
+        return std::pow(10.f, value / 20.f);
+    }
+
+}
+
+absl::StatusOr<Mixer::Settings> Mixer::parseSettings(const nlohmann::json& config) {
+    Settings settings;
+    if (!config.contains(MIXER_SECTION)) {
+        return settings;
+    }
+
+    const auto& mixer = config[MIXER_SECTION];
+    if (!mixer.is_object()) {
+        return absl::InvalidArgumentError("mixer section must be an object");
+    }
+
+    try {
+        settings.headroom = mixer.value<float>("headroom", settings.headroom);
+        settings.knee = mixer.value<float>("knee", settings.knee);
+    } catch (const nlohmann::json::exception& error) {
+        return absl::InvalidArgumentError(absl::StrFormat("malformed mixer settings: %s", error.what()));
+    }
+
+    return settings;
+}
+
+Mixer::Mixer() 
+    : frames_(0)
+    , channels_(1)
+{
+    // defaults are always valid
+    configure(Settings()).IgnoreError();
+}
+
+absl::Status Mixer::configure(Settings settings) {
+    if (!std::isfinite(settings.headroom) || settings.headroom < 0) {
+        return absl::InvalidArgumentError(absl::StrFormat("headroom must be non-negative, got: %f", settings.headroom));
+    }
+
+    if (!std::isfinite(settings.knee) || settings.knee <= 0) {
+        return absl::InvalidArgumentError(absl::StrFormat("knee must be positive, got: %f", settings.knee));
+    }
+
+    settings_ = settings;
+    inputScale_ = fromDecibels(-settings.headroom) / fullScale;
+    threshold_ = fromDecibels(-settings.knee);
+
+    return absl::OkStatus();
+}
+
+void Mixer::reserve(std::size_t frames, std::size_t channels) {
+    if (frames_ < frames || channels_ != channels) {
+        frames_ = std::max(frames_, frames);
+        channels_ = channels;
+        bus_.resize(frames_ * channels_);
+    }
+}
+
+std::size_t Mixer::capacity() const noexcept {
+    return frames_;
+}
+
+std::size_t Mixer::channels() const noexcept {
+    return channels_;
+}
+
+void Mixer::reset(std::size_t frames) noexcept {
+    frames = std::min(frames, frames_);
+    for (std::size_t channel = 0; channel < channels_; ++channel) {
+        std::fill_n(bus_.begin() + channel * frames_, frames, 0.f);
+    }
+}
+
+void Mixer::add(const std::int32_t* source, std::size_t frames) noexcept {
+    const float scale = inputScale_;
+
+    for (std::size_t channel = 0; channel < channels_; ++channel) {
+        float* bus = bus_.data() + channel * frames_;
+        const std::int32_t* plane = source + channel * frames;
+        for (std::size_t i = 0; i < frames; ++i) {
+            bus[i] += plane[i] * scale;
+        }
+    }
+}
+
+void Mixer::add(const std::int32_t* source, std::size_t frames, const ChannelMatrix& matrix) noexcept {
+    if (matrix.outputs() != channels_) {
+        // matrix was built for another device layout
+        return;
+    }
+
+    const std::size_t stride = matrix.inputs();
+    for (const ChannelMatrix::Entry& entry : matrix.entries()) {
+        float* bus = bus_.data() + entry.output * frames_;
+        const std::int32_t* channel = source + entry.input;
+        const float scale = inputScale_ * entry.gain;
+
+        // constant stride, one pass per matrix entry
+        for (std::size_t i = 0; i < frames; ++i) {
+            bus[i] += channel[i * stride] * scale;
+        }
+    }
+}
+
+void Mixer::mixdown(std::int32_t* dest, std::size_t frames, std::size_t stride) noexcept {
+    stride = (stride) ? stride : frames;
+    const float threshold = threshold_;
+    const float range = 1.f - threshold;
+
+    // below threshold signal is untouched, above it approaches full scale
+    // as t + r * d / (1 + d), which is smooth at the knee and never clips
+    for (std::size_t channel = 0; channel < channels_; ++channel) {
+        const float* bus = bus_.data() + channel * frames_;
+        std::int32_t* plane = dest + channel * stride;
+        for (std::size_t i = 0; i < frames; ++i) {
+            float magnitude = std::fabs(bus[i]);
+            float over = std::max(magnitude - threshold, 0.f) / range;
+            float limited = std::min(magnitude, threshold + range * over / (1.f + over));
+            plane[i] = static_cast<std::int32_t>(std::copysign(limited, bus[i]) * outputScale);
+        }
+    }
+}
+
+const Mixer::Settings& Mixer::settings() const noexcept {
+    return settings_;
+}
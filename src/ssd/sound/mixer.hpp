@@ -0,0 +1,67 @@
+#pragma once
+
+// abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+
+// laar
+#include <src/ssd/sound/channel-matrix.hpp>
+
+// json
+#include <nlohmann/json_fwd.hpp>
+
+// std
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace laar {
+
+    // Float mix bus: streams are summed in one linear pass each, then
+    // soft-knee limiter brings the sum back to base sample range once per period.
+    // Bus holds one plane per output channel.
+    class Mixer {
+    public:
+
+        struct Settings {
+            // attenuation of every stream before summing, dB
+            float headroom = 3.f;
+            // distance from full scale where limiter starts to bend signal, dB
+            float knee = 6.f;
+        };
+
+        static absl::StatusOr<Settings> parseSettings(const nlohmann::json& config);
+
+        Mixer();
+
+        absl::Status configure(Settings settings);
+
+        // allocates bus, must be called off real-time path
+        void reserve(std::size_t frames, std::size_t channels = 1);
+        std::size_t capacity() const noexcept;
+        std::size_t channels() const noexcept;
+
+        // prepare bus for next period of at most capacity() frames, drops previous mix
+        void reset(std::size_t frames) noexcept;
+        // source is laid out as bus: channels() planes of frames each
+        void add(const std::int32_t* source, std::size_t frames) noexcept;
+        // source is interleaved with matrix.inputs() channels, remixed onto bus on the way
+        void add(const std::int32_t* source, std::size_t frames, const ChannelMatrix& matrix) noexcept;
+        // limit bus and write it as base samples, plane after plane;
+        // stride is distance between planes in dest, frames if zero
+        void mixdown(std::int32_t* dest, std::size_t frames, std::size_t stride = 0) noexcept;
+
+        const Settings& settings() const noexcept;
+
+    private:
+        Settings settings_;
+        float inputScale_;
+        float threshold_;
+
+        std::size_t frames_;
+        std::size_t channels_;
+        std::vector<float> bus_;
+    };
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <memory>
+#include <utility>
+
+
+namespace laar {
+
+    // Hands immutable snapshots from writers to a single real-time reader.
+    // Reader never blocks and never frees memory: snapshots it stops using are
+    // pushed to retired list, which writers free. Writers must be serialized.
+    template<typename T>
+    class RcuSnapshot {
+    public:
+
+        RcuSnapshot() = default;
+        RcuSnapshot(const RcuSnapshot&) = delete;
+        RcuSnapshot& operator=(const RcuSnapshot&) = delete;
+
+        // reader must be stopped by now
+        ~RcuSnapshot() {
+            reclaim();
+            delete current_;
+            delete pending_.load(std::memory_order_acquire);
+        }
+
+        void publish(std::unique_ptr<const T> snapshot) {
+            reclaim();
+            // pending snapshot the reader has not seen yet is simply replaced
+            delete pending_.exchange(new Node{std::move(snapshot), nullptr}, std::memory_order_acq_rel);
+        }
+
+        // frees snapshots reader is done with
+        void reclaim() {
+            Node* node = retired_.exchange(nullptr, std::memory_order_acquire);
+            while (node) {
+                delete std::exchange(node, node->next);
+            }
+        }
+
+        // reader side: returned snapshot stays valid until the next acquire;
+        // nullptr until the first publish
+        const T* acquire() noexcept {
+            if (Node* next = pending_.exchange(nullptr, std::memory_order_acq_rel)) {
+                if (current_) {
+                    // only the reader pushes and writers only take whole list, so no ABA here
+                    current_->next = retired_.load(std::memory_order_relaxed);
+                    while (!retired_.compare_exchange_weak(current_->next, current_, std::memory_order_release, std::memory_order_relaxed));
+                }
+                current_ = next;
+            }
+            return current_ ? current_->value.get() : nullptr;
+        }
+
+    private:
+        struct Node {
+            std::unique_ptr<const T> value;
+            Node* next;
+        };
+
+        std::atomic<Node*> pending_ = nullptr;
+        std::atomic<Node*> retired_ = nullptr;
+        // owned by reader
+        Node* current_ = nullptr;
+    };
+
+}
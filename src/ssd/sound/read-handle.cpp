@@ -4,15 +4,17 @@
 
 // laar
 #include <src/ssd/sound/converter.hpp>
+#include <src/ssd/sound/resampler.hpp>
 #include <src/ssd/sound/ring-buffer.hpp>
 #include <src/ssd/sound/read-handle.hpp>
 #include <src/ssd/sound/interfaces/i-audio-handler.hpp>
 
-// Plog
-#include <plog/Log.h>
-
 // std
+#include <span>
 #include <memory>
+#include <cstring>
+#include <algorithm>
+#include <memory_resource>
 
 // proto
 #include <protos/client/stream.pb.h>
@@ -22,27 +24,36 @@ using namespace laar;
 using ESamples = 
     NSound::NCommon::TStreamConfiguration::TSampleSpecification;
 
-
 ReadHandle::ReadHandle(
     NSound::NCommon::TStreamConfiguration config, 
+    Resampler resampler,
+    BufferLimits limits,
+    std::shared_ptr<std::pmr::memory_resource> storage,
     std::weak_ptr<IListener> owner
 ) 
-    : format_(config.sample_spec().format())
-    , sampleSize_(getSampleSize(config.sample_spec().format()))
+    : isAlive_(true)
+    , flushRequested_(false)
+    , format_(config.sample_spec().format())
+    , bufferConfig_(limits.negotiate(config))
+    , converter_(SampleConverter::create(config.sample_spec().format()))
+    , resampler_(std::move(resampler))
+    // holds device samples, enough of them to make negotiated size of stream ones
+    , buffer_(std::make_unique<laar::SPSCRingBuffer>(
+        (resampler_.maxInput(bufferConfig_.size()) + resampler_.taps() + 1) * sizeof(std::int32_t),
+        std::move(storage)
+    ))
     , owner_(std::move(owner))
 {}
 
 absl::Status ReadHandle::flush() {
-    std::unique_lock<std::mutex> locked(lock_);
-
-    buffer_->drop(buffer_->readableSize());
+    // flush is requested by producer (audio thread) on overrun,
+    // consumer drops everything on the next read
+    flushRequested_.store(true, std::memory_order_release);
     return absl::OkStatus();
 }
 
 void ReadHandle::abort() {
-    std::unique_lock<std::mutex> locked(lock_);
-
-    isAlive_ = false;
+    isAlive_.store(false, std::memory_order_release);
 }
 
 absl::Status ReadHandle::drain() {
@@ -50,96 +61,81 @@ absl::Status ReadHandle::drain() {
 }
 
 absl::StatusOr<int> ReadHandle::read(char* dest, std::size_t size) {
-    std::unique_lock<std::mutex> locked(lock_);
-
-    std::int32_t baseSample; 
-    std::size_t trail = size - buffer_->readableSize() / BaseSampleSize;
-
-    if (trail) {
-        PLOG(plog::warning) << "underrun on handle: " << this
-            << " filling " << trail << " extra samples";
+    if (flushRequested_.exchange(false, std::memory_order_acq_rel)) {
+        buffer_->drop(buffer_->readableSize());
+        backlog_.clear();
+        resampler_.reset();
     }
 
-    for (std::size_t frame = 0; frame < size - trail; ++frame) {
-        buffer_->read((char*) &baseSample, sizeof(std::int32_t));
-        if (format_ == ESamples::UNSIGNED_8) {
-            auto converted = convertToUnsigned8(baseSample);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::SIGNED_16_BIG_ENDIAN) {
-            auto converted = convertToSigned32BE(baseSample);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::SIGNED_16_LITTLE_ENDIAN) {
-            auto converted = convertToSigned32LE(baseSample);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::FLOAT_32_BIG_ENDIAN) {
-            auto converted = convertToFloat32BE(baseSample);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::FLOAT_32_LITTLE_ENDIAN) {
-            auto converted = convertToFloat32LE(baseSample);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::SIGNED_32_BIG_ENDIAN) {
-            auto converted = convertToSigned32BE(baseSample);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::SIGNED_32_LITTLE_ENDIAN) {
-            auto converted = convertToSigned32LE(baseSample);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else {
-            throw absl::InvalidArgumentError("sample type is not supported");
-        }
+    if (!converter_.ok()) {
+        return converter_.status();
     }
 
-    for (std::size_t frame = size - trail; frame < size; ++frame) {
-        if (format_ == ESamples::UNSIGNED_8) {
-            auto converted = convertToUnsigned8(Silence);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::SIGNED_16_BIG_ENDIAN) {
-            auto converted = convertToSigned32BE(Silence);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::SIGNED_16_LITTLE_ENDIAN) {
-            auto converted = convertToSigned32LE(Silence);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::FLOAT_32_BIG_ENDIAN) {
-            auto converted = convertToFloat32BE(Silence);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::FLOAT_32_LITTLE_ENDIAN) {
-            auto converted = convertToFloat32LE(Silence);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::SIGNED_32_BIG_ENDIAN) {
-            auto converted = convertToSigned32BE(Silence);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else if (format_ == ESamples::SIGNED_32_LITTLE_ENDIAN) {
-            auto converted = convertToSigned32LE(Silence);
-            std::memcpy(dest + frame * sampleSize_, &converted, sizeof(converted));
-        } else {
-            throw absl::InvalidArgumentError("sample type is not supported");
+    // capture is never padded, client gets what device has delivered so far
+    std::size_t available = 0;
+    std::size_t sampleSize = converter_->sampleSize();
+    if (resampler_.isPassthrough()) {
+        auto regions = buffer_->readRegions(size * sizeof(std::int32_t));
+        available = regions.size() / sizeof(std::int32_t);
+
+        // samples are converted right from buffer storage
+        std::size_t frame = 0;
+        for (std::span<const char> region : {regions.first, regions.second}) {
+            std::size_t samples = region.size() / sizeof(std::int32_t);
+            converter_->toFormat(reinterpret_cast<const std::int32_t*>(region.data()), dest + frame * sampleSize, samples);
+            frame += samples;
         }
+        buffer_->commitRead(regions.size());
+    } else {
+        // never takes more device samples than client needs, output may fall short by one frame
+        // and the next chunk makes up for it
+        while (backlog_.size() < size) {
+            std::size_t wanted = std::max<std::size_t>(1, resampler_.maxInput(size - backlog_.size()));
+            auto regions = buffer_->readRegions(wanted * sizeof(std::int32_t));
+            if (!regions.size()) {
+                break;
+            }
+
+            captured_.resize(regions.size() / sizeof(std::int32_t));
+            std::memcpy(captured_.data(), regions.first.data(), regions.first.size());
+            std::memcpy(reinterpret_cast<char*>(captured_.data()) + regions.first.size(), regions.second.data(), regions.second.size());
+            buffer_->commitRead(regions.size());
+
+            std::size_t offset = backlog_.size();
+            backlog_.resize(offset + resampler_.maxOutput(captured_.size()));
+            backlog_.resize(offset + resampler_.process(captured_.data(), captured_.size(), backlog_.data() + offset));
+        }
+
+        available = std::min(size, backlog_.size());
+        converter_->toFormat(backlog_.data(), dest, available);
+        backlog_.erase(backlog_.begin(), backlog_.begin() + available);
     }
 
-    return absl::StatusOr<int>(size - trail);
+    return absl::StatusOr<int>(available);
 }
 
 absl::StatusOr<int> ReadHandle::write(const std::int32_t* src, std::size_t size) {
-    std::unique_lock<std::mutex> locked(lock_);
+    auto regions = buffer_->writeRegions(size * sizeof(std::int32_t));
+    std::memcpy(regions.first.data(), src, regions.first.size());
+    std::memcpy(regions.second.data(), reinterpret_cast<const char*>(src) + regions.first.size(), regions.second.size());
+    buffer_->commitWrite(regions.size());
 
-    if (size > buffer_->writableSize()) {
-        PLOG(plog::warning) << "overrun on handle: " << this 
-            << "; cutting " << size - buffer_->writableSize() << " samples on stream";
-        size = buffer_->writableSize();
-    }
-
-    for (std::size_t frame = 0; frame < size; ++frame) {
-        buffer_->write((char*) (src + frame), sizeof(std::int32_t));
-    }
-
-    return absl::StatusOr<int>(size);
+    // called on audio thread, overruns are reported by sound handler
+    return absl::StatusOr<int>(regions.size() / sizeof(std::int32_t));
 }
 
 ESampleType ReadHandle::getFormat() const {
     return format_;
 }
 
-bool ReadHandle::isAlive() noexcept {
-    std::unique_lock<std::mutex> locked(lock_);
+ReadHandle::TBufferConfiguration ReadHandle::getBufferConfig() const {
+    return bufferConfig_;
+}
+
+absl::StatusOr<ReadHandle::TBufferConfiguration> ReadHandle::resize(TBufferConfiguration /* config */) {
+    return absl::UnimplementedError("capture buffers are sized when stream connects");
+}
 
-    return isAlive_;
+bool ReadHandle::isAlive() noexcept {
+    return isAlive_.load(std::memory_order_acquire);
 }
\ No newline at end of file
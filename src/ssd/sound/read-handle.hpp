@@ -2,16 +2,23 @@
 
 // abseil
 #include <absl/status/status.h>
+#include <absl/status/statusor.h>
 
 // laar
+#include <src/ssd/sound/converter.hpp>
+#include <src/ssd/sound/resampler.hpp>
 #include <src/ssd/sound/ring-buffer.hpp>
+#include <src/ssd/sound/buffer-limits.hpp>
 #include <src/ssd/sound/interfaces/i-audio-handler.hpp>
 
 // RtAudio
 #include <RtAudio.h>
 
 // std
+#include <atomic>
 #include <memory>
+#include <vector>
+#include <memory_resource>
 
 // proto
 #include <protos/client/stream.pb.h>
@@ -22,8 +29,13 @@ namespace laar {
     class ReadHandle : public IStreamHandler::IReadHandle {
     public:
 
+        using TBufferConfiguration = NSound::NCommon::TStreamConfiguration::TBufferConfiguration;
+
         ReadHandle(
             NSound::NCommon::TStreamConfiguration config, 
+            Resampler resampler,
+            BufferLimits limits,
+            std::shared_ptr<std::pmr::memory_resource> storage,
             std::weak_ptr<IListener> owner
         );
 
@@ -40,17 +52,29 @@ namespace laar {
         // // getters
         // virtual void setVolume(float volume) const override;
         virtual ESampleType getFormat() const override;
+        virtual TBufferConfiguration getBufferConfig() const override;
+        // capture buffer keeps size it was opened with
+        virtual absl::StatusOr<TBufferConfiguration> resize(TBufferConfiguration config) override;
         // condition
         virtual bool isAlive() noexcept override;
 
     private:
-        bool isAlive_;
+        // buffer is SPSC: audio thread writes, session thread reads,
+        // so state shared between them is kept in atomics
+        std::atomic<bool> isAlive_;
+        std::atomic<bool> flushRequested_;
 
         ESampleType format_;
-        std::size_t sampleSize_;
+        TBufferConfiguration bufferConfig_;
+        // resolved once for stream format
+        absl::StatusOr<SampleConverter> converter_;
+        // device rate to stream rate, applied by reader; resampled
+        // samples not yet taken by client wait in backlog
+        Resampler resampler_;
+        std::vector<std::int32_t> captured_;
+        std::vector<std::int32_t> backlog_;
 
-        std::mutex lock_;
-        std::unique_ptr<laar::RingBuffer> buffer_;
+        std::unique_ptr<laar::IBuffer> buffer_;
         std::weak_ptr<IListener> owner_;
     };
 
@@ -0,0 +1,323 @@
+// laar
+#include <src/ssd/macros.hpp>
+#include <src/ssd/sound/resampler.hpp>
+
+// abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <absl/strings/str_format.h>
+
+// json
+#include <nlohmann/json.hpp>
+
+// std
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <string>
+#include <numeric>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+using namespace laar;
+
+// Filter kernel is cloned for several instruction sets and
+// picked by loader at runtime, default clone is plain scalar code.
+#if defined(__x86_64__) && defined(__ELF__) && defined(__GNUC__)
+    #define SSD_RESAMPLER_CLONES __attribute__((target_clones("avx2", "sse4.2", "default")))
+#else
+    #define SSD_RESAMPLER_CLONES
+#endif
+
+namespace {
+
+    constexpr auto RESAMPLER_SECTION = "resampler";
+    constexpr float fullScale = 2147483648.f;
+    // largest float below 2^31, so output always fits int32
+    constexpr float outputScale = 2147483520.f;
+
+    // independent partial sums, so dot product vectorizes without reassociation;
+    // every tap count is a multiple of it
+    constexpr std::size_t Lanes = 8;
+
+    struct Design {
+        std::size_t taps;
+        // kaiser window shape, trades transition width for stopband depth
+        double beta;
+        // cutoff relative to lower nyquist, leaves room for transition band
+        double rolloff;
+    };
+
+    Design designFor(Resampler::EQuality quality) {
+        switch (quality) {
+            case Resampler::EQuality::FAST:
+                return Design{ .taps = 16, .beta = 5.7, .rolloff = 0.77 };
+            case Resampler::EQuality::BEST:
+                return Design{ .taps = 64, .beta = 11.0, .rolloff = 0.89 };
+            case Resampler::EQuality::MEDIUM:
+            default:
+                return Design{ .taps = 32, .beta = 8.0, .rolloff = 0.84 };
+        }
+    }
+
+    // modified bessel function of the first kind, order zero
+    double besselI0(double x) {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 64 && term > sum * 1e-12; ++k) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // filters one channel plane for every output frame that fits in it;
+    // time is in 1/interpolation frames, history frames precede it
+    SSD_RESAMPLER_CLONES
+    std::size_t filterPlane(
+        const float* coefficients, std::size_t taps,
+        const float* plane, std::size_t frames,
+        std::size_t time, std::size_t interpolation, std::size_t decimation,
+        std::int32_t* out, std::size_t stride
+    ) {
+        std::size_t produced = 0;
+        for (; time / interpolation < frames; time += decimation, ++produced) {
+            const float* window = plane + time / interpolation + 1 - taps;
+            const float* phase = coefficients + (time % interpolation) * taps;
+
+            float lanes[Lanes] = {};
+            for (std::size_t tap = 0; tap < taps; tap += Lanes) {
+                for (std::size_t lane = 0; lane < Lanes; ++lane) {
+                    lanes[lane] += phase[tap + lane] * window[tap + lane];
+                }
+            }
+
+            float sum = 0.f;
+            for (std::size_t lane = 0; lane < Lanes; ++lane) {
+                sum += lanes[lane];
+            }
+            out[produced * stride] = static_cast<std::int32_t>(std::clamp(sum, -fullScale, outputScale));
+        }
+        return produced;
+    }
+
+    struct Ratio {
+        std::size_t interpolation;
+        std::size_t decimation;
+    };
+
+    // out / in reduced, or its closest fraction with at most MaxPhases phases
+    Ratio reduce(std::size_t inRate, std::size_t outRate) {
+        std::size_t divisor = std::gcd(inRate, outRate);
+        Ratio exact{ .interpolation = outRate / divisor, .decimation = inRate / divisor };
+        if (exact.interpolation <= Resampler::MaxPhases) {
+            return exact;
+        }
+
+        const double target = static_cast<double>(inRate) / outRate;
+        Ratio best = exact;
+        double bestError = std::numeric_limits<double>::infinity();
+        for (std::size_t interpolation = 1; interpolation <= Resampler::MaxPhases; ++interpolation) {
+            std::size_t decimation = std::max<std::size_t>(1, std::llround(target * interpolation));
+            double error = std::abs(static_cast<double>(decimation) / interpolation - target);
+            if (error < bestError) {
+                bestError = error;
+                best = Ratio{ .interpolation = interpolation, .decimation = decimation };
+            }
+        }
+        return best;
+    }
+
+}
+
+absl::StatusOr<Resampler::Settings> Resampler::parseSettings(const nlohmann::json& config) {
+    Settings settings;
+    if (!config.contains(RESAMPLER_SECTION)) {
+        return settings;
+    }
+
+    const auto& resampler = config[RESAMPLER_SECTION];
+    if (!resampler.is_object()) {
+        return absl::InvalidArgumentError("resampler section must be an object");
+    }
+
+    try {
+        std::string quality = resampler.value<std::string>("quality", "medium");
+        if (quality == "fast") {
+            settings.quality = EQuality::FAST;
+        } else if (quality == "medium") {
+            settings.quality = EQuality::MEDIUM;
+        } else if (quality == "best") {
+            settings.quality = EQuality::BEST;
+        } else {
+            return absl::InvalidArgumentError(absl::StrFormat("unknown resampler quality: %s", quality));
+        }
+    } catch (const nlohmann::json::exception& error) {
+        return absl::InvalidArgumentError(absl::StrFormat("malformed resampler settings: %s", error.what()));
+    }
+
+    return settings;
+}
+
+absl::Status Resampler::checkRate(std::size_t rate) {
+    if (rate < static_cast<std::size_t>(MinSampleRate) || rate > static_cast<std::size_t>(MaxSampleRate)) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "sample rate must be within [%d, %d], got: %d", MinSampleRate, MaxSampleRate, rate
+        ));
+    }
+    return absl::OkStatus();
+}
+
+absl::StatusOr<Resampler> Resampler::create(
+    std::size_t inRate,
+    std::size_t outRate,
+    std::size_t channels,
+    EQuality quality
+) {
+    if (absl::Status status = checkRate(inRate); !status.ok()) {
+        return status;
+    }
+    if (absl::Status status = checkRate(outRate); !status.ok()) {
+        return status;
+    }
+    if (!channels) {
+        return absl::InvalidArgumentError("resampler needs at least one channel");
+    }
+
+    if (inRate == outRate) {
+        return Resampler(inRate, outRate, channels, 1, 1, 0);
+    }
+
+    Ratio ratio = reduce(inRate, outRate);
+    Resampler resampler(inRate, outRate, channels, ratio.interpolation, ratio.decimation, designFor(quality).taps);
+    resampler.design(quality);
+    return resampler;
+}
+
+Resampler::Resampler(std::size_t inRate, std::size_t outRate, std::size_t channels, std::size_t interpolation, std::size_t decimation, std::size_t taps)
+    : inRate_(inRate)
+    , outRate_(outRate)
+    , channels_(channels)
+    , interpolation_(interpolation)
+    , decimation_(decimation)
+    , taps_(taps)
+    , stride_(0)
+    , time_(0)
+{
+    if (taps_) {
+        history_.assign(channels_ * (taps_ - 1), 0.f);
+        stride_ = taps_ - 1;
+    }
+    reset();
+}
+
+void Resampler::design(EQuality quality) {
+    const Design design = designFor(quality);
+    const std::size_t length = interpolation_ * taps_;
+    const double center = (length - 1) / 2.0;
+    // cycles per sample at interpolated rate
+    const double cutoff = design.rolloff * 0.5 / std::max(interpolation_, decimation_);
+    const double norm = besselI0(design.beta);
+
+    std::vector<double> prototype(length);
+    double sum = 0;
+    for (std::size_t n = 0; n < length; ++n) {
+        double offset = n - center;
+        double sinc = (offset == 0) ? 1.0 : std::sin(2 * M_PI * cutoff * offset) / (2 * M_PI * cutoff * offset);
+        double position = 2 * offset / (length - 1);
+        double window = besselI0(design.beta * std::sqrt(std::max(0.0, 1 - position * position))) / norm;
+        prototype[n] = 2 * cutoff * sinc * window;
+        sum += prototype[n];
+    }
+
+    // every phase sees one of interpolation_ samples, so unity gain needs sum of L
+    const double gain = interpolation_ / sum;
+    coefficients_.resize(length);
+    for (std::size_t phase = 0; phase < interpolation_; ++phase) {
+        for (std::size_t tap = 0; tap < taps_; ++tap) {
+            coefficients_[phase * taps_ + (taps_ - 1 - tap)] = static_cast<float>(prototype[phase + tap * interpolation_] * gain);
+        }
+    }
+}
+
+std::size_t Resampler::maxOutput(std::size_t inFrames) const noexcept {
+    return (inFrames * interpolation_ + decimation_ - 1) / decimation_;
+}
+
+std::size_t Resampler::maxInput(std::size_t outFrames) const noexcept {
+    return outFrames * decimation_ / interpolation_;
+}
+
+std::size_t Resampler::process(const std::int32_t* in, std::size_t frames, std::int32_t* out) {
+    if (isPassthrough()) {
+        std::copy_n(in, frames * channels_, out);
+        return frames;
+    }
+
+    if (!frames) {
+        return 0;
+    }
+
+    const std::size_t history = taps_ - 1;
+    const std::size_t total = history + frames;
+    if (stride_ < total) {
+        std::vector<float> grown(channels_ * total, 0.f);
+        for (std::size_t channel = 0; channel < channels_; ++channel) {
+            std::copy_n(history_.data() + channel * stride_, history, grown.data() + channel * total);
+        }
+        history_ = std::move(grown);
+        stride_ = total;
+    }
+
+    std::size_t produced = 0;
+    for (std::size_t channel = 0; channel < channels_; ++channel) {
+        float* plane = history_.data() + channel * stride_;
+        for (std::size_t frame = 0; frame < frames; ++frame) {
+            plane[history + frame] = static_cast<float>(in[frame * channels_ + channel]);
+        }
+
+        produced = filterPlane(
+            coefficients_.data(), taps_, plane, total,
+            time_, interpolation_, decimation_,
+            out + channel, channels_
+        );
+
+        // tail becomes history of the next call
+        std::copy(plane + frames, plane + total, plane);
+    }
+
+    time_ += produced * decimation_;
+    time_ -= frames * interpolation_;
+    return produced;
+}
+
+void Resampler::reset() noexcept {
+    std::fill(history_.begin(), history_.end(), 0.f);
+    // first output lands on first input frame
+    time_ = (taps_) ? (taps_ - 1) * interpolation_ : 0;
+}
+
+bool Resampler::isPassthrough() const noexcept {
+    return taps_ == 0;
+}
+
+std::size_t Resampler::latency() const noexcept {
+    return taps_ / 2;
+}
+
+std::size_t Resampler::inRate() const noexcept {
+    return inRate_;
+}
+
+std::size_t Resampler::outRate() const noexcept {
+    return outRate_;
+}
+
+std::size_t Resampler::channels() const noexcept {
+    return channels_;
+}
+
+std::size_t Resampler::taps() const noexcept {
+    return taps_;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+// abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+
+// json
+#include <nlohmann/json_fwd.hpp>
+
+// std
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace laar {
+
+    // Polyphase windowed-sinc converter between two fixed rates, for interleaved base samples.
+    // Ratio is reduced to out/in = L/M and filter is split into L phases, so every
+    // output frame costs one dot product of taps() coefficients per channel.
+    // Grows its buffers on demand, keep it off real-time path.
+    class Resampler {
+    public:
+
+        enum class EQuality {
+            // 16 taps per phase, ~60 dB stopband
+            FAST,
+            // 32 taps per phase, ~80 dB stopband
+            MEDIUM,
+            // 64 taps per phase, ~110 dB stopband
+            BEST
+        };
+
+        struct Settings {
+            EQuality quality = EQuality::MEDIUM;
+        };
+
+        // ratios reducing to more phases than that are approximated
+        static constexpr std::size_t MaxPhases = 1024;
+
+        static absl::StatusOr<Settings> parseSettings(const nlohmann::json& config);
+        static absl::Status checkRate(std::size_t rate);
+
+        static absl::StatusOr<Resampler> create(
+            std::size_t inRate,
+            std::size_t outRate,
+            std::size_t channels,
+            EQuality quality
+        );
+
+        // frames process() produces at most from that many input frames
+        std::size_t maxOutput(std::size_t inFrames) const noexcept;
+        // input frames that never produce more than outFrames
+        std::size_t maxInput(std::size_t outFrames) const noexcept;
+
+        // consumes all input frames, out must fit maxOutput(frames) of them;
+        // returns frames written
+        std::size_t process(const std::int32_t* in, std::size_t frames, std::int32_t* out);
+        // forgets stream history, as if nothing was processed
+        void reset() noexcept;
+
+        // same rates, process() is a plain copy
+        bool isPassthrough() const noexcept;
+        // group delay of filter, in input frames
+        std::size_t latency() const noexcept;
+
+        std::size_t inRate() const noexcept;
+        std::size_t outRate() const noexcept;
+        std::size_t channels() const noexcept;
+        std::size_t taps() const noexcept;
+
+    private:
+        Resampler(std::size_t inRate, std::size_t outRate, std::size_t channels, std::size_t interpolation, std::size_t decimation, std::size_t taps);
+
+        void design(EQuality quality);
+
+    private:
+        std::size_t inRate_;
+        std::size_t outRate_;
+        std::size_t channels_;
+        // reduced ratio: L phases, M phase steps per output frame
+        std::size_t interpolation_;
+        std::size_t decimation_;
+        std::size_t taps_;
+
+        // phase after phase, each reversed so it runs over history in order
+        std::vector<float> coefficients_;
+        // one plane per channel: taps - 1 frames of history followed by current input
+        std::vector<float> history_;
+        std::size_t stride_;
+        // position of next output frame in history, in 1/L input frames
+        std::size_t time_;
+    };
+
+}
@@ -1,7 +1,11 @@
 // std
+#include <bit>
 #include <mutex>
+#include <atomic>
 #include <memory>
 #include <cstring>
+#include <algorithm>
+#include <memory_resource>
 
 // laar
 #include <src/ssd/sound/ring-buffer.hpp>
@@ -82,7 +86,7 @@ std::size_t RingBuffer::read(char* dest, std::size_t size) {
         std::memcpy(dest, buffer_->data() + rPos_, size);
         rPos_ += size;
     } else {
-        std::memcpy(dest, buffer_->data() + rPos_, size);
+        std::memcpy(dest, buffer_->data() + rPos_, trailSize);
         std::memcpy(dest + trailSize, buffer_->data(), size - trailSize);
         rPos_ = size - trailSize;
     }
@@ -137,5 +141,155 @@ std::size_t RingBuffer::drop(std::size_t size) {
     return size;
 }
 
+WriteRegions RingBuffer::writeRegions(std::size_t size) {
+    std::scoped_lock<std::recursive_mutex> locked(lock_);
+
+    size = std::min(size, writableSize());
+    std::size_t trailSize = std::min(size, buffer_->size() - wPos_);
+
+    return WriteRegions{
+        .first = std::span<char>(buffer_->data() + wPos_, trailSize),
+        .second = std::span<char>(buffer_->data(), size - trailSize)
+    };
+}
+
+void RingBuffer::commitWrite(std::size_t size) {
+    std::scoped_lock<std::recursive_mutex> locked(lock_);
+
+    if (size > 0) {
+        wPos_ = (wPos_ + size) % buffer_->size();
+        empty_ = false;
+    }
+}
+
+ReadRegions RingBuffer::readRegions(std::size_t size) {
+    std::scoped_lock<std::recursive_mutex> locked(lock_);
+
+    size = std::min(size, readableSize());
+    std::size_t trailSize = std::min(size, buffer_->size() - rPos_);
+
+    return ReadRegions{
+        .first = std::span<const char>(buffer_->data() + rPos_, trailSize),
+        .second = std::span<const char>(buffer_->data(), size - trailSize)
+    };
+}
+
+void RingBuffer::commitRead(std::size_t size) {
+    std::scoped_lock<std::recursive_mutex> locked(lock_);
+
+    rPos_ = (rPos_ + size) % buffer_->size();
+    if (rPos_ == wPos_) {
+        empty_ = true;
+    }
+}
+
+
+
+
+namespace {
+
+    std::size_t roundUpToPowerOfTwo(std::size_t size) {
+        return std::bit_ceil(std::max<std::size_t>(size, 1));
+    }
+
+}
+
+SPSCRingBuffer::SPSCRingBuffer(std::size_t size, std::shared_ptr<std::pmr::memory_resource> storage)
+: capacity_(roundUpToPowerOfTwo(size))
+, mask_(capacity_ - 1)
+, storage_(std::move(storage))
+, buffer_(static_cast<char*>(resource()->allocate(capacity_, CacheLineSize)))
+, head_(0)
+, cachedTail_(0)
+, tail_(0)
+, cachedHead_(0)
+{}
 
+SPSCRingBuffer::~SPSCRingBuffer() {
+    resource()->deallocate(buffer_, capacity_, CacheLineSize);
+}
 
+std::pmr::memory_resource* SPSCRingBuffer::resource() const noexcept {
+    return (storage_) ? storage_.get() : std::pmr::new_delete_resource();
+}
+
+std::size_t SPSCRingBuffer::capacity() const noexcept {
+    return capacity_;
+}
+
+std::size_t SPSCRingBuffer::writableSize() {
+    // positions grow monotonically, unsigned wraparound keeps difference valid
+    return capacity_ - (head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+}
+
+std::size_t SPSCRingBuffer::readableSize() {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+}
+
+std::size_t SPSCRingBuffer::write(const char* src, std::size_t size) {
+    auto regions = writeRegions(size);
+    std::memcpy(regions.first.data(), src, regions.first.size());
+    std::memcpy(regions.second.data(), src + regions.first.size(), regions.second.size());
+
+    commitWrite(regions.size());
+    return regions.size();
+}
+
+std::size_t SPSCRingBuffer::read(char* dest, std::size_t size) {
+    size = peek(dest, size);
+    commitRead(size);
+    return size;
+}
+
+std::size_t SPSCRingBuffer::peek(char* dest, std::size_t size) {
+    auto regions = readRegions(size);
+    std::memcpy(dest, regions.first.data(), regions.first.size());
+    std::memcpy(dest + regions.first.size(), regions.second.data(), regions.second.size());
+    return regions.size();
+}
+
+std::size_t SPSCRingBuffer::drop(std::size_t size) {
+    size = readRegions(size).size();
+    commitRead(size);
+    return size;
+}
+
+WriteRegions SPSCRingBuffer::writeRegions(std::size_t size) {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+
+    if (capacity_ - (head - cachedTail_) < size) {
+        // refresh consumer position only when cached one is not enough
+        cachedTail_ = tail_.load(std::memory_order_acquire);
+    }
+
+    return regionsAt<char>(head, std::min(size, capacity_ - (head - cachedTail_)));
+}
+
+void SPSCRingBuffer::commitWrite(std::size_t size) {
+    head_.store(head_.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
+
+ReadRegions SPSCRingBuffer::readRegions(std::size_t size) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+    if (cachedHead_ - tail < size) {
+        cachedHead_ = head_.load(std::memory_order_acquire);
+    }
+
+    return regionsAt<const char>(tail, std::min(size, cachedHead_ - tail));
+}
+
+void SPSCRingBuffer::commitRead(std::size_t size) {
+    tail_.store(tail_.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
+
+template<typename CharType>
+BufferRegions<CharType> SPSCRingBuffer::regionsAt(std::size_t position, std::size_t size) const noexcept {
+    const std::size_t offset = position & mask_;
+    const std::size_t trailSize = std::min(size, capacity_ - offset);
+
+    return BufferRegions<CharType>{
+        .first = std::span<CharType>(buffer_ + offset, trailSize),
+        .second = std::span<CharType>(buffer_, size - trailSize)
+    };
+}
@@ -2,12 +2,35 @@
 
 // std
 #include <mutex>
+#include <atomic>
+#include <span>
 #include <vector>
 #include <memory>
+#include <cstddef>
+#include <memory_resource>
 
 
 namespace laar {
 
+    // size of cache line on most of supported platforms (x86_64 & arm64),
+    // used to keep producer and consumer state apart
+    inline constexpr std::size_t CacheLineSize = 64;
+
+    // Up to two contiguous parts of buffer storage, second one
+    // is empty unless requested region wraps around buffer end.
+    template<typename CharType>
+    struct BufferRegions {
+        std::span<CharType> first;
+        std::span<CharType> second;
+
+        std::size_t size() const noexcept {
+            return first.size() + second.size();
+        }
+    };
+
+    using WriteRegions = BufferRegions<char>;
+    using ReadRegions = BufferRegions<const char>;
+
     class IBuffer {
     public:
         virtual std::size_t writableSize() = 0;
@@ -19,6 +42,14 @@ namespace laar {
         virtual std::size_t peek(char* dest, std::size_t size) = 0;
         virtual std::size_t drop(std::size_t size) = 0;
 
+        // Direct access to storage: regions are at most size bytes long
+        // and stay valid until matching commit, which publishes (or releases)
+        // first n bytes of them. Commit size must not exceed regions size.
+        virtual WriteRegions writeRegions(std::size_t size) = 0;
+        virtual void commitWrite(std::size_t size) = 0;
+        virtual ReadRegions readRegions(std::size_t size) = 0;
+        virtual void commitRead(std::size_t size) = 0;
+
         virtual ~IBuffer() = default;
     };
 
@@ -34,6 +65,10 @@ namespace laar {
         virtual std::size_t read(char* dest, std::size_t size) override;
         virtual std::size_t peek(char* dest, std::size_t size) override;
         virtual std::size_t drop(std::size_t size) override;
+        virtual WriteRegions writeRegions(std::size_t size) override;
+        virtual void commitWrite(std::size_t size) override;
+        virtual ReadRegions readRegions(std::size_t size) override;
+        virtual void commitRead(std::size_t size) override;
 
     private:
         // No private methods
@@ -47,4 +82,51 @@ namespace laar {
 
     };
 
-}
\ No newline at end of file
+    // Wait-free buffer for exactly one producer and one consumer thread.
+    // write() and write regions are producer-only, read(), peek(), drop()
+    // and read regions are consumer-only,
+    // size queries are safe from both sides (but are only a snapshot).
+    // Capacity is rounded up to the nearest power of two.
+    // Storage comes from given resource (heap if none) and keeps it alive.
+    class SPSCRingBuffer : public IBuffer {
+    public:
+
+        SPSCRingBuffer(std::size_t size, std::shared_ptr<std::pmr::memory_resource> storage = nullptr);
+        ~SPSCRingBuffer() override;
+
+        // IBuffer implementation
+        virtual std::size_t writableSize() override;
+        virtual std::size_t readableSize() override;
+        virtual std::size_t write(const char* src, std::size_t size) override;
+        virtual std::size_t read(char* dest, std::size_t size) override;
+        virtual std::size_t peek(char* dest, std::size_t size) override;
+        virtual std::size_t drop(std::size_t size) override;
+        virtual WriteRegions writeRegions(std::size_t size) override;
+        virtual void commitWrite(std::size_t size) override;
+        virtual ReadRegions readRegions(std::size_t size) override;
+        virtual void commitRead(std::size_t size) override;
+
+        std::size_t capacity() const noexcept;
+
+    private:
+        std::pmr::memory_resource* resource() const noexcept;
+        template<typename CharType>
+        BufferRegions<CharType> regionsAt(std::size_t position, std::size_t size) const noexcept;
+
+    private:
+        const std::size_t capacity_;
+        const std::size_t mask_;
+        std::shared_ptr<std::pmr::memory_resource> storage_;
+        char* buffer_;
+
+        // producer side: position of next write and last seen consumer position
+        alignas(CacheLineSize) std::atomic<std::size_t> head_;
+        std::size_t cachedTail_;
+
+        // consumer side: position of next read and last seen producer position
+        alignas(CacheLineSize) std::atomic<std::size_t> tail_;
+        std::size_t cachedHead_;
+
+    };
+
+}
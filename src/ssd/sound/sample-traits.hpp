@@ -0,0 +1,251 @@
+#pragma once
+
+// abseil
+#include <absl/base/internal/endian.h>
+
+// std
+#include <bit>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// proto
+#include <protos/client/stream.pb.h>
+
+
+namespace laar {
+
+    using ESampleType =
+        NSound::NCommon::TStreamConfiguration::TSampleSpecification::TFormat;
+
+    enum class ESampleEncoding : std::int_fast8_t {
+        UNSIGNED, SIGNED, FLOAT, ALAW, ULAW
+    };
+
+    // 24-bit sample in 3 bytes, stored as is in stream byte order
+    struct PackedSample24 {
+        std::uint8_t bytes[3];
+
+        bool operator==(const PackedSample24& other) const = default;
+    };
+
+    static_assert(sizeof(PackedSample24) == 3, "packed sample must have no padding");
+
+    // G.711 companding tables, generated at compile time in converter.cpp;
+    // encode tables are indexed by top 13 (A-law) or 14 (mu-law) bits of s16 sample
+    extern const std::array<std::int16_t, 256> ALawDecodeTable;
+    extern const std::array<std::int16_t, 256> ULawDecodeTable;
+    extern const std::array<std::uint8_t, 1 << 13> ALawEncodeTable;
+    extern const std::array<std::uint8_t, 1 << 14> ULawEncodeTable;
+
+    // Compile-time description of sample format: storage, byte order
+    // and scales between format range and base (int32) samples.
+    template<ESampleType Format>
+    struct SampleTraits;
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::UNSIGNED_8> {
+        using StorageType = std::uint8_t;
+        static constexpr std::size_t width = sizeof(StorageType);
+        static constexpr std::endian endianness = std::endian::native;
+        static constexpr ESampleEncoding encoding = ESampleEncoding::UNSIGNED;
+        static constexpr std::size_t bits = 8;
+        static constexpr std::int64_t positiveScale = ((std::int64_t) INT32_MAX - INT32_MIN) / UINT8_MAX;
+        static constexpr std::int64_t negativeScale = positiveScale;
+    };
+
+    // signed integer samples with Bits significant bits in the lowest
+    // bits of StorageType, scaled to base range as in 16-bit case
+    template<typename Storage, std::size_t Bits, std::endian Endianness>
+    struct SignedTraits {
+        using StorageType = Storage;
+        static constexpr std::size_t width = sizeof(StorageType);
+        static constexpr std::endian endianness = Endianness;
+        static constexpr ESampleEncoding encoding = ESampleEncoding::SIGNED;
+        static constexpr std::size_t bits = Bits;
+        static constexpr std::int32_t positiveScale = INT32_MAX / ((std::int64_t(1) << (Bits - 1)) - 1);
+        static constexpr std::int32_t negativeScale = INT32_MIN / -(std::int64_t(1) << (Bits - 1));
+    };
+
+    template<std::endian Endianness>
+    using Signed16Traits = SignedTraits<std::uint16_t, 16, Endianness>;
+
+    template<std::endian Endianness>
+    using Signed24Traits = SignedTraits<PackedSample24, 24, Endianness>;
+
+    template<std::endian Endianness>
+    using Signed24In32Traits = SignedTraits<std::uint32_t, 24, Endianness>;
+
+    template<std::endian Endianness>
+    using Signed32Traits = SignedTraits<std::uint32_t, 32, Endianness>;
+
+    // companded 8-bit samples expand to 16-bit ones, scaled as such
+    template<ESampleEncoding Encoding>
+    struct CompandedTraits {
+        using StorageType = std::uint8_t;
+        static constexpr std::size_t width = sizeof(StorageType);
+        static constexpr std::endian endianness = std::endian::native;
+        static constexpr ESampleEncoding encoding = Encoding;
+        static constexpr std::size_t bits = 16;
+        static constexpr std::int32_t positiveScale = INT32_MAX / INT16_MAX;
+        static constexpr std::int32_t negativeScale = INT32_MIN / INT16_MIN;
+    };
+
+    template<std::endian Endianness>
+    struct Float32Traits {
+        using StorageType = std::uint32_t;
+        static constexpr std::size_t width = sizeof(StorageType);
+        static constexpr std::endian endianness = Endianness;
+        static constexpr ESampleEncoding encoding = ESampleEncoding::FLOAT;
+        static constexpr std::size_t bits = 32;
+        static constexpr double positiveScale = INT32_MAX;
+        static constexpr double negativeScale = -(double) INT32_MIN;
+    };
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::UNSIGNED_8_ALAW>
+        : CompandedTraits<ESampleEncoding::ALAW> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::UNSIGNED_8_ULAW>
+        : CompandedTraits<ESampleEncoding::ULAW> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_16_LITTLE_ENDIAN>
+        : Signed16Traits<std::endian::little> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_16_BIG_ENDIAN>
+        : Signed16Traits<std::endian::big> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_32_LITTLE_ENDIAN>
+        : Signed32Traits<std::endian::little> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_32_BIG_ENDIAN>
+        : Signed32Traits<std::endian::big> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_24_LITTLE_ENDIAN>
+        : Signed24Traits<std::endian::little> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_24_BIG_ENDIAN>
+        : Signed24Traits<std::endian::big> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_24_LSB_LITTLE_ENDIAN>
+        : Signed24In32Traits<std::endian::little> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_24_LSB_BIG_ENDIAN>
+        : Signed24In32Traits<std::endian::big> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::FLOAT_32_LITTLE_ENDIAN>
+        : Float32Traits<std::endian::little> {};
+
+    template<>
+    struct SampleTraits<NSound::NCommon::TStreamConfiguration::TSampleSpecification::FLOAT_32_BIG_ENDIAN>
+        : Float32Traits<std::endian::big> {};
+
+    // Per-sample encoding and decoding, generated from traits. Everything
+    // is resolved at compile time, so loops over these inline and vectorize.
+    template<ESampleType Format>
+    struct SampleCodec {
+        using Traits = SampleTraits<Format>;
+        using StorageType = typename Traits::StorageType;
+
+        static std::int32_t decode(StorageType raw) noexcept {
+            if constexpr (Traits::encoding == ESampleEncoding::UNSIGNED) {
+                return (std::int64_t) raw * Traits::positiveScale + INT32_MIN;
+            } else if constexpr (Traits::encoding == ESampleEncoding::SIGNED) {
+                return scale(signExtend(load(raw)));
+            } else if constexpr (Traits::encoding == ESampleEncoding::ALAW) {
+                return scale(ALawDecodeTable[raw]);
+            } else if constexpr (Traits::encoding == ESampleEncoding::ULAW) {
+                return scale(ULawDecodeTable[raw]);
+            } else {
+                float sample;
+                std::uint32_t bits = load(raw);
+                std::memcpy(&sample, &bits, sizeof(sample));
+                // double keeps enough precision for 32-bit samples and, unlike
+                // long double, has vector instructions; out of range values are clipped
+                double scaled = (double) sample * ((sample > 0) ? Traits::positiveScale : Traits::negativeScale);
+                scaled = (scaled < (double) INT32_MAX) ? scaled : (double) INT32_MAX;
+                scaled = (scaled > (double) INT32_MIN) ? scaled : (double) INT32_MIN;
+                return static_cast<std::int32_t>(scaled);
+            }
+        }
+
+        static StorageType encode(std::int32_t sample) noexcept {
+            if constexpr (Traits::encoding == ESampleEncoding::UNSIGNED) {
+                return ((std::int64_t) sample - INT32_MIN) / Traits::positiveScale;
+            } else if constexpr (Traits::encoding == ESampleEncoding::SIGNED) {
+                return store(static_cast<std::uint32_t>(unscale(sample)));
+            } else if constexpr (Traits::encoding == ESampleEncoding::ALAW) {
+                return ALawEncodeTable[static_cast<std::uint16_t>(unscale(sample)) >> 3];
+            } else if constexpr (Traits::encoding == ESampleEncoding::ULAW) {
+                return ULawEncodeTable[static_cast<std::uint16_t>(unscale(sample)) >> 2];
+            } else {
+                float floating = (sample > 0) ? ((float) sample / INT32_MAX) : ((float) sample / INT32_MIN * -1);
+                std::uint32_t bits;
+                std::memcpy(&bits, &floating, sizeof(bits));
+                return store(bits);
+            }
+        }
+
+    private:
+        static std::int32_t scale(std::int32_t sample) noexcept {
+            return (sample > 0) ? (sample * Traits::positiveScale) : (sample * Traits::negativeScale);
+        }
+
+        static std::int32_t unscale(std::int32_t sample) noexcept {
+            return (sample > 0) ? (sample / Traits::positiveScale) : (sample / Traits::negativeScale);
+        }
+
+        static std::int32_t signExtend(std::uint32_t bits) noexcept {
+            constexpr std::size_t shift = 32 - Traits::bits;
+            return static_cast<std::int32_t>(bits << shift) >> shift;
+        }
+
+        // storage in stream byte order to native integer, and back
+        static std::uint32_t load(StorageType raw) noexcept {
+            if constexpr (std::is_same_v<StorageType, PackedSample24>) {
+                if constexpr (Traits::endianness == std::endian::little) {
+                    return raw.bytes[0] | (raw.bytes[1] << 8) | (raw.bytes[2] << 16);
+                } else {
+                    return raw.bytes[2] | (raw.bytes[1] << 8) | (raw.bytes[0] << 16);
+                }
+            } else if constexpr (sizeof(StorageType) == 1 || Traits::endianness == std::endian::native) {
+                return raw;
+            } else if constexpr (sizeof(StorageType) == 2) {
+                return absl::gbswap_16(raw);
+            } else {
+                return absl::gbswap_32(raw);
+            }
+        }
+
+        static StorageType store(std::uint32_t bits) noexcept {
+            if constexpr (std::is_same_v<StorageType, PackedSample24>) {
+                if constexpr (Traits::endianness == std::endian::little) {
+                    return PackedSample24{{
+                        static_cast<std::uint8_t>(bits), static_cast<std::uint8_t>(bits >> 8), static_cast<std::uint8_t>(bits >> 16)}};
+                } else {
+                    return PackedSample24{{
+                        static_cast<std::uint8_t>(bits >> 16), static_cast<std::uint8_t>(bits >> 8), static_cast<std::uint8_t>(bits)}};
+                }
+            } else if constexpr (sizeof(StorageType) == 1 || Traits::endianness == std::endian::native) {
+                return static_cast<StorageType>(bits);
+            } else if constexpr (sizeof(StorageType) == 2) {
+                return absl::gbswap_16(static_cast<StorageType>(bits));
+            } else {
+                return absl::gbswap_32(bits);
+            }
+        }
+    };
+
+}
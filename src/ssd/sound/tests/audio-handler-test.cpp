@@ -0,0 +1,41 @@
+// GTest
+#include <gtest/gtest.h>
+
+// json
+#include <nlohmann/json.hpp>
+
+// laar
+#include <src/ssd/sound/audio-handler.hpp>
+#include <src/ssd/sound/dispatchers/bass-router-dispatcher.hpp>
+
+using ECrossover = laar::BassRouterDispatcher::ECrossover;
+
+TEST(SoundHandlerTest, ParsesBassRoutingSettings) {
+    auto config = nlohmann::json::parse(R"({
+        "fftwWisdomPath": "/var/lib/ssd/fftw.wisdom",
+        "bassRouting": {"crossover": "linkwitz-riley", "fftSize": 2048}
+    })");
+
+    auto settings = laar::SoundHandler::parseSettings(config, {});
+    EXPECT_EQ(settings.wisdomPath, "/var/lib/ssd/fftw.wisdom");
+    EXPECT_EQ(settings.bassRouting.crossover, ECrossover::LINKWITZ_RILEY);
+    EXPECT_EQ(settings.bassRouting.fftSize, 2048u);
+}
+
+TEST(SoundHandlerTest, KeepsBassRoutingOnInvalidSettings) {
+    laar::SoundHandler::Settings previous {};
+    previous.bassRouting.crossover = ECrossover::BLOCK;
+
+    auto config = nlohmann::json::parse(R"({"bassRouting": {"crossover": "brickwall"}})");
+    auto settings = laar::SoundHandler::parseSettings(config, previous);
+    EXPECT_EQ(settings.bassRouting.crossover, ECrossover::BLOCK);
+    EXPECT_TRUE(settings.wisdomPath.empty());
+}
+
+TEST(SoundHandlerTest, BassRoutingIsOptIn) {
+    auto defaulted = laar::SoundHandler::parseSettings(nlohmann::json::object(), {});
+    EXPECT_FALSE(defaulted.isBassRoutingEnabled);
+
+    auto enabled = laar::SoundHandler::parseSettings(nlohmann::json::parse(R"({"isBassRoutingEnabled": true})"), {});
+    EXPECT_TRUE(enabled.isBassRoutingEnabled);
+}
@@ -0,0 +1,76 @@
+// GTest
+#include <gtest/gtest.h>
+
+// json
+#include <nlohmann/json.hpp>
+
+// laar
+#include <src/ssd/sound/buffer-limits.hpp>
+
+// proto
+#include <protos/common/stream-configuration.pb.h>
+
+namespace {
+
+    NSound::NCommon::TStreamConfiguration makeConfig(std::uint32_t rate, std::uint32_t channels) {
+        NSound::NCommon::TStreamConfiguration config;
+        config.mutable_sample_spec()->set_sample_rate(rate);
+        config.mutable_sample_spec()->set_channels(channels);
+        return config;
+    }
+
+}
+
+TEST(BufferLimitsTest, DefaultsFillMissingSizes) {
+    auto config = makeConfig(48000, 2);
+    auto negotiated = laar::BufferLimits{}.negotiate(config);
+
+    // 250 ms of stereo, requests are a quarter of it
+    EXPECT_EQ(negotiated.size(), 12000u * 2);
+    EXPECT_EQ(negotiated.min_request_size(), 3000u * 2);
+    EXPECT_EQ(negotiated.fragment_size(), 3000u * 2);
+    EXPECT_EQ(negotiated.prebuffing_size(), 0u);
+}
+
+TEST(BufferLimitsTest, ClampsRequestsToLimits) {
+    laar::BufferLimits limits{ .minMs = 10, .defaultMs = 100, .maxMs = 1000 };
+
+    auto huge = makeConfig(44100, 2);
+    huge.mutable_buffer_config()->set_size(44100 * 2 * 120);
+    huge.mutable_buffer_config()->set_prebuffing_size(44100 * 2 * 120);
+    huge.mutable_buffer_config()->set_min_request_size(44100 * 2 * 120);
+    auto negotiated = limits.negotiate(huge);
+    EXPECT_EQ(negotiated.size(), 44100u * 2);
+    EXPECT_EQ(negotiated.prebuffing_size(), 44100u * 2);
+    EXPECT_EQ(negotiated.min_request_size(), 22050u * 2);
+
+    auto tiny = makeConfig(44100, 2);
+    tiny.mutable_buffer_config()->set_size(3);
+    EXPECT_EQ(limits.negotiate(tiny).size(), 441u * 2);
+}
+
+TEST(BufferLimitsTest, KeepsWholeFrames) {
+    auto config = makeConfig(48000, 3);
+    config.mutable_buffer_config()->set_size(3 * 4000 + 2);
+    config.mutable_buffer_config()->set_min_request_size(3 * 100 + 1);
+
+    auto negotiated = laar::BufferLimits{}.negotiate(config);
+    EXPECT_EQ(negotiated.size(), 3u * 4000);
+    EXPECT_EQ(negotiated.min_request_size(), 3u * 100);
+}
+
+TEST(BufferLimitsTest, Parse) {
+    auto defaults = laar::BufferLimits::parse(nlohmann::json::object());
+    ASSERT_TRUE(defaults.ok());
+    EXPECT_EQ(defaults->defaultMs, 250u);
+
+    auto parsed = laar::BufferLimits::parse(nlohmann::json::parse(R"({"streamBuffer": {"min": 5, "max": 400}})"));
+    ASSERT_TRUE(parsed.ok()) << parsed.status().message();
+    EXPECT_EQ(parsed->minMs, 5u);
+    EXPECT_EQ(parsed->defaultMs, 250u);
+    EXPECT_EQ(parsed->maxMs, 400u);
+
+    EXPECT_FALSE(laar::BufferLimits::parse(nlohmann::json::parse(R"({"streamBuffer": {"default": 5000}})")).ok());
+    EXPECT_FALSE(laar::BufferLimits::parse(nlohmann::json::parse(R"({"streamBuffer": {"min": 0}})")).ok());
+    EXPECT_FALSE(laar::BufferLimits::parse(nlohmann::json::parse(R"({"streamBuffer": []})")).ok());
+}
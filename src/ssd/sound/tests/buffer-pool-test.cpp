@@ -0,0 +1,109 @@
+// GTest
+#include <gtest/gtest.h>
+
+// json
+#include <nlohmann/json.hpp>
+
+// standard
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+
+// laar
+#include <src/ssd/sound/buffer-pool.hpp>
+#include <src/ssd/sound/ring-buffer.hpp>
+
+namespace {
+
+    std::shared_ptr<laar::BufferPool> makePool(std::size_t blocks) {
+        // huge pages are rarely reserved on test machines, pool falls back anyway
+        auto pool = laar::BufferPool::create({ .blocks = blocks, .minBlock = 64, .maxBlock = 4096, .hugePages = false });
+        EXPECT_TRUE(pool.ok()) << pool.status().message();
+        return pool.value();
+    }
+
+}
+
+TEST(BufferPoolTest, RecyclesBlocks) {
+    auto pool = makePool(2);
+    EXPECT_EQ(pool->collectStats().blocks, 7u * 2);
+
+    void* first = pool->allocate(1000, 8);
+    void* second = pool->allocate(1024, 64);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(second) % 1024, 0u);
+    EXPECT_EQ(pool->collectStats().used, 2u);
+
+    // released block is handed out again
+    pool->deallocate(first, 1000, 8);
+    EXPECT_EQ(pool->allocate(900, 8), first);
+
+    pool->deallocate(first, 900, 8);
+    pool->deallocate(second, 1024, 64);
+    auto stats = pool->collectStats();
+    EXPECT_EQ(stats.used, 0u);
+    EXPECT_EQ(stats.peak, 2u);
+    EXPECT_EQ(stats.misses, 0u);
+}
+
+TEST(BufferPoolTest, FallsBackToHeap) {
+    auto pool = makePool(1);
+
+    // too large for any class, then class exhausted
+    void* large = pool->allocate(8192, 8);
+    void* block = pool->allocate(100, 8);
+    void* spilled = pool->allocate(100, 8);
+    auto stats = pool->collectStats();
+    EXPECT_EQ(stats.used, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+
+    pool->deallocate(large, 8192, 8);
+    pool->deallocate(spilled, 100, 8);
+    pool->deallocate(block, 100, 8);
+    stats = pool->collectStats();
+    EXPECT_EQ(stats.used, 0u);
+    EXPECT_EQ(stats.misses, 0u);
+}
+
+TEST(BufferPoolTest, BacksBuffersAndObjects) {
+    auto pool = makePool(1);
+    {
+        laar::SPSCRingBuffer buffer(1000, pool);
+        std::vector<char> in(1024), out(1024);
+        std::iota(in.begin(), in.end(), 0);
+        ASSERT_EQ(buffer.write(in.data(), in.size()), in.size());
+        ASSERT_EQ(buffer.read(out.data(), out.size()), out.size());
+        EXPECT_EQ(in, out);
+
+        auto object = std::allocate_shared<std::vector<int>>(laar::PoolAllocator<std::vector<int>>(pool), 3, 7);
+        EXPECT_EQ(*object, std::vector<int>(3, 7));
+        EXPECT_EQ(pool->collectStats().used, 2u);
+    }
+    EXPECT_EQ(pool->collectStats().used, 0u);
+
+    // allocations keep pool alive
+    auto object = std::allocate_shared<int>(laar::PoolAllocator<int>(pool), 5);
+    std::weak_ptr<laar::BufferPool> weak = pool;
+    pool.reset();
+    EXPECT_FALSE(weak.expired());
+    object.reset();
+    EXPECT_TRUE(weak.expired());
+}
+
+TEST(BufferPoolTest, ParseSettings) {
+    auto defaults = laar::BufferPool::parseSettings(nlohmann::json::object());
+    ASSERT_TRUE(defaults.ok());
+    EXPECT_EQ(defaults->blocks, 8u);
+
+    auto parsed = laar::BufferPool::parseSettings(nlohmann::json::parse(R"({"streamPool": {"blocks": 4, "maxBlock": 65536, "hugePages": false}})"));
+    ASSERT_TRUE(parsed.ok()) << parsed.status().message();
+    EXPECT_EQ(parsed->blocks, 4u);
+    EXPECT_EQ(parsed->maxBlock, 65536u);
+    EXPECT_FALSE(parsed->hugePages);
+
+    EXPECT_FALSE(laar::BufferPool::parseSettings(nlohmann::json::parse(R"({"streamPool": {"minBlock": 1000}})")).ok());
+    EXPECT_FALSE(laar::BufferPool::parseSettings(nlohmann::json::parse(R"({"streamPool": {"minBlock": 4096, "maxBlock": 1024}})")).ok());
+    EXPECT_FALSE(laar::BufferPool::parseSettings(nlohmann::json::parse(R"({"streamPool": 1})")).ok());
+}
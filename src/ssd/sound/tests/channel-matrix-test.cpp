@@ -0,0 +1,131 @@
+// GTest
+#include <gtest/gtest.h>
+
+// standard
+#include <cmath>
+#include <cstddef>
+
+// laar
+#include <src/ssd/sound/channel-matrix.hpp>
+
+// protos
+#include <protos/common/stream-configuration.pb.h>
+
+using TStreamConfiguration = NSound::NCommon::TStreamConfiguration;
+using TChannelMap = TStreamConfiguration::TChannelMap;
+
+namespace {
+
+    TStreamConfiguration makeConfig(std::initializer_list<TChannelMap::TLabeledPosition> positions) {
+        TStreamConfiguration config;
+        config.mutable_sample_spec()->set_channels(positions.size());
+        for (auto position : positions) {
+            config.mutable_channel_map()->add_mapped_channel()->set_position(position);
+        }
+        return config;
+    }
+
+}
+
+TEST(ChannelMatrixTest, LayoutFromConfig) {
+    TStreamConfiguration config;
+    config.mutable_sample_spec()->set_channels(6);
+    auto defaulted = laar::ChannelLayout::fromConfig(config);
+    ASSERT_TRUE(defaulted.ok()) << defaulted.status().message();
+    EXPECT_EQ(defaulted->toString(), "LEFT RIGHT REAR_LEFT REAR_RIGHT CENTER LFE");
+
+    auto mapped = laar::ChannelLayout::fromConfig(makeConfig({TChannelMap::RIGHT, TChannelMap::LEFT}));
+    ASSERT_TRUE(mapped.ok());
+    EXPECT_EQ(mapped->find(laar::ChannelLayout::Position::labeled(TChannelMap::LEFT)), 1);
+
+    // map must cover every channel exactly once
+    config.mutable_channel_map()->add_mapped_channel()->set_position(TChannelMap::LEFT);
+    EXPECT_FALSE(laar::ChannelLayout::fromConfig(config).ok());
+    EXPECT_FALSE(laar::ChannelLayout::fromConfig(makeConfig({TChannelMap::LEFT, TChannelMap::LEFT})).ok());
+    EXPECT_FALSE(laar::ChannelLayout::byCount(0).ok());
+    EXPECT_FALSE(laar::ChannelLayout::byCount(laar::ChannelLayout::MaxChannels + 1).ok());
+
+    TChannelMap map;
+    mapped->toConfig(&map);
+    ASSERT_EQ(map.mapped_channel_size(), 2);
+    EXPECT_EQ(map.mapped_channel(0).position(), TChannelMap::RIGHT);
+}
+
+TEST(ChannelMatrixTest, MonoIsSpreadOverFront) {
+    auto mono = laar::ChannelLayout::byCount(1);
+    auto stereo = laar::ChannelLayout::byCount(2);
+    auto surround = laar::ChannelLayout::byCount(6);
+
+    // mono clients keep their level on stereo devices
+    auto toStereo = laar::ChannelMatrix::create(*mono, *stereo);
+    EXPECT_FLOAT_EQ(toStereo.gain(0, 0), 1.f);
+    EXPECT_FLOAT_EQ(toStereo.gain(0, 1), 1.f);
+
+    // and go to center speaker when there is one
+    auto toSurround = laar::ChannelMatrix::create(*mono, *surround);
+    EXPECT_EQ(toSurround.entries().size(), 1);
+    EXPECT_FLOAT_EQ(toSurround.gain(0, 4), 1.f);
+}
+
+TEST(ChannelMatrixTest, SurroundIsFoldedDown) {
+    auto stereo = laar::ChannelLayout::byCount(2);
+    auto surround = laar::ChannelLayout::byCount(8);
+    auto mono = laar::ChannelLayout::byCount(1);
+
+    // FL FR RL RR FC LFE SL SR
+    auto toStereo = laar::ChannelMatrix::create(*surround, *stereo);
+    EXPECT_EQ(toStereo.inputs(), 8);
+    EXPECT_EQ(toStereo.outputs(), 2);
+    EXPECT_FLOAT_EQ(toStereo.gain(0, 0), 1.f);
+    EXPECT_FLOAT_EQ(toStereo.gain(0, 1), 0.f);
+    EXPECT_FLOAT_EQ(toStereo.gain(2, 0), M_SQRT1_2);
+    EXPECT_FLOAT_EQ(toStereo.gain(3, 1), M_SQRT1_2);
+    EXPECT_FLOAT_EQ(toStereo.gain(4, 0), M_SQRT1_2);
+    EXPECT_FLOAT_EQ(toStereo.gain(4, 1), M_SQRT1_2);
+    EXPECT_FLOAT_EQ(toStereo.gain(5, 0), 0.f);
+    EXPECT_FLOAT_EQ(toStereo.gain(7, 1), M_SQRT1_2);
+
+    // side speakers fall back to rear ones before front
+    auto toQuad = laar::ChannelMatrix::create(*surround, *laar::ChannelLayout::byCount(4));
+    EXPECT_FLOAT_EQ(toQuad.gain(6, 2), 1.f);
+    EXPECT_FLOAT_EQ(toQuad.gain(6, 0), 0.f);
+
+    // mono device averages everything but lfe
+    auto toMono = laar::ChannelMatrix::create(*surround, *mono);
+    EXPECT_FLOAT_EQ(toMono.gain(0, 0), 1.f / 7);
+    EXPECT_FLOAT_EQ(toMono.gain(5, 0), 0.f);
+}
+
+TEST(ChannelMatrixTest, AuxChannelsAreNotDropped) {
+    auto aux = laar::ChannelLayout::byCount(3);
+    auto stereo = laar::ChannelLayout::byCount(2);
+    ASSERT_EQ(aux->toString(), "AUX0 AUX1 AUX2");
+
+    // outputs of same index take what they can, the rest is folded into front
+    auto toStereo = laar::ChannelMatrix::create(*aux, *stereo);
+    EXPECT_FLOAT_EQ(toStereo.gain(0, 0), 1.f);
+    EXPECT_FLOAT_EQ(toStereo.gain(0, 1), 0.f);
+    EXPECT_FLOAT_EQ(toStereo.gain(1, 1), 1.f);
+    EXPECT_FLOAT_EQ(toStereo.gain(2, 0), M_SQRT1_2);
+    EXPECT_FLOAT_EQ(toStereo.gain(2, 1), M_SQRT1_2);
+}
+
+TEST(ChannelMatrixTest, StereoPlaysOnAuxDevices) {
+    auto stereo = laar::ChannelLayout::byCount(2);
+
+    // first two aux outputs stand in for front speakers
+    for (std::size_t channels : {3u, 7u}) {
+        auto device = laar::ChannelLayout::byCount(channels);
+        auto matrix = laar::ChannelMatrix::create(*stereo, *device);
+        EXPECT_EQ(matrix.entries().size(), 2) << channels << " channels";
+        EXPECT_FLOAT_EQ(matrix.gain(0, 0), 1.f);
+        EXPECT_FLOAT_EQ(matrix.gain(1, 1), 1.f);
+        EXPECT_FLOAT_EQ(matrix.gain(0, 1), 0.f);
+    }
+
+    // lfe keeps its index, center is folded into front pair
+    auto toAux = laar::ChannelMatrix::create(*laar::ChannelLayout::byCount(6), *laar::ChannelLayout::byCount(7));
+    EXPECT_FLOAT_EQ(toAux.gain(5, 5), 1.f);
+    EXPECT_FLOAT_EQ(toAux.gain(4, 0), M_SQRT1_2);
+    EXPECT_FLOAT_EQ(toAux.gain(4, 1), M_SQRT1_2);
+}
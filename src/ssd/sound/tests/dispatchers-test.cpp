@@ -7,7 +7,13 @@
 #include <memory>
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 #include <climits>
+#include <utility>
+#include <algorithm>
+
+// json
+#include <nlohmann/json.hpp>
 
 // laar
 #include <src/ssd/sound/interfaces/i-audio-handler.hpp>
@@ -43,8 +49,8 @@ TEST(DispatcherTest, TestChannelIteratorInterleaved) {
     constexpr std::size_t channels = 3;
 
     auto in = std::make_unique<std::int32_t[]>(samples * channels);
-    auto wrapper = laar::StreamWrapper<std::int32_t>(
-        samples, channels, laar::ESamplesOrder::INTERLEAVED, in.get()
+    auto wrapper = laar::StreamWrapper<std::int32_t, laar::ESamplesOrder::INTERLEAVED>(
+        samples, channels, in.get()
     );
 
     for (std::size_t channel = 0; channel < channels; ++channel) {
@@ -70,8 +76,8 @@ TEST(DispatcherTest, TestChannelIteratorNoninterleaved) {
     constexpr std::size_t channels = 3;
 
     auto in = std::make_unique<std::int32_t[]>(samples * channels);
-    auto wrapper = laar::StreamWrapper<std::int32_t>(
-        samples, channels, laar::ESamplesOrder::NONINTERLEAVED, in.get()
+    auto wrapper = laar::StreamWrapper<std::int32_t, laar::ESamplesOrder::NONINTERLEAVED>(
+        samples, channels, in.get()
     );
 
     for (std::size_t channel = 0; channel < channels; ++channel) {
@@ -92,6 +98,46 @@ TEST(DispatcherTest, TestChannelIteratorNoninterleaved) {
         << arrayToString(in.get(), samples * channels);
 }
 
+TEST(DispatcherTest, TestChannelIteratorRandomAccess) {
+    constexpr std::size_t samples = 20;
+    constexpr std::size_t channels = 3;
+
+    std::vector<std::int32_t> in (samples * channels);
+    for (std::size_t i = 0; i < in.size(); ++i) {
+        in[i] = i;
+    }
+
+    auto wrapper = laar::StreamWrapper<std::int32_t, laar::ESamplesOrder::INTERLEAVED>(
+        samples, channels, in.data()
+    );
+
+    auto begin = wrapper.begin(1);
+    auto end = wrapper.end(1);
+    EXPECT_EQ(end - begin, static_cast<std::ptrdiff_t>(samples));
+    EXPECT_EQ(begin[5], static_cast<std::int32_t>(5 * channels + 1));
+    EXPECT_EQ(*(begin + 7), static_cast<std::int32_t>(7 * channels + 1));
+    EXPECT_EQ(*(end - 1), static_cast<std::int32_t>((samples - 1) * channels + 1));
+    EXPECT_TRUE(begin < end);
+
+    // postfix returns previous position by value
+    auto current = begin;
+    auto previous = current++;
+    EXPECT_EQ(previous, begin);
+    EXPECT_EQ(current - previous, 1);
+
+    // standard algorithms see channel as a plain range
+    std::reverse(begin, end);
+    for (std::size_t sample = 0; sample < samples; ++sample) {
+        EXPECT_EQ(in[sample * channels + 1], static_cast<std::int32_t>((samples - 1 - sample) * channels + 1));
+        EXPECT_EQ(in[sample * channels], static_cast<std::int32_t>(sample * channels));
+    }
+
+    auto constWrapper = laar::StreamWrapper<const std::int32_t, laar::ESamplesOrder::NONINTERLEAVED>(
+        samples, channels, in.data()
+    );
+    EXPECT_EQ(*std::max_element(constWrapper.begin(2), constWrapper.end(2)), static_cast<std::int32_t>(3 * samples - 1));
+}
+
 TEST(DispatcherTest, TestOneToMany) {
     constexpr std::size_t channels = 4;
     auto dispatcherOneToMany = laar::TubeDispatcher::create(
@@ -113,8 +159,8 @@ TEST(DispatcherTest, TestOneToMany) {
     auto status = dispatcherOneToMany->dispatch(in.get(), out.get(), samples);
     EXPECT_TRUE(status.ok()) << "error while dispatching stream: " << status.message();
 
-    auto wrapper = laar::StreamWrapper<std::int32_t>(
-        samples, channels, laar::ESamplesOrder::NONINTERLEAVED, out.get()
+    auto wrapper = laar::StreamWrapper<std::int32_t, laar::ESamplesOrder::NONINTERLEAVED>(
+        samples, channels, out.get()
     );
 
     bool check = true;
@@ -150,8 +196,8 @@ TEST(DispatcherTest, TestManyToOne) {
     auto status = dispatcherManyToOne->dispatch(in.get(), out.get(), samples);
     EXPECT_TRUE(status.ok()) << "error while dispatching stream: " << status.message();
 
-    auto wrapper = laar::StreamWrapper<std::int32_t>(
-        samples, 1, laar::ESamplesOrder::NONINTERLEAVED, out.get()
+    auto wrapper = laar::StreamWrapper<std::int32_t, laar::ESamplesOrder::NONINTERLEAVED>(
+        samples, 1, out.get()
     );
 
     bool check = true;
@@ -173,6 +219,7 @@ TEST(DispatcherTest, TestBassRouting) {
         laar::BassRouterDispatcher::BassRange(20, 250),
         channelInfo
     );
+    ASSERT_TRUE(bassRouteDispatcher->configure({ .crossover = laar::BassRouterDispatcher::ECrossover::BLOCK }).ok());
 
     // create arrays
     constexpr std::size_t samples = 20;
@@ -188,8 +235,8 @@ TEST(DispatcherTest, TestBassRouting) {
     auto status = bassRouteDispatcher->dispatch(in.get(), out.get(), samples);
     EXPECT_TRUE(status.ok()) << "error while dispatching stream: " << status.message();
 
-    auto outWrapper = laar::StreamWrapper<std::int32_t>(
-        samples, 2, laar::ESamplesOrder::NONINTERLEAVED, out.get()
+    auto outWrapper = laar::StreamWrapper<std::int32_t, laar::ESamplesOrder::NONINTERLEAVED>(
+        samples, 2, out.get()
     );
 
     // output should be either: original - silent or silent - original
@@ -236,4 +283,155 @@ TEST(DispatcherTest, TestBassRouting) {
         )
     }
 
-}
\ No newline at end of file
+}
+
+TEST(DispatcherTest, TestBassRoutingReusesPlans) {
+    laar::BassRouterDispatcher::ChannelInfo channelInfo (0, 1);
+    auto bassRouteDispatcher = laar::BassRouterDispatcher::create(
+        laar::ESamplesOrder::NONINTERLEAVED,
+        NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_32_LITTLE_ENDIAN,
+        44100,
+        laar::BassRouterDispatcher::BassRange(20, 250),
+        channelInfo
+    );
+    ASSERT_TRUE(bassRouteDispatcher->configure({ .crossover = laar::BassRouterDispatcher::ECrossover::BLOCK }).ok());
+
+    constexpr std::size_t samples = 1024;
+    ASSERT_TRUE(bassRouteDispatcher->prepare(samples).ok());
+    EXPECT_FALSE(bassRouteDispatcher->prepare(0).ok());
+
+    // 100 Hz and 5 kHz tones, they must end up on separate channels
+    auto in = std::make_unique<std::int32_t[]>(samples);
+    for (std::size_t i = 0; i < samples; ++i) {
+        in[i] = static_cast<std::int32_t>(
+            1e8 * std::sin(2 * M_PI * 100 * i / 44100) + 1e8 * std::sin(2 * M_PI * 5000 * i / 44100)
+        );
+    }
+
+    // same block size twice, then another one: cached plan must not leak state
+    auto first = std::make_unique<std::int32_t[]>(samples * 2);
+    auto second = std::make_unique<std::int32_t[]>(samples * 2);
+    auto shorter = std::make_unique<std::int32_t[]>(samples);
+    ASSERT_TRUE(bassRouteDispatcher->dispatch(in.get(), first.get(), samples).ok());
+    ASSERT_TRUE(bassRouteDispatcher->dispatch(in.get(), shorter.get(), samples / 2).ok());
+    ASSERT_TRUE(bassRouteDispatcher->dispatch(in.get(), second.get(), samples).ok());
+
+    double bassEnergy = 0;
+    double normalEnergy = 0;
+    for (std::size_t i = 0; i < samples * 2; ++i) {
+        EXPECT_EQ(first[i], second[i]) << "mismatch at sample " << i;
+    }
+    for (std::size_t i = 0; i < samples; ++i) {
+        // bands must sum back to original signal
+        EXPECT_NEAR(
+            static_cast<double>(first[channelInfo.bass * samples + i]) + first[channelInfo.normal * samples + i], 
+            in[i], 2
+        );
+        bassEnergy += std::pow(first[channelInfo.bass * samples + i], 2);
+        normalEnergy += std::pow(first[channelInfo.normal * samples + i], 2);
+    }
+
+    EXPECT_GT(bassEnergy, 0);
+    EXPECT_GT(normalEnergy, 0);
+}
+
+
+TEST(DispatcherTest, TestBassRoutingOverlapAdd) {
+    laar::BassRouterDispatcher::ChannelInfo channelInfo (0, 1);
+    auto bassRouteDispatcher = laar::BassRouterDispatcher::create(
+        laar::ESamplesOrder::NONINTERLEAVED,
+        NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_32_LITTLE_ENDIAN,
+        44100,
+        laar::BassRouterDispatcher::BassRange(20, 250),
+        channelInfo
+    );
+
+    EXPECT_FALSE(bassRouteDispatcher->configure({ .fftSize = 1000 }).ok());
+    ASSERT_TRUE(bassRouteDispatcher->configure({ .crossover = laar::BassRouterDispatcher::ECrossover::OVERLAP_ADD, .fftSize = 256 }).ok());
+    EXPECT_EQ(bassRouteDispatcher->latency(), 256);
+
+    constexpr std::size_t total = 4096;
+    std::vector<std::int32_t> in (total);
+    for (std::size_t i = 0; i < total; ++i) {
+        in[i] = static_cast<std::int32_t>(
+            1e8 * std::sin(2 * M_PI * 100 * i / 44100) + 1e8 * std::sin(2 * M_PI * 5000 * i / 44100)
+        );
+    }
+
+    // periods do not line up with hop on purpose
+    std::vector<std::int32_t> bass, normal;
+    for (std::size_t offset = 0, period = 77; offset < total; offset += period, period = 77 + (period * 7) % 300) {
+        std::size_t samples = std::min(period, total - offset);
+        std::vector<std::int32_t> out (samples * 2);
+        ASSERT_TRUE(bassRouteDispatcher->dispatch(in.data() + offset, out.data(), samples).ok());
+
+        bass.insert(bass.end(), out.begin() + channelInfo.bass * samples, out.begin() + (channelInfo.bass + 1) * samples);
+        normal.insert(normal.end(), out.begin() + channelInfo.normal * samples, out.begin() + (channelInfo.normal + 1) * samples);
+    }
+
+    // bands sum back to original delayed by latency, without seams on period boundaries
+    const std::size_t latency = bassRouteDispatcher->latency();
+    for (std::size_t i = 0; i < latency; ++i) {
+        EXPECT_EQ(bass[i] + normal[i], laar::Silence);
+    }
+    for (std::size_t i = latency; i < total; ++i) {
+        EXPECT_NEAR(static_cast<double>(bass[i]) + normal[i], in[i - latency], 2) << "at sample " << i;
+    }
+}
+
+TEST(DispatcherTest, TestBassRoutingLinkwitzRiley) {
+    laar::BassRouterDispatcher::ChannelInfo channelInfo (0, 1);
+    auto bassRouteDispatcher = laar::BassRouterDispatcher::create(
+        laar::ESamplesOrder::NONINTERLEAVED,
+        NSound::NCommon::TStreamConfiguration::TSampleSpecification::SIGNED_32_LITTLE_ENDIAN,
+        44100,
+        laar::BassRouterDispatcher::BassRange(20, 250),
+        channelInfo
+    );
+
+    ASSERT_TRUE(bassRouteDispatcher->configure({ .crossover = laar::BassRouterDispatcher::ECrossover::LINKWITZ_RILEY }).ok());
+    EXPECT_EQ(bassRouteDispatcher->latency(), 0);
+
+    // energy of each band for a tone, after filters settle
+    auto measure = [&](double frequency) {
+        constexpr std::size_t samples = 512;
+        std::vector<std::int32_t> in (samples);
+        std::vector<std::int32_t> out (samples * 2);
+        std::pair<double, double> energy;
+        for (std::size_t period = 0, phase = 0; period < 16; ++period) {
+            for (std::size_t i = 0; i < samples; ++i, ++phase) {
+                in[i] = static_cast<std::int32_t>(1e8 * std::sin(2 * M_PI * frequency * phase / 44100));
+            }
+            EXPECT_TRUE(bassRouteDispatcher->dispatch(in.data(), out.data(), samples).ok());
+        }
+        for (std::size_t i = 0; i < samples; ++i) {
+            energy.first += std::pow(out[channelInfo.bass * samples + i], 2);
+            energy.second += std::pow(out[channelInfo.normal * samples + i], 2);
+        }
+        return energy;
+    };
+
+    auto [lowBass, lowNormal] = measure(60);
+    EXPECT_GT(lowBass, 100 * lowNormal);
+
+    auto [highBass, highNormal] = measure(5000);
+    EXPECT_GT(highNormal, 100 * highBass);
+}
+
+TEST(DispatcherTest, TestBassRoutingSettings) {
+    auto settings = laar::BassRouterDispatcher::parseSettings(nlohmann::json::parse(R"({
+        "bassRouting": { "crossover": "linkwitz-riley", "fftSize": 512 }
+    })"));
+    ASSERT_TRUE(settings.ok()) << settings.status().message();
+    EXPECT_EQ(settings->crossover, laar::BassRouterDispatcher::ECrossover::LINKWITZ_RILEY);
+    EXPECT_EQ(settings->fftSize, 512);
+
+    EXPECT_FALSE(laar::BassRouterDispatcher::parseSettings(nlohmann::json::parse(R"({
+        "bassRouting": { "crossover": "brickwall" }
+    })")).ok());
+
+    EXPECT_EQ(
+        laar::BassRouterDispatcher::parseSettings(nlohmann::json::object())->crossover, 
+        laar::BassRouterDispatcher::ECrossover::OVERLAP_ADD
+    );
+}
@@ -0,0 +1,122 @@
+// GTest
+#include <gtest/gtest.h>
+
+// abseil
+#include <absl/status/status.h>
+
+// standard
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// laar
+#include <src/ssd/macros.hpp>
+#include <src/ssd/sound/dsp-stage.hpp>
+#include <src/ssd/sound/interfaces/i-dispatcher.hpp>
+
+namespace {
+
+    constexpr std::size_t frames = 256;
+    constexpr std::size_t channels = 2;
+
+    // negates signal on the second channel, optionally waiting before it
+    class FakeDispatcher : public laar::IDispatcher {
+    public:
+        absl::Status dispatch(void* in, void* out, std::size_t samples) override {
+            entered.fetch_add(1);
+            while (blocked.load()) {
+                std::this_thread::yield();
+            }
+
+            auto source = static_cast<const std::int32_t*>(in);
+            auto dest = static_cast<std::int32_t*>(out);
+            for (std::size_t i = 0; i < samples; ++i) {
+                dest[i] = source[i];
+                dest[samples + i] = -source[i];
+            }
+
+            calls.fetch_add(1);
+            return absl::OkStatus();
+        }
+
+        std::atomic<bool> blocked = false;
+        std::atomic<int> entered = 0;
+        std::atomic<int> calls = 0;
+    };
+
+    std::vector<std::int32_t> makePeriod(std::int32_t value) {
+        return std::vector<std::int32_t>(frames, value);
+    }
+
+    // waits until worker is done with everything handed over
+    void awaitCalls(const FakeDispatcher& dispatcher, int calls) {
+        while (dispatcher.calls.load() < calls) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+}
+
+TEST(DspStageTest, OutputLagsOnePeriod) {
+    auto dispatcher = std::make_shared<FakeDispatcher>();
+    auto stage = laar::DspStage::create(dispatcher, frames, channels);
+    ASSERT_EQ(stage->latency(), frames);
+
+    std::vector<std::int32_t> out(frames * channels);
+
+    // nothing was handed over yet, so first period is silent
+    stage->process(makePeriod(1).data(), out.data(), frames);
+    EXPECT_EQ(out, std::vector<std::int32_t>(frames * channels, laar::Silence));
+
+    for (std::int32_t period = 2; period < 10; ++period) {
+        awaitCalls(*dispatcher, period - 1);
+        stage->process(makePeriod(period).data(), out.data(), frames);
+
+        EXPECT_EQ(out[0], period - 1);
+        EXPECT_EQ(out[frames], -(period - 1));
+    }
+
+    auto stats = stage->collectStats();
+    EXPECT_EQ(stats.processed, 8);
+    EXPECT_EQ(stats.missed, 0);
+}
+
+TEST(DspStageTest, MissedDeadlinePlaysDry) {
+    auto dispatcher = std::make_shared<FakeDispatcher>();
+    auto stage = laar::DspStage::create(dispatcher, frames, channels);
+    std::vector<std::int32_t> out(frames * channels);
+
+    dispatcher->blocked = true;
+    stage->process(makePeriod(1).data(), out.data(), frames);
+    while (!dispatcher->entered.load()) {
+        std::this_thread::yield();
+    }
+    stage->process(makePeriod(2).data(), out.data(), frames);
+
+    // worker is stuck on the first period: dry mix of it goes to both channels
+    EXPECT_EQ(out[0], 1);
+    EXPECT_EQ(out[frames], 1);
+
+    stage->process(makePeriod(3).data(), out.data(), frames);
+    EXPECT_EQ(out[0], 2);
+    EXPECT_EQ(out[frames], 2);
+
+    // second period was dropped before worker took it, third was not handed over
+    dispatcher->blocked = false;
+    awaitCalls(*dispatcher, 1);
+    stage->process(makePeriod(4).data(), out.data(), frames);
+    EXPECT_EQ(out[0], 3);
+    EXPECT_EQ(out[frames], 3);
+
+    // pipeline recovers
+    awaitCalls(*dispatcher, 2);
+    stage->process(makePeriod(5).data(), out.data(), frames);
+    EXPECT_EQ(out[0], 4);
+    EXPECT_EQ(out[frames], -4);
+    EXPECT_EQ(dispatcher->calls, 2);
+    EXPECT_GE(stage->collectStats().missed, 2);
+}
@@ -0,0 +1,140 @@
+// GTest
+#include <gtest/gtest.h>
+
+// json
+#include <nlohmann/json.hpp>
+
+// standard
+#include <cmath>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+// laar
+#include <src/ssd/macros.hpp>
+#include <src/ssd/sound/mixer.hpp>
+#include <src/ssd/sound/channel-matrix.hpp>
+
+namespace {
+
+    constexpr std::size_t frames = 1001;
+
+    std::vector<std::int32_t> makeSine(std::int32_t amplitude) {
+        std::vector<std::int32_t> samples(frames);
+        for (std::size_t i = 0; i < frames; ++i) {
+            samples[i] = static_cast<std::int32_t>(amplitude * std::sin(2 * M_PI * i / 100));
+        }
+        return samples;
+    }
+
+}
+
+TEST(MixerTest, SilenceStaysSilent) {
+    laar::Mixer mixer;
+    mixer.reserve(frames);
+    std::vector<std::int32_t> silence(frames, laar::Silence);
+    std::vector<std::int32_t> out(frames, 1);
+
+    mixer.reset(frames);
+    mixer.mixdown(out.data(), frames);
+    EXPECT_TRUE(std::all_of(out.begin(), out.end(), [](auto sample) { return sample == laar::Silence; }));
+
+    mixer.reset(frames);
+    mixer.add(silence.data(), frames);
+    mixer.add(silence.data(), frames);
+    mixer.mixdown(out.data(), frames);
+    EXPECT_TRUE(std::all_of(out.begin(), out.end(), [](auto sample) { return sample == laar::Silence; }));
+}
+
+TEST(MixerTest, QuietStreamPassesThrough) {
+    laar::Mixer mixer;
+    mixer.reserve(frames);
+    ASSERT_TRUE(mixer.configure({.headroom = 0, .knee = 6}).ok());
+
+    // well below knee, so limiter must not touch it
+    auto in = makeSine(INT32_MAX / 4);
+    std::vector<std::int32_t> out(frames);
+
+    mixer.reset(frames);
+    mixer.add(in.data(), frames);
+    mixer.mixdown(out.data(), frames);
+    for (std::size_t i = 0; i < frames; ++i) {
+        EXPECT_NEAR(in[i], out[i], 1 << 8);
+    }
+}
+
+TEST(MixerTest, LoudStreamsAreLimited) {
+    laar::Mixer mixer;
+    mixer.reserve(frames);
+    ASSERT_TRUE(mixer.configure({.headroom = 0, .knee = 6}).ok());
+
+    auto in = makeSine(INT32_MAX);
+    std::vector<std::int32_t> out(frames);
+
+    mixer.reset(frames);
+    for (int stream = 0; stream < 8; ++stream) {
+        mixer.add(in.data(), frames);
+    }
+    mixer.mixdown(out.data(), frames);
+
+    for (std::size_t i = 0; i < frames; ++i) {
+        // no wrap around, sign and shape of signal are preserved
+        EXPECT_EQ(in[i] > 0, out[i] > 0) << "sample " << i;
+        EXPECT_LE(std::abs((std::int64_t) out[i]), std::abs((std::int64_t) in[i]) * 8);
+    }
+
+    // limiter is monotonic
+    for (std::size_t i = 1; i < 25; ++i) {
+        EXPECT_GE(out[i], out[i - 1]);
+    }
+}
+
+TEST(MixerTest, SettingsParsing) {
+    auto defaults = laar::Mixer::parseSettings(nlohmann::json::object());
+    ASSERT_TRUE(defaults.ok());
+    EXPECT_EQ(defaults->headroom, laar::Mixer::Settings().headroom);
+
+    auto parsed = laar::Mixer::parseSettings(nlohmann::json::parse(R"({"mixer": {"headroom": 1.5, "knee": 3}})"));
+    ASSERT_TRUE(parsed.ok());
+    EXPECT_FLOAT_EQ(parsed->headroom, 1.5);
+    EXPECT_FLOAT_EQ(parsed->knee, 3);
+
+    EXPECT_FALSE(laar::Mixer::parseSettings(nlohmann::json::parse(R"({"mixer": {"knee": "soft"}})")).ok());
+
+    laar::Mixer mixer;
+    mixer.reserve(frames);
+    EXPECT_FALSE(mixer.configure({.headroom = -1, .knee = 6}).ok());
+    EXPECT_FALSE(mixer.configure({.headroom = 0, .knee = 0}).ok());
+    EXPECT_FLOAT_EQ(mixer.settings().knee, laar::Mixer::Settings().knee);
+}
+
+TEST(MixerTest, StreamsAreRemixedOntoDeviceLayout) {
+    auto stereo = laar::ChannelLayout::byCount(2);
+    auto surround = laar::ChannelLayout::byCount(6);
+    ASSERT_TRUE(stereo.ok() && surround.ok());
+
+    laar::Mixer mixer;
+    mixer.reserve(frames, surround->size());
+    ASSERT_TRUE(mixer.configure({.headroom = 0, .knee = 6}).ok());
+
+    // stereo stream: left is a sine, right is silent
+    auto sine = makeSine(INT32_MAX / 4);
+    std::vector<std::int32_t> in(frames * 2, laar::Silence);
+    for (std::size_t i = 0; i < frames; ++i) {
+        in[i * 2] = sine[i];
+    }
+
+    std::vector<std::int32_t> out(frames * surround->size(), 1);
+    mixer.reset(frames);
+    mixer.add(in.data(), frames, laar::ChannelMatrix::create(*stereo, *surround));
+    mixer.mixdown(out.data(), frames);
+
+    // 5.1 layout is FL FR RL RR FC LFE, only front left carries signal
+    for (std::size_t i = 0; i < frames; ++i) {
+        EXPECT_NEAR(out[i], sine[i], 1 << 8);
+    }
+    for (std::size_t i = frames; i < out.size(); ++i) {
+        EXPECT_EQ(out[i], laar::Silence) << "sample " << i % frames << " of channel " << i / frames;
+    }
+}
@@ -0,0 +1,121 @@
+// GTest
+#include <gtest/gtest.h>
+
+// standard
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <cstddef>
+
+// laar
+#include <src/ssd/sound/rcu-snapshot.hpp>
+#include <src/ssd/sound/handle-registry.hpp>
+
+namespace {
+
+    std::atomic<int> aliveSnapshots = 0;
+
+    struct Snapshot {
+        explicit Snapshot(std::size_t version) : version(version) {
+            aliveSnapshots.fetch_add(1);
+        }
+
+        ~Snapshot() {
+            aliveSnapshots.fetch_sub(1);
+        }
+
+        std::size_t version;
+    };
+
+    struct FakeHandle {
+        bool isAlive() noexcept {
+            return alive.load();
+        }
+
+        std::atomic<bool> alive = true;
+    };
+
+}
+
+TEST(RcuSnapshotTest, ReaderSeesLatestSnapshot) {
+    {
+        laar::RcuSnapshot<Snapshot> cell;
+        EXPECT_EQ(cell.acquire(), nullptr);
+
+        cell.publish(std::make_unique<Snapshot>(1));
+        cell.publish(std::make_unique<Snapshot>(2));
+        // replaced pending snapshot is freed right away
+        EXPECT_EQ(aliveSnapshots, 1);
+
+        ASSERT_NE(cell.acquire(), nullptr);
+        EXPECT_EQ(cell.acquire()->version, 2);
+
+        cell.publish(std::make_unique<Snapshot>(3));
+        EXPECT_EQ(cell.acquire()->version, 3);
+        cell.publish(std::make_unique<Snapshot>(4));
+        EXPECT_EQ(cell.acquire()->version, 4);
+        // retired snapshot waits for writer
+        EXPECT_EQ(aliveSnapshots, 2);
+        cell.reclaim();
+        EXPECT_EQ(aliveSnapshots, 1);
+    }
+
+    EXPECT_EQ(aliveSnapshots, 0);
+}
+
+TEST(RcuSnapshotTest, ConcurrentPublishing) {
+    constexpr std::size_t versions = 1 << 14;
+
+    {
+        laar::RcuSnapshot<Snapshot> cell;
+        std::atomic<bool> done = false;
+
+        std::thread reader([&]() {
+            std::size_t last = 0;
+            while (!done.load() || last != versions) {
+                if (const Snapshot* snapshot = cell.acquire()) {
+                    // versions never go back
+                    ASSERT_GE(snapshot->version, last);
+                    last = snapshot->version;
+                }
+            }
+        });
+
+        for (std::size_t version = 1; version <= versions; ++version) {
+            cell.publish(std::make_unique<Snapshot>(version));
+        }
+        done.store(true);
+        reader.join();
+    }
+
+    EXPECT_EQ(aliveSnapshots, 0);
+}
+
+TEST(RcuSnapshotTest, RegistryReleasesDeadHandles) {
+    laar::HandleRegistry<FakeHandle> registry;
+    EXPECT_TRUE(registry.acquire().empty());
+
+    auto first = std::make_shared<FakeHandle>();
+    auto second = std::make_shared<FakeHandle>();
+    registry.add(first);
+    registry.add(second);
+    ASSERT_EQ(registry.acquire().size(), 2);
+    EXPECT_EQ(registry.sweep(), 0);
+
+    std::weak_ptr<FakeHandle> released = first;
+    first->alive = false;
+    first.reset();
+
+    // audio thread may still use the old list until it asks for a new one
+    EXPECT_EQ(registry.sweep(), 1);
+    EXPECT_FALSE(released.expired());
+
+    auto handles = registry.acquire();
+    ASSERT_EQ(handles.size(), 1);
+    EXPECT_EQ(handles[0], second);
+
+    registry.sweep();
+    EXPECT_TRUE(released.expired());
+    EXPECT_EQ(registry.size(), 1);
+}
@@ -0,0 +1,76 @@
+// GTest
+#include <gtest/gtest.h>
+
+// standard
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+// laar
+#include <src/ssd/sound/converter.hpp>
+#include <src/ssd/sound/resampler.hpp>
+#include <src/ssd/sound/read-handle.hpp>
+
+// proto
+#include <protos/common/stream-configuration.pb.h>
+
+namespace {
+
+    using ESamples = NSound::NCommon::TStreamConfiguration::TSampleSpecification;
+
+    std::shared_ptr<laar::ReadHandle> makeHandle(ESamples::TFormat format, std::size_t rate, std::size_t deviceRate) {
+        NSound::NCommon::TStreamConfiguration config;
+        config.set_direction(NSound::NCommon::TStreamConfiguration::RECORD);
+        config.mutable_sample_spec()->set_format(format);
+        config.mutable_sample_spec()->set_sample_rate(rate);
+        config.mutable_sample_spec()->set_channels(1);
+
+        auto resampler = laar::Resampler::create(deviceRate, rate, 1, laar::Resampler::EQuality::FAST);
+        EXPECT_TRUE(resampler.ok());
+        return std::make_shared<laar::ReadHandle>(std::move(config), std::move(resampler.value()), laar::BufferLimits{}, nullptr, std::weak_ptr<laar::ReadHandle::IListener>());
+    }
+
+}
+
+TEST(ReadHandleTest, ReturnsOnlyCapturedSamples) {
+    auto handle = makeHandle(ESamples::SIGNED_16_LITTLE_ENDIAN, 48000, 48000);
+    ASSERT_TRUE(handle->isAlive());
+
+    // device samples that survive conversion to 16 bit exactly
+    std::vector<std::int32_t> captured = {
+        laar::convertFromSigned16LE(std::uint16_t{1}), laar::convertFromSigned16LE(std::uint16_t{2}), laar::convertFromSigned16LE(std::uint16_t{3})
+    };
+    ASSERT_EQ(handle->write(captured.data(), captured.size()).value(), 3);
+
+    std::vector<std::int16_t> out(8, -1);
+    auto taken = handle->read(reinterpret_cast<char*>(out.data()), out.size());
+    ASSERT_TRUE(taken.ok()) << taken.status().message();
+    EXPECT_EQ(taken.value(), 3);
+    EXPECT_EQ(out, (std::vector<std::int16_t>{1, 2, 3, -1, -1, -1, -1, -1}));
+
+    // nothing captured since, nothing is made up
+    EXPECT_EQ(handle->read(reinterpret_cast<char*>(out.data()), out.size()).value(), 0);
+}
+
+TEST(ReadHandleTest, FlushDropsPendingCapture) {
+    auto handle = makeHandle(ESamples::SIGNED_32_LITTLE_ENDIAN, 44100, 48000);
+
+    std::vector<std::int32_t> captured(480, 1 << 20);
+    ASSERT_EQ(handle->write(captured.data(), captured.size()).value(), 480);
+    ASSERT_TRUE(handle->flush().ok());
+
+    std::vector<std::int32_t> out(480);
+    EXPECT_EQ(handle->read(reinterpret_cast<char*>(out.data()), out.size()).value(), 0);
+
+    // resampled path delivers rate converted count
+    ASSERT_EQ(handle->write(captured.data(), captured.size()).value(), 480);
+    auto taken = handle->read(reinterpret_cast<char*>(out.data()), out.size());
+    ASSERT_TRUE(taken.ok());
+    EXPECT_NEAR(taken.value(), 441, 1);
+}
+
+TEST(ReadHandleTest, AbortMarksHandleDead) {
+    auto handle = makeHandle(ESamples::SIGNED_32_LITTLE_ENDIAN, 48000, 48000);
+    handle->abort();
+    EXPECT_FALSE(handle->isAlive());
+}
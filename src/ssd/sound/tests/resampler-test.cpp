@@ -0,0 +1,159 @@
+// GTest
+#include <gtest/gtest.h>
+
+// json
+#include <nlohmann/json.hpp>
+
+// standard
+#include <cmath>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// laar
+#include <src/ssd/sound/resampler.hpp>
+
+namespace {
+
+    constexpr double amplitude = 1 << 30;
+
+    std::vector<std::int32_t> makeSine(double frequency, std::size_t rate, std::size_t frames, std::size_t channels = 1) {
+        std::vector<std::int32_t> signal(frames * channels);
+        for (std::size_t frame = 0; frame < frames; ++frame) {
+            for (std::size_t channel = 0; channel < channels; ++channel) {
+                // channels differ in sign, so swapped planes would show
+                double sign = (channel % 2) ? -1.0 : 1.0;
+                signal[frame * channels + channel] = static_cast<std::int32_t>(sign * amplitude * std::sin(2 * M_PI * frequency * frame / rate));
+            }
+        }
+        return signal;
+    }
+
+    std::vector<std::int32_t> resample(laar::Resampler& resampler, const std::vector<std::int32_t>& in, std::size_t chunk) {
+        const std::size_t channels = resampler.channels();
+        std::vector<std::int32_t> out;
+        std::vector<std::int32_t> scratch;
+        for (std::size_t offset = 0; offset < in.size() / channels; offset += chunk) {
+            std::size_t frames = std::min(chunk, in.size() / channels - offset);
+            scratch.resize(resampler.maxOutput(frames) * channels);
+            std::size_t produced = resampler.process(in.data() + offset * channels, frames, scratch.data());
+            EXPECT_LE(produced, resampler.maxOutput(frames));
+            out.insert(out.end(), scratch.begin(), scratch.begin() + produced * channels);
+        }
+        return out;
+    }
+
+    // amplitude of given frequency in one channel, by correlation with quadrature pair
+    double measure(const std::vector<std::int32_t>& signal, double frequency, std::size_t rate, std::size_t begin, std::size_t channel = 0, std::size_t channels = 1) {
+        double re = 0, im = 0;
+        std::size_t frames = signal.size() / channels - begin;
+        for (std::size_t frame = 0; frame < frames; ++frame) {
+            double phase = 2 * M_PI * frequency * (begin + frame) / rate;
+            re += signal[(begin + frame) * channels + channel] * std::cos(phase);
+            im += signal[(begin + frame) * channels + channel] * std::sin(phase);
+        }
+        return 2 * std::hypot(re, im) / frames;
+    }
+
+}
+
+TEST(ResamplerTest, SameRatesPassThrough) {
+    auto resampler = laar::Resampler::create(44100, 44100, 2, laar::Resampler::EQuality::MEDIUM);
+    ASSERT_TRUE(resampler.ok()) << resampler.status().message();
+    EXPECT_TRUE(resampler->isPassthrough());
+    EXPECT_EQ(resampler->latency(), 0);
+
+    auto in = makeSine(1000, 44100, 512, 2);
+    EXPECT_EQ(resample(resampler.value(), in, 100), in);
+}
+
+TEST(ResamplerTest, KeepsToneAcrossRates) {
+    for (std::size_t inRate : {16000, 32000, 44100, 48000, 96000}) {
+        for (std::size_t outRate : {44100, 48000}) {
+            if (inRate == outRate) {
+                continue;
+            }
+
+            auto resampler = laar::Resampler::create(inRate, outRate, 2, laar::Resampler::EQuality::MEDIUM);
+            ASSERT_TRUE(resampler.ok()) << resampler.status().message();
+
+            const std::size_t frames = inRate / 2;
+            auto out = resample(resampler.value(), makeSine(1000, inRate, frames, 2), 441);
+
+            // output count follows rate ratio exactly
+            std::size_t produced = out.size() / 2;
+            EXPECT_NEAR(static_cast<double>(produced), static_cast<double>(frames) * outRate / inRate, 1.0) << inRate << " -> " << outRate;
+
+            // skip filter warm-up
+            std::size_t begin = resampler->latency() * 4 * outRate / inRate + 1;
+            EXPECT_NEAR(measure(out, 1000, outRate, begin, 0, 2) / amplitude, 1.0, 0.01) << inRate << " -> " << outRate;
+            EXPECT_NEAR(measure(out, 1000, outRate, begin, 1, 2) / amplitude, 1.0, 0.01) << inRate << " -> " << outRate;
+        }
+    }
+}
+
+TEST(ResamplerTest, SuppressesAliases) {
+    // 30 kHz does not exist at 48 kHz, it must not fold back to 18 kHz
+    auto resampler = laar::Resampler::create(96000, 48000, 1, laar::Resampler::EQuality::MEDIUM);
+    ASSERT_TRUE(resampler.ok());
+
+    auto out = resample(resampler.value(), makeSine(30000, 96000, 48000), 1000);
+    EXPECT_LT(measure(out, 18000, 48000, 100) / amplitude, 1e-3);
+}
+
+TEST(ResamplerTest, ChunkingDoesNotChangeOutput) {
+    auto in = makeSine(440, 48000, 4800, 3);
+
+    auto whole = laar::Resampler::create(48000, 44100, 3, laar::Resampler::EQuality::FAST);
+    auto chunked = laar::Resampler::create(48000, 44100, 3, laar::Resampler::EQuality::FAST);
+    ASSERT_TRUE(whole.ok() && chunked.ok());
+
+    EXPECT_EQ(resample(whole.value(), in, in.size()), resample(chunked.value(), in, 7));
+}
+
+TEST(ResamplerTest, ResetForgetsHistory) {
+    auto resampler = laar::Resampler::create(32000, 48000, 1, laar::Resampler::EQuality::BEST);
+    ASSERT_TRUE(resampler.ok());
+
+    auto in = makeSine(1000, 32000, 1000);
+    auto first = resample(resampler.value(), in, 128);
+    resampler->reset();
+    EXPECT_EQ(resample(resampler.value(), in, 128), first);
+}
+
+TEST(ResamplerTest, MaxInputFitsOutput) {
+    auto resampler = laar::Resampler::create(44100, 48000, 1, laar::Resampler::EQuality::FAST);
+    ASSERT_TRUE(resampler.ok());
+
+    for (std::size_t out = 0; out < 1000; ++out) {
+        EXPECT_LE(resampler->maxOutput(resampler->maxInput(out)), out);
+    }
+}
+
+TEST(ResamplerTest, OddRatiosAreApproximated) {
+    auto resampler = laar::Resampler::create(44101, 48000, 1, laar::Resampler::EQuality::FAST);
+    ASSERT_TRUE(resampler.ok()) << resampler.status().message();
+
+    auto out = resample(resampler.value(), makeSine(1000, 44101, 44101), 512);
+    EXPECT_NEAR(static_cast<double>(out.size()), 48000.0, 2.0);
+}
+
+TEST(ResamplerTest, RejectsBadRates) {
+    EXPECT_FALSE(laar::Resampler::create(0, 48000, 1, laar::Resampler::EQuality::FAST).ok());
+    EXPECT_FALSE(laar::Resampler::create(48000, 1000000, 1, laar::Resampler::EQuality::FAST).ok());
+    EXPECT_FALSE(laar::Resampler::create(48000, 44100, 0, laar::Resampler::EQuality::FAST).ok());
+    EXPECT_TRUE(laar::Resampler::checkRate(96000).ok());
+}
+
+TEST(ResamplerTest, Settings) {
+    auto defaults = laar::Resampler::parseSettings(nlohmann::json::object());
+    ASSERT_TRUE(defaults.ok());
+    EXPECT_EQ(defaults->quality, laar::Resampler::EQuality::MEDIUM);
+
+    auto best = laar::Resampler::parseSettings(nlohmann::json::parse(R"({"resampler": {"quality": "best"}})"));
+    ASSERT_TRUE(best.ok());
+    EXPECT_EQ(best->quality, laar::Resampler::EQuality::BEST);
+
+    EXPECT_FALSE(laar::Resampler::parseSettings(nlohmann::json::parse(R"({"resampler": {"quality": "huge"}})")).ok());
+    EXPECT_FALSE(laar::Resampler::parseSettings(nlohmann::json::parse(R"({"resampler": 1})")).ok());
+}
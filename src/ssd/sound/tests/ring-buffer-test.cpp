@@ -0,0 +1,152 @@
+// GTest
+#include <gtest/gtest.h>
+
+// standard
+#include <thread>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <cstring>
+#include <algorithm>
+
+// laar
+#include <src/ssd/sound/ring-buffer.hpp>
+
+namespace {
+
+    template<typename BufferType>
+    void testWrapAround(BufferType& buffer, std::size_t capacity) {
+        std::vector<char> in(capacity);
+        std::vector<char> out(capacity);
+        std::iota(in.begin(), in.end(), 0);
+
+        // move positions to the middle, so next write wraps
+        ASSERT_EQ(buffer.write(in.data(), capacity / 2 + 1), capacity / 2 + 1);
+        ASSERT_EQ(buffer.read(out.data(), capacity / 2 + 1), capacity / 2 + 1);
+
+        ASSERT_EQ(buffer.writableSize(), capacity);
+        ASSERT_EQ(buffer.write(in.data(), capacity), capacity);
+        ASSERT_EQ(buffer.writableSize(), 0);
+        ASSERT_EQ(buffer.readableSize(), capacity);
+
+        ASSERT_EQ(buffer.peek(out.data(), capacity), capacity);
+        ASSERT_EQ(in, out);
+
+        std::fill(out.begin(), out.end(), 0);
+        ASSERT_EQ(buffer.read(out.data(), capacity), capacity);
+        ASSERT_EQ(in, out);
+        ASSERT_EQ(buffer.readableSize(), 0);
+    }
+
+}
+
+TEST(RingBufferTest, TestWrapAround) {
+    constexpr std::size_t capacity = 100;
+    laar::RingBuffer buffer(capacity);
+    testWrapAround(buffer, capacity);
+}
+
+TEST(RingBufferTest, TestSPSCWrapAround) {
+    constexpr std::size_t capacity = 128;
+    laar::SPSCRingBuffer buffer(capacity);
+    ASSERT_EQ(buffer.capacity(), capacity);
+    testWrapAround(buffer, capacity);
+}
+
+TEST(RingBufferTest, TestSPSCCapacityRounding) {
+    laar::SPSCRingBuffer buffer(1000);
+    EXPECT_EQ(buffer.capacity(), 1024);
+    EXPECT_EQ(buffer.writableSize(), 1024);
+    EXPECT_EQ(buffer.readableSize(), 0);
+}
+
+TEST(RingBufferTest, TestSPSCOverflowAndDrop) {
+    laar::SPSCRingBuffer buffer(16);
+    std::vector<char> in(32, 1);
+
+    EXPECT_EQ(buffer.write(in.data(), in.size()), 16);
+    EXPECT_EQ(buffer.write(in.data(), in.size()), 0);
+    EXPECT_EQ(buffer.drop(10), 10);
+    EXPECT_EQ(buffer.readableSize(), 6);
+    EXPECT_EQ(buffer.drop(100), 6);
+    EXPECT_EQ(buffer.readableSize(), 0);
+}
+
+TEST(RingBufferTest, TestSPSCConcurrentTransfer) {
+    constexpr std::size_t total = 1 << 18;
+    constexpr std::size_t chunk = 333;
+    laar::SPSCRingBuffer buffer(4096);
+
+    std::thread producer([&]() {
+        std::uint32_t next = 0;
+        std::vector<std::uint32_t> data(chunk);
+        while (next < total) {
+            std::size_t count = std::min<std::size_t>(chunk, total - next);
+            std::iota(data.begin(), data.begin() + count, next);
+
+            std::size_t written = 0;
+            while (written < count * sizeof(std::uint32_t)) {
+                written += buffer.write(
+                    reinterpret_cast<const char*>(data.data()) + written, 
+                    count * sizeof(std::uint32_t) - written
+                );
+            }
+            next += count;
+        }
+    });
+
+    bool check = true;
+    std::uint32_t expected = 0;
+    std::vector<std::uint32_t> data(chunk);
+    while (expected < total) {
+        std::size_t available = buffer.readableSize() / sizeof(std::uint32_t);
+        std::size_t count = std::min(available, chunk);
+        if (!count) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        buffer.read(reinterpret_cast<char*>(data.data()), count * sizeof(std::uint32_t));
+        for (std::size_t i = 0; i < count; ++i) {
+            check &= data[i] == expected++;
+        }
+    }
+
+    producer.join();
+    EXPECT_TRUE(check) << "consumer received samples out of order";
+}
+
+TEST(RingBufferTest, TestRegionsWrapAround) {
+    constexpr std::size_t capacity = 64;
+    std::vector<std::unique_ptr<laar::IBuffer>> buffers;
+    buffers.push_back(std::make_unique<laar::RingBuffer>(capacity));
+    buffers.push_back(std::make_unique<laar::SPSCRingBuffer>(capacity));
+
+    for (auto& buffer : buffers) {
+        std::vector<char> in(capacity);
+        std::iota(in.begin(), in.end(), 0);
+        ASSERT_EQ(buffer->write(in.data(), 40), 40);
+        ASSERT_EQ(buffer->drop(40), 40);
+
+        auto writeRegions = buffer->writeRegions(capacity * 2);
+        ASSERT_EQ(writeRegions.first.size(), capacity - 40);
+        ASSERT_EQ(writeRegions.second.size(), 40);
+        std::memcpy(writeRegions.first.data(), in.data(), writeRegions.first.size());
+        std::memcpy(writeRegions.second.data(), in.data() + writeRegions.first.size(), writeRegions.second.size());
+        buffer->commitWrite(writeRegions.size());
+        ASSERT_EQ(buffer->readableSize(), capacity);
+
+        auto readRegions = buffer->readRegions(capacity);
+        ASSERT_EQ(readRegions.size(), capacity);
+        std::vector<char> out(readRegions.first.begin(), readRegions.first.end());
+        out.insert(out.end(), readRegions.second.begin(), readRegions.second.end());
+        ASSERT_EQ(in, out);
+
+        // partial commit releases only part of the regions
+        buffer->commitRead(10);
+        ASSERT_EQ(buffer->readableSize(), capacity - 10);
+        ASSERT_EQ(buffer->readRegions(capacity).first.data()[0], in[10]);
+    }
+}
@@ -3,6 +3,8 @@
 
 // standard
 #include <cmath>
+#include <algorithm>
+#include <vector>
 #include <cstdint>
 #include <iostream>
 #include <type_traits>
@@ -32,8 +34,8 @@ namespace {
     template<typename SampleHolder>
     class ConvertWrapper {
     public:
-        ConvertWrapper(const std::function<std::int32_t(SampleHolder)>& converter)
-        : converter_(std::move(converter))
+        ConvertWrapper(std::int32_t (*converter)(SampleHolder))
+        : converter_(converter)
         {}
 
         std::int32_t operator()(SampleHolder sample) const {
@@ -200,4 +202,182 @@ TEST_F(SampleTest, ResamplingTestF32) {
         max, 
         ConvertWrapper<std::uint32_t>{&laar::convertFromFloat32LE}
     );
-}
\ No newline at end of file
+}
+
+namespace {
+
+    // odd size to cover both vector body and scalar tail of batch converters
+    constexpr std::size_t batchSize = 1003;
+
+    std::vector<std::int32_t> makeBaseSamples() {
+        std::vector<std::int32_t> samples(batchSize);
+        for (std::size_t i = 0; i < batchSize; ++i) {
+            samples[i] = static_cast<std::int32_t>(INT32_MIN + (std::int64_t) i * (((std::int64_t) UINT32_MAX) / (batchSize - 1)));
+        }
+        return samples;
+    }
+
+    template<typename SampleHolder>
+    void testBatchMatchesScalar(
+        SampleHolder (*scalarTo)(std::int32_t),
+        void (*batchTo)(const std::int32_t*, SampleHolder*, std::size_t),
+        std::int32_t (*scalarFrom)(SampleHolder),
+        void (*batchFrom)(const SampleHolder*, std::int32_t*, std::size_t)
+    ) {
+        auto base = makeBaseSamples();
+
+        std::vector<SampleHolder> converted(batchSize);
+        batchTo(base.data(), converted.data(), batchSize);
+        for (std::size_t i = 0; i < batchSize; ++i) {
+            ASSERT_EQ(converted[i], scalarTo(base[i])) << "sample " << i << " differs on conversion to format";
+        }
+
+        std::vector<std::int32_t> restored(batchSize);
+        batchFrom(converted.data(), restored.data(), batchSize);
+        for (std::size_t i = 0; i < batchSize; ++i) {
+            ASSERT_EQ(restored[i], scalarFrom(converted[i])) << "sample " << i << " differs on conversion from format";
+        }
+    }
+
+}
+
+TEST(SoundTest, BatchConversionMatchesScalar) {
+    testBatchMatchesScalar<std::uint8_t>(
+        &laar::convertToUnsigned8, &laar::convertToUnsigned8, &laar::convertFromUnsigned8, &laar::convertFromUnsigned8);
+    testBatchMatchesScalar<std::uint16_t>(
+        &laar::convertToSigned16LE, &laar::convertToSigned16LE, &laar::convertFromSigned16LE, &laar::convertFromSigned16LE);
+    testBatchMatchesScalar<std::uint16_t>(
+        &laar::convertToSigned16BE, &laar::convertToSigned16BE, &laar::convertFromSigned16BE, &laar::convertFromSigned16BE);
+    testBatchMatchesScalar<std::uint32_t>(
+        &laar::convertToSigned32LE, &laar::convertToSigned32LE, &laar::convertFromSigned32LE, &laar::convertFromSigned32LE);
+    testBatchMatchesScalar<std::uint32_t>(
+        &laar::convertToSigned32BE, &laar::convertToSigned32BE, &laar::convertFromSigned32BE, &laar::convertFromSigned32BE);
+    testBatchMatchesScalar<std::uint32_t>(
+        &laar::convertToFloat32LE, &laar::convertToFloat32LE, &laar::convertFromFloat32LE, &laar::convertFromFloat32LE);
+    testBatchMatchesScalar<std::uint32_t>(
+        &laar::convertToFloat32BE, &laar::convertToFloat32BE, &laar::convertFromFloat32BE, &laar::convertFromFloat32BE);
+    testBatchMatchesScalar<laar::PackedSample24>(
+        &laar::convertToSigned24LE, &laar::convertToSigned24LE, &laar::convertFromSigned24LE, &laar::convertFromSigned24LE);
+    testBatchMatchesScalar<laar::PackedSample24>(
+        &laar::convertToSigned24BE, &laar::convertToSigned24BE, &laar::convertFromSigned24BE, &laar::convertFromSigned24BE);
+    testBatchMatchesScalar<std::uint32_t>(
+        &laar::convertToSigned24LsbLE, &laar::convertToSigned24LsbLE, &laar::convertFromSigned24LsbLE, &laar::convertFromSigned24LsbLE);
+    testBatchMatchesScalar<std::uint32_t>(
+        &laar::convertToSigned24LsbBE, &laar::convertToSigned24LsbBE, &laar::convertFromSigned24LsbBE, &laar::convertFromSigned24LsbBE);
+    testBatchMatchesScalar<std::uint8_t>(
+        &laar::convertToALaw, &laar::convertToALaw, &laar::convertFromALaw, &laar::convertFromALaw);
+    testBatchMatchesScalar<std::uint8_t>(
+        &laar::convertToULaw, &laar::convertToULaw, &laar::convertFromULaw, &laar::convertFromULaw);
+}
+
+TEST(SoundTest, FormatRoundTrip) {
+    using ESamples = NSound::NCommon::TStreamConfiguration::TSampleSpecification;
+    auto base = makeBaseSamples();
+
+    // formats able to hold base samples losslessly
+    for (auto format : {ESamples::SIGNED_32_LITTLE_ENDIAN, ESamples::SIGNED_32_BIG_ENDIAN}) {
+        auto converter = laar::SampleConverter::create(format);
+        ASSERT_TRUE(converter.ok());
+        ASSERT_EQ(converter->sampleSize(), laar::getSampleSize(format));
+
+        std::vector<char> converted(batchSize * converter->sampleSize());
+        std::vector<std::int32_t> restored(batchSize);
+        converter->toFormat(base.data(), converted.data(), batchSize);
+        converter->fromFormat(converted.data(), restored.data(), batchSize);
+        EXPECT_EQ(base, restored);
+    }
+
+    // float keeps 24 bits of precision
+    auto converter = laar::SampleConverter::create(ESamples::FLOAT_32_LITTLE_ENDIAN);
+    ASSERT_TRUE(converter.ok());
+
+    std::vector<std::uint32_t> floats(batchSize);
+    std::vector<std::int32_t> restored(batchSize);
+    converter->toFormat(base.data(), floats.data(), batchSize);
+    converter->fromFormat(floats.data(), restored.data(), batchSize);
+    for (std::size_t i = 0; i < batchSize; ++i) {
+        EXPECT_NEAR(base[i], restored[i], 1 << 8);
+    }
+
+    // resolved converter matches named one
+    std::vector<std::uint32_t> expected(batchSize);
+    laar::convertToFloat32LE(base.data(), expected.data(), batchSize);
+    EXPECT_EQ(floats, expected);
+
+    EXPECT_FALSE(laar::SampleConverter::create(ESamples::UNKNOWN).ok());
+}
+
+TEST(SoundTest, UnalignedConversion) {
+    using ESamples = NSound::NCommon::TStreamConfiguration::TSampleSpecification;
+    auto base = makeBaseSamples();
+
+    // pushed frames are viewed right inside received message, so
+    // encoded samples may start at any byte offset
+    for (auto format : {
+        ESamples::SIGNED_16_LITTLE_ENDIAN, ESamples::SIGNED_32_BIG_ENDIAN,
+        ESamples::FLOAT_32_LITTLE_ENDIAN, ESamples::SIGNED_24_LSB_LITTLE_ENDIAN
+    }) {
+        auto converter = laar::SampleConverter::create(format);
+        ASSERT_TRUE(converter.ok());
+
+        std::vector<char> aligned(batchSize * converter->sampleSize());
+        std::vector<char> unaligned(aligned.size() + 1);
+        converter->toFormat(base.data(), aligned.data(), batchSize);
+        converter->toFormat(base.data(), unaligned.data() + 1, batchSize);
+        ASSERT_TRUE(std::equal(aligned.begin(), aligned.end(), unaligned.begin() + 1));
+
+        std::vector<std::int32_t> expected(batchSize);
+        std::vector<std::int32_t> restored(batchSize);
+        converter->fromFormat(aligned.data(), expected.data(), batchSize);
+        converter->fromFormat(unaligned.data() + 1, restored.data(), batchSize);
+        EXPECT_EQ(expected, restored);
+    }
+}
+
+TEST(SoundTest, Signed24RoundTrip) {
+    using ESamples = NSound::NCommon::TStreamConfiguration::TSampleSpecification;
+    auto base = makeBaseSamples();
+
+    for (auto format : {
+        ESamples::SIGNED_24_LITTLE_ENDIAN, ESamples::SIGNED_24_BIG_ENDIAN,
+        ESamples::SIGNED_24_LSB_LITTLE_ENDIAN, ESamples::SIGNED_24_LSB_BIG_ENDIAN
+    }) {
+        auto converter = laar::SampleConverter::create(format);
+        ASSERT_TRUE(converter.ok());
+        ASSERT_EQ(converter->sampleSize(), laar::getSampleSize(format));
+
+        std::vector<char> converted(batchSize * converter->sampleSize());
+        std::vector<std::int32_t> restored(batchSize);
+        converter->toFormat(base.data(), converted.data(), batchSize);
+        converter->fromFormat(converted.data(), restored.data(), batchSize);
+        for (std::size_t i = 0; i < batchSize; ++i) {
+            EXPECT_NEAR(base[i], restored[i], 1 << 8);
+        }
+    }
+
+    // byte order of packed samples
+    laar::PackedSample24 little = laar::convertToSigned24LE(0x12345600);
+    laar::PackedSample24 big = laar::convertToSigned24BE(0x12345600);
+    EXPECT_EQ(little, (laar::PackedSample24{{0x56, 0x34, 0x12}}));
+    EXPECT_EQ(big, (laar::PackedSample24{{0x12, 0x34, 0x56}}));
+    EXPECT_EQ(laar::convertFromSigned24LsbLE(0x00800000), INT32_MIN);
+}
+
+TEST(SoundTest, CompandedRoundTrip) {
+    for (int code = 0; code <= UINT8_MAX; ++code) {
+        // tables are symmetric around sign bit
+        EXPECT_EQ(laar::ALawDecodeTable[code], -laar::ALawDecodeTable[code ^ 0x80]);
+        EXPECT_EQ(laar::ULawDecodeTable[code], -laar::ULawDecodeTable[code ^ 0x80]);
+
+        EXPECT_EQ(laar::convertToALaw(laar::convertFromALaw(code)), code);
+        // mu-law has negative zero, which is encoded back as positive one
+        if (code != 0x7F) {
+            EXPECT_EQ(laar::convertToULaw(laar::convertFromULaw(code)), code);
+        }
+    }
+
+    // silence and full scale
+    EXPECT_EQ(laar::convertFromULaw(laar::convertToULaw(0)), 0);
+    EXPECT_EQ(laar::convertToALaw(INT32_MAX), 0xAA);
+    EXPECT_EQ(laar::convertToULaw(INT32_MIN), 0x00);
+}
@@ -0,0 +1,154 @@
+// GTest
+#include <gtest/gtest.h>
+
+// standard
+#include <memory>
+#include <vector>
+#include <numeric>
+#include <cstdint>
+
+// laar
+#include <src/ssd/sound/resampler.hpp>
+#include <src/ssd/sound/write-handle.hpp>
+#include <src/ssd/sound/buffer-limits.hpp>
+#include <src/ssd/sound/channel-matrix.hpp>
+
+// proto
+#include <protos/common/stream-configuration.pb.h>
+
+namespace {
+
+    using ESamples = NSound::NCommon::TStreamConfiguration::TSampleSpecification;
+
+    // mono S32 stream at 8 kHz, limits are 80..8000 samples
+    std::shared_ptr<laar::WriteHandle> makeHandle(std::uint32_t size) {
+        NSound::NCommon::TStreamConfiguration config;
+        config.set_direction(NSound::NCommon::TStreamConfiguration::PLAYBACK);
+        config.mutable_sample_spec()->set_format(ESamples::SIGNED_32_LITTLE_ENDIAN);
+        config.mutable_sample_spec()->set_sample_rate(8000);
+        config.mutable_sample_spec()->set_channels(1);
+        config.mutable_buffer_config()->set_size(size);
+
+        auto layout = laar::ChannelLayout::byCount(1);
+        auto resampler = laar::Resampler::create(8000, 8000, 1, laar::Resampler::EQuality::FAST);
+        EXPECT_TRUE(layout.ok() && resampler.ok());
+
+        laar::BufferLimits limits{ .minMs = 10, .defaultMs = 100, .maxMs = 1000 };
+        return std::make_shared<laar::WriteHandle>(
+            std::move(config), laar::ChannelMatrix::create(layout.value(), layout.value()),
+            std::move(resampler.value()), limits, nullptr, std::weak_ptr<laar::WriteHandle::IListener>()
+        );
+    }
+
+    std::vector<std::int32_t> ramp(std::size_t size, std::int32_t first) {
+        std::vector<std::int32_t> samples(size);
+        std::iota(samples.begin(), samples.end(), first);
+        return samples;
+    }
+
+}
+
+TEST(WriteHandleTest, BufferFollowsNegotiatedSize) {
+    auto handle = makeHandle(800 * 120);
+    // clamped to 1000 ms of 8 kHz
+    EXPECT_EQ(handle->getBufferConfig().size(), 8000u);
+    EXPECT_EQ(handle->writableSize(), 8000u);
+
+    auto samples = ramp(9000, 0);
+    EXPECT_EQ(handle->write(reinterpret_cast<const char*>(samples.data()), samples.size()).value(), 8000);
+    EXPECT_EQ(handle->writableSize(), 0u);
+}
+
+TEST(WriteHandleTest, ResizeKeepsQueuedSamples) {
+    auto handle = makeHandle(800);
+    auto first = ramp(500, 0);
+    ASSERT_EQ(handle->write(reinterpret_cast<const char*>(first.data()), first.size()).value(), 500);
+
+    // grows storage, old samples are still played first
+    auto resized = handle->resize(handle->getBufferConfig());
+    ASSERT_TRUE(resized.ok());
+    NSound::NCommon::TStreamConfiguration::TBufferConfiguration bigger = resized.value();
+    bigger.set_size(4000);
+    resized = handle->resize(bigger);
+    ASSERT_TRUE(resized.ok()) << resized.status().message();
+    EXPECT_EQ(resized->size(), 4000u);
+    EXPECT_EQ(handle->writableSize(), 3500u);
+
+    auto second = ramp(1000, 500);
+    ASSERT_EQ(handle->write(reinterpret_cast<const char*>(second.data()), second.size()).value(), 1000);
+
+    // audio thread has not moved to new buffer yet
+    EXPECT_FALSE(handle->resize(bigger).ok());
+
+    std::vector<std::int32_t> out(1500);
+    ASSERT_EQ(handle->read(out.data(), 300).value(), 300);
+    ASSERT_EQ(handle->read(out.data() + 300, 1200).value(), 1200);
+    EXPECT_EQ(out, ramp(1500, 0));
+
+    // old buffer is released once reader is done with it
+    EXPECT_EQ(handle->writableSize(), 4000u);
+    EXPECT_TRUE(handle->resize(bigger).ok());
+}
+
+TEST(WriteHandleTest, FlushDropsBothBuffers) {
+    auto handle = makeHandle(800);
+    auto samples = ramp(400, 1);
+    ASSERT_EQ(handle->write(reinterpret_cast<const char*>(samples.data()), samples.size()).value(), 400);
+
+    auto bigger = handle->getBufferConfig();
+    bigger.set_size(8000);
+    ASSERT_TRUE(handle->resize(bigger).ok());
+    ASSERT_EQ(handle->write(reinterpret_cast<const char*>(samples.data()), samples.size()).value(), 400);
+
+    ASSERT_TRUE(handle->flush().ok());
+    std::vector<std::int32_t> out(100, -1);
+    EXPECT_EQ(handle->read(out.data(), out.size()).value(), 0);
+    EXPECT_EQ(out, std::vector<std::int32_t>(100, 0));
+}
+
+TEST(WriteHandleTest, CreditFollowsLimitOverRingSpace) {
+    auto handle = makeHandle(4000);
+    EXPECT_EQ(handle->writableSize(), 4000u);
+
+    // shrinking by half keeps storage, ring still has room for 4096 samples
+    auto smaller = handle->getBufferConfig();
+    smaller.set_size(2000);
+    auto resized = handle->resize(smaller);
+    ASSERT_TRUE(resized.ok()) << resized.status().message();
+    EXPECT_EQ(resized->size(), 2000u);
+    EXPECT_EQ(handle->writableSize(), 2000u);
+
+    auto samples = ramp(1500, 0);
+    ASSERT_EQ(handle->write(reinterpret_cast<const char*>(samples.data()), samples.size()).value(), 1500);
+    EXPECT_EQ(handle->writableSize(), 500u);
+}
+
+TEST(WriteHandleTest, CreditReturnsAsRingDrains) {
+    // limit matches ring capacity exactly
+    auto handle = makeHandle(2048);
+    auto samples = ramp(2048, 0);
+    ASSERT_EQ(handle->write(reinterpret_cast<const char*>(samples.data()), samples.size()).value(), 2048);
+    EXPECT_EQ(handle->writableSize(), 0u);
+
+    std::vector<std::int32_t> out(512);
+    ASSERT_EQ(handle->read(out.data(), out.size()).value(), 512);
+    EXPECT_EQ(handle->writableSize(), 512u);
+}
+
+TEST(WriteHandleTest, PushPastCreditIsClipped) {
+    auto handle = makeHandle(800);
+    auto first = ramp(600, 0);
+    ASSERT_EQ(handle->write(reinterpret_cast<const char*>(first.data()), first.size()).value(), 600);
+    // state poll answering this push reports what is left
+    EXPECT_EQ(handle->writableSize(), 200u);
+
+    auto second = ramp(500, 600);
+    EXPECT_EQ(handle->write(reinterpret_cast<const char*>(second.data()), second.size()).value(), 200);
+    EXPECT_EQ(handle->writableSize(), 0u);
+
+    // only samples within credit were queued
+    std::vector<std::int32_t> out(800);
+    ASSERT_EQ(handle->read(out.data(), out.size()).value(), 800);
+    EXPECT_EQ(out, ramp(800, 0));
+    EXPECT_EQ(handle->writableSize(), 800u);
+}
@@ -4,6 +4,7 @@
 
 // laar
 #include <src/ssd/sound/converter.hpp>
+#include <src/ssd/sound/resampler.hpp>
 #include <src/ssd/sound/ring-buffer.hpp>
 #include <src/ssd/sound/write-handle.hpp>
 #include <src/ssd/sound/interfaces/i-audio-handler.hpp>
@@ -12,7 +13,11 @@
 #include <plog/Log.h>
 
 // std
+#include <span>
 #include <memory>
+#include <cstring>
+#include <algorithm>
+#include <memory_resource>
 
 // proto
 #include <protos/client/stream.pb.h>
@@ -24,26 +29,46 @@ using ESamples =
 
 WriteHandle::WriteHandle(
     NSound::NCommon::TStreamConfiguration config, 
+    ChannelMatrix remix,
+    Resampler resampler,
+    BufferLimits limits,
+    std::shared_ptr<std::pmr::memory_resource> storage,
     std::weak_ptr<IListener> owner
 ) 
     : isAlive_(true)
-    , sampleSize_(getSampleSize(config.sample_spec().format())) // think of config here
+    , flushRequested_(false)
+    , prebuffering_(0)
+    , underrunSamples_(0)
+    , converter_(SampleConverter::create(config.sample_spec().format()))
     , config_(std::move(config))
-    , buffer_(std::make_unique<laar::RingBuffer>(44100 * 4 * 120))
+    , remix_(std::move(remix))
+    , resampler_(std::move(resampler))
+    , limits_(std::move(limits))
+    , storage_(std::move(storage))
+    , limit_(0)
+    , capacity_(0)
+    , reading_(nullptr)
+    , next_(nullptr)
     , owner_(std::move(owner))
-{}
+{
+    *config_.mutable_buffer_config() = limits_.negotiate(config_);
+    // client counts prebuffering in stream samples, buffer is in device ones
+    prebuffering_.store(resampler_.maxOutput(config_.buffer_config().prebuffing_size()), std::memory_order_relaxed);
+
+    limit_ = capacity_ = deviceBytes(config_.buffer_config());
+    buffer_ = std::make_unique<laar::SPSCRingBuffer>(capacity_, storage_);
+    reading_.store(buffer_.get(), std::memory_order_release);
+}
 
 absl::Status WriteHandle::flush() {
-    std::unique_lock<std::mutex> locked(lock_);
-
-    buffer_->drop(buffer_->readableSize());
+    // only consumer is allowed to move read position, so
+    // actual drop happens on the next read
+    flushRequested_.store(true, std::memory_order_release);
     return absl::OkStatus();
 }
 
 void WriteHandle::abort() {
-    std::unique_lock<std::mutex> locked(lock_);
-
-    isAlive_ = false;
+    isAlive_.store(false, std::memory_order_release);
 }
 
 absl::Status WriteHandle::drain() {
@@ -51,100 +76,169 @@ absl::Status WriteHandle::drain() {
 }
 
 absl::StatusOr<int> WriteHandle::read(std::int32_t* dest, std::size_t size) {
-    std::unique_lock<std::mutex> locked(lock_);
-
-    if (buffer_->readableSize() / sizeof (std::int32_t) < config_.buffer_config().prebuffing_size()) {
-        PLOG(plog::warning) << "handle " << this << " is stalled, "
-            << "waiting for " << config_.buffer_config().prebuffing_size() - buffer_->readableSize() / sizeof (std::int32_t)
-            << " samples (prebuffing size is " << config_.buffer_config().prebuffing_size()
-            << "; readable size is " << buffer_->readableSize() / sizeof (std::int32_t) << ")";
-        return absl::DataLossError("handle is stalled, await");
-    } else {
-        config_.mutable_buffer_config()->set_prebuffing_size(0);
-    }
-
-    std::size_t trail = 0;
-    if (size > buffer_->readableSize() / sizeof (std::int32_t)) {
-        trail = size - buffer_->readableSize() / sizeof (std::int32_t);
+    laar::IBuffer* buffer = reading_.load(std::memory_order_relaxed);
+
+    if (flushRequested_.exchange(false, std::memory_order_acq_rel)) {
+        buffer->drop(buffer->readableSize());
+        if (laar::IBuffer* next = next_.load(std::memory_order_acquire); next && next != buffer) {
+            buffer = next;
+            reading_.store(next, std::memory_order_release);
+            buffer->drop(buffer->readableSize());
+        }
     }
 
-    if (trail) {
-        PLOG(plog::warning) << "underrun on handle: " << this
-            << " filling " << trail << " extra samples, avail: " << size - trail;
+    // called on audio thread: no logging here, underruns are reported by writer
+    std::size_t prebuffering = prebuffering_.load(std::memory_order_relaxed);
+    if (prebuffering && buffer->readableSize() / sizeof (std::int32_t) < prebuffering) {
+        // stalled until prebuffering is done
+        std::fill(dest, dest + size, Silence);
+        return absl::StatusOr<int>(0);
+    } else {
+        prebuffering_.store(0, std::memory_order_relaxed);
     }
 
-    for (std::size_t frame = 0; frame < size - trail; ++frame) {
-        buffer_->read((char*) (dest + frame), sizeof(std::int32_t));
+    // buffer holds whole samples only and its size is sample-aligned,
+    // so a period is moved with at most two copies per buffer
+    std::size_t available = 0;
+    while (available < size) {
+        auto regions = buffer->readRegions((size - available) * sizeof(std::int32_t));
+        std::memcpy(dest + available, regions.first.data(), regions.first.size());
+        std::memcpy(reinterpret_cast<char*>(dest + available) + regions.first.size(), regions.second.data(), regions.second.size());
+        buffer->commitRead(regions.size());
+        available += regions.size() / sizeof(std::int32_t);
+
+        laar::IBuffer* next = next_.load(std::memory_order_acquire);
+        if (available == size || !next || next == buffer) {
+            break;
+        }
+        // writer may have filled old buffer right before it moved on
+        if (buffer->readableSize()) {
+            continue;
+        }
+        buffer = next;
+        reading_.store(next, std::memory_order_release);
     }
 
-    for (std::size_t frame = size - trail; frame < size; ++frame) {
-        std::memcpy(dest + frame, &Silence, sizeof(std::int32_t));
+    if (available < size) {
+        underrunSamples_.fetch_add(size - available, std::memory_order_relaxed);
+        std::fill(dest + available, dest + size, Silence);
     }
 
-    return absl::StatusOr<int>(size - trail);
+    return absl::StatusOr<int>(available);
 }
 
 absl::StatusOr<int> WriteHandle::write(const char* src, std::size_t size) {
-    std::unique_lock<std::mutex> locked(lock_);
+    if (!converter_.ok()) {
+        return converter_.status();
+    }
+
+    if (std::size_t underrun = underrunSamples_.exchange(0, std::memory_order_relaxed)) {
+        PLOG(plog::warning) << "underrun on handle: " << this 
+            << "; " << underrun << " samples were filled with silence";
+    }
 
-    std::uint8_t sample8 = 0;
-    std::uint16_t sample16 = 0;
-    std::uint32_t sample32 = 0;
-    std::int32_t converted = 0;
+    // partial frames are never stored, reader relies on channels staying in step
+    const std::size_t channels = remix_.inputs();
+    const std::size_t frames = std::min(size, writableSize()) / channels;
+    std::size_t accepted = frames * channels;
 
-    if (size > buffer_->writableSize()) {
+    if (accepted < size) {
         PLOG(plog::warning) << "overrun on handle: " << this 
-            << "; cutting " << size - buffer_->writableSize() << " samples on stream";
-        size = buffer_->writableSize();
+            << "; cutting " << size - accepted << " samples on stream";
     }
 
-    PLOG(plog::debug) << "receiving bytes in handle: " << size;
-
-    for (std::size_t frame = 0; frame < size; ++frame) {
-        switch (config_.sample_spec().format()) {
-            case ESamples::UNSIGNED_8:
-                std::memcpy(&sample8, src + frame * sizeof(sample8), sizeof(sample8));
-                converted = convertFromUnsigned8(sample8);
-                break;
-            case ESamples::SIGNED_16_BIG_ENDIAN:
-                std::memcpy(&sample16, src + frame * sizeof(sample16), sizeof(sample16));
-                converted = convertFromSigned16BE(sample16);
-                break;
-            case ESamples::SIGNED_16_LITTLE_ENDIAN:
-                std::memcpy(&sample16, src + frame * sizeof(sample16), sizeof(sample16));
-                converted = convertFromSigned16LE(sample16);
-                break;
-            case ESamples::FLOAT_32_BIG_ENDIAN:
-                std::memcpy(&sample32, src + frame * sizeof(sample32), sizeof(sample32));
-                converted = convertFromFloat32BE(sample32);
-                break;
-            case ESamples::FLOAT_32_LITTLE_ENDIAN:
-                std::memcpy(&sample32, src + frame * sizeof(sample32), sizeof(sample32));
-                converted = convertFromFloat32LE(sample32);
-                break;
-            case ESamples::SIGNED_32_BIG_ENDIAN:
-                std::memcpy(&sample32, src + frame * sizeof(sample32), sizeof(sample32));
-                converted = convertFromSigned32BE(sample32);
-                break;
-            case ESamples::SIGNED_32_LITTLE_ENDIAN:
-                std::memcpy(&sample32, src + frame * sizeof(sample32), sizeof(sample32));
-                converted = convertFromSigned32LE(sample32);
-                break;
-            default:
-                std::abort();
+    PLOG(plog::debug) << "receiving samples in handle: " << accepted;
+
+    laar::IBuffer* buffer = writing();
+    if (resampler_.isPassthrough()) {
+        // samples are converted right into buffer storage
+        auto regions = buffer->writeRegions(accepted * sizeof(std::int32_t));
+        std::size_t frame = 0;
+        for (std::span<char> region : {regions.first, regions.second}) {
+            std::size_t samples = region.size() / sizeof(std::int32_t);
+            converter_->fromFormat(src + frame * converter_->sampleSize(), reinterpret_cast<std::int32_t*>(region.data()), samples);
+            frame += samples;
         }
-        buffer_->write((char*) &converted, sizeof(std::uint32_t));
+        buffer->commitWrite(regions.size());
+        return absl::StatusOr<int>(accepted);
     }
 
-    return absl::StatusOr<int>(size);
+    decoded_.resize(accepted);
+    resampled_.resize(resampler_.maxOutput(frames) * channels);
+    converter_->fromFormat(src, decoded_.data(), accepted);
+    std::size_t produced = resampler_.process(decoded_.data(), frames, resampled_.data()) * channels;
+
+    // space was checked against maxOutput, so it all fits
+    auto regions = buffer->writeRegions(produced * sizeof(std::int32_t));
+    std::memcpy(regions.first.data(), resampled_.data(), regions.first.size());
+    std::memcpy(regions.second.data(), reinterpret_cast<const char*>(resampled_.data()) + regions.first.size(), regions.second.size());
+    buffer->commitWrite(regions.size());
+
+    return absl::StatusOr<int>(accepted);
 }
 
 ESampleType WriteHandle::getFormat() const {
     return config_.sample_spec().format();
 }
 
-bool WriteHandle::isAlive() noexcept {
-    std::unique_lock<std::mutex> locked(lock_);
+std::size_t WriteHandle::writableSize() {
+    laar::IBuffer* buffer = writing();
+
+    // samples old buffer still holds count against new limit
+    std::size_t queued = buffer->readableSize();
+    if (buffer != buffer_.get()) {
+        queued += buffer_->readableSize();
+    }
+    std::size_t free = std::min((limit_ > queued) ? limit_ - queued : 0, buffer->writableSize());
 
-    return isAlive_;
+    // buffer holds device frames, client counts stream ones
+    const std::size_t channels = remix_.inputs();
+    return resampler_.maxInput(free / (channels * sizeof(std::int32_t))) * channels;
+}
+
+WriteHandle::TBufferConfiguration WriteHandle::getBufferConfig() const {
+    return config_.buffer_config();
+}
+
+absl::StatusOr<WriteHandle::TBufferConfiguration> WriteHandle::resize(TBufferConfiguration config) {
+    writing();
+    if (resized_) {
+        return absl::UnavailableError("previous resize is not done yet, audio thread still drains old buffer");
+    }
+
+    TStreamConfiguration requested = config_;
+    *requested.mutable_buffer_config() = std::move(config);
+    *config_.mutable_buffer_config() = limits_.negotiate(requested);
+    limit_ = deviceBytes(config_.buffer_config());
+
+    // storage is replaced when it is too small or mostly unused
+    if (limit_ > capacity_ || limit_ < capacity_ / 4) {
+        capacity_ = limit_;
+        resized_ = std::make_unique<laar::SPSCRingBuffer>(capacity_, storage_);
+        next_.store(resized_.get(), std::memory_order_release);
+    }
+
+    return config_.buffer_config();
+}
+
+std::size_t WriteHandle::deviceBytes(const TBufferConfiguration& config) const {
+    const std::size_t channels = remix_.inputs();
+    return resampler_.maxOutput(config.size() / channels) * channels * sizeof(std::int32_t);
+}
+
+laar::IBuffer* WriteHandle::writing() {
+    if (resized_ && reading_.load(std::memory_order_acquire) == resized_.get()) {
+        // reader has moved on, old buffer is not touched anymore
+        next_.store(nullptr, std::memory_order_release);
+        buffer_ = std::move(resized_);
+    }
+    return (resized_) ? resized_.get() : buffer_.get();
+}
+
+const ChannelMatrix& WriteHandle::getChannelMatrix() const noexcept {
+    return remix_;
+}
+
+bool WriteHandle::isAlive() noexcept {
+    return isAlive_.load(std::memory_order_acquire);
 }
\ No newline at end of file
@@ -6,14 +6,20 @@
 
 // laar
 #include <src/ssd/sound/converter.hpp>
+#include <src/ssd/sound/resampler.hpp>
 #include <src/ssd/sound/ring-buffer.hpp>
+#include <src/ssd/sound/buffer-limits.hpp>
+#include <src/ssd/sound/channel-matrix.hpp>
 #include <src/ssd/sound/interfaces/i-audio-handler.hpp>
 
 // RtAudio
 #include <RtAudio.h>
 
 // std
+#include <atomic>
 #include <memory>
+#include <vector>
+#include <memory_resource>
 
 // proto
 #include <protos/client/stream.pb.h>
@@ -24,9 +30,14 @@ namespace laar {
     public:
 
         using TStreamConfiguration = NSound::NCommon::TStreamConfiguration;
+        using TBufferConfiguration = TStreamConfiguration::TBufferConfiguration;
 
         WriteHandle(
             TStreamConfiguration config, 
+            ChannelMatrix remix,
+            Resampler resampler,
+            BufferLimits limits,
+            std::shared_ptr<std::pmr::memory_resource> storage,
             std::weak_ptr<IListener> owner
         );
 
@@ -42,20 +53,51 @@ namespace laar {
         // // getters
         // virtual void setVolume(float volume) const override;
         virtual ESampleType getFormat() const override;
+        virtual std::size_t writableSize() override;
+        virtual TBufferConfiguration getBufferConfig() const override;
+        virtual absl::StatusOr<TBufferConfiguration> resize(TBufferConfiguration config) override;
+        virtual const ChannelMatrix& getChannelMatrix() const noexcept override;
         // condition
         virtual bool isAlive() noexcept override;
 
     private:
-        bool isAlive_;
-        std::size_t sampleSize_;
+        // bytes of device samples negotiated config holds
+        std::size_t deviceBytes(const TBufferConfiguration& config) const;
+        // buffer writer fills, swaps replacement in once reader moved to it
+        IBuffer* writing();
+
+    private:
+        // buffer is SPSC: session thread writes, audio thread reads,
+        // so state shared between them is kept in atomics
+        std::atomic<bool> isAlive_;
+        std::atomic<bool> flushRequested_;
+        std::atomic<std::size_t> prebuffering_;
+        // filled on audio thread, reported on the writing one
+        std::atomic<std::size_t> underrunSamples_;
+        // resolved once for stream format
+        absl::StatusOr<SampleConverter> converter_;
 
         // buffer config
         TStreamConfiguration config_;
+        const ChannelMatrix remix_;
+        // stream rate to device rate, buffer holds device frames
+        Resampler resampler_;
+        std::vector<std::int32_t> decoded_;
+        std::vector<std::int32_t> resampled_;
+
+        // buffer is replaced when it is resized: writer moves to replacement
+        // at once, reader drains old one first, writer frees it afterwards
+        const BufferLimits limits_;
+        std::shared_ptr<std::pmr::memory_resource> storage_;
+        std::size_t limit_;
+        std::size_t capacity_;
+        std::unique_ptr<laar::IBuffer> buffer_;
+        std::unique_ptr<laar::IBuffer> resized_;
+        std::atomic<laar::IBuffer*> reading_;
+        std::atomic<laar::IBuffer*> next_;
 
-        std::mutex lock_;
-        std::unique_ptr<laar::RingBuffer> buffer_;
         std::weak_ptr<IListener> owner_;
-        
+
     };
 
 }
\ No newline at end of file
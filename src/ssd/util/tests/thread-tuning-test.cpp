@@ -0,0 +1,115 @@
+// nlohmann
+#include <nlohmann/json.hpp>
+
+// GTest
+#include <gtest/gtest.h>
+
+// standard
+#include <thread>
+#include <cerrno>
+
+// posix
+#include <sched.h>
+#include <pthread.h>
+
+// laar
+#include <src/ssd/util/thread-tuning.hpp>
+
+using namespace laar;
+
+TEST(ThreadTuningTest, ParseCpuSet) {
+    auto listed = parseCpuSet(nlohmann::json::parse("[3, 1, 3]"));
+    ASSERT_TRUE(listed.ok()) << listed.status().message();
+    EXPECT_EQ(listed.value(), (CpuSet{3, 1}));
+
+    auto ranged = parseCpuSet(nlohmann::json("0-2, 5"));
+    ASSERT_TRUE(ranged.ok()) << ranged.status().message();
+    EXPECT_EQ(ranged.value(), (CpuSet{0, 1, 2, 5}));
+
+    EXPECT_TRUE(parseCpuSet(nlohmann::json("")).value().empty());
+    EXPECT_FALSE(parseCpuSet(nlohmann::json("2-1")).ok());
+    EXPECT_FALSE(parseCpuSet(nlohmann::json("1-2-3")).ok());
+    EXPECT_FALSE(parseCpuSet(nlohmann::json("a")).ok());
+    EXPECT_FALSE(parseCpuSet(nlohmann::json::parse("[-1]")).ok());
+    EXPECT_FALSE(parseCpuSet(nlohmann::json::parse("[\"1\"]")).ok());
+}
+
+TEST(ThreadTuningTest, ParseSettings) {
+    auto settings = ThreadSettings::parse(nlohmann::json::parse(R"({"policy": "fifo", "priority": 70, "cpus": [1]})"));
+    ASSERT_TRUE(settings.ok()) << settings.status().message();
+    EXPECT_EQ(settings->policy, ESchedulingPolicy::FIFO);
+    EXPECT_EQ(settings->priority, 70);
+    EXPECT_EQ(settings->cpus, CpuSet{1});
+    EXPECT_EQ(toString(settings.value()), "policy: fifo, priority: 70, cpus: 1");
+
+    // missing keys keep defaults
+    auto defaulted = ThreadSettings::parse(nlohmann::json::object(), ThreadSettings{
+        .policy = ESchedulingPolicy::RR, .priority = 10, .cpus = {}
+    });
+    ASSERT_TRUE(defaulted.ok());
+    EXPECT_EQ(defaulted->policy, ESchedulingPolicy::RR);
+    EXPECT_EQ(defaulted->priority, 10);
+
+    EXPECT_FALSE(ThreadSettings::parse(nlohmann::json::parse(R"({"policy": "idle"})")).ok());
+    EXPECT_FALSE(ThreadSettings::parse(nlohmann::json::parse(R"({"policy": "fifo", "priority": 0})")).ok());
+    EXPECT_FALSE(ThreadSettings::parse(nlohmann::json::parse("[]")).ok());
+}
+
+TEST(ThreadTuningTest, PinsThreadToAllowedCpu) {
+    cpu_set_t allowed;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+
+    int target = 0;
+    while (!CPU_ISSET(target, &allowed)) {
+        ++target;
+    }
+
+    std::thread worker([&]() {
+        ThreadSettings settings{ .policy = ESchedulingPolicy::OTHER, .priority = 0, .cpus = {target} };
+        absl::Status status = tuneCurrentThread(settings);
+        ASSERT_TRUE(status.ok()) << status.message();
+
+        cpu_set_t pinned;
+        ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(pinned), &pinned), 0);
+        EXPECT_EQ(CPU_COUNT(&pinned), 1);
+        EXPECT_TRUE(CPU_ISSET(target, &pinned));
+    });
+    worker.join();
+}
+
+TEST(ThreadTuningTest, RealtimeFailureLeavesThreadUsable) {
+    std::thread worker([]() {
+        // may or may not be permitted here, either way thread keeps running
+        absl::Status status = tuneCurrentThread(ThreadSettings{ .policy = ESchedulingPolicy::FIFO, .priority = 10, .cpus = {} });
+
+        int policy = 0;
+        sched_param param{};
+        ASSERT_EQ(pthread_getschedparam(pthread_self(), &policy, &param), 0);
+        EXPECT_EQ(policy, (status.ok()) ? SCHED_FIFO : SCHED_OTHER);
+    });
+    worker.join();
+}
+
+TEST(ThreadTuningTest, RawResultIsReportedOffThread) {
+    ThreadSettings settings{ .policy = ESchedulingPolicy::FIFO, .priority = 10, .cpus = {1, 2} };
+    EXPECT_TRUE(toStatus(settings, TuningResult{}).ok());
+
+    absl::Status status = toStatus(settings, TuningResult{ .affinity = EINVAL, .scheduling = EPERM });
+    ASSERT_FALSE(status.ok());
+    EXPECT_NE(status.message().find("pinning to cpus 1,2 failed"), absl::string_view::npos);
+    EXPECT_NE(status.message().find("CAP_SYS_NICE"), absl::string_view::npos);
+}
+
+TEST(ThreadTuningTest, EmptySettingsKeepInheritedScheduling) {
+    std::thread worker([]() {
+        // batch policy needs no privileges, it stands for whatever chrt would set
+        sched_param param{};
+        ASSERT_EQ(pthread_setschedparam(pthread_self(), SCHED_BATCH, &param), 0);
+        EXPECT_TRUE(tuneCurrentThread(ThreadSettings{}).ok());
+
+        int policy = 0;
+        ASSERT_EQ(pthread_getschedparam(pthread_self(), &policy, &param), 0);
+        EXPECT_EQ(policy, SCHED_BATCH);
+    });
+    worker.join();
+}
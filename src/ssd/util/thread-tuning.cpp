@@ -0,0 +1,241 @@
+// laar
+#include <src/ssd/util/thread-tuning.hpp>
+
+// Abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_join.h>
+#include <absl/strings/str_split.h>
+#include <absl/strings/str_format.h>
+#include <absl/strings/string_view.h>
+
+// nlohmann_json
+#include <nlohmann/json.hpp>
+
+// standard
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// posix
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+using namespace laar;
+
+namespace {
+
+    int toNative(ESchedulingPolicy policy) {
+        switch (policy) {
+            case ESchedulingPolicy::FIFO:
+                return SCHED_FIFO;
+            case ESchedulingPolicy::RR:
+                return SCHED_RR;
+            case ESchedulingPolicy::OTHER:
+            default:
+                return SCHED_OTHER;
+        }
+    }
+
+    absl::string_view policyName(ESchedulingPolicy policy) {
+        switch (policy) {
+            case ESchedulingPolicy::FIFO:
+                return "fifo";
+            case ESchedulingPolicy::RR:
+                return "rr";
+            case ESchedulingPolicy::OTHER:
+            default:
+                return "other";
+        }
+    }
+
+    absl::Status addCpu(CpuSet& set, std::int64_t cpu) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return absl::InvalidArgumentError(absl::StrFormat("cpu index out of range: %d", cpu));
+        }
+        if (std::find(set.begin(), set.end(), cpu) == set.end()) {
+            set.push_back(static_cast<int>(cpu));
+        }
+        return absl::OkStatus();
+    }
+
+}
+
+absl::StatusOr<ThreadSettings> ThreadSettings::parse(const nlohmann::json& config) {
+    return parse(config, ThreadSettings());
+}
+
+absl::StatusOr<ThreadSettings> ThreadSettings::parse(const nlohmann::json& config, ThreadSettings defaults) {
+    ThreadSettings settings = std::move(defaults);
+    if (!config.is_object()) {
+        return absl::InvalidArgumentError("thread settings must be an object");
+    }
+
+    try {
+        if (config.contains("policy")) {
+            std::string policy = config["policy"].get<std::string>();
+            if (policy == "other") {
+                settings.policy = ESchedulingPolicy::OTHER;
+            } else if (policy == "fifo") {
+                settings.policy = ESchedulingPolicy::FIFO;
+            } else if (policy == "rr") {
+                settings.policy = ESchedulingPolicy::RR;
+            } else {
+                return absl::InvalidArgumentError(absl::StrFormat("unknown scheduling policy: %s", policy));
+            }
+        }
+
+        settings.priority = config.value<int>("priority", settings.priority);
+    } catch (const nlohmann::json::exception& error) {
+        return absl::InvalidArgumentError(absl::StrFormat("malformed thread settings: %s", error.what()));
+    }
+
+    if (settings.policy != ESchedulingPolicy::OTHER) {
+        int min = sched_get_priority_min(toNative(settings.policy));
+        int max = sched_get_priority_max(toNative(settings.policy));
+        if (settings.priority < min || settings.priority > max) {
+            return absl::InvalidArgumentError(absl::StrFormat(
+                "priority of %s policy must be within [%d, %d], got: %d", policyName(settings.policy), min, max, settings.priority
+            ));
+        }
+    }
+
+    if (config.contains("cpus")) {
+        absl::StatusOr<CpuSet> cpus = parseCpuSet(config["cpus"]);
+        if (!cpus.ok()) {
+            return cpus.status();
+        }
+        settings.cpus = std::move(cpus.value());
+    }
+
+    return settings;
+}
+
+absl::StatusOr<CpuSet> laar::parseCpuSet(const nlohmann::json& cpus) {
+    CpuSet set;
+
+    if (cpus.is_array()) {
+        for (const auto& cpu : cpus) {
+            if (!cpu.is_number_integer()) {
+                return absl::InvalidArgumentError(absl::StrFormat("cpu must be an integer, got: %s", cpu.dump()));
+            }
+            if (absl::Status status = addCpu(set, cpu.get<std::int64_t>()); !status.ok()) {
+                return status;
+            }
+        }
+        return set;
+    }
+
+    if (!cpus.is_string()) {
+        return absl::InvalidArgumentError("cpus must be an array or a list like \"0-2,5\"");
+    }
+
+    // same syntax as taskset --cpu-list
+    for (absl::string_view range : absl::StrSplit(cpus.get<std::string>(), ',', absl::SkipWhitespace())) {
+        std::vector<absl::string_view> bounds = absl::StrSplit(range, '-');
+        std::int64_t first = 0, last = 0;
+        if (bounds.size() > 2
+            || !absl::SimpleAtoi(bounds.front(), &first)
+            || !absl::SimpleAtoi(bounds.back(), &last)
+            || first > last
+        ) {
+            return absl::InvalidArgumentError(absl::StrFormat("malformed cpu range: %s", range));
+        }
+
+        for (std::int64_t cpu = first; cpu <= last; ++cpu) {
+            if (absl::Status status = addCpu(set, cpu); !status.ok()) {
+                return status;
+            }
+        }
+    }
+    return set;
+}
+
+std::string laar::toString(const ThreadSettings& settings) {
+    std::string result = absl::StrCat("policy: ", policyName(settings.policy));
+    if (settings.policy != ESchedulingPolicy::OTHER) {
+        absl::StrAppend(&result, ", priority: ", settings.priority);
+    }
+    absl::StrAppend(&result, ", cpus: ", (settings.cpus.empty()) ? "any" : absl::StrJoin(settings.cpus, ","));
+    return result;
+}
+
+namespace {
+
+    TuningResult applySettings(pthread_t thread, const ThreadSettings& settings) noexcept {
+        TuningResult result;
+
+        if (!settings.cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu : settings.cpus) {
+                CPU_SET(cpu, &set);
+            }
+            result.affinity = pthread_setaffinity_np(thread, sizeof(set), &set);
+        }
+
+        // default policy asks for nothing, so scheduling thread inherited
+        // (from chrt or service manager) is kept as is
+        if (settings.policy == ESchedulingPolicy::OTHER) {
+            return result;
+        }
+
+        sched_param param{};
+        param.sched_priority = settings.priority;
+        result.scheduling = pthread_setschedparam(thread, toNative(settings.policy), &param);
+
+        return result;
+    }
+
+}
+
+absl::Status laar::toStatus(const ThreadSettings& settings, TuningResult result) {
+    std::string failures;
+
+    if (result.affinity) {
+        absl::StrAppend(&failures, "pinning to cpus ", absl::StrJoin(settings.cpus, ","), " failed: ", std::strerror(result.affinity), "; ");
+    }
+
+    if (result.scheduling) {
+        absl::StrAppend(&failures, policyName(settings.policy), " scheduling failed: ", std::strerror(result.scheduling));
+        if (result.scheduling == EPERM) {
+            absl::StrAppend(&failures, " (needs CAP_SYS_NICE or RLIMIT_RTPRIO)");
+        }
+        absl::StrAppend(&failures, "; ");
+    }
+
+    if (!failures.empty()) {
+        return absl::FailedPreconditionError(failures);
+    }
+    return absl::OkStatus();
+}
+
+absl::Status laar::tuneThread(pthread_t thread, const ThreadSettings& settings) {
+    return toStatus(settings, applySettings(thread, settings));
+}
+
+absl::Status laar::tuneCurrentThread(const ThreadSettings& settings) {
+    return tuneThread(pthread_self(), settings);
+}
+
+TuningResult laar::tuneCurrentThreadRaw(const ThreadSettings& settings) noexcept {
+    return applySettings(pthread_self(), settings);
+}
+
+absl::Status laar::lockMemory() {
+    if (mlockall(MCL_CURRENT) != 0) {
+        int error = errno;
+        std::string message = absl::StrCat("locking memory failed: ", std::strerror(error));
+        if (error == ENOMEM || error == EPERM) {
+            absl::StrAppend(&message, " (RLIMIT_MEMLOCK is too low)");
+        }
+        return absl::FailedPreconditionError(message);
+    }
+    return absl::OkStatus();
+}
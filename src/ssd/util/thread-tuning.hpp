@@ -0,0 +1,64 @@
+#pragma once
+
+// Abseil
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+
+// nlohmann_json
+#include <nlohmann/json_fwd.hpp>
+
+// standard
+#include <string>
+#include <vector>
+
+// posix
+#include <pthread.h>
+
+
+namespace laar {
+
+    // CPUs a thread may run on, empty set leaves placement to the scheduler
+    using CpuSet = std::vector<int>;
+
+    enum class ESchedulingPolicy {
+        OTHER,
+        FIFO,
+        RR
+    };
+
+    // Scheduling and placement of one kind of daemon threads.
+    struct ThreadSettings {
+        ESchedulingPolicy policy = ESchedulingPolicy::OTHER;
+        // realtime priority, used by FIFO and RR only
+        int priority = 0;
+        CpuSet cpus;
+
+        // {"policy": "other" | "fifo" | "rr", "priority": 1..99, "cpus": [0, 1] or "0-1,3"},
+        // missing keys keep values of defaults
+        static absl::StatusOr<ThreadSettings> parse(const nlohmann::json& config);
+        static absl::StatusOr<ThreadSettings> parse(const nlohmann::json& config, ThreadSettings defaults);
+    };
+
+    absl::StatusOr<CpuSet> parseCpuSet(const nlohmann::json& cpus);
+    std::string toString(const ThreadSettings& settings);
+
+    // Error codes of each tuning step, zero if it succeeded or was not needed.
+    struct TuningResult {
+        int affinity = 0;
+        int scheduling = 0;
+    };
+
+    // Failures leave thread as it was, so callers may go on with default scheduling.
+    // Affinity and policy are applied independently, status reports both;
+    // "other" policy and empty cpu set keep what thread inherited.
+    absl::Status tuneThread(pthread_t thread, const ThreadSettings& settings);
+    absl::Status tuneCurrentThread(const ThreadSettings& settings);
+
+    // real-time safe variant: no allocations, result is turned into status off real-time path
+    TuningResult tuneCurrentThreadRaw(const ThreadSettings& settings) noexcept;
+    absl::Status toStatus(const ThreadSettings& settings, TuningResult result);
+
+    // pins pages mapped so far, call once working set is allocated
+    absl::Status lockMemory();
+
+}